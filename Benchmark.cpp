@@ -0,0 +1,1448 @@
+/**
+ * @file Benchmark.cpp
+ * @brief Micro-benchmarks for the password keeper internals.
+ *
+ * Usage: PasswordManagerBenchmark <benchmark> [entries]
+ * Build with -DCMAKE_BUILD_TYPE=Release for meaningful numbers.
+ */
+
+#include "DataStorage.h"
+#include "ConcurrentKeeper.h"
+#include "TextFold.h"
+#include "KeyRotation.h"
+#include "PerfectHash.h"
+#include "StrengthEstimator.h"
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <numeric>
+#include <random>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * @brief Generates a synthetic vault with realistic field distributions.
+ *
+ * There are few categories and a moderate number of websites, so secondary
+ * sort keys are exercised, and names share common prefixes.
+ *
+ * @param count Number of entries to generate.
+ * @param seed Seed of the generator, so runs are reproducible.
+ * @return The generated entries.
+ */
+
+vector<KeyData> makeVault(size_t count, uint64_t seed = 42) {
+    static const char* categories[] = {"Work", "Personal", "Banking", "Social", "Shopping", "Email",
+                                       "Gaming", "Travel", "Utilities", "Streaming", "Dev", "Health"};
+    static const char* prefixes[] = {"account", "Account", "login", "my", "The", "user", "admin", ""};
+    mt19937_64 random(seed);
+    auto pick = [&random](size_t bound) { return static_cast<size_t>(random() % bound); };
+    auto word = [&](size_t minLength, size_t maxLength) {
+        string text;
+        size_t length = minLength + pick(maxLength - minLength + 1);
+        for (size_t i = 0; i < length; i++) {
+            text += static_cast<char>('a' + pick(26));
+        }
+        return text;
+    };
+
+    vector<string> sites;
+    for (size_t i = 0; i < 1000; i++) {
+        sites.push_back(word(3, 10) + ".com");
+    }
+
+    vector<KeyData> vault(count);
+    for (size_t i = 0; i < count; i++) {
+        KeyData& entry = vault[i];
+        entry.name = string(prefixes[pick(8)]) + word(4, 12);
+        entry.password = word(12, 20);
+        entry.category = categories[pick(12)];
+        entry.website = (pick(2) ? "www." : "") + sites[pick(sites.size())];
+        entry.login = word(5, 10) + "@example.com";
+        entry.id = i + 1;
+    }
+    return vault;
+}
+
+/**
+ * @brief Folds the searchable columns of a vault the way PasswordKeeper does when indexing.
+ * @param vault The entries to fold.
+ * @return The folded columns, index-aligned with the vault.
+ */
+
+vector<SearchColumns> foldColumns(const vector<KeyData>& vault) {
+    vector<SearchColumns> columns(vault.size());
+    for (size_t i = 0; i < vault.size(); i++) {
+        columns[i].name = foldForSearch(vault[i].name);
+        columns[i].category = foldForSearch(vault[i].category);
+        columns[i].website = foldForSearch(vault[i].website);
+        columns[i].login = foldForSearch(vault[i].login);
+        columns[i].host = normalizeWebsite(vault[i].website);
+    }
+    return columns;
+}
+
+/**
+ * @brief Runs a function and returns its wall time in milliseconds.
+ */
+
+double timeMs(const function<void()>& body) {
+    auto start = chrono::steady_clock::now();
+    body();
+    return chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+}
+
+/**
+ * @brief Prints one result line of a benchmark.
+ */
+
+void report(const string& label, double milliseconds, const string& extra = "") {
+    cout << "  " << left << setw(44) << label << right << setw(10) << fixed << setprecision(2)
+         << milliseconds << " ms" << (extra.empty() ? "" : "  " + extra) << endl;
+}
+
+/**
+ * @brief Set by a benchmark whose correctness or quality check fails, so the run exits non-zero.
+ */
+
+bool benchmarkFailed = false;
+
+// SORT BENCHMARK
+/**
+ * @brief Compares a multi-key std::sort of KeyData objects with the packed-prefix index sort.
+ * @param count Number of entries.
+ */
+
+void benchmarkSort(size_t count) {
+    vector<KeyData> vault = makeVault(count);
+    vector<SearchColumns> columns;
+    double foldTime = timeMs([&] { columns = foldColumns(vault); });
+
+    vector<SortKey> keys;
+    parseSortKeys("category,website,name", keys);
+
+    cout << "sort: " << count << " entries, keys category,website,name" << endl;
+    report("fold columns (paid at load time)", foldTime);
+
+    vector<KeyData> copy = vault;
+    double baseline = timeMs([&] {
+        sort(copy.begin(), copy.end(), [](const KeyData& a, const KeyData& b) {
+            if (a.category != b.category) return a.category < b.category;
+            if (a.website != b.website) return a.website < b.website;
+            return a.name < b.name;
+        });
+    });
+    report("std::sort on vector<KeyData>", baseline);
+
+    vector<size_t> order;
+    double packed = timeMs([&] { order = sortedOrder(columns, keys); });
+    report("sortedOrder with packed prefixes", packed, to_string(baseline / packed).substr(0, 4) + "x");
+
+    double top = timeMs([&] { order = topOrder(columns, keys, 20); });
+    report("topOrder, first 20 entries", top, to_string(baseline / top).substr(0, 6) + "x");
+
+    // Names that only differ after the packed prefix, under mixed directions, against a plain full-string sort
+    mt19937_64 random(11);
+    for (size_t i = 0; i < vault.size(); i++) {
+        vault[i].name = "accounta" + string(1, static_cast<char>('a' + random() % 3)) + to_string(random() % 50);
+        vault[i].category = random() % 2 ? "personalbanking" : "personalbankingz";
+        vault[i].modified = static_cast<int64_t>(random() % 4);
+    }
+    columns = foldColumns(vault);
+    for (size_t i = 0; i < vault.size(); i++) {
+        columns[i].modified = vault[i].modified;
+    }
+    WorkerPool pool(4);
+    for (const string spec : {"name,category:desc,website", "category:desc,name,login:desc",
+                              "modified:desc,name:desc,category"}) {
+        parseSortKeys(spec, keys);
+        vector<size_t> expected(columns.size());
+        iota(expected.begin(), expected.end(), 0);
+        stable_sort(expected.begin(), expected.end(), [&](size_t a, size_t b) {
+            for (const SortKey& key : keys) {
+                int order;
+                if (key.field == SortField::Modified) {
+                    order = columns[a].modified < columns[b].modified ? -1 : columns[a].modified > columns[b].modified;
+                } else if (key.field == SortField::Name) {
+                    order = columns[a].name.compare(columns[b].name);
+                } else if (key.field == SortField::Category) {
+                    order = columns[a].category.compare(columns[b].category);
+                } else if (key.field == SortField::Website) {
+                    order = columns[a].host.compare(columns[b].host);
+                } else {
+                    order = columns[a].login.compare(columns[b].login);
+                }
+                if (order != 0) {
+                    return (order < 0) != key.descending;
+                }
+            }
+            return false;
+        });
+        vector<size_t> top = topOrder(columns, keys, 100);
+        bool correct = sortedOrder(columns, keys) == expected && sortedOrder(columns, keys, &pool) == expected &&
+                       equal(top.begin(), top.end(), expected.begin());
+        benchmarkFailed = benchmarkFailed || !correct;
+        cout << "  order check, long shared prefixes, " << spec << ": " << (correct ? "OK" : "WRONG ORDER") << endl;
+    }
+}
+
+// PARALLEL SORT BENCHMARK
+/**
+ * @brief Compares std::sort on vector<KeyData> with the index sort at 1, 2, 4 and 8 threads.
+ * @param count Number of entries.
+ */
+
+void benchmarkParallelSort(size_t count) {
+    vector<KeyData> vault = makeVault(count);
+    vector<SearchColumns> columns = foldColumns(vault);
+    vector<SortKey> keys;
+    parseSortKeys("category,website,name", keys);
+
+    cout << "parallel-sort: " << count << " entries, keys category,website,name, "
+         << thread::hardware_concurrency() << " hardware threads" << endl;
+
+    double baseline = timeMs([&] {
+        sort(vault.begin(), vault.end(), [](const KeyData& a, const KeyData& b) {
+            if (a.category != b.category) return a.category < b.category;
+            if (a.website != b.website) return a.website < b.website;
+            return a.name < b.name;
+        });
+    });
+    report("std::sort on vector<KeyData>", baseline);
+
+    vector<size_t> serial;
+    double serialTime = 0;
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        WorkerPool pool(threads);
+        vector<size_t> order;
+        double elapsed = timeMs([&] { order = sortedOrder(columns, keys, &pool); });
+        if (threads == 1) {
+            serial = order;
+            serialTime = elapsed;
+        }
+        report("sortedOrder, " + to_string(threads) + " thread(s)", elapsed,
+               to_string(baseline / elapsed).substr(0, 4) + "x, " +
+               to_string(serialTime / elapsed).substr(0, 4) + "x over 1 thread" + (order == serial ? "" : "  MISMATCH"));
+        benchmarkFailed = benchmarkFailed || order != serial;
+    }
+}
+
+/**
+ * @brief Formats a throughput in GB/s.
+ */
+
+string gigabytesPerSecond(size_t bytes, double milliseconds) {
+    ostringstream text;
+    text << fixed << setprecision(2) << bytes / (milliseconds * 1e6) << " GB/s";
+    return text.str();
+}
+
+// CIPHER BENCHMARK
+/**
+ * @brief Measures ChaCha20, Poly1305 and the AEAD per kernel, then vault encryption.
+ * @param count Number of vault entries for the per-record part.
+ */
+
+void benchmarkCipher(size_t count) {
+    const size_t bufferSize = 64 << 20;
+    vector<uint8_t> buffer(bufferSize + ChaCha20Poly1305::tagSize);
+    uint8_t key[ChaCha20Poly1305::keySize];
+    uint8_t nonce[ChaCha20Poly1305::nonceSize];
+    fillRandom(buffer.data(), bufferSize);
+    fillRandom(key, sizeof(key));
+    fillRandom(nonce, sizeof(nonce));
+    ChaCha20Poly1305 cipher(key);
+
+    cout << "cipher: " << (bufferSize >> 20) << " MiB buffer, default kernel "
+         << ChaCha20Poly1305::kernelName() << endl;
+
+    string defaultKernel = ChaCha20Poly1305::kernelName();
+    for (const string& kernel : ChaCha20Poly1305::availableKernels()) {
+        ChaCha20Poly1305::selectKernel(kernel);
+        double elapsed = timeMs([&] { cipher.xorKeystream(nonce, 1, buffer.data(), buffer.data(), bufferSize); });
+        report("chacha20 " + kernel, elapsed, gigabytesPerSecond(bufferSize, elapsed));
+    }
+    ChaCha20Poly1305::selectKernel(defaultKernel);
+
+    uint8_t tag[ChaCha20Poly1305::tagSize];
+    double macTime = timeMs([&] { poly1305(key, buffer.data(), bufferSize, tag); });
+    report("poly1305", macTime, gigabytesPerSecond(bufferSize, macTime));
+
+    double sealTime = timeMs([&] { cipher.seal(nonce, buffer.data(), bufferSize, nullptr, 0, buffer.data()); });
+    report("chacha20-poly1305 seal " + defaultKernel, sealTime, gigabytesPerSecond(bufferSize, sealTime));
+
+    vector<KeyData> vault = makeVault(count);
+    size_t bytes = 0;
+    for (const KeyData& entry : vault) {
+        bytes += entry.password.size();
+    }
+    double vaultTime = timeMs([&] {
+        for (KeyData& entry : vault) {
+            entry.password = encryptText(cipher, entry.password, entry.name);
+        }
+    });
+    report("encrypt " + to_string(count) + " vault passwords", vaultTime,
+           to_string(static_cast<size_t>(count / (vaultTime / 1000))) + " entries/s, " +
+           gigabytesPerSecond(bytes, vaultTime));
+}
+
+// PARALLEL CIPHER BENCHMARK
+/**
+ * @brief Encrypts and decrypts a vault in place on a worker pool of 1, 2, 4 and 8 threads.
+ * @param count Number of entries.
+ */
+
+void benchmarkParallelCipher(size_t count) {
+    const size_t chunk = 256;
+    vector<KeyData> original = makeVault(count);
+    size_t bytes = 0;
+    for (const KeyData& entry : original) {
+        bytes += entry.password.size();
+    }
+    uint8_t key[ChaCha20Poly1305::keySize];
+    fillRandom(key, sizeof(key));
+    ChaCha20Poly1305 cipher(key);
+
+    cout << "parallel-cipher: " << count << " entries, chunks of " << chunk << ", kernel "
+         << ChaCha20Poly1305::kernelName() << ", " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+    auto rate = [&](double elapsed) {
+        return to_string(static_cast<size_t>(count / (elapsed / 1000))) + " entries/s, " +
+               gigabytesPerSecond(bytes, elapsed);
+    };
+
+    for (unsigned threads : {1u, 2u, 4u, 8u}) {
+        WorkerPool pool(threads);
+        vector<KeyData> vault = original;
+        atomic<size_t> failed{0};
+
+        double encryptTime = timeMs([&] {
+            pool.parallelFor(vault.size(), chunk, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    encryptTextInPlace(cipher, vault[i].password, vault[i].name);
+                }
+            });
+        });
+        double decryptTime = timeMs([&] {
+            pool.parallelFor(vault.size(), chunk, [&](size_t begin, size_t end) {
+                for (size_t i = begin; i < end; i++) {
+                    if (!decryptTextInPlace(cipher, vault[i].password, vault[i].name)) {
+                        failed++;
+                    }
+                }
+            });
+        });
+
+        bool roundTrip = failed == 0;
+        for (size_t i = 0; roundTrip && i < vault.size(); i++) {
+            roundTrip = vault[i].password == original[i].password;
+        }
+        report("encrypt, " + to_string(threads) + " thread(s)", encryptTime, rate(encryptTime));
+        report("decrypt, " + to_string(threads) + " thread(s)", decryptTime,
+               rate(decryptTime) + (roundTrip ? "" : "  MISMATCH"));
+    }
+}
+
+// KDF BENCHMARK
+/**
+ * @brief Measures SHA-256 and PBKDF2 per kernel, calibration accuracy, and unlocking versus using the cached key.
+ * @param count Number of passwords decrypted with the cached session key.
+ */
+
+void benchmarkKdf(size_t count) {
+    const size_t bufferSize = 64 << 20;
+    const uint32_t iterations = 200000;
+    vector<uint8_t> buffer(bufferSize);
+    uint8_t salt[KdfParameters::saltSize];
+    uint8_t digest[Sha256::digestSize];
+    LockedKey key;
+    fillRandom(buffer.data(), bufferSize);
+    fillRandom(salt, sizeof(salt));
+
+    cout << "kdf: default kernel " << Sha256::kernelName() << ", key page "
+         << (key.isLocked() ? "locked" : "NOT locked") << " in RAM" << endl;
+
+    string defaultKernel = Sha256::kernelName();
+    for (const string& kernel : Sha256::availableKernels()) {
+        Sha256::selectKernel(kernel);
+        double hashTime = timeMs([&] { sha256(buffer.data(), bufferSize, digest); });
+        report("sha256 " + kernel, hashTime, gigabytesPerSecond(bufferSize, hashTime));
+        double deriveTime = timeMs([&] {
+            pbkdf2HmacSha256("correct horse", salt, sizeof(salt), iterations, key.data(), LockedKey::size);
+        });
+        report("pbkdf2-sha256 " + kernel + ", " + to_string(iterations) + " iterations", deriveTime,
+               to_string(static_cast<size_t>(iterations / (deriveTime / 1000))) + " iterations/s");
+    }
+    Sha256::selectKernel(defaultKernel);
+
+    for (double target : {100.0, 250.0, 500.0, 1000.0}) {
+        uint32_t calibrated = 0;
+        double calibrateTime = timeMs([&] { calibrated = calibrateIterations(target); });
+        double deriveTime = timeMs([&] {
+            pbkdf2HmacSha256("correct horse", salt, sizeof(salt), calibrated, key.data(), LockedKey::size);
+        });
+        report("unlock, target " + to_string(static_cast<int>(target)) + " ms", deriveTime,
+               to_string(calibrated) + " iterations, calibrated in " + to_string(static_cast<int>(calibrateTime)) +
+               " ms");
+    }
+
+    // With the session key cached, each operation only pays for the cipher
+    ChaCha20Poly1305 cipher(key.data());
+    vector<KeyData> vault = makeVault(count);
+    for (KeyData& entry : vault) {
+        encryptTextInPlace(cipher, entry.password, entry.name);
+    }
+    string plaintext;
+    double revealTime = timeMs([&] {
+        for (const KeyData& entry : vault) {
+            ChaCha20Poly1305 sessionCipher(key.data());
+            decryptText(sessionCipher, entry.password, entry.name, plaintext);
+        }
+    });
+    report("reveal " + to_string(count) + " passwords, cached key", revealTime,
+           to_string(static_cast<size_t>(revealTime * 1e6 / count)) + " ns per password");
+}
+
+// REKEY BENCHMARK
+/**
+ * @brief Rotates the key of an encrypted vault file with several block sizes.
+ * @param count Number of entries in the vault file.
+ */
+
+void benchmarkRekey(size_t count) {
+    const string path = "PasswordManagerBenchmark.vault";
+    uint8_t firstKey[ChaCha20Poly1305::keySize];
+    uint8_t secondKey[ChaCha20Poly1305::keySize];
+    fillRandom(firstKey, sizeof(firstKey));
+    fillRandom(secondKey, sizeof(secondKey));
+    ChaCha20Poly1305 first(firstKey), second(secondKey);
+
+    vector<KeyData> vault = makeVault(count);
+    {
+        ofstream output(path);
+        output << vaultFormatLine << '\n';
+        for (KeyData& entry : vault) {
+            encryptTextInPlace(first, entry.password, entry.name);
+            output << "Name: " << entry.name << '\n' << encryptedPasswordField << entry.password << '\n'
+                   << "Category: " << entry.category << '\n' << "Website: " << entry.website << '\n'
+                   << "Login: " << entry.login << '\n' << "----------\n";
+        }
+    }
+    vault.clear();
+    vault.shrink_to_fit();
+
+    ifstream sized(path, ios::binary | ios::ate);
+    size_t bytes = static_cast<size_t>(sized.tellg());
+    sized.close();
+    WorkerPool pool;
+    cout << "rekey: " << count << " entries, " << (bytes >> 20) << " MiB vault file, " << pool.size()
+         << " thread(s)" << endl;
+
+    // Alternate the direction so every run starts from a vault under the key it rotates from
+    bool forward = true;
+    for (size_t blockEntries : {64, 1024, 16384}) {
+        bool ok = false;
+        double elapsed = timeMs([&] {
+            ok = forward ? rotateVaultKey(path, first, second, {}, pool, blockEntries)
+                         : rotateVaultKey(path, second, first, {}, pool, blockEntries);
+        });
+        forward = !forward;
+        report("rotate, blocks of " + to_string(blockEntries) + " entries", elapsed,
+               to_string(static_cast<size_t>(count / (elapsed / 1000))) + " entries/s, " +
+               gigabytesPerSecond(bytes, elapsed) + (ok ? "" : "  FAILED"));
+    }
+    remove(path.c_str());
+}
+
+// BLIND INDEX BENCHMARK
+/**
+ * @brief Compares blind-index lookups with decrypting every encrypted name to search it.
+ * @param count Number of entries.
+ */
+
+void benchmarkBlindIndex(size_t count) {
+    vector<KeyData> vault = makeVault(count);
+    vector<SearchColumns> columns = foldColumns(vault);
+    uint8_t key[LockedKey::size];
+    fillRandom(key, sizeof(key));
+    ChaCha20Poly1305 cipher(key);
+
+    // The names as they would be stored if they were encrypted at rest
+    vector<string> encryptedNames(count);
+    for (size_t i = 0; i < count; i++) {
+        encryptedNames[i] = encryptText(cipher, vault[i].name, "");
+    }
+
+    BlindIndex index;
+    index.setKey(key);
+    double buildTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            index.insert(vault[i].id, columns[i].name, columns[i].host, columns[i].login);
+        }
+    });
+
+    cout << "blind-index: " << count << " entries, queries for 100 existing names" << endl;
+    report("build index (name, website, login)", buildTime,
+           to_string(static_cast<size_t>(count / (buildTime / 1000))) + " entries/s");
+
+    const size_t queries = 100;
+    size_t scanMatches = 0, exactMatches = 0, wordMatches = 0;
+    double scanTime = timeMs([&] {
+        string name;
+        for (size_t q = 0; q < 10; q++) {
+            const string& wanted = columns[q * (count / 10)].name;
+            for (const string& encrypted : encryptedNames) {
+                if (decryptText(cipher, encrypted, "", name) && foldForSearch(name) == wanted) {
+                    scanMatches++;
+                }
+            }
+        }
+    });
+    report("decrypt and scan, per query", scanTime / 10);
+
+    double exactTime = timeMs([&] {
+        for (size_t q = 0; q < queries; q++) {
+            exactMatches += index.findExact(BlindField::Name, columns[q * (count / queries)].name).size();
+        }
+    });
+    report("blind exact lookup, 100 queries", exactTime,
+           to_string(static_cast<size_t>(scanTime / 10 / (exactTime / queries))) + "x faster per query");
+
+    double wordTime = timeMs([&] {
+        for (size_t q = 0; q < queries; q++) {
+            wordMatches += index.findWords(BlindField::Login, columns[q * (count / queries)].login).size();
+        }
+    });
+    report("blind word lookup (login words), 100 queries", wordTime,
+           to_string(wordMatches) + " matches for " + to_string(queries) + " queries");
+    if (exactMatches < queries || scanMatches < 10) {
+        cout << "  MISMATCH: an indexed name was not found" << endl;
+    }
+}
+
+// SAVE BENCHMARK
+/**
+ * @brief Compares saving every entry with saving after a single change, and repeats encryption.
+ * @param count Number of entries in the vault file.
+ */
+
+void benchmarkSave(size_t count) {
+    const string path = "PasswordManagerBenchmark.vault";
+    {
+        ofstream output(path);
+        for (const KeyData& entry : makeVault(count)) {
+            output << "Name: " << entry.name << '\n' << "Password: " << entry.password << '\n'
+                   << "Category: " << entry.category << '\n' << "Website: " << entry.website << '\n'
+                   << "Login: " << entry.login << '\n' << "----------\n";
+        }
+    }
+
+    PasswordKeeper keeper(path);
+    keeper.unlock("benchmark");
+    cout << "save: " << count << " entries" << endl;
+
+    double encryptTime = timeMs([&] { keeper.encryptAllPasswords(); });
+    report("encrypt all and save", encryptTime);
+    double againTime = timeMs([&] { keeper.encryptAllPasswords(); });
+    report("encrypt all again (nothing to do)", againTime, to_string(encryptTime / againTime).substr(0, 7) + "x");
+
+    // A new master password re-seals every entry, so the next save formats all of them
+    keeper.changeMasterPassword("benchmark", "benchmark again");
+    double fullTime = timeMs([&] { keeper.savePasswordsToFile(); });
+    report("save, every entry dirty", fullTime);
+
+    string name = keeper.getSortedPasswords({}, 0, 1).front().name;
+    keeper.editPassword(name, "changed");
+    double oneTime = timeMs([&] { keeper.savePasswordsToFile(); });
+    report("save, one entry dirty", oneTime, to_string(fullTime / oneTime).substr(0, 4) + "x");
+
+    double cleanTime = timeMs([&] { keeper.savePasswordsToFile(); });
+    report("save, nothing dirty", cleanTime);
+    remove(path.c_str());
+}
+
+// SECRET ARENA BENCHMARK
+/**
+ * @brief Compares keeping passwords in the secure arena with heap strings that are wiped by hand.
+ * @param count Number of passwords.
+ */
+
+void benchmarkSecretArena(size_t count) {
+    vector<KeyData> vault = makeVault(count);
+    vector<string> source;
+    source.reserve(count);
+    for (const KeyData& entry : vault) {
+        source.emplace_back(entry.password);
+    }
+    vault.clear();
+    cout << "secret-arena: " << count << " passwords, 3 rounds of copy and release" << endl;
+
+    // Short strings stay in the object itself, wherever that is; secrets need a buffer of their own
+    double inlineTime = timeMs([&] {
+        for (int round = 0; round < 3; round++) {
+            vector<string> copies(source.begin(), source.end());
+            for (string& copy : copies) {
+                secureZero(copy.data(), copy.size());
+            }
+        }
+    });
+    report("std::string, short ones inline, wiped", inlineTime);
+
+    double heapTime = timeMs([&] {
+        for (int round = 0; round < 3; round++) {
+            vector<string> copies(count);
+            for (size_t i = 0; i < count; i++) {
+                copies[i].reserve(32);
+                copies[i] = source[i];
+            }
+            for (string& copy : copies) {
+                secureZero(copy.data(), copy.size());
+            }
+        }
+    });
+    report("std::string on the heap, wiped", heapTime);
+
+    double arenaTime = timeMs([&] {
+        for (int round = 0; round < 3; round++) {
+            vector<SecretText> copies(source.begin(), source.end());
+        }
+    });
+    report("SecretText in the secure arena", arenaTime,
+           to_string(heapTime / arenaTime).substr(0, 4) + "x faster than the heap");
+
+    SecureArena& arena = SecureArena::instance();
+    vector<SecretText> kept(source.begin(), source.end());
+    cout << "  arena: " << (arena.mappedBytes() >> 10) << " KiB of pages for " << count << " passwords, "
+         << (arena.isLocked() ? "locked" : "NOT locked") << " in RAM" << endl;
+}
+
+// GENERATE BENCHMARK
+/**
+ * @brief Compares the seeded rand() generator with the CSPRNG generator, one at a time and in bulk.
+ * @param count Number of passwords of 16 characters.
+ */
+
+void benchmarkGenerate(size_t count) {
+    const string alphabet = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz!@#$%^&*()_+-=[]{}|;:,.<>?/";
+    const size_t length = 16;
+    cout << "generate: " << count << " passwords of " << length << " characters from " << alphabet.size()
+         << " symbols" << endl;
+    auto rate = [&](double milliseconds) {
+        return to_string(static_cast<size_t>(count / (milliseconds / 1000))) + " passwords/s";
+    };
+
+    // What generatePassword used to do, reseeding from the clock on every call
+    size_t checksum = 0;
+    double randTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            string password = "";
+            srand(time(nullptr));
+            for (size_t j = 0; j < length; j++) {
+                password += alphabet[rand() % alphabet.size()];
+            }
+            checksum += password[0];
+        }
+    });
+    report("srand(time) + rand() %, one at a time", randTime, rate(randTime));
+
+    SecureRandom random;
+    PasswordGenerator generator(alphabet);
+    double singleTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            checksum += generator.generate(random, length).data()[0];
+        }
+    });
+    report("CSPRNG, one at a time", singleTime, rate(singleTime));
+
+    SecretText batch;
+    double bulkTime = timeMs([&] { batch = generator.generateBulk(random, count, length); });
+    report("CSPRNG, bulk into one buffer", bulkTime,
+           rate(bulkTime) + ", " + to_string(bulkTime * 1e6 / count).substr(0, 5) + " ns each");
+
+    // Every class guaranteed: one pass with a shuffle, against redrawing until each class appears
+    PasswordPolicy policy;
+    policy.length = length;
+    double policyTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            checksum += generateForPolicy(random, policy).data()[0];
+        }
+    });
+    report("policy, one pass + shuffle", policyTime, rate(policyTime));
+
+    const CharacterSet &everyClass = characterSetFor(policy.classMask(), false);
+    size_t redraws = 0;
+    double retryTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            SecretText password;
+            password.resize(length);
+            bool complete = false;
+            while (!complete) {
+                everyClass.fill(random, password.data(), length);
+                complete = true;
+                for (string_view characters : classCharacters) {
+                    complete = complete && string_view(password).find_first_of(characters) != string_view::npos;
+                }
+                redraws += !complete;
+            }
+            checksum += password.data()[0];
+        }
+    });
+    report("policy, redraw until met", retryTime,
+           rate(retryTime) + ", " + to_string(redraws) + " redraws");
+
+    // Passwords generated within the same second by the old code are all the same
+    set<string> distinct;
+    for (size_t i = 0; i < min<size_t>(count, 1000); i++) {
+        string password;
+        srand(time(nullptr));
+        for (size_t j = 0; j < length; j++) {
+            password += alphabet[rand() % alphabet.size()];
+        }
+        distinct.insert(password);
+    }
+    cout << "  distinct among 1000 rand() passwords: " << distinct.size() << ", checksum " << checksum % 10
+         << endl;
+}
+
+// GENERATOR QUALITY BENCHMARK
+/**
+ * @brief Generates passwords with one generator and reports its speed and how far its output is from the expected distribution.
+ *
+ * The character counts are compared with the expected counts by a chi-square
+ * test, over all positions together and at each position separately. Each
+ * statistic is shown as a z-score, (chi2 - df) / sqrt(2 df); an unbiased
+ * generator stays within a few units of zero however many passwords are
+ * drawn, while a biased one grows with the sample. Repeated passwords are
+ * compared with the number expected from the birthday bound.
+ *
+ * @param label Name of the generator.
+ * @param count Number of passwords.
+ * @param length Length of each password.
+ * @param probability Expected probability of each character at any position.
+ * @param generate Writes password i into the given buffer.
+ * @return True if the generator looks biased.
+ */
+
+bool reportGeneratorQuality(const string& label, size_t count, size_t length, const array<double, 256>& probability,
+                            const function<void(size_t, char*)>& generate) {
+    vector<char> passwords(count * length);
+    double elapsed = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            generate(i, passwords.data() + i * length);
+        }
+    });
+    report(label, elapsed, to_string(static_cast<size_t>(count / (elapsed / 1000))) + " passwords/s");
+
+    vector<array<size_t, 256>> positionCounts(length, array<size_t, 256>{});
+    for (size_t i = 0; i < count; i++) {
+        for (size_t position = 0; position < length; position++) {
+            positionCounts[position][static_cast<unsigned char>(passwords[i * length + position])]++;
+        }
+    }
+
+    auto zScore = [](double chiSquare, size_t degrees) {
+        return degrees == 0 ? 0 : (chiSquare - degrees) / sqrt(2.0 * degrees);
+    };
+    size_t symbols = 0, unexpected = 0;
+    double chiSquare = 0, worstPosition = 0;
+    vector<double> positionChiSquare(length, 0);
+    for (unsigned c = 0; c < 256; c++) {
+        size_t total = 0;
+        for (size_t position = 0; position < length; position++) {
+            size_t observed = positionCounts[position][c];
+            total += observed;
+            if (probability[c] > 0) {
+                double expected = probability[c] * count;
+                positionChiSquare[position] += (observed - expected) * (observed - expected) / expected;
+            }
+        }
+        if (probability[c] > 0) {
+            double expected = probability[c] * count * length;
+            chiSquare += (total - expected) * (total - expected) / expected;
+            symbols++;
+        } else {
+            unexpected += total;
+        }
+    }
+    for (size_t position = 0; position < length; position++) {
+        double z = zScore(positionChiSquare[position], symbols - 1);
+        worstPosition = abs(z) > abs(worstPosition) ? z : worstPosition;
+    }
+
+    // Birthday bound over the effective number of passwords, 1 / P(two draws are equal)
+    double collision = 0;
+    for (double p : probability) {
+        collision += p * p;
+    }
+    double space = pow(collision, -static_cast<double>(length));
+    double expectedRepeats = count - space * -expm1(-static_cast<double>(count) / space);
+
+    vector<uint64_t> fingerprints(count);
+    for (size_t i = 0; i < count; i++) {
+        fingerprints[i] = hash<string_view>()(string_view(passwords.data() + i * length, length));
+    }
+    sort(fingerprints.begin(), fingerprints.end());
+    size_t repeats = count - static_cast<size_t>(unique(fingerprints.begin(), fingerprints.end()) - fingerprints.begin());
+
+    double overall = zScore(chiSquare, symbols - 1);
+    bool biased = abs(overall) > 6 || abs(worstPosition) > 6 || unexpected > 0 ||
+                  repeats > expectedRepeats + 6 * sqrt(expectedRepeats + 1);
+    cout << "    chi-square z " << setprecision(2) << overall << " (" << symbols - 1 << " df), worst position z "
+         << worstPosition << ", repeats " << repeats << " (expected " << setprecision(1) << expectedRepeats << ")"
+         << (unexpected > 0 ? ", " + to_string(unexpected) + " unexpected characters" : "")
+         << (biased ? "  BIASED" : "") << endl;
+    return biased;
+}
+
+/**
+ * @brief Gets the probability of each character at any position of a password generated for a policy.
+ * @param policy The policy.
+ * @return The probabilities.
+ */
+
+array<double, 256> policyCharacterProbability(const PasswordPolicy& policy) {
+    array<double, 256> probability{};
+    const CharacterSet& everyClass = characterSetFor(policy.classMask(), policy.excludeAmbiguous);
+    double filler = static_cast<double>(policy.length - policy.requiredLength()) / policy.length;
+    for (char c : everyClass.characters()) {
+        probability[static_cast<unsigned char>(c)] = filler / everyClass.size();
+    }
+    // The required characters land on a uniformly chosen position
+    for (size_t index = 0; index < characterClassCount; index++) {
+        size_t minimum = policy.minimumOf(static_cast<CharacterClass>(index));
+        const CharacterSet& set = characterSetFor(1u << index, policy.excludeAmbiguous);
+        for (char c : set.characters()) {
+            probability[static_cast<unsigned char>(c)] += static_cast<double>(minimum) / policy.length / set.size();
+        }
+    }
+    return probability;
+}
+
+/**
+ * @brief Checks the generators for speed, uniformity, positional bias and repeats.
+ * Fails the run if a policy looks biased or a negative control does not.
+ * @param count Number of passwords per generator.
+ */
+
+void benchmarkGeneratorQuality(size_t count) {
+    cout << "generator-quality: " << count << " passwords per generator" << endl;
+    SecureRandom random;
+
+    PasswordPolicy everyClass;
+    PasswordPolicy letters;
+    letters.length = 12;
+    letters.excludeAmbiguous = true;
+    letters.include(CharacterClass::Uppercase, 2);
+    letters.omit(CharacterClass::Digits);
+    letters.omit(CharacterClass::Special);
+    PasswordPolicy pin;
+    pin.length = 4;
+    pin.omit(CharacterClass::Uppercase);
+    pin.omit(CharacterClass::Lowercase);
+    pin.omit(CharacterClass::Special);
+    PasswordPolicy manyDigits;
+    manyDigits.length = 10;
+    manyDigits.include(CharacterClass::Digits, 4);
+    manyDigits.include(CharacterClass::Special, 2);
+
+    const pair<string, PasswordPolicy*> policies[] = {
+        {"policy: 16, every class", &everyClass},
+        {"policy: 12 letters, 2+ upper, unambiguous", &letters},
+        {"policy: 4-digit PIN", &pin},
+        {"policy: 10, 4+ digits, 2+ special", &manyDigits}
+    };
+    size_t biasedPolicies = 0;
+    for (const auto& [label, policy] : policies) {
+        biasedPolicies += reportGeneratorQuality(label, count, policy->length, policyCharacterProbability(*policy),
+                                                 [&](size_t, char* out) {
+            SecretText password = generateForPolicy(random, *policy);
+            memcpy(out, password.data(), password.size());
+        });
+    }
+
+    // Negative controls: the checks must flag these; one that passes means the checks lost their power
+    const CharacterSet& alphabet = characterSetFor(everyClass.classMask(), false);
+    array<double, 256> uniform{};
+    for (char c : alphabet.characters()) {
+        uniform[static_cast<unsigned char>(c)] = 1.0 / alphabet.size();
+    }
+    size_t missedControls = 0;
+    missedControls += !reportGeneratorQuality("control: random byte % size", count, 16, uniform,
+                                              [&](size_t, char* out) {
+        for (size_t j = 0; j < 16; j++) {
+            out[j] = alphabet.characters()[random.nextByte() % alphabet.size()];
+        }
+    });
+    missedControls += !reportGeneratorQuality("control: srand(time) + rand() %", count, 16, uniform,
+                                              [&](size_t, char* out) {
+        srand(time(nullptr));
+        for (size_t j = 0; j < 16; j++) {
+            out[j] = alphabet.characters()[rand() % alphabet.size()];
+        }
+    });
+
+    if (biasedPolicies > 0 || missedControls > 0) {
+        benchmarkFailed = true;
+        cout << "  FAILED: " << biasedPolicies << " biased policies, " << missedControls
+             << " controls not flagged (controls need enough passwords, e.g. 200000)" << endl;
+    } else {
+        cout << "  PASSED: no policy biased, every control flagged" << endl;
+    }
+}
+
+// STRENGTH BENCHMARK
+/**
+ * @brief Times the strength estimator on passwords of several lengths and shows its verdict on common weak passwords.
+ * @param count Number of estimates per length.
+ */
+
+void benchmarkStrength(size_t count) {
+    cout << "strength: " << count << " estimates per length" << endl;
+    SecureRandom random;
+    PasswordPolicy policy;
+    for (size_t length : {8, 16, 32, 64}) {
+        policy.length = length;
+        vector<SecretText> passwords;
+        for (size_t i = 0; i < 64; i++) {
+            passwords.push_back(generateForPolicy(random, policy));
+        }
+        double total = 0;
+        double elapsed = timeMs([&] {
+            for (size_t i = 0; i < count; i++) {
+                total += estimateStrength(passwords[i % passwords.size()]).guessesLog10;
+            }
+        });
+        report("random, " + to_string(length) + " characters", elapsed,
+               to_string(elapsed * 1000 / count).substr(0, 5) + " us each, average 10^" +
+               to_string(total / count).substr(0, 4) + " guesses");
+    }
+
+    // The old rule: 6+ characters with a capital and a lowercase letter or digit is Strong
+    auto oldRule = [](const string& password) {
+        bool upper = any_of(password.begin(), password.end(), ::isupper);
+        bool lowerOrDigit = any_of(password.begin(), password.end(), [](char c) {
+            return islower(c) || isdigit(c);
+        });
+        return password.size() < 6 ? "Weak" : upper && lowerOrDigit ? "Strong" : "Moderate";
+    };
+    const char* scores[] = {"Weak", "Weak", "Moderate", "Moderate", "Strong"};
+    for (const string password : {"Password1", "Qwerty123", "Jessica1995", "P@ssw0rd", "Drowssap1", "Zxcvbnm,./"}) {
+        StrengthEstimate estimate = estimateStrength(password);
+        cout << "    " << left << setw(12) << password << " old rule " << setw(9) << oldRule(password)
+             << " estimate " << setw(9) << scores[estimate.score] << right << " 10^" << setprecision(1)
+             << estimate.guessesLog10 << " guesses" << endl;
+    }
+}
+
+// PASSPHRASE BENCHMARK
+/**
+ * @brief Loads a 7776-word diceware list by mapping and by reading lines, then generates passphrases.
+ * @param count Number of six-word passphrases.
+ */
+
+void benchmarkPassphrase(size_t count) {
+    const string path = "PasswordManagerBenchmark.wordlist";
+    const size_t listSize = 7776;
+    {
+        // Dice numbers and made-up words, sorted, in the layout of the EFF large wordlist
+        mt19937 generator(42);
+        vector<string> madeUp(listSize);
+        for (string& word : madeUp) {
+            for (size_t letters = 3 + generator() % 7; letters > 0; letters--) {
+                word += static_cast<char>('a' + generator() % 26);
+            }
+        }
+        sort(madeUp.begin(), madeUp.end());
+
+        ofstream output(path);
+        for (size_t i = 0; i < listSize; i++) {
+            size_t dice = i;
+            string number;
+            for (int roll = 0; roll < 5; roll++, dice /= 6) {
+                number.insert(number.begin(), static_cast<char>('1' + dice % 6));
+            }
+            output << number << '\t' << madeUp[i] << '\n';
+        }
+    }
+    cout << "passphrase: " << listSize << "-word list, " << count << " passphrases of 6 words" << endl;
+
+    const int loads = 200;
+    size_t words = 0;
+    double readTime = timeMs([&] {
+        for (int i = 0; i < loads; i++) {
+            ifstream input(path);
+            vector<string> lines;
+            string line;
+            while (getline(input, line)) {
+                lines.push_back(line.substr(line.find('\t') + 1));
+            }
+            words += set<string>(lines.begin(), lines.end()).size();
+        }
+    });
+    report("load, getline into strings", readTime / loads, to_string(words / loads) + " words");
+
+    Wordlist wordlist;
+    words = 0;
+    double mapTime = timeMs([&] {
+        for (int i = 0; i < loads; i++) {
+            wordlist.open(path);
+            words += wordlist.size();
+        }
+    });
+    report("load, mmap + offset table", mapTime / loads, to_string(words / loads) + " words");
+
+    SecureRandom random;
+    size_t checksum = 0;
+    double generateTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            checksum += generatePassphrase(random, wordlist, 6).size();
+        }
+    });
+    report("generate", generateTime,
+           to_string(static_cast<size_t>(count / (generateTime / 1000))) + " passphrases/s, " +
+           to_string(wordlist.entropyBits(6)).substr(0, 5) + " bits each, checksum " + to_string(checksum % 10));
+
+    wordlist.close();
+    remove(path.c_str());
+}
+
+// BREACH BENCHMARK
+/**
+ * @brief Looks hashes up in a synthetic breach corpus by binary and interpolation search, with and without a Bloom filter.
+ * @param count Number of hash prefixes in the corpus.
+ */
+
+void benchmarkBreach(size_t count) {
+    const string path = "PasswordManagerBenchmark.breaches";
+    const size_t lookups = 1000000;
+    const char* breached[] = {"password", "123456", "qwerty", "letmein", "dragon", "monkey", "iloveyou", "sunshine"};
+
+    // Uniform sorted prefixes, drawn as running sums of exponential gaps, with a few real SHA-1 prefixes merged in
+    mt19937_64 generator(42);
+    vector<uint64_t> realKeys;
+    for (const char* password : breached) {
+        uint8_t digest[20];
+        sha1(reinterpret_cast<const uint8_t*>(password), strlen(password), digest);
+        uint64_t key = 0;
+        for (int i = 0; i < 8; i++) {
+            key = key << 8 | digest[i];
+        }
+        realKeys.push_back(key);
+    }
+    sort(realKeys.begin(), realKeys.end());
+    vector<uint64_t> present;
+    {
+        ofstream output(path, ios::binary | ios::trunc);
+        char header[BreachCorpus::headerSize] = {'P', 'M', 'B', 'R', 'E', 'A', 'C', 'H', 1, 8};
+        output.write(header, sizeof(header));
+        exponential_distribution<double> gap(1.0);
+        double scale = 18446744073709551615.0 / static_cast<double>(count + 1);
+        double position = 0;
+        size_t real = 0;
+        vector<char> buffer;
+        auto append = [&](uint64_t key) {
+            for (int i = 7; i >= 0; i--) {
+                buffer.push_back(static_cast<char>(key >> (8 * i)));
+            }
+            if (present.size() < lookups && generator() % (count / lookups + 1) == 0) {
+                present.push_back(key);
+            }
+        };
+        uint64_t previous = 0;
+        for (size_t i = 0; i < count; i++) {
+            position += gap(generator) * scale;
+            uint64_t key = static_cast<uint64_t>(min(position, 18446744073709549568.0));
+            while (real < realKeys.size() && realKeys[real] <= key) {
+                if (realKeys[real] > previous) {
+                    append(realKeys[real]);
+                    previous = realKeys[real];
+                }
+                real++;
+            }
+            if (key > previous) {
+                append(key);
+                previous = key;
+            }
+            if (buffer.size() >= (1 << 20)) {
+                output.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        output.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    }
+    shuffle(present.begin(), present.end(), generator);
+
+    BreachCorpus corpus;
+    if (!corpus.open(path)) {
+        cerr << "Error: Unable To Open The Breach Corpus File " << path << "!" << endl;
+        return;
+    }
+    cout << "breach: " << corpus.size() << " SHA-1 prefixes (" << corpus.size() * 8 / 1000000 << " MB), "
+         << lookups << " lookups" << endl;
+
+    // Digests of corpus hashes and of random hashes, which are almost surely absent
+    vector<array<uint8_t, 20>> hits(lookups);
+    vector<array<uint8_t, 20>> misses(lookups);
+    for (size_t i = 0; i < lookups; i++) {
+        uint64_t hit = present[i % present.size()];
+        uint64_t miss = generator();
+        for (int b = 0; b < 8; b++) {
+            hits[i][b] = static_cast<uint8_t>(hit >> (56 - 8 * b));
+            misses[i][b] = static_cast<uint8_t>(miss >> (56 - 8 * b));
+        }
+    }
+
+    auto run = [&](const string& label, const vector<array<uint8_t, 20>>& digests, bool interpolate) {
+        size_t found = 0;
+        size_t reads = 0;
+        double elapsed = timeMs([&] {
+            for (const auto& digest : digests) {
+                size_t probes = 0;
+                found += interpolate ? corpus.containsHash(digest.data(), &probes)
+                                     : corpus.containsHashBinarySearch(digest.data(), &probes);
+                reads += probes;
+            }
+        });
+        report(label, elapsed, to_string(static_cast<size_t>(elapsed * 1000000 / lookups)) + " ns each, " +
+               to_string(static_cast<double>(reads) / lookups).substr(0, 4) + " records read, " +
+               to_string(found) + " found");
+    };
+    run("hits, binary search", hits, false);
+    run("hits, interpolation search", hits, true);
+    run("misses, binary search", misses, false);
+    run("misses, interpolation search", misses, true);
+
+    double buildTime = timeMs([&] {
+        corpus.buildBloomFilter();
+    });
+    report("build Bloom filter, 10 bits per record", buildTime,
+           to_string(corpus.bloomFilterBytes() / 1000000) + " MB");
+    run("hits, Bloom filter + interpolation", hits, true);
+    run("misses, Bloom filter + interpolation", misses, true);
+
+    size_t found = 0;
+    double passwordTime = timeMs([&] {
+        for (size_t i = 0; i < lookups; i++) {
+            found += corpus.contains(breached[i % size(breached)]);
+        }
+    });
+    report("contains(password), SHA-1 + lookup", passwordTime,
+           to_string(static_cast<size_t>(passwordTime * 1000000 / lookups)) + " ns each, " + to_string(found) + " found");
+
+    corpus.close();
+    remove(path.c_str());
+}
+
+// AUDIT BENCHMARK
+/**
+ * @brief Audits a synthetic vault with reused, varied, weak and stale passwords, plaintext and encrypted.
+ * @param count Number of entries.
+ */
+
+void benchmarkAudit(size_t count) {
+    const string path = "PasswordManagerBenchmark.vault";
+    const int64_t now = static_cast<int64_t>(time(nullptr));
+    vector<KeyData> vault = makeVault(count);
+    mt19937_64 random(7);
+    for (size_t i = 0; i < count; i++) {
+        KeyData& entry = vault[i];
+        // One entry in ten reuses a password, one in ten varies one, one in twenty is weak
+        if (i % 10 == 1) {
+            entry.password = vault[i - 1].password;
+        } else if (i % 10 == 2) {
+            entry.password = string(vault[i - 2].password) + to_string(i % 100);
+        } else if (i % 20 == 3) {
+            entry.password = "summer" + to_string(2000 + i % 25);
+        }
+        entry.website = i % 25 == 0 ? "" : entry.website;
+        entry.login = i % 30 == 0 ? "" : entry.login;
+        entry.created = now - static_cast<int64_t>(random() % (3 * 365 * 86400));
+        entry.modified = entry.created;
+    }
+    {
+        ofstream output(path);
+        for (const KeyData& entry : vault) {
+            output << "Name: " << entry.name << '\n' << "Password: " << entry.password << '\n'
+                   << "Category: " << entry.category << '\n' << "Website: " << entry.website << '\n'
+                   << "Login: " << entry.login << '\n' << "Created: " << entry.created << '\n'
+                   << "Modified: " << entry.modified << '\n' << "----------\n";
+        }
+    }
+
+    PasswordKeeper keeper(path);
+    keeper.unlock("benchmark");
+    cout << "audit: " << count << " entries, " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+    uint64_t checksum = 0;
+    double sequentialTime = timeMs([&] {
+        for (const KeyData& entry : keeper.getPasswords()) {
+            checksum += examinePassword(entry.password, 1, nullptr).score;
+        }
+    });
+    report("examine each password, one thread", sequentialTime, "checksum " + to_string(checksum % 100));
+
+    AuditReport audit;
+    auto describe = [&](double milliseconds) {
+        string counts;
+        for (size_t issue = 0; issue < auditIssueCount; issue++) {
+            counts += (issue ? ", " : "") + to_string(audit.counts[issue]) + " " +
+                      describeIssue(static_cast<AuditIssue>(issue));
+        }
+        return to_string(static_cast<size_t>(count / (milliseconds / 1000))) + " entries/s; " + counts;
+    };
+    double plainTime = timeMs([&] { audit = keeper.auditVault(); });
+    report("audit, plaintext vault", plainTime, describe(plainTime));
+
+    keeper.encryptAllPasswords();
+    double encryptedTime = timeMs([&] { audit = keeper.auditVault(); });
+    report("audit, encrypted vault", encryptedTime, describe(encryptedTime));
+    cout << "    " << audit.reuseGroups << " reused passwords, " << audit.similarGroups << " groups of variations, "
+         << audit.categories.size() << " categories" << endl;
+    remove(path.c_str());
+}
+
+// NEAR-DUPLICATES BENCHMARK
+/**
+ * @brief Clusters passwords with small variations by MinHash/LSH, and checks it against pairwise edit distance on a sample.
+ * @param count Number of passwords.
+ */
+
+void benchmarkNearDuplicates(size_t count) {
+    // Random base passwords; one in four has two or three variations that change or append a character or two
+    mt19937_64 random(11);
+    auto letters = [&](size_t length) {
+        string text;
+        for (size_t i = 0; i < length; i++) {
+            text += static_cast<char>('a' + random() % 26);
+        }
+        return text;
+    };
+    vector<string> passwords;
+    passwords.reserve(count);
+    while (passwords.size() < count) {
+        string base = letters(8 + random() % 8) + to_string(random() % 1000);
+        passwords.push_back(base);
+        if (random() % 4 == 0) {
+            for (size_t variation = 2 + random() % 2; variation > 0 && passwords.size() < count; variation--) {
+                string changed = base;
+                changed[changed.size() - 1 - random() % 2] = static_cast<char>('0' + random() % 10);
+                passwords.push_back(random() % 2 ? changed : changed + "!");
+            }
+        }
+    }
+    cout << "near-duplicates: " << count << " passwords" << endl;
+
+    vector<MinHashSketch> sketches(count);
+    vector<uint64_t> hashes(count);
+    double sketchTime = timeMs([&] {
+        for (size_t i = 0; i < count; i++) {
+            sketches[i] = minHashSketch(passwords[i], 5);
+            hashes[i] = perfectHashOf(passwords[i], 5);
+        }
+    });
+    report("MinHash sketches", sketchTime, to_string(sketchTime * 1000 / count).substr(0, 4) + " us each");
+    size_t groupCount = 0;
+    vector<size_t> groups;
+    double lshTime = timeMs([&] {
+        groups = findNearDuplicates(sketches, hashes, groupCount);
+    });
+    size_t grouped = count - static_cast<size_t>(std::count(groups.begin(), groups.end(), 0));
+    report("LSH buckets + clusters", lshTime, to_string(groupCount) + " clusters, " + to_string(grouped) + " passwords");
+
+    // Pairwise edit distance on a sample, the quadratic way
+    size_t sample = min<size_t>(count, 3000);
+    auto editDistance = [](const string& a, const string& b) {
+        vector<size_t> row(b.size() + 1);
+        iota(row.begin(), row.end(), 0);
+        for (size_t i = 1; i <= a.size(); i++) {
+            size_t diagonal = row[0];
+            row[0] = i;
+            for (size_t j = 1; j <= b.size(); j++) {
+                size_t above = row[j];
+                row[j] = min({row[j] + 1, row[j - 1] + 1, diagonal + (a[i - 1] != b[j - 1])});
+                diagonal = above;
+            }
+        }
+        return row[b.size()];
+    };
+    size_t closePairs = 0;
+    size_t clusteredPairs = 0;
+    size_t falsePairs = 0;
+    double pairwiseTime = timeMs([&] {
+        for (size_t i = 0; i < sample; i++) {
+            for (size_t j = i + 1; j < sample; j++) {
+                if (passwords[i] == passwords[j]) {
+                    continue;
+                }
+                bool close = editDistance(passwords[i], passwords[j]) <= 2;
+                bool together = groups[i] != 0 && groups[i] == groups[j];
+                closePairs += close;
+                clusteredPairs += close && together;
+                falsePairs += !close && together;
+            }
+        }
+    });
+    double pairs = static_cast<double>(count) * static_cast<double>(count - 1) / 2;
+    double samplePairs = static_cast<double>(sample) * static_cast<double>(sample - 1) / 2;
+    report("pairwise edit distance, " + to_string(sample) + " sample", pairwiseTime,
+           "~" + to_string(static_cast<size_t>(pairwiseTime * pairs / samplePairs / 1000)) + " s for all " +
+           to_string(count));
+    cout << "    pairs within edit distance 2 clustered together: " << clusteredPairs << " of " << closePairs
+         << ", pairs clustered that are further apart: " << falsePairs << endl;
+}
+
+/**
+ * @brief Entry point; runs the benchmark named on the command line.
+ */
+
+// CONCURRENT BENCHMARK
+/**
+ * @brief Measures name lookups and searches on snapshots across reader threads, with and without a writer
+ * editing entries meanwhile, against a keeper behind one mutex.
+ * @param count Number of entries.
+ */
+
+void benchmarkConcurrent(size_t count) {
+    const string path = "PasswordManagerBenchmark.vault";
+    vector<KeyData> vault = makeVault(count);
+    {
+        ofstream output(path);
+        for (const KeyData& entry : vault) {
+            output << "Name: " << entry.name << '\n' << "Password: " << entry.password << '\n'
+                   << "Category: " << entry.category << '\n' << "Website: " << entry.website << '\n'
+                   << "Login: " << entry.login << '\n' << "----------\n";
+        }
+    }
+    vector<string> queries;
+    for (size_t i = 0; i < 64; i++) {
+        queries.push_back(vault[i * 7919 % count].name.substr(0, 5));
+    }
+
+    {
+        // Both keepers save on destruction, so they go before the file is removed
+        ConcurrentPasswordKeeper concurrent(path);
+        PasswordKeeper locked(path);
+        mutex keeperLock;
+        cout << "concurrent: " << count << " entries, " << thread::hardware_concurrency() << " hardware threads" << endl;
+
+        // Readers run for a fixed time while the writer, if any, edits entries as fast as it can
+        streambuf* console = cout.rdbuf();
+        auto measure = [&](const string& label, unsigned readers, const function<void(size_t)>& read,
+                           const function<void(size_t)>& write) {
+            atomic<bool> stop{false};
+            atomic<size_t> reads{0};
+            atomic<size_t> writes{0};
+            vector<thread> threads;
+            cout.rdbuf(nullptr);
+            double elapsed = timeMs([&] {
+                for (unsigned t = 0; t < readers; t++) {
+                    threads.emplace_back([&, t] {
+                        size_t done = 0;
+                        for (size_t i = t; !stop.load(memory_order_relaxed); i += readers) {
+                            read(i);
+                            done++;
+                        }
+                        reads += done;
+                    });
+                }
+                if (write) {
+                    threads.emplace_back([&] {
+                        for (size_t i = 0; !stop.load(memory_order_relaxed); i++) {
+                            write(i);
+                            writes++;
+                        }
+                    });
+                }
+                this_thread::sleep_for(chrono::milliseconds(400));
+                stop = true;
+                for (thread& worker : threads) {
+                    worker.join();
+                }
+            });
+            cout.rdbuf(console);
+            string extra = to_string(static_cast<size_t>(reads / (elapsed / 1000))) + " reads/s";
+            if (write) {
+                extra += ", " + to_string(static_cast<size_t>(writes / (elapsed / 1000))) + " writes/s";
+            }
+            report(label, elapsed, extra);
+        };
+
+        auto lookup = [&](size_t i) {
+            ConcurrentPasswordKeeper::Reader reader(concurrent);
+            reader->findByName(vault[i % count].name);
+        };
+        auto search = [&](size_t i) {
+            concurrent.searchPasswords(queries[i % queries.size()]);
+        };
+        auto lockedSearch = [&](size_t i) {
+            lock_guard<mutex> guard(keeperLock);
+            locked.searchPasswords(queries[i % queries.size()]);
+        };
+        auto edit = [&](size_t i) {
+            concurrent.editPassword(vault[i % count].name, "changed" + to_string(i));
+        };
+        auto lockedEdit = [&](size_t i) {
+            lock_guard<mutex> guard(keeperLock);
+            locked.editPassword(vault[i % count].name, "changed" + to_string(i));
+        };
+
+        for (unsigned readers : {1u, 2u, 4u, 8u}) {
+            string threads = to_string(readers) + (readers == 1 ? " reader" : " readers");
+            measure("snapshot lookup, " + threads, readers, lookup, nullptr);
+            measure("snapshot lookup, " + threads + " + writer", readers, lookup, edit);
+            measure("snapshot search, " + threads, readers, search, nullptr);
+            measure("snapshot search, " + threads + " + writer", readers, search, edit);
+            measure("mutex search, " + threads, readers, lockedSearch, nullptr);
+            measure("mutex search, " + threads + " + writer", readers, lockedSearch, lockedEdit);
+        }
+    }
+    remove(path.c_str());
+}
+
+int main(int argc, char* argv[]) {
+    map<string, function<void(size_t)>> benchmarks = {
+        {"sort", benchmarkSort},
+        {"parallel-sort", benchmarkParallelSort},
+        {"cipher", benchmarkCipher},
+        {"parallel-cipher", benchmarkParallelCipher},
+        {"kdf", benchmarkKdf},
+        {"rekey", benchmarkRekey},
+        {"blind-index", benchmarkBlindIndex},
+        {"save", benchmarkSave},
+        {"secret-arena", benchmarkSecretArena},
+        {"generate", benchmarkGenerate},
+        {"passphrase", benchmarkPassphrase},
+        {"generator-quality", benchmarkGeneratorQuality},
+        {"strength", benchmarkStrength},
+        {"breach", benchmarkBreach},
+        {"audit", benchmarkAudit},
+        {"near-duplicates", benchmarkNearDuplicates},
+        {"concurrent", benchmarkConcurrent},
+    };
+
+    if (argc < 2 || !benchmarks.count(argv[1])) {
+        cerr << "Usage: " << argv[0] << " <benchmark> [entries]" << endl << "Benchmarks:";
+        for (const auto& benchmark : benchmarks) {
+            cerr << " " << benchmark.first;
+        }
+        cerr << endl;
+        return 1;
+    }
+
+    // The parallel sort only pays off on large vaults, so it is measured on a million entries by default
+    map<string, size_t> defaultCounts = {
+        {"parallel-sort", 1000000},
+    };
+    size_t count = argc > 2 ? stoull(argv[2]) : defaultCounts.count(argv[1]) ? defaultCounts[argv[1]] : 200000;
+    benchmarks[argv[1]](count);
+    return benchmarkFailed ? 1 : 0;
+}
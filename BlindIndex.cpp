@@ -0,0 +1,240 @@
+/**
+ * @file BlindIndex.cpp
+ * @brief Implementation of the HMAC blind index.
+ */
+
+#include "BlindIndex.h"
+#include "Crypto.h"
+#include <algorithm>
+#include <cstring>
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Checks whether a byte belongs to a word.
+ */
+
+bool isWordByte(unsigned char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c >= 0x80;
+}
+
+/**
+ * @brief Removes one id from a sorted posting list.
+ */
+
+void eraseId(vector<uint64_t>& ids, uint64_t id) {
+    auto it = lower_bound(ids.begin(), ids.end(), id);
+    if (it != ids.end() && *it == id) {
+        ids.erase(it);
+    }
+}
+
+} // namespace
+
+// SPLIT WORDS
+/**
+     * @brief Splits a value into its distinct alphanumeric words.
+     * @param value The value.
+     * @return The words, in order of first appearance.
+     */
+
+vector<string> splitWords(const string& value) {
+    vector<string> words;
+    size_t i = 0;
+    while (i < value.size()) {
+        while (i < value.size() && !isWordByte(value[i])) {
+            i++;
+        }
+        size_t start = i;
+        while (i < value.size() && isWordByte(value[i])) {
+            i++;
+        }
+        if (i > start) {
+            string word = value.substr(start, i - start);
+            if (find(words.begin(), words.end(), word) == words.end()) {
+                words.push_back(std::move(word));
+            }
+        }
+    }
+    return words;
+}
+
+/**
+     * @brief Computes HMAC(key, field | kind | value) truncated to 64 bits.
+     * @param field The field.
+     * @param kind 'E' for exact, 'W' for word.
+     * @param value The value or word.
+     * @return The token.
+     */
+
+uint64_t BlindIndex::token(BlindField field, char kind, const string& value) const {
+    uint8_t message[256];
+    uint8_t digest[Sha256::digestSize];
+    message[0] = static_cast<uint8_t>(field);
+    message[1] = static_cast<uint8_t>(kind);
+
+    // Short values are hashed from a stack buffer; longer ones are rare
+    if (value.size() + 2 <= sizeof(message)) {
+        memcpy(message + 2, value.data(), value.size());
+        tokenMac->mac(message, value.size() + 2, digest);
+    } else {
+        string joined = string(reinterpret_cast<const char*>(message), 2) + value;
+        tokenMac->mac(reinterpret_cast<const uint8_t*>(joined.data()), joined.size(), digest);
+    }
+
+    uint64_t result;
+    memcpy(&result, digest, sizeof(result));
+    return result;
+}
+
+// KEY
+/**
+     * @brief Derives the index key from the vault key.
+     * @param vaultKey The 32-byte vault key.
+     */
+
+void BlindIndex::setKey(const uint8_t* vaultKey) {
+    static const string label = "PasswordManager Blind Index";
+    uint8_t indexKey[Sha256::digestSize];
+    hmacSha256(vaultKey, LockedKey::size, reinterpret_cast<const uint8_t*>(label.data()), label.size(), indexKey);
+
+    tokenMac = make_unique<HmacSha256>(indexKey, sizeof(indexKey));
+    secureZero(indexKey, sizeof(indexKey));
+    clear();
+}
+
+/**
+     * @brief Wipes the index key and drops every token.
+     */
+
+void BlindIndex::forgetKey() {
+    tokenMac.reset();
+    clear();
+}
+
+/**
+     * @brief Checks whether an index key is set.
+     * @return True if keyed.
+     */
+
+bool BlindIndex::isKeyed() const {
+    return tokenMac != nullptr;
+}
+
+// INSERT
+/**
+     * @brief Replaces the tokens of an entry with those of the given values.
+     * @param id Id of the entry.
+     * @param name Normalized name.
+     * @param website Normalized website host.
+     * @param login Normalized login.
+     */
+
+void BlindIndex::insert(uint64_t id, const string& name, const string& website, const string& login) {
+    remove(id);
+    if (!tokenMac) {
+        return;
+    }
+
+    vector<uint64_t>& tokens = entryTokens[id];
+    auto add = [&](uint64_t value) {
+        if (find(tokens.begin(), tokens.end(), value) == tokens.end()) {
+            tokens.push_back(value);
+            // Ids mostly grow, so keeping the list sorted is usually an append
+            vector<uint64_t>& ids = postings[value];
+            ids.insert(upper_bound(ids.begin(), ids.end(), id), id);
+        }
+    };
+    const pair<BlindField, const string*> fields[] = {
+        {BlindField::Name, &name}, {BlindField::Website, &website}, {BlindField::Login, &login}};
+    for (const auto& field : fields) {
+        if (field.second->empty()) {
+            continue;
+        }
+        add(token(field.first, 'E', *field.second));
+        for (const string& word : splitWords(*field.second)) {
+            add(token(field.first, 'W', word));
+        }
+    }
+}
+
+// REMOVE
+/**
+     * @brief Removes the entry from the posting list of each of its tokens.
+     * @param id Id of the entry.
+     */
+
+void BlindIndex::remove(uint64_t id) {
+    auto it = entryTokens.find(id);
+    if (it == entryTokens.end()) {
+        return;
+    }
+    for (uint64_t value : it->second) {
+        auto posting = postings.find(value);
+        eraseId(posting->second, id);
+        if (posting->second.empty()) {
+            postings.erase(posting);
+        }
+    }
+    entryTokens.erase(it);
+}
+
+// FIND
+/**
+     * @brief Looks up the exact token of the value.
+     * @param field The field.
+     * @param value Normalized value.
+     * @return Ids of the matching entries.
+     */
+
+vector<uint64_t> BlindIndex::findExact(BlindField field, const string& value) const {
+    if (!tokenMac || value.empty()) {
+        return {};
+    }
+    auto it = postings.find(token(field, 'E', value));
+    return it == postings.end() ? vector<uint64_t>() : it->second;
+}
+
+/**
+     * @brief Intersects the posting lists of the word tokens of the query, shortest list first.
+     * @param field The field.
+     * @param query Normalized query.
+     * @return Ids of the entries having every word.
+     */
+
+vector<uint64_t> BlindIndex::findWords(BlindField field, const string& query) const {
+    vector<string> words = splitWords(query);
+    if (!tokenMac || words.empty()) {
+        return {};
+    }
+
+    vector<const vector<uint64_t>*> lists;
+    for (const string& word : words) {
+        auto it = postings.find(token(field, 'W', word));
+        if (it == postings.end()) {
+            return {};
+        }
+        lists.push_back(&it->second);
+    }
+    sort(lists.begin(), lists.end(), [](const vector<uint64_t>* a, const vector<uint64_t>* b) {
+        return a->size() < b->size();
+    });
+
+    // Posting lists are sorted, so the other lists are probed by binary search
+    vector<uint64_t> result = *lists[0];
+    for (size_t i = 1; i < lists.size() && !result.empty(); i++) {
+        erase_if(result, [&](uint64_t id) { return !binary_search(lists[i]->begin(), lists[i]->end(), id); });
+    }
+    return result;
+}
+
+// CLEAR
+/**
+     * @brief Drops every token.
+     */
+
+void BlindIndex::clear() {
+    postings.clear();
+    entryTokens.clear();
+}
@@ -0,0 +1,143 @@
+#ifndef PASSWORDMANAGER_BLINDINDEX_H
+#define PASSWORDMANAGER_BLINDINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "KeyDerivation.h"
+using namespace std;
+
+/**
+ * @file BlindIndex.h
+ * @brief Keyed (HMAC) search tokens that allow lookups without access to the field values.
+ */
+
+/**
+ * @brief A field covered by the blind index.
+ */
+
+enum class BlindField {
+    Name,       ///< Entry name
+    Website,    ///< Normalized website host
+    Login       ///< Login
+};
+
+/**
+ * @brief Index of HMAC-SHA256 tokens of the name, website and login fields.
+ *
+ * Every field value yields one exact token, HMAC(key, field | "exact" | value),
+ * and one word token per alphanumeric word, HMAC(key, field | "word" | word),
+ * each truncated to 64 bits. The index maps tokens to entry ids and never
+ * stores a value, so when the fields are encrypted at rest a lookup only
+ * needs the token of the query: nothing has to be decrypted, and without
+ * the key the tokens reveal nothing beyond equality.
+ *
+ * Values are expected to be normalized already (folded, or the normalized
+ * host for websites), so equal-looking values produce equal tokens.
+ */
+
+class BlindIndex {
+private:
+    unique_ptr<HmacSha256> tokenMac;                        /**< HMAC under the index key; null until keyed. */
+    unordered_map<uint64_t, vector<uint64_t>> postings;     /**< Token to the sorted ids of the entries having it. */
+    unordered_map<uint64_t, vector<uint64_t>> entryTokens;  /**< Entry id to its tokens, for removal. */
+
+    /**
+     * @brief Computes a 64-bit token.
+     * @param field The field the value belongs to.
+     * @param kind 'E' for an exact token, 'W' for a word token.
+     * @param value The value or word.
+     * @return The token.
+     */
+
+    uint64_t token(BlindField field, char kind, const string &value) const;
+
+public:
+
+    // KEY
+    /**
+     * @brief Derives the index key from the vault key and drops the tokens of the previous key.
+     *
+     * The index key is HMAC(vaultKey, "PasswordManager Blind Index"), so tokens
+     * cannot be used to attack the encryption key and change with it.
+     *
+     * @param vaultKey The 32-byte vault key.
+     */
+
+    void setKey(const uint8_t *vaultKey);
+
+    /**
+     * @brief Forgets the index key and every token.
+     */
+
+    void forgetKey();
+
+    /**
+     * @brief Checks whether an index key is set.
+     * @return True if tokens can be computed.
+     */
+
+    bool isKeyed() const;
+
+    // INSERT
+    /**
+     * @brief Indexes an entry, replacing its previous tokens.
+     * @param id Id of the entry.
+     * @param name Normalized name.
+     * @param website Normalized website host.
+     * @param login Normalized login.
+     */
+
+    void insert(uint64_t id, const string &name, const string &website, const string &login);
+
+    // REMOVE
+    /**
+     * @brief Removes every token of an entry.
+     * @param id Id of the entry.
+     */
+
+    void remove(uint64_t id);
+
+    // FIND
+    /**
+     * @brief Finds the entries whose field equals the value.
+     * @param field The field.
+     * @param value Normalized value.
+     * @return Ids of the matching entries, in ascending order.
+     */
+
+    vector<uint64_t> findExact(BlindField field, const string &value) const;
+
+    /**
+     * @brief Finds the entries whose field contains every word of the query.
+     * @param field The field.
+     * @param query Normalized query; split into words like the indexed values.
+     * @return Ids of the matching entries in ascending order; empty if the query has no words.
+     */
+
+    vector<uint64_t> findWords(BlindField field, const string &query) const;
+
+    // CLEAR
+    /**
+     * @brief Drops every token but keeps the key.
+     */
+
+    void clear();
+};
+
+// SPLIT WORDS
+/**
+ * @brief Splits a normalized value into the words the blind index tokenizes.
+ *
+ * Words are runs of ASCII letters and digits and of non-ASCII bytes, so
+ * "john.doe@example.com" yields john, doe, example and com.
+ *
+ * @param value The value.
+ * @return The distinct words, in order of first appearance.
+ */
+
+vector<string> splitWords(const string &value);
+
+#endif //PASSWORDMANAGER_BLINDINDEX_H
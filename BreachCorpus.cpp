@@ -0,0 +1,690 @@
+/**
+ * @file BreachCorpus.cpp
+ * @brief Implementation of SHA-1, NTLM and lookups in memory-mapped breach corpora.
+ */
+
+#include "BreachCorpus.h"
+#include "Crypto.h"
+#include "MappedFile.h"
+#include "SecureArena.h"
+#include <algorithm>
+#include <bit>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+
+using namespace std;
+
+namespace {
+
+const char corpusMagic[8] = {'P', 'M', 'B', 'R', 'E', 'A', 'C', 'H'};
+
+/**
+ * @brief Reads up to eight leading bytes of a hash as a big-endian number, left-aligned in 64 bits.
+ */
+
+uint64_t leadingBytes(const uint8_t* bytes, size_t count) {
+    uint64_t value = 0;
+    for (size_t i = 0; i < count; i++) {
+        value = value << 8 | bytes[i];
+    }
+    return count < 8 ? value << (8 * (8 - count)) : value;
+}
+
+/**
+ * @brief Spreads the bits of a prefix for the Bloom filter; prefixes shorter than eight bytes end in zeros.
+ */
+
+uint64_t mixBits(uint64_t value) {
+    value ^= value >> 30;
+    value *= 0xBF58476D1CE4E5B9ull;
+    value ^= value >> 27;
+    value *= 0x94D049BB133111EBull;
+    value ^= value >> 31;
+    return value;
+}
+
+/**
+ * @brief Gets the bits a prefix sets in its word of the Bloom filter; six bits of the hash per bit.
+ */
+
+uint64_t bloomPattern(uint64_t hash, unsigned hashes) {
+    uint64_t pattern = 0;
+    for (unsigned i = 0; i < hashes; i++) {
+        pattern |= 1ull << (hash & 63);
+        hash >>= 6;
+    }
+    return pattern;
+}
+
+/**
+ * @brief Gets the word of the Bloom filter a prefix falls in, from the high half of its hash.
+ */
+
+size_t bloomWord(uint64_t hash, size_t words) {
+    return static_cast<size_t>(((hash >> 32) * static_cast<uint64_t>(words)) >> 32);
+}
+
+/**
+ * @brief Reads a hexadecimal digit.
+ * @return Its value, or -1 for any other character.
+ */
+
+int hexValue(char c) {
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    return -1;
+}
+
+/**
+ * @brief Processes one 64-byte block of SHA-1.
+ */
+
+void sha1Block(uint32_t* state, const uint8_t* block) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; i++) {
+        w[i] = static_cast<uint32_t>(block[4 * i]) << 24 | static_cast<uint32_t>(block[4 * i + 1]) << 16 |
+               static_cast<uint32_t>(block[4 * i + 2]) << 8 | block[4 * i + 3];
+    }
+    for (int i = 16; i < 80; i++) {
+        w[i] = rotl(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; i++) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t next = rotl(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl(b, 30);
+        b = a;
+        a = next;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+    secureZero(w, sizeof(w));
+}
+
+/**
+ * @brief Processes one 64-byte block of MD4.
+ */
+
+void md4Block(uint32_t* state, const uint8_t* block) {
+    uint32_t x[16];
+    for (int i = 0; i < 16; i++) {
+        x[i] = block[4 * i] | static_cast<uint32_t>(block[4 * i + 1]) << 8 |
+               static_cast<uint32_t>(block[4 * i + 2]) << 16 | static_cast<uint32_t>(block[4 * i + 3]) << 24;
+    }
+
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+    static const int shifts1[4] = {3, 7, 11, 19};
+    for (int i = 0; i < 16; i++) {
+        uint32_t next = rotl(a + ((b & c) | (~b & d)) + x[i], shifts1[i % 4]);
+        a = d;
+        d = c;
+        c = b;
+        b = next;
+    }
+    static const int shifts2[4] = {3, 5, 9, 13};
+    for (int i = 0; i < 16; i++) {
+        int word = (i % 4) * 4 + i / 4;
+        uint32_t next = rotl(a + ((b & c) | (b & d) | (c & d)) + x[word] + 0x5A827999u, shifts2[i % 4]);
+        a = d;
+        d = c;
+        c = b;
+        b = next;
+    }
+    static const int shifts3[4] = {3, 9, 11, 15};
+    static const int order3[16] = {0, 8, 4, 12, 2, 10, 6, 14, 1, 9, 5, 13, 3, 11, 7, 15};
+    for (int i = 0; i < 16; i++) {
+        uint32_t next = rotl(a + (b ^ c ^ d) + x[order3[i]] + 0x6ED9EBA1u, shifts3[i % 4]);
+        a = d;
+        d = c;
+        c = b;
+        b = next;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    secureZero(x, sizeof(x));
+}
+
+/**
+ * @brief Runs the Merkle-Damgard padding shared by SHA-1 and MD4 over a whole message.
+ * @param bigEndian Whether the bit length is stored big-endian (SHA-1) or little-endian (MD4).
+ */
+
+template <typename Block>
+void hashMessage(uint32_t* state, const uint8_t* data, size_t length, bool bigEndian, Block block) {
+    size_t whole = length / 64 * 64;
+    for (size_t offset = 0; offset < whole; offset += 64) {
+        block(state, data + offset);
+    }
+
+    uint8_t tail[128] = {};
+    size_t rest = length - whole;
+    if (rest > 0) {
+        memcpy(tail, data + whole, rest);
+    }
+    tail[rest] = 0x80;
+    size_t tailSize = rest < 56 ? 64 : 128;
+    uint64_t bits = static_cast<uint64_t>(length) * 8;
+    for (int i = 0; i < 8; i++) {
+        tail[tailSize - 1 - (bigEndian ? i : 7 - i)] = static_cast<uint8_t>(bits >> (8 * i));
+    }
+    for (size_t offset = 0; offset < tailSize; offset += 64) {
+        block(state, tail + offset);
+    }
+    secureZero(tail, sizeof(tail));
+}
+
+/**
+ * @brief Decodes one UTF-8 character, counting a malformed byte as U+FFFD.
+ * @param text The text.
+ * @param position Position of the character; moved past it.
+ * @return The code point.
+ */
+
+uint32_t decodeUtf8(string_view text, size_t& position) {
+    auto byte = [&](size_t i) {
+        return static_cast<uint8_t>(text[i]);
+    };
+    uint8_t lead = byte(position);
+    size_t length = lead < 0x80 ? 1 : (lead >> 5) == 0x6 ? 2 : (lead >> 4) == 0xE ? 3 : (lead >> 3) == 0x1E ? 4 : 0;
+    if (length == 1) {
+        position++;
+        return lead;
+    }
+    if (length == 0 || position + length > text.size()) {
+        position++;
+        return 0xFFFD;
+    }
+    uint32_t codePoint = lead & (0x7F >> length);
+    for (size_t i = 1; i < length; i++) {
+        if ((byte(position + i) & 0xC0) != 0x80) {
+            position++;
+            return 0xFFFD;
+        }
+        codePoint = codePoint << 6 | (byte(position + i) & 0x3F);
+    }
+    static const uint32_t smallest[5] = {0, 0, 0x80, 0x800, 0x10000};
+    if (codePoint < smallest[length] || codePoint > 0x10FFFF || (codePoint >= 0xD800 && codePoint < 0xE000)) {
+        position++;
+        return 0xFFFD;
+    }
+    position += length;
+    return codePoint;
+}
+
+} // namespace
+
+// HASHES
+/**
+     * @brief Computes the SHA-1 digest of a message.
+     * @param data Message bytes.
+     * @param length Message length.
+     * @param digest Receives the 20-byte digest.
+     */
+
+void sha1(const uint8_t* data, size_t length, uint8_t* digest) {
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    hashMessage(state, data, length, true, sha1Block);
+    for (int i = 0; i < 5; i++) {
+        for (int j = 0; j < 4; j++) {
+            digest[4 * i + j] = static_cast<uint8_t>(state[i] >> (24 - 8 * j));
+        }
+    }
+    secureZero(state, sizeof(state));
+}
+
+/**
+     * @brief Computes the NTLM hash of a password: MD4 of its UTF-16LE encoding.
+     * @param password The password in UTF-8.
+     * @param digest Receives the 16-byte hash.
+     */
+
+void ntlmHash(string_view password, uint8_t* digest) {
+    // Never more than two bytes of UTF-16 per byte of UTF-8
+    SecretText utf16;
+    utf16.reserve(password.size() * 2);
+    auto append = [&](uint32_t unit) {
+        char bytes[2] = {static_cast<char>(unit & 0xFF), static_cast<char>(unit >> 8)};
+        utf16.append(string_view(bytes, 2));
+    };
+    for (size_t position = 0; position < password.size();) {
+        uint32_t codePoint = decodeUtf8(password, position);
+        if (codePoint >= 0x10000) {
+            codePoint -= 0x10000;
+            append(0xD800 | (codePoint >> 10));
+            append(0xDC00 | (codePoint & 0x3FF));
+        } else {
+            append(codePoint);
+        }
+    }
+
+    uint32_t state[4] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476};
+    hashMessage(state, reinterpret_cast<const uint8_t*>(utf16.data()), utf16.size(), false, md4Block);
+    for (int i = 0; i < 4; i++) {
+        for (int j = 0; j < 4; j++) {
+            digest[4 * i + j] = static_cast<uint8_t>(state[i] >> (8 * j));
+        }
+    }
+    secureZero(state, sizeof(state));
+}
+
+/**
+ * @brief Destructor.
+ * Unmaps the file.
+ */
+
+BreachCorpus::~BreachCorpus() {
+    close();
+}
+
+// OPEN
+/**
+     * @brief Maps the file and checks its header and size.
+     * @param path Path of the file.
+     * @return True if the corpus is usable.
+     */
+
+bool BreachCorpus::open(const string& path) {
+    close();
+    size_t size = 0;
+    const char* view = mapFile(path, size);
+    if (!view) {
+        return false;
+    }
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(view);
+    size_t length = size >= headerSize ? bytes[9] : 0;
+    bool valid = size > headerSize && memcmp(bytes, corpusMagic, sizeof(corpusMagic)) == 0 &&
+                 (bytes[8] == static_cast<uint8_t>(BreachHash::Sha1) ||
+                  bytes[8] == static_cast<uint8_t>(BreachHash::Ntlm)) &&
+                 length >= 4 && length <= 8 && (size - headerSize) % length == 0;
+    if (!valid) {
+        unmapFile(view, size);
+        return false;
+    }
+
+    file = bytes;
+    fileSize = size;
+    records = bytes + headerSize;
+    prefixBytes = length;
+    recordCount = (size - headerSize) / length;
+    kind = static_cast<BreachHash>(bytes[8]);
+    firstKey = record(0);
+    lastKey = record(recordCount - 1);
+    return true;
+}
+
+/**
+     * @brief Unmaps the file and drops the Bloom filter.
+     */
+
+void BreachCorpus::close() {
+    if (file) {
+        unmapFile(reinterpret_cast<const char*>(file), fileSize);
+    }
+    file = nullptr;
+    fileSize = 0;
+    records = nullptr;
+    recordCount = 0;
+    prefixBytes = 0;
+    firstKey = 0;
+    lastKey = 0;
+    bloomBits.clear();
+    bloomBits.shrink_to_fit();
+    bloomHashes = 0;
+}
+
+/**
+     * @brief Checks whether a corpus is open.
+     * @return True if a file is mapped.
+     */
+
+bool BreachCorpus::isOpen() const {
+    return file != nullptr;
+}
+
+/**
+     * @brief Gets the number of hash prefixes in the corpus.
+     * @return The number of records.
+     */
+
+size_t BreachCorpus::size() const {
+    return recordCount;
+}
+
+/**
+     * @brief Gets the hash the corpus is keyed by.
+     * @return The hash.
+     */
+
+BreachHash BreachCorpus::hashKind() const {
+    return kind;
+}
+
+/**
+     * @brief Reads record i as a left-aligned big-endian number.
+     * @param index Index of the record.
+     * @return The record.
+     */
+
+uint64_t BreachCorpus::record(size_t index) const {
+    return leadingBytes(records + index * prefixBytes, prefixBytes);
+}
+
+// BLOOM FILTER
+/**
+     * @brief Builds a blocked Bloom filter: each record sets its bits in a single 64-bit word.
+     *
+     * One word per record keeps a check to one memory access, at the cost of
+     * a somewhat higher false positive rate than bits spread over the whole
+     * filter.
+     *
+     * @param bitsPerRecord Bits of memory per record.
+     */
+
+void BreachCorpus::buildBloomFilter(size_t bitsPerRecord) {
+    bloomBits.clear();
+    if (recordCount == 0 || bitsPerRecord == 0) {
+        return;
+    }
+    // The word index is taken from 32 bits of the hash
+    size_t words = min<size_t>((recordCount * bitsPerRecord + 63) / 64, UINT32_MAX);
+    bloomBits.assign(words, 0);
+    bloomHashes = static_cast<unsigned>(clamp<double>(round(static_cast<double>(bitsPerRecord) * log(2.0)), 1, 8));
+    for (size_t i = 0; i < recordCount; i++) {
+        uint64_t hash = mixBits(record(i));
+        bloomBits[bloomWord(hash, words)] |= bloomPattern(hash, bloomHashes);
+    }
+}
+
+/**
+     * @brief Gets the memory taken by the Bloom filter.
+     * @return Bytes.
+     */
+
+size_t BreachCorpus::bloomFilterBytes() const {
+    return bloomBits.size() * sizeof(uint64_t);
+}
+
+/**
+     * @brief Checks the Bloom filter for a prefix.
+     * @param key The prefix, left-aligned in 64 bits.
+     * @return False if the prefix is certainly not in the corpus.
+     */
+
+bool BreachCorpus::bloomMayContain(uint64_t key) const {
+    if (bloomBits.empty()) {
+        return true;
+    }
+    uint64_t hash = mixBits(key);
+    uint64_t pattern = bloomPattern(hash, bloomHashes);
+    return (bloomBits[bloomWord(hash, bloomBits.size())] & pattern) == pattern;
+}
+
+// LOOKUP
+/**
+     * @brief Hashes the password as the corpus is keyed, then looks the hash up.
+     * @param password The password.
+     * @return True if the password is in the corpus.
+     */
+
+bool BreachCorpus::contains(string_view password) const {
+    if (!file) {
+        return false;
+    }
+    uint8_t digest[20];
+    if (kind == BreachHash::Ntlm) {
+        ntlmHash(password, digest);
+    } else {
+        sha1(reinterpret_cast<const uint8_t*>(password.data()), password.size(), digest);
+    }
+    bool found = containsHash(digest);
+    secureZero(digest, sizeof(digest));
+    return found;
+}
+
+/**
+     * @brief Looks a hash up by interpolation search.
+     *
+     * Each step guesses the position of the prefix from its value relative to
+     * the ends of the range, then reads a second record about as far from the
+     * guess as the guess is likely to be off, to close the range from both
+     * sides. For uniform hashes this takes about log log n steps. Should a step
+     * leave more than half of the range, as it can on a skewed file, the next
+     * one bisects, so a lookup never takes more than three times the reads of
+     * a binary search.
+     *
+     * @param digest The hash.
+     * @param probes Receives the number of records read.
+     * @return True if the prefix of the hash is in the corpus.
+     */
+
+bool BreachCorpus::containsHash(const uint8_t* digest, size_t* probes) const {
+    size_t reads = 0;
+    auto finish = [&](bool found) {
+        if (probes) {
+            *probes = reads;
+        }
+        return found;
+    };
+    if (recordCount == 0) {
+        return finish(false);
+    }
+    uint64_t key = leadingBytes(digest, prefixBytes);
+    if (!bloomMayContain(key)) {
+        return finish(false);
+    }
+
+    size_t low = 0;
+    size_t high = recordCount - 1;
+    uint64_t lowKey = firstKey;
+    uint64_t highKey = lastKey;
+    if (key <= lowKey || key >= highKey) {
+        return finish(key == lowKey || key == highKey);
+    }
+
+    // lowKey < key < highKey throughout
+    bool bisect = false;
+    auto narrow = [&](size_t position) {
+        uint64_t probe = record(position);
+        reads++;
+        if (probe < key) {
+            low = position;
+            lowKey = probe;
+        } else if (probe > key) {
+            high = position;
+            highKey = probe;
+        }
+        return probe == key;
+    };
+    while (high - low > 1) {
+        size_t span = high - low;
+        if (bisect) {
+            if (narrow(low + span / 2)) {
+                return finish(true);
+            }
+            bisect = false;
+            continue;
+        }
+
+        double fraction = static_cast<double>(key - lowKey) / static_cast<double>(highKey - lowKey);
+        size_t guess = low + static_cast<size_t>(fraction * static_cast<double>(span) + 0.5);
+        size_t position = clamp(guess, low + 1, high - 1);
+        if (narrow(position)) {
+            return finish(true);
+        }
+        // A guess is typically off by about half the square root of the span, so a second read that far on
+        // usually brackets the key
+        size_t step = max<size_t>(1, static_cast<size_t>(sqrt(static_cast<double>(span)) / 2));
+        size_t second = low == position ? min(position + step, high - 1) : max(position - min(step, position), low + 1);
+        if (second > low && second < high && narrow(second)) {
+            return finish(true);
+        }
+        bisect = high - low > span / 2;
+    }
+    return finish(false);
+}
+
+/**
+     * @brief Looks a hash up by binary search.
+     * @param digest The hash.
+     * @param probes Receives the number of records read.
+     * @return True if the prefix of the hash is in the corpus.
+     */
+
+bool BreachCorpus::containsHashBinarySearch(const uint8_t* digest, size_t* probes) const {
+    uint64_t key = leadingBytes(digest, prefixBytes);
+    size_t reads = 0;
+    size_t low = 0;
+    size_t high = recordCount;
+    while (low < high) {
+        size_t middle = low + (high - low) / 2;
+        reads++;
+        if (record(middle) < key) {
+            low = middle + 1;
+        } else {
+            high = middle;
+        }
+    }
+    bool found = low < recordCount && (reads++, record(low) == key);
+    if (probes) {
+        *probes = reads;
+    }
+    return found;
+}
+
+// CONVERT
+/**
+     * @brief Writes the header, then the prefix of every hash line, dropping repeated prefixes.
+     * @param textPath Path of the text file.
+     * @param corpusPath Path of the corpus file to write.
+     * @param prefixLength Bytes of each hash to keep.
+     * @return Number of records written, or 0 on an error.
+     */
+
+size_t BreachCorpus::convert(const string& textPath, const string& corpusPath, size_t prefixLength) {
+    if (prefixLength < 4 || prefixLength > 8) {
+        cerr << "Error: The Hash Prefix Must Be 4 To 8 Bytes Long!" << endl;
+        return 0;
+    }
+    size_t size = 0;
+    const char* text = mapFile(textPath, size);
+    if (!text) {
+        cerr << "Error: Unable To Open The Breach File " << textPath << "!" << endl;
+        return 0;
+    }
+    ofstream output(corpusPath, ios::binary | ios::trunc);
+    if (!output) {
+        unmapFile(text, size);
+        cerr << "Error: Unable To Create The Breach Corpus File " << corpusPath << "!" << endl;
+        return 0;
+    }
+
+    size_t hexDigits = 0;
+    size_t written = 0;
+    size_t lineNumber = 0;
+    bool failed = false;
+    uint64_t previous = 0;
+    vector<char> buffer;
+    buffer.reserve(1 << 20);
+    const char* end = text + size;
+    for (const char* line = text; line < end && !failed;) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+        lineNumber++;
+
+        size_t digits = 0;
+        while (line + digits < lineEnd && hexValue(line[digits]) >= 0) {
+            digits++;
+        }
+        if (digits == 0 && (line == lineEnd || *line == '\r')) {
+            line = lineEnd + 1;
+            continue;
+        }
+        const char* after = line + digits;
+        bool hashLine = (digits == 40 || digits == 32) && (hexDigits == 0 || digits == hexDigits) &&
+                        (after == lineEnd || *after == ':' || *after == '\r');
+        if (!hashLine) {
+            cerr << "Error: Line " << lineNumber << " Of The Breach File Is Not A SHA-1 Or NTLM Hash!" << endl;
+            failed = true;
+            break;
+        }
+        if (hexDigits == 0) {
+            hexDigits = digits;
+            char header[headerSize] = {};
+            memcpy(header, corpusMagic, sizeof(corpusMagic));
+            header[8] = static_cast<char>(digits == 40 ? BreachHash::Sha1 : BreachHash::Ntlm);
+            header[9] = static_cast<char>(prefixLength);
+            output.write(header, headerSize);
+        }
+
+        uint8_t prefix[8];
+        for (size_t i = 0; i < prefixLength; i++) {
+            prefix[i] = static_cast<uint8_t>(hexValue(line[2 * i]) << 4 | hexValue(line[2 * i + 1]));
+        }
+        uint64_t value = leadingBytes(prefix, prefixLength);
+        if (written > 0 && value < previous) {
+            cerr << "Error: The Breach File Must Be Sorted By Hash (Line " << lineNumber << ")!" << endl;
+            failed = true;
+            break;
+        }
+        if (written == 0 || value != previous) {
+            buffer.insert(buffer.end(), prefix, prefix + prefixLength);
+            written++;
+            previous = value;
+            if (buffer.size() >= (1 << 20)) {
+                output.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+                buffer.clear();
+            }
+        }
+        line = lineEnd + 1;
+    }
+    output.write(buffer.data(), static_cast<streamsize>(buffer.size()));
+    unmapFile(text, size);
+
+    if (!failed && written == 0) {
+        cerr << "Error: The Breach File Holds No Hashes!" << endl;
+        failed = true;
+    }
+    if (!failed && !output.flush()) {
+        cerr << "Error: Unable To Write The Breach Corpus File " << corpusPath << "!" << endl;
+        failed = true;
+    }
+    if (failed) {
+        output.close();
+        remove(corpusPath.c_str());
+        return 0;
+    }
+    return written;
+}
@@ -0,0 +1,215 @@
+#ifndef PASSWORDMANAGER_BREACHCORPUS_H
+#define PASSWORDMANAGER_BREACHCORPUS_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+/**
+ * @file BreachCorpus.h
+ * @brief Offline check of passwords against a local corpus of breached password hashes.
+ */
+
+/**
+ * @brief Name of the breach corpus file used when none is given.
+ */
+
+const string defaultBreachCorpusFile = "breach-corpus.bin";
+
+/**
+ * @brief Hash a breach corpus is keyed by, as in the Pwned Passwords downloads.
+ */
+
+enum class BreachHash : uint8_t {
+    Sha1 = 1,       ///< SHA-1 of the UTF-8 password
+    Ntlm = 2        ///< NTLM: MD4 of the UTF-16LE password
+};
+
+// HASHES
+/**
+ * @brief Computes the SHA-1 digest of a message (FIPS 180-4).
+ * @param data Message bytes.
+ * @param length Message length.
+ * @param digest Receives the 20-byte digest.
+ */
+
+void sha1(const uint8_t *data, size_t length, uint8_t *digest);
+
+/**
+ * @brief Computes the NTLM hash of a password: MD4 (RFC 1320) of its UTF-16LE encoding.
+ * @param password The password in UTF-8; invalid bytes count as U+FFFD.
+ * @param digest Receives the 16-byte hash.
+ */
+
+void ntlmHash(string_view password, uint8_t *digest);
+
+/**
+ * @brief A memory-mapped, sorted file of breached password hash prefixes.
+ *
+ * The file starts with a 16-byte header: the magic "PMBREACH", the hash
+ * (BreachHash) and the prefix length in bytes (4 to 8), then six zero
+ * bytes. Then come the leading bytes of every hash in the corpus, sorted in
+ * ascending order with repeats removed. Eight-byte prefixes of a billion
+ * hashes take 8 GB, and a password that is not in the corpus matches one
+ * only about once in 2^34 checks.
+ *
+ * Hashes are uniformly distributed, so a lookup interpolates where the
+ * prefix should be instead of halving the range: it touches a handful of
+ * records, and so a handful of pages, even in a multi-gigabyte file.
+ * An optional Bloom filter in memory answers most misses without touching
+ * the file at all.
+ *
+ * Build the file from a Pwned Passwords text download ("HASH:COUNT" lines
+ * sorted by hash) with convert().
+ */
+
+class BreachCorpus {
+private:
+    const uint8_t *file = nullptr;      /**< The mapped file. */
+    size_t fileSize = 0;                /**< Bytes mapped. */
+    const uint8_t *records = nullptr;   /**< First record, after the header. */
+    size_t recordCount = 0;             /**< Number of records. */
+    size_t prefixBytes = 0;             /**< Bytes per record. */
+    BreachHash kind = BreachHash::Sha1; /**< Hash the records are prefixes of. */
+    uint64_t firstKey = 0;              /**< The smallest record, where every search starts. */
+    uint64_t lastKey = 0;               /**< The largest record. */
+    vector<uint64_t> bloomBits;         /**< Bloom filter over the records; empty when not built. */
+    unsigned bloomHashes = 0;           /**< Bits set per record in the Bloom filter. */
+
+    /**
+     * @brief Reads record i as a number, the prefix bytes in big-endian order.
+     * @param index Index of the record.
+     * @return The record, left-aligned in 64 bits.
+     */
+
+    uint64_t record(size_t index) const;
+
+    /**
+     * @brief Checks whether the Bloom filter may hold a prefix.
+     * @param key The prefix, left-aligned in 64 bits.
+     * @return False if the prefix is certainly not in the corpus.
+     */
+
+    bool bloomMayContain(uint64_t key) const;
+
+public:
+    static const size_t headerSize = 16;    /**< Bytes before the first record. */
+
+    /**
+     * @brief Constructor for BreachCorpus class; no file is open.
+     */
+
+    BreachCorpus() = default;
+
+    /**
+     * @brief Destructor; unmaps the file.
+     */
+
+    ~BreachCorpus();
+
+    BreachCorpus(const BreachCorpus &) = delete;
+    BreachCorpus &operator=(const BreachCorpus &) = delete;
+
+    // OPEN
+    /**
+     * @brief Maps a corpus file, replacing the one open before.
+     * @param path Path of the file.
+     * @return True if the file could be mapped and has a valid header.
+     */
+
+    bool open(const string &path);
+
+    /**
+     * @brief Unmaps the file and drops the Bloom filter.
+     */
+
+    void close();
+
+    /**
+     * @brief Checks whether a corpus is open.
+     * @return True if a file is mapped.
+     */
+
+    bool isOpen() const;
+
+    /**
+     * @brief Gets the number of hash prefixes in the corpus.
+     * @return The number of records.
+     */
+
+    size_t size() const;
+
+    /**
+     * @brief Gets the hash the corpus is keyed by.
+     * @return The hash.
+     */
+
+    BreachHash hashKind() const;
+
+    // BLOOM FILTER
+    /**
+     * @brief Builds a Bloom filter over every record, reading the file once.
+     *
+     * Ten bits per record give about one false positive in a hundred, and
+     * each false positive costs one lookup in the file.
+     *
+     * @param bitsPerRecord Bits of memory per record.
+     */
+
+    void buildBloomFilter(size_t bitsPerRecord = 10);
+
+    /**
+     * @brief Gets the memory taken by the Bloom filter.
+     * @return Bytes; 0 when no filter is built.
+     */
+
+    size_t bloomFilterBytes() const;
+
+    // LOOKUP
+    /**
+     * @brief Checks whether a password is in the corpus.
+     * @param password The password.
+     * @return True if the prefix of its hash is in the corpus.
+     */
+
+    bool contains(string_view password) const;
+
+    /**
+     * @brief Checks whether a hash is in the corpus.
+     * @param digest The SHA-1 or NTLM hash, matching hashKind().
+     * @param probes Receives the number of records read, if not null.
+     * @return True if the prefix of the hash is in the corpus.
+     */
+
+    bool containsHash(const uint8_t *digest, size_t *probes = nullptr) const;
+
+    /**
+     * @brief Checks whether a hash is in the corpus by plain binary search, for comparison.
+     * @param digest The hash.
+     * @param probes Receives the number of records read, if not null.
+     * @return True if the prefix of the hash is in the corpus.
+     */
+
+    bool containsHashBinarySearch(const uint8_t *digest, size_t *probes = nullptr) const;
+
+    // CONVERT
+    /**
+     * @brief Writes a corpus file from a Pwned Passwords text file.
+     *
+     * Every line holds a hash in hexadecimal, 40 digits for SHA-1 or 32 for
+     * NTLM, optionally followed by ":" and a count. The lines must be sorted
+     * by hash, as in the downloads ordered by hash.
+     *
+     * @param textPath Path of the text file.
+     * @param corpusPath Path of the corpus file to write.
+     * @param prefixLength Bytes of each hash to keep, 4 to 8.
+     * @return Number of records written, or 0 on an error, which is printed.
+     */
+
+    static size_t convert(const string &textPath, const string &corpusPath, size_t prefixLength = 8);
+};
+
+#endif //PASSWORDMANAGER_BREACHCORPUS_H
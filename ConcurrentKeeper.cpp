@@ -0,0 +1,536 @@
+/**
+ * @file ConcurrentKeeper.cpp
+ * @brief Implementation of the thread-safe password keeper and its snapshots.
+ */
+
+#include "ConcurrentKeeper.h"
+#include "TextFold.h"
+#include "WebsiteIndex.h"
+#include <algorithm>
+#include <utility>
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Appends an entry to a block being built, folding its fields into the scan text.
+ */
+
+void appendEntry(SnapshotBlock& block, SnapshotEntry entry) {
+    const KeyData& data = *entry.entry;
+    for (const string* field : {&data.name, &data.category, &data.website, &data.login}) {
+        block.fields.append(foldForSearch(*field)).push_back('\n');
+    }
+    block.fieldEnds.push_back(static_cast<uint32_t>(block.fields.size()));
+    if (!data.encrypted) {
+        block.passwords.append(data.password);
+    }
+    block.passwords.append("\n");
+    block.passwordEnds.push_back(static_cast<uint32_t>(block.passwords.size()));
+    block.entries.push_back(move(entry));
+}
+
+/**
+ * @brief Appends an entry of another block, copying its scan text rather than folding it again.
+ */
+
+void copyEntry(SnapshotBlock& block, const SnapshotBlock& from, size_t index) {
+    size_t fieldsBegin = index == 0 ? 0 : from.fieldEnds[index - 1];
+    block.fields.append(from.fields, fieldsBegin, from.fieldEnds[index] - fieldsBegin);
+    block.fieldEnds.push_back(static_cast<uint32_t>(block.fields.size()));
+    size_t passwordsBegin = index == 0 ? 0 : from.passwordEnds[index - 1];
+    block.passwords.append(string_view(from.passwords).substr(passwordsBegin, from.passwordEnds[index] - passwordsBegin));
+    block.passwordEnds.push_back(static_cast<uint32_t>(block.passwords.size()));
+    block.entries.push_back(from.entries[index]);
+}
+
+/**
+ * @brief Copies a block with one of its entries replaced, or left out if the replacement is null.
+ */
+
+shared_ptr<SnapshotBlock> spliceBlock(const SnapshotBlock& from, size_t index, const SnapshotEntry* replacement) {
+    auto block = make_shared<SnapshotBlock>();
+    block->entries.reserve(from.entries.size());
+    block->fields.reserve(from.fields.size() + 64);
+    block->passwords.reserve(from.passwords.size() + 32);
+    for (size_t i = 0; i < from.entries.size(); i++) {
+        if (i != index) {
+            copyEntry(*block, from, i);
+        } else if (replacement) {
+            appendEntry(*block, *replacement);
+        }
+    }
+    return block;
+}
+
+/**
+ * @brief Finds the block holding the entry with an order, and its index in the block.
+ */
+
+pair<size_t, size_t> locate(const vector<shared_ptr<const SnapshotBlock>>& blocks, uint64_t order) {
+    auto block = lower_bound(blocks.begin(), blocks.end(), order, [](const auto& candidate, uint64_t wanted) {
+        return candidate->entries.back().order < wanted;
+    });
+    const vector<SnapshotEntry>& entries = (*block)->entries;
+    auto entry = lower_bound(entries.begin(), entries.end(), order, [](const SnapshotEntry& candidate, uint64_t wanted) {
+        return candidate.order < wanted;
+    });
+    return {static_cast<size_t>(block - blocks.begin()), static_cast<size_t>(entry - entries.begin())};
+}
+
+/**
+ * @brief Finds the entries whose text in a packed column contains the query, adding them to the matched flags.
+ */
+
+void scanColumn(string_view column, const vector<uint32_t>& ends, string_view query, vector<uint8_t>& matched) {
+    // No field holds a newline, so a match never runs from one entry into the next
+    size_t position = 0;
+    while (position < column.size()) {
+        size_t hit = column.find(query, position);
+        if (hit == string_view::npos) {
+            break;
+        }
+        size_t index = upper_bound(ends.begin(), ends.end(), hit) - ends.begin();
+        matched[index] = 1;
+        position = ends[index];
+    }
+}
+
+} // namespace
+
+// SNAPSHOT
+/**
+     * @brief Hashes the name to a shard.
+     * @param name The name.
+     * @return Index of the shard.
+     */
+
+size_t VaultSnapshot::shardOf(const string& name) {
+    return hash<string>{}(name) % shardCount;
+}
+
+/**
+     * @brief Gets the number of entries.
+     * @return The entry count.
+     */
+
+size_t VaultSnapshot::size() const {
+    return entryCount;
+}
+
+/**
+     * @brief Looks the name up in the index of its shard.
+     * @param name The name.
+     * @return The entry, or nullptr.
+     */
+
+const KeyData* VaultSnapshot::findByName(const string& name) const {
+    const SnapshotShard& shard = *shards[shardOf(name)];
+    auto it = shard.byName.find(name);
+    return it != shard.byName.end() ? it->second.front().entry.get() : nullptr;
+}
+
+/**
+     * @brief Scans the packed fields and passwords of every block in vault order.
+     * @param query The search query.
+     * @param caseSensitive Whether to match the fields byte for byte.
+     * @return The matching entries.
+     */
+
+vector<KeyData> VaultSnapshot::searchPasswords(const string& query, bool caseSensitive) const {
+    vector<KeyData> results;
+    if (query.find('\n') != string::npos) {
+        return results;
+    }
+    string foldedQuery = caseSensitive ? query : foldForSearch(query);
+    vector<uint8_t> matched;
+    for (const auto& block : blocks) {
+        matched.assign(block->entries.size(), 0);
+        if (caseSensitive) {
+            for (size_t i = 0; i < block->entries.size(); i++) {
+                const KeyData& entry = *block->entries[i].entry;
+                matched[i] = entry.name.find(query) != string::npos ||
+                             entry.category.find(query) != string::npos ||
+                             entry.website.find(query) != string::npos ||
+                             entry.login.find(query) != string::npos;
+            }
+        } else {
+            scanColumn(block->fields, block->fieldEnds, foldedQuery, matched);
+        }
+        // Passwords are never folded; encrypted ones are not in the column
+        scanColumn(block->passwords, block->passwordEnds, query, matched);
+        for (size_t i = 0; i < matched.size(); i++) {
+            if (matched[i]) {
+                results.push_back(*block->entries[i].entry);
+            }
+        }
+    }
+    return results;
+}
+
+// READER
+/**
+     * @brief Constructor; enters the reclaimer, then loads the snapshot.
+     * @param keeper The keeper.
+     */
+
+ConcurrentPasswordKeeper::Reader::Reader(const ConcurrentPasswordKeeper& keeper)
+    : guard(keeper.reclaimer), snapshot(keeper.current.load(memory_order_seq_cst)) {
+}
+
+/**
+     * @brief Gets the snapshot.
+     * @return The snapshot.
+     */
+
+const VaultSnapshot& ConcurrentPasswordKeeper::Reader::operator*() const {
+    return *snapshot;
+}
+
+/**
+     * @brief Gets the snapshot.
+     * @return The snapshot.
+     */
+
+const VaultSnapshot* ConcurrentPasswordKeeper::Reader::operator->() const {
+    return snapshot;
+}
+
+// CONSTRUCTOR
+/**
+     * @brief Constructor.
+     * Loads the vault and publishes its first snapshot.
+     * @param filePath Path to the file storing the passwords.
+     */
+
+ConcurrentPasswordKeeper::ConcurrentPasswordKeeper(const string& filePath) : keeper(filePath) {
+    lock_guard<mutex> guard(writeLock);
+    publishAll();
+}
+
+/**
+ * @brief Destructor.
+ * Frees the current snapshot; the reclaimer frees the retired ones.
+ */
+
+ConcurrentPasswordKeeper::~ConcurrentPasswordKeeper() {
+    delete current.load();
+}
+
+// PUBLISH
+/**
+     * @brief Swaps the snapshot in and hands the old one to the reclaimer.
+     * @param snapshot The new snapshot.
+     */
+
+void ConcurrentPasswordKeeper::publish(unique_ptr<VaultSnapshot> snapshot) {
+    const VaultSnapshot* previous = current.load(memory_order_relaxed);
+    snapshot->version = previous ? previous->version + 1 : 0;
+    current.store(snapshot.release(), memory_order_seq_cst);
+    if (previous) {
+        reclaimer.retire([previous] { delete previous; });
+    }
+}
+
+/**
+     * @brief Packs every entry of the keeper into fresh blocks and shards.
+     */
+
+void ConcurrentPasswordKeeper::publishAll() {
+    const vector<KeyData>& entries = keeper.getPasswords();
+    array<shared_ptr<SnapshotShard>, VaultSnapshot::shardCount> shards;
+    for (auto& shard : shards) {
+        shard = make_shared<SnapshotShard>();
+    }
+    auto snapshot = make_unique<VaultSnapshot>();
+    shared_ptr<SnapshotBlock> block;
+    nextOrder = 0;
+    for (const KeyData& data : entries) {
+        if (!block || block->entries.size() == SnapshotBlock::capacity) {
+            block = make_shared<SnapshotBlock>();
+            snapshot->blocks.push_back(block);
+        }
+        SnapshotEntry entry{nextOrder++, make_shared<const KeyData>(data)};
+        shards[VaultSnapshot::shardOf(data.name)]->byName[data.name].push_back(entry);
+        appendEntry(*block, move(entry));
+    }
+
+    for (size_t i = 0; i < VaultSnapshot::shardCount; i++) {
+        snapshot->shards[i] = move(shards[i]);
+    }
+    snapshot->entryCount = entries.size();
+    publish(move(snapshot));
+}
+
+/**
+     * @brief Copies the last block, or starts a new one if it is full, and the shard of the name.
+     */
+
+void ConcurrentPasswordKeeper::publishAppend() {
+    const VaultSnapshot& previous = *current.load(memory_order_relaxed);
+    const KeyData& data = keeper.getPasswords().back();
+    SnapshotEntry entry{nextOrder++, make_shared<const KeyData>(data)};
+
+    auto snapshot = make_unique<VaultSnapshot>();
+    snapshot->blocks = previous.blocks;
+    snapshot->shards = previous.shards;
+    snapshot->entryCount = previous.entryCount + 1;
+
+    size_t index = VaultSnapshot::shardOf(data.name);
+    auto shard = make_shared<SnapshotShard>(*previous.shards[index]);
+    shard->byName[data.name].push_back(entry);
+    snapshot->shards[index] = move(shard);
+
+    if (snapshot->blocks.empty() || snapshot->blocks.back()->entries.size() == SnapshotBlock::capacity) {
+        auto block = make_shared<SnapshotBlock>();
+        appendEntry(*block, move(entry));
+        snapshot->blocks.push_back(move(block));
+    } else {
+        const SnapshotBlock& last = *snapshot->blocks.back();
+        auto block = spliceBlock(last, last.entries.size(), nullptr);
+        appendEntry(*block, move(entry));
+        snapshot->blocks.back() = move(block);
+    }
+    publish(move(snapshot));
+}
+
+/**
+     * @brief Copies the block and the shard of the first entry with the name, with the keeper's entry in its place.
+     * @param name The name.
+     */
+
+void ConcurrentPasswordKeeper::publishReplace(const string& name) {
+    const VaultSnapshot& previous = *current.load(memory_order_relaxed);
+    size_t index = VaultSnapshot::shardOf(name);
+    auto found = previous.shards[index]->byName.find(name);
+    if (found == previous.shards[index]->byName.end()) {
+        return;
+    }
+    const SnapshotEntry& old = found->second.front();
+    const KeyData* data = keeper.findEntry(old.entry->id);
+    if (!data) {
+        publishAll();
+        return;
+    }
+    SnapshotEntry entry{old.order, make_shared<const KeyData>(*data)};
+
+    auto snapshot = make_unique<VaultSnapshot>();
+    snapshot->blocks = previous.blocks;
+    snapshot->shards = previous.shards;
+    snapshot->entryCount = previous.entryCount;
+
+    auto [blockIndex, position] = locate(previous.blocks, entry.order);
+    snapshot->blocks[blockIndex] = spliceBlock(*previous.blocks[blockIndex], position, &entry);
+    auto shard = make_shared<SnapshotShard>(*previous.shards[index]);
+    shard->byName[name].front() = move(entry);
+    snapshot->shards[index] = move(shard);
+    publish(move(snapshot));
+}
+
+/**
+     * @brief Copies the block and the shard of the first entry with the name, without it.
+     * @param name The name.
+     */
+
+void ConcurrentPasswordKeeper::publishRemove(const string& name) {
+    const VaultSnapshot& previous = *current.load(memory_order_relaxed);
+    size_t index = VaultSnapshot::shardOf(name);
+    auto found = previous.shards[index]->byName.find(name);
+    if (found == previous.shards[index]->byName.end()) {
+        publishAll();
+        return;
+    }
+    uint64_t order = found->second.front().order;
+
+    auto snapshot = make_unique<VaultSnapshot>();
+    snapshot->blocks = previous.blocks;
+    snapshot->shards = previous.shards;
+    snapshot->entryCount = previous.entryCount - 1;
+
+    auto [blockIndex, position] = locate(previous.blocks, order);
+    if (previous.blocks[blockIndex]->entries.size() == 1) {
+        snapshot->blocks.erase(snapshot->blocks.begin() + static_cast<ptrdiff_t>(blockIndex));
+    } else {
+        snapshot->blocks[blockIndex] = spliceBlock(*previous.blocks[blockIndex], position, nullptr);
+    }
+    auto shard = make_shared<SnapshotShard>(*previous.shards[index]);
+    vector<SnapshotEntry>& named = shard->byName[name];
+    named.erase(named.begin());
+    if (named.empty()) {
+        shard->byName.erase(name);
+    }
+    snapshot->shards[index] = move(shard);
+    publish(move(snapshot));
+}
+
+// READ
+/**
+     * @brief Gets the number of entries.
+     * @return The entry count.
+     */
+
+size_t ConcurrentPasswordKeeper::size() const {
+    Reader reader(*this);
+    return reader->size();
+}
+
+/**
+     * @brief Copies the first entry with the name out of the current snapshot.
+     * @param name The name.
+     * @param entry Receives the entry.
+     * @return True if found.
+     */
+
+bool ConcurrentPasswordKeeper::findByName(const string& name, KeyData& entry) const {
+    Reader reader(*this);
+    const KeyData* found = reader->findByName(name);
+    if (!found) {
+        return false;
+    }
+    entry = *found;
+    return true;
+}
+
+/**
+     * @brief Searches the current snapshot.
+     * @param query The search query.
+     * @param caseSensitive Whether to match the fields byte for byte.
+     * @return The matching entries.
+     */
+
+vector<KeyData> ConcurrentPasswordKeeper::searchPasswords(const string& query, bool caseSensitive) const {
+    Reader reader(*this);
+    return reader->searchPasswords(query, caseSensitive);
+}
+
+/**
+     * @brief Reveals the password under the write lock.
+     * @param entry The entry.
+     * @return The password.
+     */
+
+SecretText ConcurrentPasswordKeeper::revealPassword(const KeyData& entry) {
+    lock_guard<mutex> guard(writeLock);
+    return keeper.revealPassword(entry);
+}
+
+// WRITE
+/**
+     * @brief Adds the entry to the keeper and appends it to the snapshot, or replaces the copy it overwrote.
+     * @param name Name of the password.
+     * @param password Password.
+     * @param category Category of the password.
+     * @param website Website associated with the password.
+     * @param login Login associated with the password.
+     */
+
+void ConcurrentPasswordKeeper::addPassword(const string& name, const string& password, const string& category,
+                                           const string& website, const string& login) {
+    lock_guard<mutex> guard(writeLock);
+    size_t before = keeper.getPasswords().size();
+    keeper.addPassword(name, password, category, website, login);
+    if (keeper.getPasswords().size() > before) {
+        publishAppend();
+    } else {
+        // Either a duplicate was refused or the first entry with the name was overwritten in place
+        publishReplace(name);
+    }
+}
+
+/**
+     * @brief Edits the entry in the keeper and replaces its copy in the snapshot.
+     * @param name Name of the password entry.
+     * @param newPassword New password.
+     */
+
+void ConcurrentPasswordKeeper::editPassword(const string& name, const string& newPassword) {
+    lock_guard<mutex> guard(writeLock);
+    keeper.editPassword(name, newPassword);
+    publishReplace(name);
+}
+
+/**
+     * @brief Deletes the entry from the keeper and from the snapshot.
+     * @param name Name of the password entry.
+     */
+
+void ConcurrentPasswordKeeper::deletePassword(const string& name) {
+    lock_guard<mutex> guard(writeLock);
+    size_t before = keeper.getPasswords().size();
+    keeper.deletePassword(name);
+    if (keeper.getPasswords().size() < before) {
+        publishRemove(name);
+    }
+}
+
+/**
+     * @brief Adds the category to the keeper and appends its entry, which has no name, to the snapshot.
+     * @param categoryName Name of the category.
+     */
+
+void ConcurrentPasswordKeeper::addCategory(const string& categoryName) {
+    lock_guard<mutex> guard(writeLock);
+    size_t before = keeper.getPasswords().size();
+    keeper.addCategory(categoryName);
+    if (keeper.getPasswords().size() > before) {
+        publishAppend();
+    }
+}
+
+/**
+     * @brief Deletes the category from the keeper and publishes a full snapshot.
+     * @param categoryName Name of the category.
+     */
+
+void ConcurrentPasswordKeeper::deleteCategory(const string& categoryName) {
+    update([&categoryName](PasswordKeeper& vault) { vault.deleteCategory(categoryName); });
+}
+
+/**
+     * @brief Unlocks the keeper; older vaults are migrated to the derived key, so a full snapshot follows.
+     * @param masterPassword The master password.
+     * @return True if unlocked.
+     */
+
+bool ConcurrentPasswordKeeper::unlock(const string& masterPassword) {
+    bool unlocked = false;
+    update([&](PasswordKeeper& vault) { unlocked = vault.unlock(masterPassword); });
+    return unlocked;
+}
+
+/**
+     * @brief Encrypts every entry and publishes a full snapshot.
+     */
+
+void ConcurrentPasswordKeeper::encryptAllPasswords() {
+    update([](PasswordKeeper& vault) { vault.encryptAllPasswords(); });
+}
+
+/**
+     * @brief Decrypts every entry and publishes a full snapshot.
+     */
+
+void ConcurrentPasswordKeeper::decryptAllPasswords() {
+    update([](PasswordKeeper& vault) { vault.decryptAllPasswords(); });
+}
+
+/**
+     * @brief Saves the vault; the entries do not change, so nothing is published.
+     */
+
+void ConcurrentPasswordKeeper::savePasswordsToFile() {
+    lock_guard<mutex> guard(writeLock);
+    keeper.savePasswordsToFile();
+}
+
+/**
+     * @brief Runs the change under the write lock and publishes a full snapshot.
+     * @param change Function given the keeper.
+     */
+
+void ConcurrentPasswordKeeper::update(const function<void(PasswordKeeper&)>& change) {
+    lock_guard<mutex> guard(writeLock);
+    change(keeper);
+    publishAll();
+}
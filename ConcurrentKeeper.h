@@ -0,0 +1,338 @@
+#ifndef PASSWORDMANAGER_CONCURRENTKEEPER_H
+#define PASSWORDMANAGER_CONCURRENTKEEPER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "DataStorage.h"
+#include "EpochReclaimer.h"
+using namespace std;
+
+/**
+ * @file ConcurrentKeeper.h
+ * @brief Thread-safe password keeper: one writer at a time, readers on immutable snapshots.
+ */
+
+/**
+ * @brief An entry of a snapshot with its place in vault order.
+ */
+
+class SnapshotEntry {
+public:
+    uint64_t order = 0;                 /**< Position in vault order; deletions leave gaps. */
+    shared_ptr<const KeyData> entry;    /**< The entry, shared by every snapshot that did not change it. */
+};
+
+/**
+ * @brief A run of consecutive entries of a snapshot, laid out for scanning.
+ *
+ * The folded searchable fields of all its entries are packed into one
+ * string, and the passwords that are not encrypted into one secret text, so
+ * a search runs a single substring scan over each instead of visiting every
+ * entry.
+ */
+
+class SnapshotBlock {
+public:
+    static const size_t capacity = 256;     /**< Entries a block holds at most. */
+
+    vector<SnapshotEntry> entries;          /**< The entries, in vault order. */
+    string fields;                          /**< Folded name, category, website and login of each entry, each ended by a newline. */
+    vector<uint32_t> fieldEnds;             /**< Where the fields of each entry end in fields. */
+    SecretText passwords;                   /**< Password of each entry that is not encrypted, each ended by a newline. */
+    vector<uint32_t> passwordEnds;          /**< Where the password of each entry ends in passwords. */
+};
+
+/**
+ * @brief The entries of a snapshot whose names hash to one shard, for lookups by name.
+ */
+
+class SnapshotShard {
+public:
+    unordered_map<string, vector<SnapshotEntry>> byName;   /**< Entries with each name, in vault order. */
+};
+
+/**
+ * @brief An immutable copy of the vault at one point in time.
+ *
+ * Entries are kept in vault order in blocks, which searches scan from start
+ * to end, and indexed by name in shards chosen by a hash of the name. A
+ * writer that adds, edits or deletes one entry copies only its block and its
+ * shard and shares every other one with the previous snapshot, so a write
+ * costs a small fraction of the vault rather than all of it.
+ */
+
+class VaultSnapshot {
+public:
+    static const size_t shardCount = 1024;  /**< Shards of every snapshot. */
+
+    vector<shared_ptr<const SnapshotBlock>> blocks;             /**< The entries in vault order; no block is empty. */
+    array<shared_ptr<const SnapshotShard>, shardCount> shards;  /**< The name index; never null. */
+    size_t entryCount = 0;                                      /**< Entries over all blocks. */
+    uint64_t version = 0;                                       /**< Number of snapshots published before this one. */
+
+    /**
+     * @brief Gets the shard an entry name belongs to.
+     * @param name The name.
+     * @return Index of the shard.
+     */
+
+    static size_t shardOf(const string &name);
+
+    /**
+     * @brief Gets the number of entries.
+     * @return The entry count.
+     */
+
+    size_t size() const;
+
+    /**
+     * @brief Finds the first entry with a name, as PasswordKeeper::editPassword does.
+     * @param name The name.
+     * @return The entry, valid while the snapshot is held; nullptr if there is none.
+     */
+
+    const KeyData *findByName(const string &name) const;
+
+    /**
+     * @brief Searches the entries the way PasswordKeeper::searchPasswords does, in vault order.
+     * @param query Query string to search for.
+     * @param caseSensitive Whether to match the fields byte for byte.
+     * @return Copies of the matching entries.
+     */
+
+    vector<KeyData> searchPasswords(const string &query, bool caseSensitive = false) const;
+};
+
+/**
+ * @brief A PasswordKeeper that many threads can read while another writes.
+ *
+ * Writers take a single lock, change the wrapped keeper and publish a new
+ * snapshot with one atomic store. Readers take no lock: they load the
+ * current snapshot inside an epoch guard (see EpochReclaimer), so they never
+ * wait for a writer or for each other, and a snapshot is only freed once
+ * the last reader that could hold it has left.
+ *
+ * The snapshot keeps its own copy of the entries, so the passwords of the
+ * vault are held twice in the secure arena.
+ */
+
+class ConcurrentPasswordKeeper {
+private:
+    PasswordKeeper keeper;                          /**< The vault; only touched with writeLock held. */
+    mutable mutex writeLock;                        /**< Serializes writers. */
+    mutable EpochReclaimer reclaimer;               /**< Frees replaced snapshots once readers are done. */
+    atomic<const VaultSnapshot *> current{nullptr}; /**< Latest published snapshot. */
+    uint64_t nextOrder = 0;                         /**< Vault order given to the next appended entry. */
+
+    /**
+     * @brief Publishes a snapshot and retires the one it replaces; writeLock must be held.
+     * @param snapshot The new snapshot.
+     */
+
+    void publish(unique_ptr<VaultSnapshot> snapshot);
+
+    /**
+     * @brief Publishes a snapshot built from every entry of the keeper; writeLock must be held.
+     */
+
+    void publishAll();
+
+    /**
+     * @brief Publishes a snapshot with the last entry of the keeper appended; writeLock must be held.
+     */
+
+    void publishAppend();
+
+    /**
+     * @brief Publishes a snapshot with the first entry of a name copied again from the keeper; writeLock must be held.
+     * @param name The name.
+     */
+
+    void publishReplace(const string &name);
+
+    /**
+     * @brief Publishes a snapshot without the first entry of a name; writeLock must be held.
+     * @param name The name.
+     */
+
+    void publishRemove(const string &name);
+
+public:
+
+    /**
+     * @brief Keeps the current snapshot alive for as long as it is in scope.
+     *
+     * Every lookup through one reader sees the same snapshot, and pointers it
+     * returns stay valid until the reader goes out of scope. Writers are
+     * never blocked by a reader.
+     */
+
+    class Reader {
+    private:
+        EpochReclaimer::ReadGuard guard;    /**< Announces the reader; constructed before the snapshot is loaded. */
+        const VaultSnapshot *snapshot;      /**< The snapshot read. */
+
+    public:
+        /**
+         * @brief Enters the reclaimer and loads the current snapshot.
+         * @param keeper The keeper.
+         */
+
+        explicit Reader(const ConcurrentPasswordKeeper &keeper);
+
+        Reader(const Reader &) = delete;
+        Reader &operator=(const Reader &) = delete;
+
+        /**
+         * @brief Gets the snapshot.
+         * @return The snapshot.
+         */
+
+        const VaultSnapshot &operator*() const;
+
+        /**
+         * @brief Gets the snapshot.
+         * @return The snapshot.
+         */
+
+        const VaultSnapshot *operator->() const;
+    };
+
+    /**
+     * @brief Constructor for ConcurrentPasswordKeeper class.
+     * @param filePath Path to the file storing the passwords.
+     */
+
+    explicit ConcurrentPasswordKeeper(const string &filePath);
+
+    /**
+     * @brief Destructor; no reader may still be inside.
+     */
+
+    ~ConcurrentPasswordKeeper();
+
+    ConcurrentPasswordKeeper(const ConcurrentPasswordKeeper &) = delete;
+    ConcurrentPasswordKeeper &operator=(const ConcurrentPasswordKeeper &) = delete;
+
+    // READ
+    /**
+     * @brief Gets the number of entries in the current snapshot.
+     * @return The entry count.
+     */
+
+    size_t size() const;
+
+    /**
+     * @brief Finds the first entry with a name in the current snapshot.
+     * @param name The name.
+     * @param entry Receives a copy of the entry.
+     * @return False if there is none.
+     */
+
+    bool findByName(const string &name, KeyData &entry) const;
+
+    /**
+     * @brief Searches the current snapshot (see VaultSnapshot::searchPasswords).
+     * @param query Query string to search for.
+     * @param caseSensitive Whether to match the fields byte for byte.
+     * @return Copies of the matching entries.
+     */
+
+    vector<KeyData> searchPasswords(const string &query, bool caseSensitive = false) const;
+
+    /**
+     * @brief Gets the password of an entry, decrypting it if needed (see PasswordKeeper::revealPassword).
+     *
+     * The reveal cache is shared, so this takes the write lock.
+     *
+     * @param entry The entry, e.g. from a snapshot.
+     * @return The password.
+     */
+
+    SecretText revealPassword(const KeyData &entry);
+
+    // WRITE
+    /**
+     * @brief Adds a password entry (see PasswordKeeper::addPassword).
+     * @param name Name of the password.
+     * @param password Password.
+     * @param category Category of the password.
+     * @param website Website associated with the password.
+     * @param login Login associated with the password.
+     */
+
+    void addPassword(const string &name, const string &password, const string &category = "",
+                     const string &website = "", const string &login = "");
+
+    /**
+     * @brief Edits the password of the first entry with a name.
+     * @param name Name of the password entry.
+     * @param newPassword New password.
+     */
+
+    void editPassword(const string &name, const string &newPassword);
+
+    /**
+     * @brief Deletes the first entry with a name.
+     * @param name Name of the password entry.
+     */
+
+    void deletePassword(const string &name);
+
+    /**
+     * @brief Adds a category.
+     * @param categoryName Name of the category.
+     */
+
+    void addCategory(const string &categoryName);
+
+    /**
+     * @brief Deletes a category and every entry in it.
+     * @param categoryName Name of the category.
+     */
+
+    void deleteCategory(const string &categoryName);
+
+    /**
+     * @brief Derives the session key (see PasswordKeeper::unlock).
+     * @param masterPassword The master password.
+     * @return False if the master password is wrong or empty.
+     */
+
+    bool unlock(const string &masterPassword);
+
+    /**
+     * @brief Encrypts every password entry.
+     */
+
+    void encryptAllPasswords();
+
+    /**
+     * @brief Decrypts every password entry.
+     */
+
+    void decryptAllPasswords();
+
+    /**
+     * @brief Saves the vault to its source file.
+     */
+
+    void savePasswordsToFile();
+
+    /**
+     * @brief Runs any change on the wrapped keeper under the write lock, then publishes a full snapshot.
+     * @param change Function given the keeper.
+     */
+
+    void update(const function<void(PasswordKeeper &)> &change);
+};
+
+#endif //PASSWORDMANAGER_CONCURRENTKEEPER_H
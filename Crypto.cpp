@@ -0,0 +1,995 @@
+/**
+ * @file Crypto.cpp
+ * @brief Implementation of ChaCha20-Poly1305 with runtime-selected SIMD kernels.
+ */
+
+#include "Crypto.h"
+#include <array>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#include <bcrypt.h>
+#elif defined(__linux__)
+#include <sys/random.h>
+#include <cerrno>
+#endif
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PASSWORDMANAGER_X86_KERNELS 1
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+uint32_t load32(const uint8_t* p) {
+    return uint32_t(p[0]) | (uint32_t(p[1]) << 8) | (uint32_t(p[2]) << 16) | (uint32_t(p[3]) << 24);
+}
+
+void store32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v);
+    p[1] = uint8_t(v >> 8);
+    p[2] = uint8_t(v >> 16);
+    p[3] = uint8_t(v >> 24);
+}
+
+void store64(uint8_t* p, uint64_t v) {
+    store32(p, uint32_t(v));
+    store32(p + 4, uint32_t(v >> 32));
+}
+
+uint32_t rotl32(uint32_t v, int n) {
+    return (v << n) | (v >> (32 - n));
+}
+
+/**
+ * @brief Builds the initial ChaCha20 state from key, counter and nonce.
+ */
+
+void initState(uint32_t state[16], const uint32_t key[8], uint32_t counter, const uint8_t* nonce) {
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (int i = 0; i < 8; i++) {
+        state[4 + i] = key[i];
+    }
+    state[12] = counter;
+    state[13] = load32(nonce);
+    state[14] = load32(nonce + 4);
+    state[15] = load32(nonce + 8);
+}
+
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b; d ^= a; d = rotl32(d, 16); \
+    c += d; b ^= c; b = rotl32(b, 12); \
+    a += b; d ^= a; d = rotl32(d, 8); \
+    c += d; b ^= c; b = rotl32(b, 7);
+
+/**
+ * @brief Computes one 64-byte keystream block.
+ */
+
+void chachaBlock(const uint32_t state[16], uint8_t out[64]) {
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (int round = 0; round < 10; round++) {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12])
+        QUARTER_ROUND(x[1], x[5], x[9], x[13])
+        QUARTER_ROUND(x[2], x[6], x[10], x[14])
+        QUARTER_ROUND(x[3], x[7], x[11], x[15])
+        QUARTER_ROUND(x[0], x[5], x[10], x[15])
+        QUARTER_ROUND(x[1], x[6], x[11], x[12])
+        QUARTER_ROUND(x[2], x[7], x[8], x[13])
+        QUARTER_ROUND(x[3], x[4], x[9], x[14])
+    }
+    for (int i = 0; i < 16; i++) {
+        store32(out + 4 * i, x[i] + state[i]);
+    }
+}
+
+#undef QUARTER_ROUND
+
+/**
+ * @brief A keystream kernel: XORs whole 64-byte blocks and advances the counter in state[12].
+ * @return The number of blocks processed; kernels may leave a remainder for the scalar code.
+ */
+
+using ChaChaKernel = size_t (*)(uint32_t state[16], const uint8_t* in, uint8_t* out, size_t blocks);
+
+size_t chachaScalar(uint32_t state[16], const uint8_t* in, uint8_t* out, size_t blocks) {
+    uint8_t keystream[64];
+    for (size_t b = 0; b < blocks; b++) {
+        chachaBlock(state, keystream);
+        for (int i = 0; i < 64; i++) {
+            out[64 * b + i] = in[64 * b + i] ^ keystream[i];
+        }
+        state[12]++;
+    }
+    secureZero(keystream, sizeof(keystream));
+    return blocks;
+}
+
+#ifdef PASSWORDMANAGER_X86_KERNELS
+
+#define ROTL128(v, n) _mm_or_si128(_mm_slli_epi32(v, n), _mm_srli_epi32(v, 32 - (n)))
+#define QUARTER_ROUND128(a, b, c, d) \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 16); \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 12); \
+    a = _mm_add_epi32(a, b); d = _mm_xor_si128(d, a); d = ROTL128(d, 8); \
+    c = _mm_add_epi32(c, d); b = _mm_xor_si128(b, c); b = ROTL128(b, 7);
+
+/**
+ * @brief SSE2 kernel: four blocks per pass, one block per 32-bit lane.
+ */
+
+__attribute__((target("sse2")))
+size_t chachaSse2(uint32_t state[16], const uint8_t* in, uint8_t* out, size_t blocks) {
+    size_t done = 0;
+    for (; done + 4 <= blocks; done += 4) {
+        __m128i initial[16], x[16];
+        for (int i = 0; i < 16; i++) {
+            initial[i] = _mm_set1_epi32(static_cast<int>(state[i]));
+        }
+        initial[12] = _mm_add_epi32(initial[12], _mm_set_epi32(3, 2, 1, 0));
+        for (int i = 0; i < 16; i++) {
+            x[i] = initial[i];
+        }
+
+        for (int round = 0; round < 10; round++) {
+            QUARTER_ROUND128(x[0], x[4], x[8], x[12])
+            QUARTER_ROUND128(x[1], x[5], x[9], x[13])
+            QUARTER_ROUND128(x[2], x[6], x[10], x[14])
+            QUARTER_ROUND128(x[3], x[7], x[11], x[15])
+            QUARTER_ROUND128(x[0], x[5], x[10], x[15])
+            QUARTER_ROUND128(x[1], x[6], x[11], x[12])
+            QUARTER_ROUND128(x[2], x[7], x[8], x[13])
+            QUARTER_ROUND128(x[3], x[4], x[9], x[14])
+        }
+
+        const uint8_t* src = in + 64 * done;
+        uint8_t* dst = out + 64 * done;
+        for (int group = 0; group < 4; group++) {
+            __m128i a = _mm_add_epi32(x[4 * group + 0], initial[4 * group + 0]);
+            __m128i b = _mm_add_epi32(x[4 * group + 1], initial[4 * group + 1]);
+            __m128i c = _mm_add_epi32(x[4 * group + 2], initial[4 * group + 2]);
+            __m128i d = _mm_add_epi32(x[4 * group + 3], initial[4 * group + 3]);
+
+            // Transpose so that each register holds four consecutive words of one block
+            __m128i ab0 = _mm_unpacklo_epi32(a, b), cd0 = _mm_unpacklo_epi32(c, d);
+            __m128i ab1 = _mm_unpackhi_epi32(a, b), cd1 = _mm_unpackhi_epi32(c, d);
+            __m128i rows[4] = {_mm_unpacklo_epi64(ab0, cd0), _mm_unpackhi_epi64(ab0, cd0),
+                               _mm_unpacklo_epi64(ab1, cd1), _mm_unpackhi_epi64(ab1, cd1)};
+            for (int block = 0; block < 4; block++) {
+                size_t offset = 64 * block + 16 * group;
+                __m128i data = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + offset));
+                _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + offset), _mm_xor_si128(data, rows[block]));
+            }
+        }
+        state[12] += 4;
+    }
+    return done;
+}
+
+#undef QUARTER_ROUND128
+#undef ROTL128
+
+#define ROTL256(v, n) _mm256_or_si256(_mm256_slli_epi32(v, n), _mm256_srli_epi32(v, 32 - (n)))
+#define QUARTER_ROUND256(a, b, c, d) \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot16); \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = ROTL256(b, 12); \
+    a = _mm256_add_epi32(a, b); d = _mm256_xor_si256(d, a); d = _mm256_shuffle_epi8(d, rot8); \
+    c = _mm256_add_epi32(c, d); b = _mm256_xor_si256(b, c); b = ROTL256(b, 7);
+
+/**
+ * @brief AVX2 kernel: eight blocks per pass, one block per 32-bit lane.
+ */
+
+__attribute__((target("avx2")))
+size_t chachaAvx2(uint32_t state[16], const uint8_t* in, uint8_t* out, size_t blocks) {
+    const __m256i rot16 = _mm256_setr_epi8(2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13,
+                                           2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9, 14, 15, 12, 13);
+    const __m256i rot8 = _mm256_setr_epi8(3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14,
+                                          3, 0, 1, 2, 7, 4, 5, 6, 11, 8, 9, 10, 15, 12, 13, 14);
+    size_t done = 0;
+    for (; done + 8 <= blocks; done += 8) {
+        __m256i initial[16], x[16];
+        for (int i = 0; i < 16; i++) {
+            initial[i] = _mm256_set1_epi32(static_cast<int>(state[i]));
+        }
+        initial[12] = _mm256_add_epi32(initial[12], _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7));
+        for (int i = 0; i < 16; i++) {
+            x[i] = initial[i];
+        }
+
+        for (int round = 0; round < 10; round++) {
+            QUARTER_ROUND256(x[0], x[4], x[8], x[12])
+            QUARTER_ROUND256(x[1], x[5], x[9], x[13])
+            QUARTER_ROUND256(x[2], x[6], x[10], x[14])
+            QUARTER_ROUND256(x[3], x[7], x[11], x[15])
+            QUARTER_ROUND256(x[0], x[5], x[10], x[15])
+            QUARTER_ROUND256(x[1], x[6], x[11], x[12])
+            QUARTER_ROUND256(x[2], x[7], x[8], x[13])
+            QUARTER_ROUND256(x[3], x[4], x[9], x[14])
+        }
+
+        // After a 4x4 transpose within each 128-bit half, rows[group][j] holds words
+        // 4*group..4*group+3 of block j in the low half and of block j + 4 in the high half
+        __m256i rows[4][4];
+        for (int group = 0; group < 4; group++) {
+            __m256i a = _mm256_add_epi32(x[4 * group + 0], initial[4 * group + 0]);
+            __m256i b = _mm256_add_epi32(x[4 * group + 1], initial[4 * group + 1]);
+            __m256i c = _mm256_add_epi32(x[4 * group + 2], initial[4 * group + 2]);
+            __m256i d = _mm256_add_epi32(x[4 * group + 3], initial[4 * group + 3]);
+            __m256i ab0 = _mm256_unpacklo_epi32(a, b), cd0 = _mm256_unpacklo_epi32(c, d);
+            __m256i ab1 = _mm256_unpackhi_epi32(a, b), cd1 = _mm256_unpackhi_epi32(c, d);
+            rows[group][0] = _mm256_unpacklo_epi64(ab0, cd0);
+            rows[group][1] = _mm256_unpackhi_epi64(ab0, cd0);
+            rows[group][2] = _mm256_unpacklo_epi64(ab1, cd1);
+            rows[group][3] = _mm256_unpackhi_epi64(ab1, cd1);
+        }
+
+        const uint8_t* src = in + 64 * done;
+        uint8_t* dst = out + 64 * done;
+        for (int j = 0; j < 4; j++) {
+            __m256i words[4] = {_mm256_permute2x128_si256(rows[0][j], rows[1][j], 0x20),
+                                _mm256_permute2x128_si256(rows[2][j], rows[3][j], 0x20),
+                                _mm256_permute2x128_si256(rows[0][j], rows[1][j], 0x31),
+                                _mm256_permute2x128_si256(rows[2][j], rows[3][j], 0x31)};
+            size_t offsets[4] = {64 * size_t(j), 64 * size_t(j) + 32, 64 * size_t(j + 4), 64 * size_t(j + 4) + 32};
+            for (int k = 0; k < 4; k++) {
+                __m256i data = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + offsets[k]));
+                _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + offsets[k]), _mm256_xor_si256(data, words[k]));
+            }
+        }
+        state[12] += 8;
+    }
+    return done;
+}
+
+#undef QUARTER_ROUND256
+#undef ROTL256
+
+#endif // PASSWORDMANAGER_X86_KERNELS
+
+/**
+ * @brief A named keystream kernel.
+ */
+
+struct KernelInfo {
+    const char* name;       /**< Kernel name. */
+    ChaChaKernel kernel;    /**< Kernel function. */
+    bool (*supported)();    /**< Whether the CPU can run it. */
+};
+
+const KernelInfo kernels[] = {
+    {"scalar", chachaScalar, [] { return true; }},
+#ifdef PASSWORDMANAGER_X86_KERNELS
+    {"sse2", chachaSse2, [] { return __builtin_cpu_supports("sse2") != 0; }},
+    {"avx2", chachaAvx2, [] { return __builtin_cpu_supports("avx2") != 0; }},
+#endif
+};
+
+/**
+ * @brief The kernel in use; starts as the fastest supported one.
+ */
+
+const KernelInfo*& activeKernel() {
+    static const KernelInfo* active = [] {
+        const KernelInfo* best = &kernels[0];
+        for (const KernelInfo& info : kernels) {
+            if (info.supported()) {
+                best = &info;
+            }
+        }
+        return best;
+    }();
+    return active;
+}
+
+/**
+ * @brief Incremental Poly1305 using 26-bit limbs, portable to any compiler.
+ */
+
+class Poly1305 {
+private:
+    uint32_t r[5];          /**< Clamped multiplier. */
+    uint32_t h[5];          /**< Accumulator. */
+    uint32_t pad[4];        /**< Final addend. */
+    uint8_t buffer[16];     /**< Partial block. */
+    size_t leftover = 0;    /**< Bytes in buffer. */
+
+    void blocks(const uint8_t* m, size_t bytes, uint32_t hibit) {
+        const uint32_t mask = 0x3ffffff;
+        uint32_t r0 = r[0], r1 = r[1], r2 = r[2], r3 = r[3], r4 = r[4];
+        uint32_t s1 = r1 * 5, s2 = r2 * 5, s3 = r3 * 5, s4 = r4 * 5;
+        uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+
+        while (bytes >= 16) {
+            h0 += load32(m) & mask;
+            h1 += (load32(m + 3) >> 2) & mask;
+            h2 += (load32(m + 6) >> 4) & mask;
+            h3 += (load32(m + 9) >> 6) & mask;
+            h4 += (load32(m + 12) >> 8) | hibit;
+
+            uint64_t d0 = uint64_t(h0) * r0 + uint64_t(h1) * s4 + uint64_t(h2) * s3 + uint64_t(h3) * s2 + uint64_t(h4) * s1;
+            uint64_t d1 = uint64_t(h0) * r1 + uint64_t(h1) * r0 + uint64_t(h2) * s4 + uint64_t(h3) * s3 + uint64_t(h4) * s2;
+            uint64_t d2 = uint64_t(h0) * r2 + uint64_t(h1) * r1 + uint64_t(h2) * r0 + uint64_t(h3) * s4 + uint64_t(h4) * s3;
+            uint64_t d3 = uint64_t(h0) * r3 + uint64_t(h1) * r2 + uint64_t(h2) * r1 + uint64_t(h3) * r0 + uint64_t(h4) * s4;
+            uint64_t d4 = uint64_t(h0) * r4 + uint64_t(h1) * r3 + uint64_t(h2) * r2 + uint64_t(h3) * r1 + uint64_t(h4) * r0;
+
+            uint32_t c = uint32_t(d0 >> 26); h0 = uint32_t(d0) & mask;
+            d1 += c; c = uint32_t(d1 >> 26); h1 = uint32_t(d1) & mask;
+            d2 += c; c = uint32_t(d2 >> 26); h2 = uint32_t(d2) & mask;
+            d3 += c; c = uint32_t(d3 >> 26); h3 = uint32_t(d3) & mask;
+            d4 += c; c = uint32_t(d4 >> 26); h4 = uint32_t(d4) & mask;
+            h0 += c * 5; c = h0 >> 26; h0 &= mask;
+            h1 += c;
+
+            m += 16;
+            bytes -= 16;
+        }
+        h[0] = h0; h[1] = h1; h[2] = h2; h[3] = h3; h[4] = h4;
+    }
+
+public:
+    explicit Poly1305(const uint8_t* key) {
+        r[0] = load32(key) & 0x3ffffff;
+        r[1] = (load32(key + 3) >> 2) & 0x3ffff03;
+        r[2] = (load32(key + 6) >> 4) & 0x3ffc0ff;
+        r[3] = (load32(key + 9) >> 6) & 0x3f03fff;
+        r[4] = (load32(key + 12) >> 8) & 0x00fffff;
+        for (int i = 0; i < 5; i++) {
+            h[i] = 0;
+        }
+        for (int i = 0; i < 4; i++) {
+            pad[i] = load32(key + 16 + 4 * i);
+        }
+    }
+
+    ~Poly1305() {
+        secureZero(r, sizeof(r));
+        secureZero(pad, sizeof(pad));
+        secureZero(buffer, sizeof(buffer));
+    }
+
+    void update(const uint8_t* m, size_t bytes) {
+        if (leftover) {
+            size_t want = min<size_t>(16 - leftover, bytes);
+            memcpy(buffer + leftover, m, want);
+            leftover += want;
+            m += want;
+            bytes -= want;
+            if (leftover < 16) {
+                return;
+            }
+            blocks(buffer, 16, 1 << 24);
+            leftover = 0;
+        }
+        size_t whole = bytes & ~size_t(15);
+        blocks(m, whole, 1 << 24);
+        m += whole;
+        bytes -= whole;
+        if (bytes) {
+            memcpy(buffer, m, bytes);
+            leftover = bytes;
+        }
+    }
+
+    /**
+     * @brief Pads the input to a 16-byte boundary with zeros, as RFC 8439 requires between fields.
+     */
+
+    void padToBlock() {
+        if (leftover) {
+            memset(buffer + leftover, 0, 16 - leftover);
+            blocks(buffer, 16, 1 << 24);
+            leftover = 0;
+        }
+    }
+
+    void finish(uint8_t* tag) {
+        const uint32_t mask = 0x3ffffff;
+        if (leftover) {
+            buffer[leftover++] = 1;
+            memset(buffer + leftover, 0, 16 - leftover);
+            blocks(buffer, 16, 0);
+        }
+
+        uint32_t h0 = h[0], h1 = h[1], h2 = h[2], h3 = h[3], h4 = h[4];
+        uint32_t c = h1 >> 26; h1 &= mask;
+        h2 += c; c = h2 >> 26; h2 &= mask;
+        h3 += c; c = h3 >> 26; h3 &= mask;
+        h4 += c; c = h4 >> 26; h4 &= mask;
+        h0 += c * 5; c = h0 >> 26; h0 &= mask;
+        h1 += c;
+
+        // Compute h - p and keep it if it does not underflow, in constant time
+        uint32_t g0 = h0 + 5; c = g0 >> 26; g0 &= mask;
+        uint32_t g1 = h1 + c; c = g1 >> 26; g1 &= mask;
+        uint32_t g2 = h2 + c; c = g2 >> 26; g2 &= mask;
+        uint32_t g3 = h3 + c; c = g3 >> 26; g3 &= mask;
+        uint32_t g4 = h4 + c - (1u << 26);
+
+        uint32_t select = (g4 >> 31) - 1;
+        h0 = (h0 & ~select) | (g0 & select);
+        h1 = (h1 & ~select) | (g1 & select);
+        h2 = (h2 & ~select) | (g2 & select);
+        h3 = (h3 & ~select) | (g3 & select);
+        h4 = (h4 & ~select) | (g4 & select);
+
+        uint32_t w0 = h0 | (h1 << 26);
+        uint32_t w1 = (h1 >> 6) | (h2 << 20);
+        uint32_t w2 = (h2 >> 12) | (h3 << 14);
+        uint32_t w3 = (h3 >> 18) | (h4 << 8);
+
+        uint64_t f = uint64_t(w0) + pad[0]; store32(tag, uint32_t(f));
+        f = uint64_t(w1) + pad[1] + (f >> 32); store32(tag + 4, uint32_t(f));
+        f = uint64_t(w2) + pad[2] + (f >> 32); store32(tag + 8, uint32_t(f));
+        f = uint64_t(w3) + pad[3] + (f >> 32); store32(tag + 12, uint32_t(f));
+    }
+};
+
+/**
+ * @brief Computes the RFC 8439 AEAD tag over the additional data and ciphertext.
+ */
+
+void aeadTag(const uint8_t* polyKey, const uint8_t* aad, size_t aadLength,
+             const uint8_t* ciphertext, size_t length, uint8_t* tag) {
+    Poly1305 mac(polyKey);
+    if (aadLength) {
+        mac.update(aad, aadLength);
+        mac.padToBlock();
+    }
+    mac.update(ciphertext, length);
+    mac.padToBlock();
+
+    uint8_t lengths[16];
+    store64(lengths, aadLength);
+    store64(lengths + 8, length);
+    mac.update(lengths, sizeof(lengths));
+    mac.finish(tag);
+}
+
+/**
+ * @brief Draws a nonce from a per-thread pool refilled in 4 KiB batches.
+ *
+ * One system call then serves hundreds of nonces, which matters when a whole
+ * vault is encrypted record by record. Used bytes are wiped from the pool.
+ */
+
+void randomNonce(uint8_t* nonce) {
+    thread_local uint8_t pool[4096];
+    thread_local size_t available = 0;
+    if (available < ChaCha20Poly1305::nonceSize) {
+        fillRandom(pool, sizeof(pool));
+        available = sizeof(pool);
+    }
+    uint8_t* source = pool + sizeof(pool) - available;
+    memcpy(nonce, source, ChaCha20Poly1305::nonceSize);
+    secureZero(source, ChaCha20Poly1305::nonceSize);
+    available -= ChaCha20Poly1305::nonceSize;
+}
+
+const char base64Alphabet[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+
+size_t base64Length(size_t length) {
+    return (length + 2) / 3 * 4;
+}
+
+/**
+ * @brief Writes the padded base64 encoding of data to out, which must hold base64Length(length) chars.
+ */
+
+void encodeBase64(const uint8_t* data, size_t length, char* out) {
+    for (size_t i = 0; i < length; i += 3) {
+        uint32_t chunk = uint32_t(data[i]) << 16;
+        if (i + 1 < length) chunk |= uint32_t(data[i + 1]) << 8;
+        if (i + 2 < length) chunk |= data[i + 2];
+        *out++ = base64Alphabet[(chunk >> 18) & 63];
+        *out++ = base64Alphabet[(chunk >> 12) & 63];
+        *out++ = i + 1 < length ? base64Alphabet[(chunk >> 6) & 63] : '=';
+        *out++ = i + 2 < length ? base64Alphabet[chunk & 63] : '=';
+    }
+}
+
+/**
+ * @brief Decodes padded base64 into out, which must hold length / 4 * 3 bytes.
+ * @return The number of bytes written, or SIZE_MAX if the text is invalid.
+ */
+
+size_t decodeBase64(const char* text, size_t length, uint8_t* out) {
+    static const auto decodeTable = [] {
+        array<int8_t, 256> table{};
+        table.fill(-1);
+        for (int i = 0; i < 64; i++) {
+            table[static_cast<unsigned char>(base64Alphabet[i])] = static_cast<int8_t>(i);
+        }
+        return table;
+    }();
+
+    if (length % 4 != 0) {
+        return SIZE_MAX;
+    }
+    size_t written = 0;
+    for (size_t i = 0; i < length; i += 4) {
+        int values[4];
+        int padding = 0;
+        for (int k = 0; k < 4; k++) {
+            char c = text[i + k];
+            if (c == '=' && i + 4 == length && k >= 2) {
+                values[k] = 0;
+                padding++;
+            } else if (padding || (values[k] = decodeTable[static_cast<unsigned char>(c)]) < 0) {
+                return SIZE_MAX;
+            }
+        }
+        uint32_t chunk = (values[0] << 18) | (values[1] << 12) | (values[2] << 6) | values[3];
+        out[written++] = uint8_t(chunk >> 16);
+        if (padding < 2) out[written++] = uint8_t(chunk >> 8);
+        if (padding < 1) out[written++] = uint8_t(chunk);
+    }
+    return written;
+}
+
+/**
+ * @brief Per-thread scratch buffer for sealed bytes, reused across calls.
+ */
+
+vector<uint8_t>& scratchBuffer(size_t size) {
+    thread_local vector<uint8_t> scratch;
+    if (scratch.size() < size) {
+        secureZero(scratch.data(), scratch.size());
+        scratch.assign(size, 0);
+    }
+    return scratch;
+}
+
+} // namespace
+
+// FILL RANDOM
+/**
+     * @brief Fills a buffer from the operating system's secure random source.
+     * @param out Buffer to fill.
+     * @param length Number of bytes.
+     */
+
+void fillRandom(uint8_t* out, size_t length) {
+#if defined(_WIN32)
+    if (BCryptGenRandom(nullptr, out, static_cast<ULONG>(length), BCRYPT_USE_SYSTEM_PREFERRED_RNG) == 0) {
+        return;
+    }
+#elif defined(__linux__)
+    size_t filled = 0;
+    while (filled < length) {
+        ssize_t got = getrandom(out + filled, length - filled, 0);
+        if (got < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        filled += static_cast<size_t>(got);
+    }
+    if (filled == length) {
+        return;
+    }
+#else
+    FILE* source = fopen("/dev/urandom", "rb");
+    if (source) {
+        size_t got = fread(out, 1, length, source);
+        fclose(source);
+        if (got == length) {
+            return;
+        }
+    }
+#endif
+    cerr << "Error: No Secure Random Source Available!" << endl;
+    abort();
+}
+
+// SECURE ZERO
+/**
+     * @brief Wipes memory in a way the compiler may not optimize away.
+     * @param data Memory to wipe.
+     * @param length Number of bytes.
+     */
+
+void secureZero(void* data, size_t length) {
+    if (length == 0) {
+        return;
+    }
+#if defined(_WIN32)
+    SecureZeroMemory(data, length);
+#elif defined(__GNUC__) || defined(__clang__)
+    // A full-width memset; the barrier makes the compiler assume the zeroes are read
+    memset(data, 0, length);
+    __asm__ __volatile__("" : : "r"(data) : "memory");
+#else
+    volatile uint8_t* p = static_cast<volatile uint8_t*>(data);
+    while (length--) {
+        *p++ = 0;
+    }
+#endif
+}
+
+// BASE64
+/**
+     * @brief Encodes bytes as padded base64.
+     * @param data Bytes to encode.
+     * @param length Number of bytes.
+     * @return The base64 text.
+     */
+
+string toBase64(const uint8_t* data, size_t length) {
+    string text(base64Length(length), '\0');
+    encodeBase64(data, length, text.data());
+    return text;
+}
+
+/**
+     * @brief Decodes padded base64.
+     * @param text The base64 text.
+     * @param data Receives the bytes.
+     * @return False if the text is not valid base64.
+     */
+
+bool fromBase64(const string& text, vector<uint8_t>& data) {
+    data.resize(text.size() / 4 * 3);
+    size_t written = decodeBase64(text.data(), text.size(), data.data());
+    if (written == SIZE_MAX) {
+        data.clear();
+        return false;
+    }
+    data.resize(written);
+    return true;
+}
+
+/**
+     * @brief Constructor.
+     * @param keyBytes The 32-byte key.
+     */
+
+ChaCha20Poly1305::ChaCha20Poly1305(const uint8_t* keyBytes) {
+    for (int i = 0; i < 8; i++) {
+        key[i] = load32(keyBytes + 4 * i);
+    }
+}
+
+/**
+     * @brief Destructor; wipes the key.
+     */
+
+ChaCha20Poly1305::~ChaCha20Poly1305() {
+    secureZero(key, sizeof(key));
+}
+
+// KEYSTREAM
+/**
+     * @brief XORs data with the ChaCha20 keystream using the active kernel.
+     * @param nonce The 12-byte nonce.
+     * @param counter Initial block counter.
+     * @param in Input bytes.
+     * @param out Output bytes; may equal in.
+     * @param length Number of bytes.
+     */
+
+void ChaCha20Poly1305::xorKeystream(const uint8_t* nonce, uint32_t counter, const uint8_t* in, uint8_t* out,
+                                    size_t length) const {
+    uint32_t state[16];
+    initState(state, key, counter, nonce);
+
+    size_t blocks = length / 64;
+    size_t done = activeKernel()->kernel(state, in, out, blocks);
+    done += chachaScalar(state, in + 64 * done, out + 64 * done, blocks - done);
+
+    size_t tail = length - 64 * done;
+    if (tail) {
+        uint8_t keystream[64];
+        chachaBlock(state, keystream);
+        for (size_t i = 0; i < tail; i++) {
+            out[64 * done + i] = in[64 * done + i] ^ keystream[i];
+        }
+        secureZero(keystream, sizeof(keystream));
+    }
+    secureZero(state, sizeof(state));
+}
+
+// SEAL
+/**
+     * @brief Encrypts and authenticates a message (RFC 8439 section 2.8).
+     * @param nonce The 12-byte nonce.
+     * @param plaintext Message to encrypt.
+     * @param length Length of the message.
+     * @param aad Additional authenticated data, or nullptr.
+     * @param aadLength Length of the additional data.
+     * @param out Receives the ciphertext and tag.
+     */
+
+void ChaCha20Poly1305::seal(const uint8_t* nonce, const uint8_t* plaintext, size_t length,
+                            const uint8_t* aad, size_t aadLength, uint8_t* out) const {
+    uint8_t polyKey[64] = {};
+    xorKeystream(nonce, 0, polyKey, polyKey, sizeof(polyKey));
+    xorKeystream(nonce, 1, plaintext, out, length);
+    aeadTag(polyKey, aad, aadLength, out, length, out + length);
+    secureZero(polyKey, sizeof(polyKey));
+}
+
+// OPEN
+/**
+     * @brief Verifies the tag in constant time and decrypts the message.
+     * @param nonce The 12-byte nonce.
+     * @param sealed Ciphertext followed by the tag.
+     * @param length Length of sealed.
+     * @param aad Additional authenticated data, or nullptr.
+     * @param aadLength Length of the additional data.
+     * @param out Receives the plaintext.
+     * @return False if authentication fails.
+     */
+
+bool ChaCha20Poly1305::open(const uint8_t* nonce, const uint8_t* sealed, size_t length,
+                            const uint8_t* aad, size_t aadLength, uint8_t* out) const {
+    if (length < tagSize) {
+        return false;
+    }
+    size_t messageLength = length - tagSize;
+
+    uint8_t polyKey[64] = {};
+    uint8_t tag[tagSize];
+    xorKeystream(nonce, 0, polyKey, polyKey, sizeof(polyKey));
+    aeadTag(polyKey, aad, aadLength, sealed, messageLength, tag);
+    secureZero(polyKey, sizeof(polyKey));
+
+    uint8_t difference = 0;
+    for (size_t i = 0; i < tagSize; i++) {
+        difference |= tag[i] ^ sealed[messageLength + i];
+    }
+    if (difference != 0) {
+        return false;
+    }
+    xorKeystream(nonce, 1, sealed, out, messageLength);
+    return true;
+}
+
+// KERNELS
+/**
+     * @brief Lists the kernels the CPU supports.
+     * @return Kernel names, fastest last.
+     */
+
+vector<string> ChaCha20Poly1305::availableKernels() {
+    vector<string> names;
+    for (const KernelInfo& info : kernels) {
+        if (info.supported()) {
+            names.push_back(info.name);
+        }
+    }
+    return names;
+}
+
+/**
+     * @brief Gets the name of the kernel in use.
+     * @return The kernel name.
+     */
+
+string ChaCha20Poly1305::kernelName() {
+    return activeKernel()->name;
+}
+
+/**
+     * @brief Selects a kernel by name.
+     * @param name The kernel name.
+     * @return False if the kernel is unknown or unsupported.
+     */
+
+bool ChaCha20Poly1305::selectKernel(const string& name) {
+    for (const KernelInfo& info : kernels) {
+        if (name == info.name && info.supported()) {
+            activeKernel() = &info;
+            return true;
+        }
+    }
+    return false;
+}
+
+// POLY1305
+/**
+     * @brief Computes a Poly1305 tag.
+     * @param oneTimeKey The 32-byte one-time key.
+     * @param message Message bytes.
+     * @param length Message length.
+     * @param tag Receives the 16-byte tag.
+     */
+
+void poly1305(const uint8_t* oneTimeKey, const uint8_t* message, size_t length, uint8_t* tag) {
+    Poly1305 mac(oneTimeKey);
+    mac.update(message, length);
+    mac.finish(tag);
+}
+
+// TEXT ENCRYPTION
+const string encryptedTextPrefix = "enc2:";
+const string legacyEncryptedTextPrefix = "enc1:";
+
+/**
+     * @brief Encrypts a string into prefixed base64 text under a random nonce.
+     * @param cipher The cipher.
+     * @param plaintext The text to encrypt.
+     * @param associatedData Data the text is bound to.
+     * @return The encrypted text.
+     */
+
+string encryptText(const ChaCha20Poly1305& cipher, string_view plaintext, string_view associatedData) {
+    string text(plaintext);
+    encryptTextInPlace(cipher, text, associatedData);
+    return text;
+}
+
+/**
+     * @brief Decrypts prefixed base64 text.
+     * @param cipher The cipher.
+     * @param text The encrypted text.
+     * @param associatedData Data the text was bound to.
+     * @param plaintext Receives the text.
+     * @return False if the text is not encrypted or fails authentication.
+     */
+
+bool decryptText(const ChaCha20Poly1305& cipher, string_view text, string_view associatedData, string& plaintext) {
+    string decrypted(text);
+    if (!decryptTextInPlace(cipher, decrypted, associatedData)) {
+        return false;
+    }
+    plaintext = std::move(decrypted);
+    return true;
+}
+
+namespace {
+
+/**
+ * @brief Encrypts text in place, sealing through a reused per-thread scratch buffer.
+ */
+
+template <typename Text>
+void sealText(const ChaCha20Poly1305& cipher, Text& text, string_view associatedData) {
+    size_t sealedLength = ChaCha20Poly1305::nonceSize + text.size() + ChaCha20Poly1305::tagSize;
+    vector<uint8_t>& sealed = scratchBuffer(sealedLength);
+
+    randomNonce(sealed.data());
+    cipher.seal(sealed.data(), reinterpret_cast<const uint8_t*>(text.data()), text.size(),
+                reinterpret_cast<const uint8_t*>(associatedData.data()), associatedData.size(),
+                sealed.data() + ChaCha20Poly1305::nonceSize);
+
+    // Wipe the plaintext before growing, so a reallocation does not leave a copy behind
+    secureZero(text.data(), text.size());
+    text.resize(encryptedTextPrefix.size() + base64Length(sealedLength));
+    memcpy(text.data(), encryptedTextPrefix.data(), encryptedTextPrefix.size());
+    encodeBase64(sealed.data(), sealedLength, text.data() + encryptedTextPrefix.size());
+    secureZero(sealed.data(), sealedLength);
+}
+
+/**
+ * @brief Decrypts text with the given prefix in place; the plaintext is written over the encrypted text.
+ */
+
+template <typename Text>
+bool openText(const ChaCha20Poly1305& cipher, Text& text, const string& prefix, string_view associatedData) {
+    if (string_view(text.data(), text.size()).substr(0, prefix.size()) != prefix) {
+        return false;
+    }
+    size_t encodedLength = text.size() - prefix.size();
+    vector<uint8_t>& sealed = scratchBuffer(encodedLength / 4 * 3);
+    size_t sealedLength = decodeBase64(text.data() + prefix.size(), encodedLength, sealed.data());
+    if (sealedLength == SIZE_MAX || sealedLength < ChaCha20Poly1305::nonceSize + ChaCha20Poly1305::tagSize) {
+        secureZero(sealed.data(), encodedLength / 4 * 3);
+        return false;
+    }
+
+    size_t length = sealedLength - ChaCha20Poly1305::nonceSize;
+    size_t plaintextLength = length - ChaCha20Poly1305::tagSize;
+    if (!cipher.open(sealed.data(), sealed.data() + ChaCha20Poly1305::nonceSize, length,
+                     reinterpret_cast<const uint8_t*>(associatedData.data()), associatedData.size(),
+                     sealed.data() + ChaCha20Poly1305::nonceSize)) {
+        secureZero(sealed.data(), sealedLength);
+        return false;
+    }
+    memcpy(text.data(), sealed.data() + ChaCha20Poly1305::nonceSize, plaintextLength);
+    secureZero(text.data() + plaintextLength, text.size() - plaintextLength);
+    text.resize(plaintextLength);
+    secureZero(sealed.data(), sealedLength);
+    return true;
+}
+
+} // namespace
+
+/**
+     * @brief Encrypts a string in place, sealing through a reused per-thread scratch buffer.
+     * @param cipher The cipher.
+     * @param text The plaintext on input, the encrypted text on output.
+     * @param associatedData Data the text is bound to.
+     */
+
+void encryptTextInPlace(const ChaCha20Poly1305& cipher, string& text, string_view associatedData) {
+    sealText(cipher, text, associatedData);
+}
+
+/**
+     * @brief Encrypts secret text in place.
+     * @param cipher The cipher.
+     * @param text The plaintext on input, the encrypted text on output.
+     * @param associatedData Data the text is bound to.
+     */
+
+void encryptTextInPlace(const ChaCha20Poly1305& cipher, SecretText& text, string_view associatedData) {
+    sealText(cipher, text, associatedData);
+}
+
+/**
+     * @brief Decrypts a string in place; the plaintext is written over the encrypted text.
+     * @param cipher The cipher.
+     * @param text The encrypted text on input, the plaintext on success.
+     * @param associatedData Data the text was bound to.
+     * @return False if the text is not encrypted or fails authentication.
+     */
+
+bool decryptTextInPlace(const ChaCha20Poly1305& cipher, string& text, string_view associatedData) {
+    return openText(cipher, text, encryptedTextPrefix, associatedData);
+}
+
+/**
+     * @brief Decrypts secret text in place.
+     * @param cipher The cipher.
+     * @param text The encrypted text on input, the plaintext on success.
+     * @param associatedData Data the text was bound to.
+     * @return False if the text is not encrypted or fails authentication.
+     */
+
+bool decryptTextInPlace(const ChaCha20Poly1305& cipher, SecretText& text, string_view associatedData) {
+    return openText(cipher, text, encryptedTextPrefix, associatedData);
+}
+
+/**
+     * @brief Decrypts a string sealed without associated data by older versions.
+     * @param cipher The cipher.
+     * @param text The encrypted text on input, the plaintext on success.
+     * @return False if the text is not in the legacy format or fails authentication.
+     */
+
+bool decryptLegacyTextInPlace(const ChaCha20Poly1305& cipher, string& text) {
+    return openText(cipher, text, legacyEncryptedTextPrefix, {});
+}
+
+/**
+     * @brief Decrypts secret text sealed without associated data by older versions.
+     * @param cipher The cipher.
+     * @param text The encrypted text on input, the plaintext on success.
+     * @return False if the text is not in the legacy format or fails authentication.
+     */
+
+bool decryptLegacyTextInPlace(const ChaCha20Poly1305& cipher, SecretText& text) {
+    return openText(cipher, text, legacyEncryptedTextPrefix, {});
+}
+
+/**
+     * @brief Checks for the current or the legacy encrypted text prefix.
+     * @param text The text to check.
+     * @return True if the text starts with either prefix.
+     */
+
+bool isEncryptedText(string_view text) {
+    return text.substr(0, encryptedTextPrefix.size()) == encryptedTextPrefix || isLegacyEncryptedText(text);
+}
+
+/**
+     * @brief Checks for the legacy encrypted text prefix.
+     * @param text The text to check.
+     * @return True if the text starts with it.
+     */
+
+bool isLegacyEncryptedText(string_view text) {
+    return text.substr(0, legacyEncryptedTextPrefix.size()) == legacyEncryptedTextPrefix;
+}
@@ -0,0 +1,281 @@
+#ifndef PASSWORDMANAGER_CRYPTO_H
+#define PASSWORDMANAGER_CRYPTO_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "SecureArena.h"
+using namespace std;
+
+/**
+ * @file Crypto.h
+ * @brief ChaCha20-Poly1305 authenticated encryption (RFC 8439) and supporting helpers.
+ */
+
+// FILL RANDOM
+/**
+ * @brief Fills a buffer with bytes from the operating system's secure random source.
+ *
+ * Uses getrandom on Linux, BCryptGenRandom on Windows and /dev/urandom elsewhere.
+ * The program is aborted if no secure random source is available.
+ *
+ * @param out Buffer to fill.
+ * @param length Number of bytes to write.
+ */
+
+void fillRandom(uint8_t *out, size_t length);
+
+// SECURE ZERO
+/**
+ * @brief Wipes memory that held secrets in a way the compiler may not optimize away.
+ * @param data Memory to wipe.
+ * @param length Number of bytes.
+ */
+
+void secureZero(void *data, size_t length);
+
+// BASE64
+/**
+ * @brief Encodes bytes as standard base64 with padding.
+ * @param data Bytes to encode.
+ * @param length Number of bytes.
+ * @return The base64 text.
+ */
+
+string toBase64(const uint8_t *data, size_t length);
+
+/**
+ * @brief Decodes standard base64 with padding.
+ * @param text The base64 text.
+ * @param data Receives the decoded bytes.
+ * @return False if the text is not valid base64.
+ */
+
+bool fromBase64(const string &text, vector<uint8_t> &data);
+
+/**
+ * @brief ChaCha20-Poly1305 AEAD cipher as specified by RFC 8439.
+ *
+ * The ChaCha20 keystream is produced by the fastest kernel the CPU supports,
+ * chosen once at start-up: AVX2 (eight blocks per pass), SSE2 (four blocks)
+ * or portable scalar code. All kernels produce identical output.
+ */
+
+class ChaCha20Poly1305 {
+private:
+    uint32_t key[8];        /**< Key as little-endian words. */
+
+public:
+    static const size_t keySize = 32;       /**< Key length in bytes. */
+    static const size_t nonceSize = 12;     /**< Nonce length in bytes. */
+    static const size_t tagSize = 16;       /**< Authentication tag length in bytes. */
+
+    /**
+     * @brief Constructor for ChaCha20Poly1305 class.
+     * @param keyBytes The 32-byte key.
+     */
+
+    explicit ChaCha20Poly1305(const uint8_t *keyBytes);
+
+    /**
+     * @brief Destructor; wipes the key.
+     */
+
+    ~ChaCha20Poly1305();
+
+    // SEAL
+    /**
+     * @brief Encrypts and authenticates a message.
+     * @param nonce The 12-byte nonce; must never repeat under the same key.
+     * @param plaintext Message to encrypt.
+     * @param length Length of the message.
+     * @param aad Additional authenticated data, or nullptr.
+     * @param aadLength Length of the additional data.
+     * @param out Receives length bytes of ciphertext followed by the 16-byte tag; may equal plaintext.
+     */
+
+    void seal(const uint8_t *nonce, const uint8_t *plaintext, size_t length,
+              const uint8_t *aad, size_t aadLength, uint8_t *out) const;
+
+    // OPEN
+    /**
+     * @brief Verifies and decrypts a message.
+     * @param nonce The 12-byte nonce the message was sealed with.
+     * @param sealed Ciphertext followed by the 16-byte tag.
+     * @param length Length of sealed, including the tag.
+     * @param aad Additional authenticated data, or nullptr.
+     * @param aadLength Length of the additional data.
+     * @param out Receives length - 16 bytes of plaintext; may equal sealed. Untouched on failure.
+     * @return False if the message is too short or fails authentication.
+     */
+
+    bool open(const uint8_t *nonce, const uint8_t *sealed, size_t length,
+              const uint8_t *aad, size_t aadLength, uint8_t *out) const;
+
+    // KEYSTREAM
+    /**
+     * @brief XORs data with the raw ChaCha20 keystream.
+     * @param nonce The 12-byte nonce.
+     * @param counter Initial block counter.
+     * @param in Input bytes.
+     * @param out Output bytes; may equal in.
+     * @param length Number of bytes.
+     */
+
+    void xorKeystream(const uint8_t *nonce, uint32_t counter, const uint8_t *in, uint8_t *out, size_t length) const;
+
+    // KERNELS
+    /**
+     * @brief Lists the ChaCha20 kernels the CPU supports, fastest last.
+     * @return Kernel names, e.g. "scalar", "sse2", "avx2".
+     */
+
+    static vector<string> availableKernels();
+
+    /**
+     * @brief Gets the name of the kernel in use.
+     * @return The kernel name.
+     */
+
+    static string kernelName();
+
+    /**
+     * @brief Selects a kernel by name, e.g. to benchmark it.
+     * @param name The kernel name.
+     * @return False if the kernel is not available on this CPU.
+     */
+
+    static bool selectKernel(const string &name);
+};
+
+// POLY1305
+/**
+ * @brief Computes a Poly1305 one-time authenticator.
+ * @param oneTimeKey The 32-byte one-time key.
+ * @param message Message bytes.
+ * @param length Message length.
+ * @param tag Receives the 16-byte tag.
+ */
+
+void poly1305(const uint8_t *oneTimeKey, const uint8_t *message, size_t length, uint8_t *tag);
+
+// TEXT ENCRYPTION
+/**
+ * @brief Prefix that marks an encrypted password in the vault file.
+ */
+
+extern const string encryptedTextPrefix;
+
+/**
+ * @brief Prefix of text that older versions encrypted without associated data.
+ */
+
+extern const string legacyEncryptedTextPrefix;
+
+/**
+ * @brief Encrypts a string under a fresh random nonce into printable text.
+ *
+ * The result is encryptedTextPrefix followed by base64(nonce | ciphertext | tag),
+ * so it fits on one line of the vault file. The associated data is
+ * authenticated but not stored: the text only decrypts with the same data,
+ * so a password bound to its entry cannot be moved to another one.
+ *
+ * @param cipher The cipher to encrypt with.
+ * @param plaintext The text to encrypt.
+ * @param associatedData Data to bind the text to, such as the name of its entry.
+ * @return The encrypted text.
+ */
+
+string encryptText(const ChaCha20Poly1305 &cipher, string_view plaintext, string_view associatedData);
+
+/**
+ * @brief Decrypts text produced by encryptText.
+ * @param cipher The cipher to decrypt with.
+ * @param text The encrypted text.
+ * @param associatedData Data the text was bound to.
+ * @param plaintext Receives the decrypted text.
+ * @return False if the text is not encrypted or fails authentication.
+ */
+
+bool decryptText(const ChaCha20Poly1305 &cipher, string_view text, string_view associatedData, string &plaintext);
+
+/**
+ * @brief Encrypts a string in place into the format of encryptText.
+ *
+ * The sealed bytes go through a per-thread scratch buffer that is reused
+ * across calls, and the plaintext is wiped before the string grows, so the
+ * only allocation is the string's own growth.
+ *
+ * @param cipher The cipher to encrypt with.
+ * @param text The plaintext on input, the encrypted text on output.
+ * @param associatedData Data to bind the text to.
+ */
+
+void encryptTextInPlace(const ChaCha20Poly1305 &cipher, string &text, string_view associatedData);
+
+/**
+ * @brief Encrypts secret text in place into the format of encryptText.
+ * @param cipher The cipher to encrypt with.
+ * @param text The plaintext on input, the encrypted text on output.
+ * @param associatedData Data to bind the text to.
+ */
+
+void encryptTextInPlace(const ChaCha20Poly1305 &cipher, SecretText &text, string_view associatedData);
+
+/**
+ * @brief Decrypts text produced by encryptText in place without allocating.
+ * @param cipher The cipher to decrypt with.
+ * @param text The encrypted text on input, the plaintext on success.
+ * @param associatedData Data the text was bound to.
+ * @return False if the text is not encrypted or fails authentication; text is then unchanged.
+ */
+
+bool decryptTextInPlace(const ChaCha20Poly1305 &cipher, string &text, string_view associatedData);
+
+/**
+ * @brief Decrypts text produced by encryptText in place, so the plaintext only ever exists in the secure arena.
+ * @param cipher The cipher to decrypt with.
+ * @param text The encrypted text on input, the plaintext on success.
+ * @param associatedData Data the text was bound to.
+ * @return False if the text is not encrypted or fails authentication; text is then unchanged.
+ */
+
+bool decryptTextInPlace(const ChaCha20Poly1305 &cipher, SecretText &text, string_view associatedData);
+
+/**
+ * @brief Decrypts text that older versions sealed without associated data, to migrate it.
+ * @param cipher The cipher to decrypt with.
+ * @param text The encrypted text on input, the plaintext on success.
+ * @return False if the text does not carry legacyEncryptedTextPrefix or fails authentication.
+ */
+
+bool decryptLegacyTextInPlace(const ChaCha20Poly1305 &cipher, string &text);
+
+/**
+ * @brief Decrypts secret text that older versions sealed without associated data, to migrate it.
+ * @param cipher The cipher to decrypt with.
+ * @param text The encrypted text on input, the plaintext on success.
+ * @return False if the text does not carry legacyEncryptedTextPrefix or fails authentication.
+ */
+
+bool decryptLegacyTextInPlace(const ChaCha20Poly1305 &cipher, SecretText &text);
+
+/**
+ * @brief Checks whether a string carries the current or the legacy encrypted text prefix.
+ * @param text The text to check.
+ * @return True if the text looks like encryptText output.
+ */
+
+bool isEncryptedText(string_view text);
+
+/**
+ * @brief Checks whether a string carries the legacy encrypted text prefix.
+ * @param text The text to check.
+ * @return True if the text was encrypted without associated data.
+ */
+
+bool isLegacyEncryptedText(string_view text);
+
+#endif //PASSWORDMANAGER_CRYPTO_H
@@ -9,6 +9,23 @@
 #include <ctime>
 #include <cstdlib>
 #include <cstring>
+#include <cstdint>
+#include <unordered_map>
+#include <memory>
+#include "WebsiteIndex.h"
+#include "SearchCache.h"
+#include "SortKeys.h"
+#include "SortedViews.h"
+#include "Crypto.h"
+#include "WorkerPool.h"
+#include "RevealCache.h"
+#include "KeyDerivation.h"
+#include "BlindIndex.h"
+#include "SecureArena.h"
+#include "PasswordGenerator.h"
+#include "Wordlist.h"
+#include "BreachCorpus.h"
+#include "VaultAudit.h"
 using namespace std;
 
 /**
@@ -18,11 +35,31 @@ using namespace std;
 class KeyData {
 public:
     string name;            /**< Name of the password. */
-    string password;        /**< Password. */
+    SecretText password;    /**< Password, or its encrypted text; kept in the secure arena. */
     string category;        /**< Category of the password. */
     string website;         /**< Website associated with the password. */
     string login;           /**< Login associated with the password. */
-    string timestamp;       /**< Timestamp of when the password was added or modified. */
+    int64_t created = 0;    /**< When the entry was added, in seconds since the epoch; 0 if unknown. */
+    int64_t modified = 0;   /**< When the entry was last modified, in seconds since the epoch; 0 if unknown. */
+    uint64_t id = 0;        /**< Session-local identifier assigned by PasswordKeeper. */
+    bool encrypted = false; /**< Whether password holds encrypted text; stored with the entry (see vaultFormatLine). */
+    bool dirty = true;      /**< Whether the entry changed since it was last written to the vault file. */
+};
+
+/**
+ * @brief Case-folded, NFC-normalized shadow of the searchable fields of a password entry.
+ */
+
+class SearchColumns {
+public:
+    string name;            /**< Folded name. */
+    string category;        /**< Folded category. */
+    string website;         /**< Folded website. */
+    string login;           /**< Folded login. */
+    string host;            /**< Normalized host of the website. */
+    int64_t created = 0;    /**< Creation time the entry was indexed with. */
+    int64_t modified = 0;   /**< Modification time the entry was indexed with. */
+    uint64_t revision = 0;  /**< Vault generation at which the entry was last changed; 0 if not indexed. */
 };
 
 /**
@@ -33,8 +70,81 @@ class PasswordKeeper {
 private:
     vector<KeyData> passwords;      /**< Vector to store all the password entries. */
     string sourceFilePath;          /**< Path to the file storing the passwords. */
-    int encryptionKey;              /**< Key used for encryption/decryption. */
+    LockedKey encryptionKey;        /**< Key derived from the master password, kept in locked memory. */
+    bool unlocked = false;          /**< Whether encryptionKey holds the derived key. */
+    bool hasKeyDerivation = false;  /**< Whether the vault has a master password. */
+    KdfParameters keyDerivation;    /**< Salt and cost of the master-password derivation. */
+    string keyCheck;                /**< Known text encrypted under the key, to recognize a wrong master password. */
+    vector<SearchColumns> searchColumns;    /**< Folded search columns, index-aligned with passwords. */
+    WebsiteIndex websiteIndex;              /**< Reverse-domain index of the entry websites. */
+    unordered_map<uint64_t, size_t> positions;  /**< Position of each entry id in the passwords vector. */
+    uint64_t nextEntryId = 1;               /**< Next id handed out to an entry. */
+    uint64_t generation = 0;                /**< Vault generation, bumped by every mutation. */
+    SearchCache searchCache;                /**< Recent search results, stamped with the generation. */
+    SortedViews sortedViews;                /**< Orderings by name, category and modification. */
+    unique_ptr<WorkerPool> workerPool;      /**< Threads for bulk encryption, started on first use. */
+    RevealCache revealCache;                /**< Recently revealed passwords, kept for a few seconds. */
+    BlindIndex blindIndex;                  /**< Keyed search tokens of name, website and login; built on first use. */
+    bool blindIndexBuilt = false;           /**< Whether blindIndex holds every entry under the current key. */
+    SecureRandom randomSource;              /**< Buffered system randomness for password generation. */
+    Wordlist wordlist;                      /**< Wordlist of the last passphrase, mapped on first use. */
+    BreachCorpus breachCorpus;              /**< Local corpus of breached password hashes, mapped on first check. */
+    vector<SecretText> savedRecords;        /**< Vault file text of each entry as last written, index-aligned with passwords. */
+    bool vaultDirty = true;                 /**< Whether the header or the set of entries changed since the last save. */
+    bool legacyFormat = false;              /**< Whether the vault predates format 3 and may hold unbound ciphertext. */
+
+    /**
+     * @brief Maps the default breach corpus file unless a corpus is mapped already.
+     * @return True if a corpus is available.
+     */
+
+    bool loadBreachCorpus();
+
+    /**
+     * @brief Gets the worker pool, starting it on first use.
+     * @return The worker pool.
+     */
+
+    WorkerPool &workers();
+
+    /**
+     * @brief Refreshes the derived search data of a single entry.
+     * @param index Position of the entry in the passwords vector.
+     */
+
+    void indexEntry(size_t index);
+
+    /**
+     * @brief Removes the derived search data of a single entry before it is erased.
+     * @param index Position of the entry in the passwords vector.
+     */
 
+    void unindexEntry(size_t index);
+
+    /**
+     * @brief Rebuilds all derived search data from the passwords vector.
+     */
+
+    void rebuildIndexes();
+
+    /**
+     * @brief Checks that the vault is unlocked and reports an error otherwise.
+     * @return True if the encryption key is available.
+     */
+
+    bool requireUnlocked() const;
+
+    /**
+     * @brief Re-encrypts passwords encrypted under the fixed key of older versions with the derived key.
+     */
+
+    void migrateLegacyKey();
+
+    /**
+     * @brief Re-encrypts passwords that older versions sealed without associated data, bound to their entry names.
+     */
+
+    void bindLegacyCiphertext();
 
 public:
 
@@ -75,14 +185,76 @@ public:
     // GENERATE PASSWORD
     /**
      * @brief Generates a random password.
-     * @param length Length of the generated password.
-     * @param useUpper Whether to include uppercase letters in the generated password.
-     * @param useLower Whether to include lowercase letters in the generated password.
-     * @param useSpecial Whether to include special characters in the generated password.
-     * @return Generated password.
+     *
+     * Characters are drawn with the system's cryptographic random source,
+     * and the password holds at least the minimum number of characters of
+     * every class the policy includes (see generateForPolicy).
+     *
+     * @param policy Length, character classes and minimums of the generated password.
+     * @return Generated password; empty if the policy cannot be met.
+     */
+
+    SecretText generatePassword(const PasswordPolicy &policy);
+
+    // GENERATE PASSPHRASE
+    /**
+     * @brief Generates a diceware passphrase.
+     *
+     * The wordlist file is mapped on first use and stays mapped until a
+     * passphrase is asked for from a different file.
+     *
+     * @param wordCount Number of words.
+     * @param wordlistPath Wordlist file with one word per line, such as the EFF large wordlist.
+     * @param separator Text between two words.
+     * @return Generated passphrase; empty if the wordlist could not be opened.
+     */
+
+    SecretText generatePassphrase(size_t wordCount, const string &wordlistPath = defaultWordlistFile,
+                                  string_view separator = " ");
+
+    /**
+     * @brief Gets the wordlist of the last passphrase.
+     * @return The wordlist; empty before the first passphrase.
      */
 
-    string generatePassword(int length, bool useUpper, bool useLower, bool useSpecial);
+    const Wordlist &getWordlist() const;
+
+    // BREACH CHECK
+    /**
+     * @brief Checks whether a password appears in the local corpus of breached passwords.
+     *
+     * The corpus file (see BreachCorpus) is mapped on the first check. Without
+     * one, every password passes, so the check costs nothing until a corpus
+     * is installed.
+     *
+     * @param password The password.
+     * @return True if the password is in the corpus.
+     */
+
+    bool isBreached(string_view password);
+
+    /**
+     * @brief Gets the breach corpus.
+     * @return The corpus; not open until a corpus file has been found.
+     */
+
+    const BreachCorpus &getBreachCorpus() const;
+
+    // AUDIT
+    /**
+     * @brief Audits every entry of the vault for weak, breached, reused and varied passwords,
+     * stale entries and entries without a website or login.
+     *
+     * The passwords are decrypted, examined and wiped again on all worker
+     * threads; only hashes and scores of them are kept (see examinePassword).
+     * Reuse and variations are then found by sorting those, so a million
+     * entries take seconds.
+     *
+     * @param options Settings of the audit; its time is taken as now if 0.
+     * @return The report, grouped by category; empty if encrypted passwords cannot be read.
+     */
+
+    AuditReport auditVault(AuditOptions options = AuditOptions());
 
     // EDIT PASSWORD
     /**
@@ -111,21 +283,41 @@ public:
     // LOAD PASSWORD
     /**
      * @brief Loads password entries from the source file.
+     *
+     * A vault written before the encryption state was stored is read by
+     * recognizing encrypted text, and is rewritten in the current format at
+     * the next save.
      */
 
     void loadPasswordsFromFile();
 
     // GET PASSWORD
     /**
-     * @brief Gets the vector of password entries.
+     * @brief Gets the vector of password entries for reading only.
+     *
+     * Entries are only changed through the keeper, which keeps the search
+     * columns, indexes, sorted views and dirty flags in step with them.
+     *
      * @return Vector of password entries.
      */
 
-    vector<KeyData> &getPasswords();
+    const vector<KeyData> &getPasswords() const;
+
+    /**
+     * @brief Gets the entry with an id.
+     * @param id The id, as assigned when the entry was added or loaded.
+     * @return The entry, valid until the vault changes; nullptr if there is none.
+     */
+
+    const KeyData *findEntry(uint64_t id) const;
 
     // SAVE PASSWORD
     /**
      * @brief Saves the password entries to the source file.
+     *
+     * Only entries marked dirty are formatted again; the others are written
+     * from the text they were loaded or last saved with. Nothing is written
+     * when no entry, header line or deletion is pending.
      */
 
     void savePasswordsToFile();
@@ -133,31 +325,175 @@ public:
     // SEARCH PASSWORD
     /**
      * @brief Searches for password entries matching a given query.
+     *
+     * Unless caseSensitive is set, name, category, website and login are matched
+     * against their precomputed folded columns, so the search ignores case and
+     * Unicode normalization differences at no extra cost per entry.
+     * Passwords are always matched exactly, and only while they are not encrypted.
+     * Results are cached per query until the vault changes.
+     *
      * @param query Query string to search for.
+     * @param caseSensitive Whether to match the fields byte for byte.
      * @return Vector of password entries matching the query.
      */
 
-    vector<KeyData> searchPasswords(const string &query);
+    vector<KeyData> searchPasswords(const string &query, bool caseSensitive = false);
+
+    // FIND BY WEBSITE
+    /**
+     * @brief Finds the password entries that belong to a website.
+     *
+     * The URL is normalized the same way entry websites are, so
+     * "https://accounts.google.com/login" finds entries saved for
+     * "accounts.google.com" and for "google.com".
+     *
+     * @param url Website or URL to look up.
+     * @param includeSubdomains Whether to also return entries of subdomains of the host.
+     * @return Vector of password entries belonging to the website.
+     */
+
+    vector<KeyData> findByWebsite(const string &url, bool includeSubdomains = false);
+
+    // BLIND INDEX SEARCH
+    /**
+     * @brief Finds entries through the blind index, without reading the field values.
+     *
+     * Only the keyed tokens of the query are computed and looked up, so this
+     * works the same when the fields are stored encrypted. Requires the vault
+     * to be unlocked. The index is built on the first call after unlocking or
+     * reloading, and kept up to date by every change after that.
+     *
+     * @param field The field to search.
+     * @param query The value; a website may be given as a URL.
+     * @param wordMatch False to match the whole field, true to match entries containing every word of the query.
+     * @return Vector of matching password entries.
+     */
+
+    vector<KeyData> findByBlindIndex(BlindField field, const string &query, bool wordMatch = false);
 
     // SORT PASSWORD
     /**
-     * @brief Sorts the password entries based on a given criteria.
-     * @param sortBy Criteria to sort by (e.g., "name", "category", "timestamp").
+     * @brief Prints the password entries sorted by a given criteria.
+     *
+     * The storage order of the entries is left unchanged.
+     *
+     * @param sortBy Sort specification, e.g. "name" or "category,website:desc,name" (see parseSortKeys).
      */
 
     void sortPasswords(const string &sortBy);
 
+    /**
+     * @brief Prints the password entries sorted by several keys at once.
+     * @param keys Sort keys, most significant first.
+     */
+
+    void sortPasswords(const vector<SortKey> &keys);
+
+    /**
+     * @brief Gets the password entries in sorted order without reordering the storage.
+     *
+     * A single name, category or modified key is read from a maintained view and
+     * needs no sort; other keys fall back to the packed-prefix sort.
+     *
+     * @param keys Sort keys, most significant first.
+     * @return Vector of password entries in sorted order.
+     */
+
+    vector<KeyData> getSortedPasswords(const vector<SortKey> &keys);
+
+    /**
+     * @brief Gets one page of the password entries in sorted order.
+     *
+     * Only the requested page is materialized. A single name, category or
+     * modified key walks its view; other keys select the first offset + limit
+     * entries with a partial sort, so the top k of a large vault costs
+     * O(n log k) rather than a full sort.
+     *
+     * @param keys Sort keys, most significant first.
+     * @param offset Number of sorted entries to skip.
+     * @param limit Maximum number of entries to return.
+     * @return Vector of at most limit password entries.
+     */
+
+    vector<KeyData> getSortedPasswords(const vector<SortKey> &keys, size_t offset, size_t limit);
+
+    // GET PASSWORDS MODIFIED BETWEEN
+    /**
+     * @brief Gets the password entries modified within a time range, oldest first.
+     *
+     * The range is read from the modification view, so no entry outside it is visited.
+     *
+     * @param from Start of the range, in seconds since the epoch (inclusive).
+     * @param to End of the range, in seconds since the epoch (inclusive).
+     * @return Vector of password entries modified within the range.
+     */
+
+    vector<KeyData> getPasswordsModifiedBetween(int64_t from, int64_t to);
+
+    // MASTER PASSWORD
+    /**
+     * @brief Checks whether the vault is protected by a master password yet.
+     * @return True if the vault file carries key derivation parameters.
+     */
+
+    bool hasMasterPassword() const;
+
+    /**
+     * @brief Derives the encryption key from the master password and keeps it for the session.
+     *
+     * For a vault without a master password, this sets it: the derivation cost
+     * is calibrated so unlocking takes about half a second on this machine and
+     * the parameters are saved with the vault. The derived key stays in locked
+     * memory until lock() or destruction, so later operations do not derive again.
+     *
+     * @param masterPassword The master password.
+     * @return False if the master password is wrong or empty.
+     */
+
+    bool unlock(const string &masterPassword);
+
+    /**
+     * @brief Changes the master password and re-encrypts the vault under the newly derived key.
+     *
+     * The vault file is re-encrypted as a stream with bounded memory and then
+     * atomically swapped in (see rotateVaultKey); the passwords in memory are
+     * re-encrypted in place, so no password is ever decrypted in bulk.
+     *
+     * @param currentPassword The current master password.
+     * @param newPassword The new master password.
+     * @return False if the current master password is wrong, an encrypted password fails
+     * authentication (nothing is changed then), or the rotation failed.
+     */
+
+    bool changeMasterPassword(const string &currentPassword, const string &newPassword);
+
+    /**
+     * @brief Wipes the session key; encryption and decryption need unlock() again.
+     */
+
+    void lock();
+
+    /**
+     * @brief Checks whether the session key is available.
+     * @return True after a successful unlock().
+     */
+
+    bool isUnlocked() const;
+
     // ENCRYPT
     /**
      * @brief Encrypts all the password entries.
+     *
+     * Entries that are already encrypted are skipped, so calling this again is
+     * a no-op; only the entries it encrypts are marked dirty for the next save.
      */
 
     void encryptAllPasswords();
 
     /**
-     * @brief Encrypts a given password.
+     * @brief Encrypts a given password with ChaCha20-Poly1305 under a fresh random nonce.
      * @param password Password to encrypt.
-     * @return Encrypted password.
+     * @return Encrypted password as printable text (see encryptText).
      */
 
     string encrypt(const string &password);
@@ -165,18 +501,57 @@ public:
     // DECRYPT
     /**
      * @brief Decrypts all the password entries.
+     *
+     * Entries that are not encrypted are skipped, so calling this again is a
+     * no-op; only the entries it decrypts are marked dirty for the next save.
      */
 
     void decryptAllPasswords();
 
     /**
-     * @brief Decrypts a given encrypted password.
+     * @brief Decrypts and authenticates a given encrypted password.
      * @param encryptedPassword Encrypted password.
-     * @return Decrypted password.
+     * @return Decrypted password; the input unchanged if it is not encrypted or fails authentication.
      */
 
     string decrypt(const string &encryptedPassword);
 
+    // REVEAL PASSWORD
+    /**
+     * @brief Gets the password of an entry for display or copying, decrypting it only if it is encrypted.
+     *
+     * Encrypted entries stay encrypted in memory; the plaintext is produced on
+     * demand and, for a short lifetime, cached so that showing the same entry
+     * again does not decrypt it a second time.
+     *
+     * @param entry The entry, e.g. from a search result.
+     * @return The password in the secure arena; the encrypted text unchanged if it fails authentication.
+     */
+
+    SecretText revealPassword(const KeyData &entry);
+
+    /**
+     * @brief Sets how long revealed passwords are cached.
+     * @param seconds The lifetime in seconds; 0 disables caching.
+     */
+
+    void setRevealCacheLifetime(int seconds);
+
+    // LEGACY IMPORT
+    /**
+     * @brief Decodes the passwords of a vault encrypted by the first version, which XOR-ed every byte with 10.
+     *
+     * Those passwords carry no marker, so they cannot be told apart from
+     * plaintext and are loaded as plaintext; this is only run when asked for
+     * (PasswordManager --import-xor-vault). Vaults with a master password were
+     * written by a later version and are refused. Decoded entries are saved
+     * in plaintext, ready to be encrypted under the master password.
+     *
+     * @return Number of passwords decoded; 0 if the vault has a master password.
+     */
+
+    size_t decodeLegacyXorPasswords();
+
     // ADD CATEGORY
     /**
      * @brief Adds a new category.
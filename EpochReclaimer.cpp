@@ -0,0 +1,119 @@
+/**
+ * @file EpochReclaimer.cpp
+ * @brief Implementation of epoch-based reclamation.
+ */
+
+#include "EpochReclaimer.h"
+#include <algorithm>
+#include <thread>
+
+using namespace std;
+
+// READ GUARD
+/**
+     * @brief Constructor; claims a slot of the reclaimer.
+     * @param reclaimer The reclaimer.
+     */
+
+EpochReclaimer::ReadGuard::ReadGuard(EpochReclaimer& reclaimer) : reclaimer(reclaimer), slot(reclaimer.enter()) {
+}
+
+/**
+ * @brief Destructor.
+ * Gives the slot back.
+ */
+
+EpochReclaimer::ReadGuard::~ReadGuard() {
+    reclaimer.leave(slot);
+}
+
+// ENTER AND LEAVE
+/**
+     * @brief Claims a free slot, starting from one picked by thread so a thread usually gets the same slot,
+     * and announces the epoch in it.
+     * @return The slot.
+     */
+
+size_t EpochReclaimer::enter() {
+    static thread_local size_t preferred = hash<thread::id>{}(this_thread::get_id()) % slotCount;
+    for (;;) {
+        for (size_t i = 0; i < slotCount; i++) {
+            size_t slot = (preferred + i) % slotCount;
+            ReaderSlot& reader = slots[slot];
+            if (reader.busy.load(memory_order_relaxed) || reader.busy.exchange(true, memory_order_acquire)) {
+                continue;
+            }
+            // Sequentially consistent, so the announcement is visible before the caller loads a pointer
+            reader.epoch.store(globalEpoch.load(memory_order_seq_cst), memory_order_seq_cst);
+            preferred = slot;
+            return slot;
+        }
+        this_thread::yield();
+    }
+}
+
+/**
+     * @brief Clears the announcement of the slot and frees it.
+     * @param slot The slot.
+     */
+
+void EpochReclaimer::leave(size_t slot) {
+    slots[slot].epoch.store(0, memory_order_release);
+    slots[slot].busy.store(false, memory_order_release);
+}
+
+// RETIRE
+/**
+     * @brief Tags the release function with the current epoch, advances the epoch and releases what it can.
+     * @param release Function that frees the object.
+     */
+
+void EpochReclaimer::retire(function<void()> release) {
+    lock_guard<mutex> guard(retiredLock);
+    retired.emplace_back(globalEpoch.fetch_add(1, memory_order_seq_cst), move(release));
+    releaseUnreachable();
+}
+
+// RECLAIM
+/**
+     * @brief Releases the retired objects no reader can still hold.
+     * @return Number of objects still waiting.
+     */
+
+size_t EpochReclaimer::reclaim() {
+    lock_guard<mutex> guard(retiredLock);
+    releaseUnreachable();
+    return retired.size();
+}
+
+/**
+     * @brief Finds the oldest epoch a reader is inside and runs every release function retired before it.
+     */
+
+void EpochReclaimer::releaseUnreachable() {
+    uint64_t oldest = UINT64_MAX;
+    for (const ReaderSlot& reader : slots) {
+        uint64_t epoch = reader.epoch.load(memory_order_seq_cst);
+        if (epoch != 0) {
+            oldest = min(oldest, epoch);
+        }
+    }
+    auto reachable = stable_partition(retired.begin(), retired.end(), [oldest](const auto& object) {
+        return object.first >= oldest;
+    });
+    for (auto it = reachable; it != retired.end(); ++it) {
+        it->second();
+    }
+    retired.erase(reachable, retired.end());
+}
+
+/**
+ * @brief Destructor.
+ * Releases every retired object.
+ */
+
+EpochReclaimer::~EpochReclaimer() {
+    for (auto& object : retired) {
+        object.second();
+    }
+}
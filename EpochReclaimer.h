@@ -0,0 +1,138 @@
+#ifndef PASSWORDMANAGER_EPOCHRECLAIMER_H
+#define PASSWORDMANAGER_EPOCHRECLAIMER_H
+
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <utility>
+#include <vector>
+using namespace std;
+
+/**
+ * @file EpochReclaimer.h
+ * @brief Epoch-based reclamation of objects that lock-free readers may still be using.
+ */
+
+/**
+ * @brief Defers freeing unpublished objects until no reader can still hold them.
+ *
+ * A reader announces the global epoch in a slot of its own for as long as it
+ * holds a published pointer; entering and leaving costs one atomic exchange
+ * and two stores, and readers never wait for one another or for a writer.
+ * A writer first publishes the replacement, then retires the old object with
+ * the current epoch and advances the epoch. The object is freed once every
+ * busy slot announces a later epoch, since readers that entered after the
+ * advance can only have loaded the replacement.
+ *
+ * Slots are padded to a cache line each so readers on different cores do not
+ * share one. If more readers than slots are inside at once, the extra ones
+ * spin until a slot frees up.
+ */
+
+class EpochReclaimer {
+public:
+    static const size_t slotCount = 128;    /**< Readers that can be inside at the same time. */
+
+private:
+    /**
+     * @brief Announcement of one reader, on a cache line of its own.
+     */
+
+    struct alignas(64) ReaderSlot {
+        atomic<bool> busy{false};       /**< Whether a reader owns the slot. */
+        atomic<uint64_t> epoch{0};      /**< Epoch the reader entered in; 0 while it is not inside. */
+    };
+
+    array<ReaderSlot, slotCount> slots;                 /**< One slot per reader inside. */
+    atomic<uint64_t> globalEpoch{1};                    /**< Current epoch; advanced by every retirement. */
+    mutex retiredLock;                                  /**< Guards retired. */
+    vector<pair<uint64_t, function<void()>>> retired;   /**< Release functions, with the epoch they were retired in. */
+
+    /**
+     * @brief Claims a slot and announces the current epoch in it.
+     * @return The slot.
+     */
+
+    size_t enter();
+
+    /**
+     * @brief Clears the announcement and gives the slot back.
+     * @param slot The slot.
+     */
+
+    void leave(size_t slot);
+
+    /**
+     * @brief Runs the release functions no reader can depend on any more; retiredLock must be held.
+     */
+
+    void releaseUnreachable();
+
+public:
+
+    /**
+     * @brief Keeps the published objects a reader loads alive until it goes out of scope.
+     *
+     * Load the published pointer after constructing the guard, never before.
+     */
+
+    class ReadGuard {
+    private:
+        EpochReclaimer &reclaimer;  /**< Reclaimer the slot belongs to. */
+        size_t slot;                /**< Slot claimed for this reader. */
+
+    public:
+        /**
+         * @brief Enters a read-side critical section.
+         * @param reclaimer The reclaimer.
+         */
+
+        explicit ReadGuard(EpochReclaimer &reclaimer);
+
+        /**
+         * @brief Leaves the critical section.
+         */
+
+        ~ReadGuard();
+
+        ReadGuard(const ReadGuard &) = delete;
+        ReadGuard &operator=(const ReadGuard &) = delete;
+    };
+
+    EpochReclaimer() = default;
+
+    /**
+     * @brief Destructor; releases everything still retired. No reader may be inside.
+     */
+
+    ~EpochReclaimer();
+
+    EpochReclaimer(const EpochReclaimer &) = delete;
+    EpochReclaimer &operator=(const EpochReclaimer &) = delete;
+
+    // RETIRE
+    /**
+     * @brief Schedules an object that is no longer published to be released.
+     *
+     * The replacement must be published before the call. The release function
+     * runs on the calling thread of this or a later retire() or reclaim(),
+     * once no reader that could have loaded the object is still inside.
+     *
+     * @param release Function that frees the object.
+     */
+
+    void retire(function<void()> release);
+
+    // RECLAIM
+    /**
+     * @brief Releases the retired objects no reader can still hold.
+     * @return Number of objects still waiting for readers.
+     */
+
+    size_t reclaim();
+};
+
+#endif //PASSWORDMANAGER_EPOCHRECLAIMER_H
@@ -0,0 +1,611 @@
+/**
+ * @file KeyDerivation.cpp
+ * @brief Implementation of SHA-256, HMAC-SHA256, PBKDF2 and the locked key page.
+ */
+
+#include "KeyDerivation.h"
+#include "Crypto.h"
+#include "SecureArena.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if (defined(__x86_64__) || defined(__i386__)) && (defined(__GNUC__) || defined(__clang__))
+#define PASSWORDMANAGER_SHA_KERNELS 1
+#include <cpuid.h>
+#include <immintrin.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+const uint32_t roundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+};
+
+const uint32_t initialState[8] = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+};
+
+uint32_t loadBigEndian32(const uint8_t* p) {
+    return (uint32_t(p[0]) << 24) | (uint32_t(p[1]) << 16) | (uint32_t(p[2]) << 8) | uint32_t(p[3]);
+}
+
+void storeBigEndian32(uint8_t* p, uint32_t v) {
+    p[0] = uint8_t(v >> 24);
+    p[1] = uint8_t(v >> 16);
+    p[2] = uint8_t(v >> 8);
+    p[3] = uint8_t(v);
+}
+
+uint32_t rotr32(uint32_t v, int n) {
+    return (v >> n) | (v << (32 - n));
+}
+
+/**
+ * @brief Signature of a compression kernel: hashes whole 64-byte blocks into the state.
+ */
+
+using Sha256Kernel = void (*)(uint32_t state[8], const uint8_t* data, size_t blocks);
+
+/**
+ * @brief Portable compression function.
+ */
+
+void sha256Scalar(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    uint32_t w[64];
+    for (; blocks > 0; blocks--, data += 64) {
+        for (int i = 0; i < 16; i++) {
+            w[i] = loadBigEndian32(data + 4 * i);
+        }
+        for (int i = 16; i < 64; i++) {
+            uint32_t s0 = rotr32(w[i - 15], 7) ^ rotr32(w[i - 15], 18) ^ (w[i - 15] >> 3);
+            uint32_t s1 = rotr32(w[i - 2], 17) ^ rotr32(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        uint32_t a = state[0], b = state[1], c = state[2], d = state[3];
+        uint32_t e = state[4], f = state[5], g = state[6], h = state[7];
+        for (int i = 0; i < 64; i++) {
+            uint32_t t1 = h + (rotr32(e, 6) ^ rotr32(e, 11) ^ rotr32(e, 25)) + ((e & f) ^ (~e & g)) +
+                          roundConstants[i] + w[i];
+            uint32_t t2 = (rotr32(a, 2) ^ rotr32(a, 13) ^ rotr32(a, 22)) + ((a & b) ^ (a & c) ^ (b & c));
+            h = g; g = f; f = e; e = d + t1;
+            d = c; c = b; b = a; a = t1 + t2;
+        }
+        state[0] += a; state[1] += b; state[2] += c; state[3] += d;
+        state[4] += e; state[5] += f; state[6] += g; state[7] += h;
+    }
+    secureZero(w, sizeof(w));
+}
+
+#ifdef PASSWORDMANAGER_SHA_KERNELS
+
+/**
+ * @brief Compression with the x86 SHA extensions; four rounds per group.
+ */
+
+__attribute__((target("sha,sse4.1")))
+void sha256Shani(uint32_t state[8], const uint8_t* data, size_t blocks) {
+    const __m128i byteSwap = _mm_set_epi64x(0x0c0d0e0f08090a0bULL, 0x0405060700010203ULL);
+
+    // The instructions keep the state as ABEF and CDGH
+    __m128i tmp = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[0])), 0xB1);
+    __m128i state1 = _mm_shuffle_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(&state[4])), 0x1B);
+    __m128i state0 = _mm_alignr_epi8(tmp, state1, 8);
+    state1 = _mm_blend_epi16(state1, tmp, 0xF0);
+
+    for (; blocks > 0; blocks--, data += 64) {
+        __m128i savedAbef = state0, savedCdgh = state1;
+        __m128i msg[4];
+
+#pragma GCC unroll 16
+        for (int g = 0; g < 16; g++) {
+            __m128i& current = msg[g % 4];
+            if (g < 4) {
+                current = _mm_shuffle_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(data + 16 * g)), byteSwap);
+            }
+            __m128i words = _mm_add_epi32(current,
+                                          _mm_loadu_si128(reinterpret_cast<const __m128i*>(&roundConstants[4 * g])));
+            state1 = _mm_sha256rnds2_epu32(state1, state0, words);
+            if (g >= 3 && g <= 14) {
+                __m128i& next = msg[(g + 1) % 4];
+                next = _mm_add_epi32(next, _mm_alignr_epi8(current, msg[(g + 3) % 4], 4));
+                next = _mm_sha256msg2_epu32(next, current);
+            }
+            state0 = _mm_sha256rnds2_epu32(state0, state1, _mm_shuffle_epi32(words, 0x0E));
+            if (g >= 1 && g <= 12) {
+                msg[(g + 3) % 4] = _mm_sha256msg1_epu32(msg[(g + 3) % 4], current);
+            }
+        }
+
+        state0 = _mm_add_epi32(state0, savedAbef);
+        state1 = _mm_add_epi32(state1, savedCdgh);
+    }
+
+    tmp = _mm_shuffle_epi32(state0, 0x1B);
+    state1 = _mm_shuffle_epi32(state1, 0xB1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[0]), _mm_blend_epi16(tmp, state1, 0xF0));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&state[4]), _mm_alignr_epi8(state1, tmp, 8));
+}
+
+/**
+ * @brief Checks for the SHA extensions and the SSSE3/SSE4.1 shuffles the kernel uses.
+ */
+
+bool cpuHasShaExtensions() {
+    unsigned eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx) || !(ecx & bit_SSSE3) || !(ecx & bit_SSE4_1)) {
+        return false;
+    }
+    return __get_cpuid_count(7, 0, &eax, &ebx, &ecx, &edx) && (ebx & bit_SHA);
+}
+
+#endif // PASSWORDMANAGER_SHA_KERNELS
+
+/**
+ * @brief A named compression kernel.
+ */
+
+struct Sha256KernelInfo {
+    const char* name;       /**< Kernel name. */
+    Sha256Kernel kernel;    /**< Kernel function. */
+    bool (*supported)();    /**< Whether the CPU can run it. */
+};
+
+const Sha256KernelInfo sha256Kernels[] = {
+    {"scalar", sha256Scalar, [] { return true; }},
+#ifdef PASSWORDMANAGER_SHA_KERNELS
+    {"shani", sha256Shani, cpuHasShaExtensions},
+#endif
+};
+
+/**
+ * @brief The kernel in use; starts as the fastest supported one.
+ */
+
+const Sha256KernelInfo*& activeSha256Kernel() {
+    static const Sha256KernelInfo* active = [] {
+        const Sha256KernelInfo* best = &sha256Kernels[0];
+        for (const Sha256KernelInfo& info : sha256Kernels) {
+            if (info.supported()) {
+                best = &info;
+            }
+        }
+        return best;
+    }();
+    return active;
+}
+
+} // namespace
+
+/**
+     * @brief Constructor.
+     * Starts from the SHA-256 initial hash value.
+     */
+
+Sha256::Sha256() {
+    memcpy(state, initialState, sizeof(state));
+}
+
+/**
+ * @brief Destructor.
+ * Wipes the chaining state and the buffered input.
+ */
+
+Sha256::~Sha256() {
+    secureZero(state, sizeof(state));
+    secureZero(buffer, sizeof(buffer));
+}
+
+// UPDATE
+/**
+     * @brief Hashes more data, compressing whole blocks directly from the input.
+     * @param data Bytes to hash.
+     * @param length Number of bytes.
+     */
+
+void Sha256::update(const uint8_t* data, size_t length) {
+    Sha256Kernel compress = activeSha256Kernel()->kernel;
+    totalLength += length;
+
+    if (buffered > 0) {
+        size_t take = min(length, blockSize - buffered);
+        memcpy(buffer + buffered, data, take);
+        buffered += take;
+        data += take;
+        length -= take;
+        if (buffered < blockSize) {
+            return;
+        }
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+
+    size_t blocks = length / blockSize;
+    if (blocks > 0) {
+        compress(state, data, blocks);
+        data += blocks * blockSize;
+        length -= blocks * blockSize;
+    }
+    memcpy(buffer, data, length);
+    buffered = length;
+}
+
+// FINISH
+/**
+     * @brief Appends the padding and length, then writes the digest.
+     * @param digest Receives the 32-byte digest.
+     */
+
+void Sha256::finish(uint8_t* digest) {
+    Sha256Kernel compress = activeSha256Kernel()->kernel;
+    uint64_t bitLength = totalLength * 8;
+
+    buffer[buffered++] = 0x80;
+    if (buffered > blockSize - 8) {
+        memset(buffer + buffered, 0, blockSize - buffered);
+        compress(state, buffer, 1);
+        buffered = 0;
+    }
+    memset(buffer + buffered, 0, blockSize - 8 - buffered);
+    storeBigEndian32(buffer + 56, uint32_t(bitLength >> 32));
+    storeBigEndian32(buffer + 60, uint32_t(bitLength));
+    compress(state, buffer, 1);
+
+    for (int i = 0; i < 8; i++) {
+        storeBigEndian32(digest + 4 * i, state[i]);
+    }
+}
+
+// KERNELS
+/**
+     * @brief Lists the kernels the CPU supports.
+     * @return Kernel names, fastest last.
+     */
+
+vector<string> Sha256::availableKernels() {
+    vector<string> names;
+    for (const Sha256KernelInfo& info : sha256Kernels) {
+        if (info.supported()) {
+            names.push_back(info.name);
+        }
+    }
+    return names;
+}
+
+/**
+     * @brief Gets the name of the kernel in use.
+     * @return The kernel name.
+     */
+
+string Sha256::kernelName() {
+    return activeSha256Kernel()->name;
+}
+
+/**
+     * @brief Selects a kernel by name.
+     * @param name The kernel name.
+     * @return False if the kernel is unknown or unsupported.
+     */
+
+bool Sha256::selectKernel(const string& name) {
+    for (const Sha256KernelInfo& info : sha256Kernels) {
+        if (name == info.name && info.supported()) {
+            activeSha256Kernel() = &info;
+            return true;
+        }
+    }
+    return false;
+}
+
+// SHA-256
+/**
+     * @brief Computes a SHA-256 digest in one call.
+     * @param data Message bytes.
+     * @param length Message length.
+     * @param digest Receives the 32-byte digest.
+     */
+
+void sha256(const uint8_t* data, size_t length, uint8_t* digest) {
+    Sha256 hash;
+    hash.update(data, length);
+    hash.finish(digest);
+}
+
+// HMAC-SHA256
+/**
+     * @brief Computes HMAC-SHA256.
+     * @param key Key bytes.
+     * @param keyLength Key length.
+     * @param message Message bytes.
+     * @param length Message length.
+     * @param mac Receives the 32-byte authenticator.
+     */
+
+void hmacSha256(const uint8_t* key, size_t keyLength, const uint8_t* message, size_t length, uint8_t* mac) {
+    HmacSha256(key, keyLength).mac(message, length, mac);
+}
+
+/**
+     * @brief Constructor.
+     * Hashes the inner and outer key pads once.
+     * @param key Key bytes.
+     * @param keyLength Key length.
+     */
+
+HmacSha256::HmacSha256(const uint8_t* key, size_t keyLength) {
+    uint8_t block[64] = {};
+    if (keyLength > 64) {
+        sha256(key, keyLength, block);
+    } else if (keyLength > 0) {
+        memcpy(block, key, keyLength);
+    }
+
+    Sha256Kernel compress = activeSha256Kernel()->kernel;
+    uint8_t pad[64];
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x36;
+    memcpy(inner, initialState, sizeof(inner));
+    compress(inner, pad, 1);
+    for (int i = 0; i < 64; i++) pad[i] = block[i] ^ 0x5c;
+    memcpy(outer, initialState, sizeof(outer));
+    compress(outer, pad, 1);
+
+    secureZero(block, sizeof(block));
+    secureZero(pad, sizeof(pad));
+}
+
+/**
+ * @brief Destructor.
+ * Wipes the hashed pads.
+ */
+
+HmacSha256::~HmacSha256() {
+    secureZero(inner, sizeof(inner));
+    secureZero(outer, sizeof(outer));
+}
+
+// MAC
+/**
+     * @brief Finishes the inner hash from the hashed ipad, then the outer hash from the hashed opad.
+     * @param message Message bytes.
+     * @param length Message length.
+     * @param mac Receives the 32-byte authenticator.
+     */
+
+void HmacSha256::mac(const uint8_t* message, size_t length, uint8_t* mac) const {
+    Sha256Kernel compress = activeSha256Kernel()->kernel;
+    uint32_t state[8];
+    uint8_t block[64];
+
+    memcpy(state, inner, sizeof(state));
+    size_t whole = length / 64;
+    if (whole > 0) {
+        compress(state, message, whole);
+    }
+    size_t rest = length - whole * 64;
+    if (rest > 0) {
+        memcpy(block, message + whole * 64, rest);
+    }
+    block[rest++] = 0x80;
+    if (rest > 56) {
+        memset(block + rest, 0, 64 - rest);
+        compress(state, block, 1);
+        rest = 0;
+    }
+    memset(block + rest, 0, 56 - rest);
+    uint64_t bitLength = (64 + uint64_t(length)) * 8;
+    storeBigEndian32(block + 56, uint32_t(bitLength >> 32));
+    storeBigEndian32(block + 60, uint32_t(bitLength));
+    compress(state, block, 1);
+
+    // The outer message is the 32-byte inner digest after the 64-byte pad
+    for (int w = 0; w < 8; w++) storeBigEndian32(block + 4 * w, state[w]);
+    block[32] = 0x80;
+    memset(block + 33, 0, 64 - 33);
+    storeBigEndian32(block + 60, 96 * 8);
+    memcpy(state, outer, sizeof(state));
+    compress(state, block, 1);
+    for (int w = 0; w < 8; w++) storeBigEndian32(mac + 4 * w, state[w]);
+
+    secureZero(state, sizeof(state));
+    secureZero(block, sizeof(block));
+}
+
+// PBKDF2
+/**
+     * @brief Derives key material with PBKDF2-HMAC-SHA256.
+     *
+     * After the first HMAC of each output block, every iteration hashes a single
+     * pre-padded block from the cached inner state and one from the outer state.
+     *
+     * @param password The password.
+     * @param salt Salt bytes.
+     * @param saltLength Salt length.
+     * @param iterations Iteration count; at least 1.
+     * @param out Receives the derived bytes.
+     * @param outLength Number of bytes to derive.
+     */
+
+void pbkdf2HmacSha256(const string& password, const uint8_t* salt, size_t saltLength, uint32_t iterations,
+                      uint8_t* out, size_t outLength) {
+    const uint8_t* key = reinterpret_cast<const uint8_t*>(password.data());
+    HmacSha256 pads(key, password.size());
+    Sha256Kernel compress = activeSha256Kernel()->kernel;
+
+    // Both per-iteration messages are one 32-byte digest after a 64-byte pad: 96 bytes in total
+    uint8_t block[64] = {};
+    block[32] = 0x80;
+    storeBigEndian32(block + 60, 96 * 8);
+
+    vector<uint8_t> saltAndIndex(salt, salt + saltLength);
+    saltAndIndex.resize(saltLength + 4);
+
+    for (uint32_t blockIndex = 1; outLength > 0; blockIndex++) {
+        storeBigEndian32(saltAndIndex.data() + saltLength, blockIndex);
+
+        // U1 = HMAC(password, salt || index)
+        uint8_t u[Sha256::digestSize];
+        uint8_t t[Sha256::digestSize];
+        pads.mac(saltAndIndex.data(), saltAndIndex.size(), u);
+        memcpy(t, u, sizeof(t));
+
+        uint32_t state[8];
+        memcpy(block, u, sizeof(u));
+        for (uint32_t i = 1; i < iterations; i++) {
+            memcpy(state, pads.inner, sizeof(state));
+            compress(state, block, 1);
+            for (int w = 0; w < 8; w++) storeBigEndian32(block + 4 * w, state[w]);
+
+            memcpy(state, pads.outer, sizeof(state));
+            compress(state, block, 1);
+            for (int w = 0; w < 8; w++) storeBigEndian32(block + 4 * w, state[w]);
+
+            for (int b = 0; b < 32; b++) t[b] ^= block[b];
+        }
+
+        size_t take = min(outLength, sizeof(t));
+        memcpy(out, t, take);
+        out += take;
+        outLength -= take;
+
+        secureZero(u, sizeof(u));
+        secureZero(t, sizeof(t));
+        secureZero(state, sizeof(state));
+    }
+    secureZero(block, sizeof(block));
+}
+
+// TO TEXT
+/**
+     * @brief Formats the parameters as "pbkdf2-sha256:<iterations>:<base64 salt>".
+     * @return The parameters as text.
+     */
+
+string KdfParameters::toText() const {
+    return "pbkdf2-sha256:" + to_string(iterations) + ":" + toBase64(salt, saltSize);
+}
+
+// FROM TEXT
+/**
+     * @brief Parses "pbkdf2-sha256:<iterations>:<base64 salt>".
+     * @param text The text.
+     * @return False if the algorithm is unknown or a field is malformed.
+     */
+
+bool KdfParameters::fromText(const string& text) {
+    const string algorithm = "pbkdf2-sha256:";
+    size_t separator = text.find(':', algorithm.size());
+    if (text.compare(0, algorithm.size(), algorithm) != 0 || separator == string::npos) {
+        return false;
+    }
+
+    string count = text.substr(algorithm.size(), separator - algorithm.size());
+    char* end = nullptr;
+    unsigned long long parsed = strtoull(count.c_str(), &end, 10);
+    vector<uint8_t> decoded;
+    if (count.empty() || *end != '\0' || parsed == 0 || parsed > UINT32_MAX ||
+        !fromBase64(text.substr(separator + 1), decoded) || decoded.size() != saltSize) {
+        return false;
+    }
+
+    iterations = static_cast<uint32_t>(parsed);
+    memcpy(salt, decoded.data(), saltSize);
+    return true;
+}
+
+// CALIBRATE
+/**
+     * @brief Times a trial derivation and scales the iteration count to the target time.
+     * @param targetMilliseconds Desired derivation time.
+     * @return The iteration count.
+     */
+
+uint32_t calibrateIterations(double targetMilliseconds) {
+    uint8_t salt[KdfParameters::saltSize] = {};
+    uint8_t key[LockedKey::size];
+
+    // Double the trial until it runs long enough to time reliably
+    uint32_t trial = 4096;
+    double elapsed = 0;
+    while (true) {
+        auto start = chrono::steady_clock::now();
+        pbkdf2HmacSha256("calibration", salt, sizeof(salt), trial, key, sizeof(key));
+        elapsed = chrono::duration<double, milli>(chrono::steady_clock::now() - start).count();
+        if (elapsed >= 25 || trial >= (1u << 30)) {
+            break;
+        }
+        trial *= 2;
+    }
+
+    double scaled = trial * (targetMilliseconds / elapsed);
+    return static_cast<uint32_t>(clamp(scaled, double(KdfParameters::minimumIterations), double(UINT32_MAX)));
+}
+
+/**
+     * @brief Constructor.
+     * Maps a private page for the key and asks the system to keep it in RAM.
+     */
+
+LockedKey::LockedKey() {
+    pageSize = lockedPageSize();
+    bytes = mapLockedPages(pageSize, pinned);
+    if (!bytes) {
+        cerr << "Error: Unable To Allocate Memory For The Key!" << endl;
+        abort();
+    }
+}
+
+/**
+ * @brief Destructor.
+ * Wipes the key, then unlocks and releases the page.
+ */
+
+LockedKey::~LockedKey() {
+    unmapLockedPages(bytes, pageSize, pinned);
+}
+
+/**
+     * @brief Gets the key bytes.
+     * @return Pointer to the key.
+     */
+
+uint8_t* LockedKey::data() {
+    return bytes;
+}
+
+/**
+     * @brief Gets the key bytes.
+     * @return Pointer to the key.
+     */
+
+const uint8_t* LockedKey::data() const {
+    return bytes;
+}
+
+/**
+     * @brief Checks whether the page is locked in RAM.
+     * @return True if mlock or VirtualLock succeeded.
+     */
+
+bool LockedKey::isLocked() const {
+    return pinned;
+}
+
+/**
+     * @brief Zeroes the key.
+     */
+
+void LockedKey::wipe() {
+    secureZero(bytes, size);
+}
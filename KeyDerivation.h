@@ -0,0 +1,266 @@
+#ifndef PASSWORDMANAGER_KEYDERIVATION_H
+#define PASSWORDMANAGER_KEYDERIVATION_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+/**
+ * @file KeyDerivation.h
+ * @brief SHA-256, HMAC-SHA256 and PBKDF2 for deriving the vault key from a master password.
+ */
+
+/**
+ * @brief Incremental SHA-256 (FIPS 180-4).
+ *
+ * The compression function is the fastest the CPU supports, chosen once at
+ * start-up: the SHA extensions on x86 or portable scalar code.
+ */
+
+class Sha256 {
+private:
+    uint32_t state[8];          /**< Chaining state. */
+    uint8_t buffer[64];         /**< Partial block. */
+    size_t buffered = 0;        /**< Bytes in buffer. */
+    uint64_t totalLength = 0;   /**< Bytes hashed so far. */
+
+public:
+    static const size_t digestSize = 32;    /**< Digest length in bytes. */
+    static const size_t blockSize = 64;     /**< Block length in bytes. */
+
+    /**
+     * @brief Constructor for Sha256 class.
+     */
+
+    Sha256();
+
+    /**
+     * @brief Destructor; wipes the state.
+     */
+
+    ~Sha256();
+
+    // UPDATE
+    /**
+     * @brief Hashes more data.
+     * @param data Bytes to hash.
+     * @param length Number of bytes.
+     */
+
+    void update(const uint8_t *data, size_t length);
+
+    // FINISH
+    /**
+     * @brief Pads the message and writes the digest.
+     * @param digest Receives the 32-byte digest.
+     */
+
+    void finish(uint8_t *digest);
+
+    // KERNELS
+    /**
+     * @brief Lists the compression kernels the CPU supports, fastest last.
+     * @return Kernel names, e.g. "scalar", "shani".
+     */
+
+    static vector<string> availableKernels();
+
+    /**
+     * @brief Gets the name of the kernel in use.
+     * @return The kernel name.
+     */
+
+    static string kernelName();
+
+    /**
+     * @brief Selects a kernel by name, e.g. to benchmark it.
+     * @param name The kernel name.
+     * @return False if the kernel is not available on this CPU.
+     */
+
+    static bool selectKernel(const string &name);
+};
+
+// SHA-256
+/**
+ * @brief Computes the SHA-256 digest of a message.
+ * @param data Message bytes.
+ * @param length Message length.
+ * @param digest Receives the 32-byte digest.
+ */
+
+void sha256(const uint8_t *data, size_t length, uint8_t *digest);
+
+// HMAC-SHA256
+/**
+ * @brief Computes HMAC-SHA256 (RFC 2104).
+ * @param key Key bytes.
+ * @param keyLength Key length.
+ * @param message Message bytes.
+ * @param length Message length.
+ * @param mac Receives the 32-byte authenticator.
+ */
+
+void hmacSha256(const uint8_t *key, size_t keyLength, const uint8_t *message, size_t length, uint8_t *mac);
+
+/**
+ * @brief HMAC-SHA256 under a fixed key, with the key pads hashed once.
+ *
+ * Authenticating a short message then costs two compression-function calls,
+ * which suits computing many tags under one key, such as search tokens.
+ */
+
+class HmacSha256 {
+private:
+    uint32_t inner[8];      /**< SHA-256 state after hashing key ^ ipad. */
+    uint32_t outer[8];      /**< SHA-256 state after hashing key ^ opad. */
+
+    friend void pbkdf2HmacSha256(const string &password, const uint8_t *salt, size_t saltLength,
+                                 uint32_t iterations, uint8_t *out, size_t outLength);
+
+public:
+
+    /**
+     * @brief Constructor for HmacSha256 class.
+     * @param key Key bytes.
+     * @param keyLength Key length.
+     */
+
+    HmacSha256(const uint8_t *key, size_t keyLength);
+
+    /**
+     * @brief Destructor; wipes the hashed pads.
+     */
+
+    ~HmacSha256();
+
+    // MAC
+    /**
+     * @brief Computes the HMAC of a message.
+     * @param message Message bytes.
+     * @param length Message length.
+     * @param mac Receives the 32-byte authenticator.
+     */
+
+    void mac(const uint8_t *message, size_t length, uint8_t *mac) const;
+};
+
+// PBKDF2
+/**
+ * @brief Derives key material with PBKDF2-HMAC-SHA256 (RFC 8018).
+ *
+ * The HMAC pads are hashed once up front, so every iteration costs exactly
+ * two compression-function calls.
+ *
+ * @param password The password.
+ * @param salt Salt bytes.
+ * @param saltLength Salt length.
+ * @param iterations Iteration count; at least 1.
+ * @param out Receives the derived bytes.
+ * @param outLength Number of bytes to derive.
+ */
+
+void pbkdf2HmacSha256(const string &password, const uint8_t *salt, size_t saltLength, uint32_t iterations,
+                      uint8_t *out, size_t outLength);
+
+/**
+ * @brief Parameters of the master-password key derivation, stored in the vault file.
+ */
+
+class KdfParameters {
+public:
+    static const size_t saltSize = 16;              /**< Salt length in bytes. */
+    static const uint32_t minimumIterations = 100000;   /**< Lowest iteration count calibration picks. */
+
+    uint32_t iterations = 0;        /**< PBKDF2 iteration count. */
+    uint8_t salt[saltSize] = {};    /**< Random salt. */
+
+    // TO TEXT
+    /**
+     * @brief Formats the parameters for the vault file, e.g. "pbkdf2-sha256:600000:<base64 salt>".
+     * @return The parameters as text.
+     */
+
+    string toText() const;
+
+    // FROM TEXT
+    /**
+     * @brief Parses parameters written by toText.
+     * @param text The text.
+     * @return False if the text is not valid.
+     */
+
+    bool fromText(const string &text);
+};
+
+// CALIBRATE
+/**
+ * @brief Picks the PBKDF2 iteration count that takes about the target time on this machine.
+ * @param targetMilliseconds Desired derivation time.
+ * @return The iteration count, never below KdfParameters::minimumIterations.
+ */
+
+uint32_t calibrateIterations(double targetMilliseconds);
+
+/**
+ * @brief A 32-byte key kept in its own page that is locked in RAM.
+ *
+ * The page is excluded from swap and, where supported, from core dumps, and
+ * is wiped before it is released.
+ */
+
+class LockedKey {
+private:
+    uint8_t *bytes = nullptr;   /**< The key, at the start of the page. */
+    size_t pageSize = 0;        /**< Size of the mapping. */
+    bool pinned = false;        /**< Whether the page is locked in RAM. */
+
+public:
+    static const size_t size = 32;  /**< Key length in bytes. */
+
+    /**
+     * @brief Constructor for LockedKey class; the key starts zeroed.
+     */
+
+    LockedKey();
+
+    /**
+     * @brief Destructor; wipes, unlocks and releases the page.
+     */
+
+    ~LockedKey();
+
+    LockedKey(const LockedKey &) = delete;
+    LockedKey &operator=(const LockedKey &) = delete;
+
+    /**
+     * @brief Gets the key bytes.
+     * @return Pointer to the 32 key bytes.
+     */
+
+    uint8_t *data();
+
+    /**
+     * @brief Gets the key bytes.
+     * @return Pointer to the 32 key bytes.
+     */
+
+    const uint8_t *data() const;
+
+    /**
+     * @brief Checks whether the operating system agreed to lock the page in RAM.
+     * @return True if the page cannot be swapped out.
+     */
+
+    bool isLocked() const;
+
+    /**
+     * @brief Zeroes the key.
+     */
+
+    void wipe();
+};
+
+#endif //PASSWORDMANAGER_KEYDERIVATION_H
@@ -0,0 +1,199 @@
+/**
+ * @file KeyRotation.cpp
+ * @brief Implementation of streaming vault key rotation.
+ */
+
+#include "KeyRotation.h"
+#include <atomic>
+#include <cstdlib>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+const string vaultFormatField = "Vault Format: ";
+const string vaultFormatLine = vaultFormatField + "3";
+const string encryptedPasswordField = "Encrypted Password: ";
+
+// VAULT FORMAT
+/**
+     * @brief Parses the number after the format field.
+     * @param line A line of the vault file.
+     * @return The version, or 0.
+     */
+
+int vaultFormatOf(const string& line) {
+    if (line.find(vaultFormatField) != 0) {
+        return 0;
+    }
+    return atoi(line.c_str() + vaultFormatField.size());
+}
+
+namespace {
+
+const string passwordField = "Password: ";
+
+/**
+ * @brief An encrypted password among the lines of a block.
+ */
+
+struct PasswordLine {
+    size_t line;    /**< Index of the line in the block. */
+    string name;    /**< Name of the entry, which the password is bound to. */
+};
+
+/**
+ * @brief Re-encrypts the encrypted passwords among a block of vault lines in place.
+ * @return False if any password fails authentication.
+ */
+
+bool rekeyBlock(vector<string>& lines, const vector<PasswordLine>& passwordLines, bool acceptLegacy,
+                const ChaCha20Poly1305& oldCipher, const ChaCha20Poly1305& newCipher, WorkerPool& pool) {
+    atomic<bool> failed{false};
+    pool.parallelFor(passwordLines.size(), 64, [&](size_t begin, size_t end) {
+        string value;
+        for (size_t i = begin; i < end && !failed; i++) {
+            string& line = lines[passwordLines[i].line];
+            const string& name = passwordLines[i].name;
+            size_t field = line.find(encryptedPasswordField) == 0 ? encryptedPasswordField.size() : passwordField.size();
+            value.assign(line, field);
+
+            // Decryption overwrites the text in place; encryption wipes the plaintext before it grows
+            bool opened = acceptLegacy && isLegacyEncryptedText(value) ? decryptLegacyTextInPlace(oldCipher, value)
+                                                                      : decryptTextInPlace(oldCipher, value, name);
+            if (!opened) {
+                failed = true;
+                break;
+            }
+            encryptTextInPlace(newCipher, value, name);
+            line = encryptedPasswordField + value;
+        }
+        secureZero(value.data(), value.size());
+    });
+    return !failed;
+}
+
+/**
+ * @brief Writes a block of lines to the file.
+ * @return False on a write error.
+ */
+
+bool writeLines(FILE* file, const vector<string>& lines) {
+    for (const string& line : lines) {
+        if (fwrite(line.data(), 1, line.size(), file) != line.size() || fputc('\n', file) == EOF) {
+            return false;
+        }
+    }
+    return true;
+}
+
+/**
+ * @brief Flushes a file to the storage device, so the rename cannot expose an incomplete vault.
+ * @return False if the data could not be flushed.
+ */
+
+bool flushToDisk(FILE* file) {
+    if (fflush(file) != 0) {
+        return false;
+    }
+#if defined(_WIN32)
+    return _commit(_fileno(file)) == 0;
+#else
+    return fsync(fileno(file)) == 0;
+#endif
+}
+
+} // namespace
+
+// ROTATE VAULT KEY
+/**
+     * @brief Streams the vault through a temporary file, re-encrypting one block of entries at a time.
+     * @param path Path of the vault file.
+     * @param oldCipher Cipher the passwords are encrypted with now.
+     * @param newCipher Cipher to encrypt them with.
+     * @param header Lines that replace the old key lines at the top of the vault.
+     * @param pool Worker pool for the re-encryption.
+     * @param blockEntries Number of entries per block.
+     * @return False on a read, write or authentication failure; the vault is then unchanged.
+     */
+
+bool rotateVaultKey(const string& path, const ChaCha20Poly1305& oldCipher, const ChaCha20Poly1305& newCipher,
+                    const vector<string>& header, WorkerPool& pool, size_t blockEntries) {
+    ifstream input(path);
+    if (!input) {
+        cerr << "Error: Unable To Open The Vault For Key Rotation!" << endl;
+        return false;
+    }
+
+    string temporaryPath = path + ".rekey";
+    FILE* output = fopen(temporaryPath.c_str(), "wb");
+    if (!output) {
+        cerr << "Error: Unable To Create The Rotated Vault!" << endl;
+        return false;
+    }
+
+    bool ok = writeLines(output, {vaultFormatLine}) && writeLines(output, header);
+    vector<string> lines;
+    vector<PasswordLine> passwordLines;
+    size_t entries = 0;
+    int format = 0;
+    string name;
+    string line;
+
+    auto flushBlock = [&] {
+        ok = ok && rekeyBlock(lines, passwordLines, format < 3, oldCipher, newCipher, pool) &&
+             writeLines(output, lines);
+        lines.clear();
+        passwordLines.clear();
+        entries = 0;
+    };
+
+    while (ok && getline(input, line)) {
+        if (int version = vaultFormatOf(line)) {
+            format = version;
+            continue;
+        }
+        if (line.find("Key Derivation: ") == 0 || line.find("Key Check: ") == 0) {
+            continue;
+        }
+        if (line.find("Name: ") == 0) {
+            name = line.substr(6);
+        }
+        // Older vaults mark an encrypted password only by its prefix; those lines are rewritten explicitly
+        if (line.find(encryptedPasswordField) == 0 ||
+            (format < 2 && line.find(passwordField) == 0 &&
+             isEncryptedText(string_view(line).substr(passwordField.size())))) {
+            passwordLines.push_back({lines.size(), name});
+        }
+        lines.push_back(std::move(line));
+        if (lines.back() == "----------") {
+            name.clear();
+            if (++entries == blockEntries) {
+                flushBlock();
+            }
+        }
+    }
+    flushBlock();
+    ok = ok && !input.bad() && flushToDisk(output);
+    ok = fclose(output) == 0 && ok;
+    input.close();
+
+    error_code error;
+    if (ok) {
+        filesystem::rename(temporaryPath, path, error);
+    }
+    if (!ok || error) {
+        filesystem::remove(temporaryPath, error);
+        cerr << "Error: Key Rotation Failed; The Vault Was Left Unchanged!" << endl;
+        return false;
+    }
+    return true;
+}
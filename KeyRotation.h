@@ -0,0 +1,75 @@
+#ifndef PASSWORDMANAGER_KEYROTATION_H
+#define PASSWORDMANAGER_KEYROTATION_H
+
+#include <cstddef>
+#include <string>
+#include <vector>
+#include "Crypto.h"
+#include "WorkerPool.h"
+using namespace std;
+
+/**
+ * @file KeyRotation.h
+ * @brief Streaming re-encryption of a vault file under a new key.
+ */
+
+// VAULT FORMAT
+/**
+ * @brief First line of a vault file in the current format, version 3.
+ *
+ * From version 2 on, an encrypted password is stored in an
+ * encryptedPasswordField line and a "Password: " line always holds plaintext;
+ * older vaults lack the line, and their passwords count as encrypted when
+ * they look encrypted. From version 3 on, every encrypted password is bound
+ * to the name of its entry, and text in legacyEncryptedTextPrefix is refused.
+ */
+
+extern const string vaultFormatLine;
+
+/**
+ * @brief Field of the vault format line, followed by the version.
+ */
+
+extern const string vaultFormatField;
+
+/**
+ * @brief Reads the version from a vault format line.
+ * @param line A line of the vault file.
+ * @return The version; 0 if the line is not a format line.
+ */
+
+int vaultFormatOf(const string &line);
+
+/**
+ * @brief Field of the vault file that holds an encrypted password.
+ */
+
+extern const string encryptedPasswordField;
+
+// ROTATE VAULT KEY
+/**
+ * @brief Re-encrypts every encrypted password of a vault file under a new key, block by block.
+ *
+ * The file is read a block of entries at a time; the block's passwords are
+ * re-encrypted on the worker pool and the block is appended to a temporary
+ * file next to the vault, so memory use is bounded by the block size rather
+ * than the vault size. Every plaintext is wiped as soon as it is re-sealed.
+ * Once the whole vault is written and flushed to disk, the temporary file
+ * atomically replaces the vault; on any failure the vault is left untouched.
+ * The rotated vault is always written in the format of vaultFormatLine, so
+ * passwords that older versions sealed without their entry name are bound to
+ * it on the way.
+ *
+ * @param path Path of the vault file.
+ * @param oldCipher Cipher the passwords are encrypted with now.
+ * @param newCipher Cipher to encrypt them with.
+ * @param header Lines written at the top of the new vault in place of its old key lines.
+ * @param pool Worker pool for the re-encryption.
+ * @param blockEntries Number of entries per block.
+ * @return False if the vault cannot be read or written, or a password fails authentication.
+ */
+
+bool rotateVaultKey(const string &path, const ChaCha20Poly1305 &oldCipher, const ChaCha20Poly1305 &newCipher,
+                    const vector<string> &header, WorkerPool &pool, size_t blockEntries = 1024);
+
+#endif //PASSWORDMANAGER_KEYROTATION_H
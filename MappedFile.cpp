@@ -0,0 +1,80 @@
+/**
+ * @file MappedFile.cpp
+ * @brief Implementation of read-only file mapping on POSIX and Windows.
+ */
+
+#include "MappedFile.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+// MAP FILE
+/**
+     * @brief Maps a whole file read-only.
+     * @param path Path of the file.
+     * @param size Receives the size of the file.
+     * @return The mapped bytes, or nullptr if the file is missing, empty or cannot be mapped.
+     */
+
+const char* mapFile(const string& path, size_t& size) {
+    size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING,
+                              FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE) {
+        return nullptr;
+    }
+    LARGE_INTEGER fileSize;
+    const char* view = nullptr;
+    if (GetFileSizeEx(file, &fileSize) && fileSize.QuadPart > 0) {
+        HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+        if (mapping) {
+            view = static_cast<const char*>(MapViewOfFile(mapping, FILE_MAP_READ, 0, 0, 0));
+            CloseHandle(mapping);
+        }
+        size = view ? static_cast<size_t>(fileSize.QuadPart) : 0;
+    }
+    CloseHandle(file);
+    return view;
+#else
+    int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+        return nullptr;
+    }
+    struct stat status;
+    const char* view = nullptr;
+    if (fstat(descriptor, &status) == 0 && status.st_size > 0) {
+        void* mapping = mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED) {
+            view = static_cast<const char*>(mapping);
+            size = static_cast<size_t>(status.st_size);
+        }
+    }
+    ::close(descriptor);
+    return view;
+#endif
+}
+
+// UNMAP FILE
+/**
+     * @brief Releases a mapping made by mapFile.
+     * @param view The mapped bytes.
+     * @param size Size of the mapping.
+     */
+
+void unmapFile(const char* view, size_t size) {
+#if defined(_WIN32)
+    (void) size;
+    UnmapViewOfFile(view);
+#else
+    munmap(const_cast<char*>(view), size);
+#endif
+}
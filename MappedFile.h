@@ -0,0 +1,30 @@
+#ifndef PASSWORDMANAGER_MAPPEDFILE_H
+#define PASSWORDMANAGER_MAPPEDFILE_H
+
+#include <cstddef>
+#include <string>
+using namespace std;
+
+/**
+ * @file MappedFile.h
+ * @brief Read-only memory mapping of whole files, shared by the wordlist and the breach corpus.
+ */
+
+/**
+ * @brief Maps a whole file read-only.
+ * @param path Path of the file.
+ * @param size Receives the size of the file.
+ * @return The mapped bytes, or nullptr if the file is missing, empty or cannot be mapped.
+ */
+
+const char* mapFile(const string &path, size_t &size);
+
+/**
+ * @brief Releases a mapping made by mapFile.
+ * @param view The mapped bytes.
+ * @param size Size of the mapping.
+ */
+
+void unmapFile(const char* view, size_t size);
+
+#endif //PASSWORDMANAGER_MAPPEDFILE_H
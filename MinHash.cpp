@@ -0,0 +1,202 @@
+/**
+ * @file MinHash.cpp
+ * @brief Implementation of MinHash sketches and LSH clustering of similar passwords.
+ */
+
+#include "MinHash.h"
+#include "Crypto.h"
+#include "PerfectHash.h"
+#include <algorithm>
+#include <numeric>
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Shingle length in characters.
+ */
+
+const size_t shingleLength = 3;
+
+/**
+ * @brief Scrambles a 32-bit value (the lowbias32 finalizer), so the hash functions of a signature are unrelated.
+ */
+
+uint32_t mix32(uint32_t value) {
+    value ^= value >> 16;
+    value *= 0x7FEB352Du;
+    value ^= value >> 15;
+    value *= 0x846CA68Bu;
+    value ^= value >> 16;
+    return value;
+}
+
+/**
+ * @brief Finds the cluster root of an item, halving the path on the way.
+ */
+
+uint32_t findRoot(vector<uint32_t>& parent, uint32_t item) {
+    while (parent[item] != item) {
+        parent[item] = parent[parent[item]];
+        item = parent[item];
+    }
+    return item;
+}
+
+} // namespace
+
+// SIMILARITY
+/**
+     * @brief Estimates the Jaccard similarity from the share of equal low bytes.
+     * @param other The other sketch.
+     * @return The similarity.
+     */
+
+double MinHashSketch::similarity(const MinHashSketch& other) const {
+    if (empty || other.empty) {
+        return 0;
+    }
+    size_t equal = 0;
+    for (size_t i = 0; i < minHashSize; i++) {
+        equal += lowBytes[i] == other.lowBytes[i];
+    }
+    double chance = 1.0 / 256;
+    return max(0.0, (static_cast<double>(equal) / minHashSize - chance) / (1 - chance));
+}
+
+// SKETCH
+/**
+     * @brief Keeps the smallest value of each hash function over the lowercased shingles, then bands them.
+     *
+     * Each shingle is hashed once; the minHashSize functions are derived from
+     * that hash as mix32(a + i * b), which costs one multiply and a few shifts
+     * per value.
+     *
+     * @param password The password.
+     * @param seed Seed of the hash functions.
+     * @return The sketch.
+     */
+
+MinHashSketch minHashSketch(string_view password, uint64_t seed) {
+    MinHashSketch sketch;
+    if (password.empty()) {
+        return sketch;
+    }
+    sketch.empty = false;
+
+    array<uint32_t, minHashSize> minimum;
+    minimum.fill(UINT32_MAX);
+    size_t shingles = password.size() < shingleLength ? 1 : password.size() - shingleLength + 1;
+    for (size_t start = 0; start < shingles; start++) {
+        char shingle[shingleLength];
+        size_t length = min(shingleLength, password.size() - start);
+        for (size_t i = 0; i < length; i++) {
+            char c = password[start + i];
+            shingle[i] = c >= 'A' && c <= 'Z' ? static_cast<char>(c - 'A' + 'a') : c;
+        }
+        uint64_t hash = perfectHashOf(string_view(shingle, length), seed);
+        secureZero(shingle, sizeof(shingle));
+        uint32_t a = static_cast<uint32_t>(hash);
+        uint32_t b = static_cast<uint32_t>(hash >> 32) | 1;
+        for (size_t i = 0; i < minHashSize; i++) {
+            minimum[i] = min(minimum[i], mix32(a + static_cast<uint32_t>(i) * b));
+        }
+    }
+
+    for (size_t band = 0; band < minHashBands; band++) {
+        uint64_t key = band;
+        for (size_t row = 0; row < minHashRows; row++) {
+            key = (key ^ minimum[band * minHashRows + row]) * 0x9E3779B97F4A7C15ull;
+            key ^= key >> 29;
+        }
+        sketch.bandKeys[band] = static_cast<uint32_t>(key >> 32);
+    }
+    for (size_t i = 0; i < minHashSize; i++) {
+        sketch.lowBytes[i] = static_cast<uint8_t>(minimum[i]);
+    }
+    secureZero(minimum.data(), sizeof(minimum));
+    return sketch;
+}
+
+// FIND NEAR-DUPLICATES
+/**
+     * @brief Folds identical passwords, buckets every band by sorting, and joins similar passwords of a bucket.
+     * @param sketches Sketch of each item.
+     * @param passwordHashes Hash of the password of each item.
+     * @param groupCount Receives the number of clusters.
+     * @param threshold Similarity from which two passwords are near-duplicates.
+     * @return Cluster of each item, or 0.
+     */
+
+vector<size_t> findNearDuplicates(const vector<MinHashSketch>& sketches, const vector<uint64_t>& passwordHashes,
+                                  size_t& groupCount, double threshold) {
+    groupCount = 0;
+    vector<size_t> groups(sketches.size(), 0);
+
+    // One representative for each distinct password
+    vector<pair<uint64_t, uint32_t>> byPassword;
+    byPassword.reserve(sketches.size());
+    for (size_t i = 0; i < sketches.size(); i++) {
+        if (!sketches[i].empty) {
+            byPassword.emplace_back(passwordHashes[i], static_cast<uint32_t>(i));
+        }
+    }
+    sort(byPassword.begin(), byPassword.end());
+    vector<uint32_t> representatives;
+    vector<uint32_t> representativeOf(sketches.size(), UINT32_MAX);
+    for (size_t i = 0; i < byPassword.size(); i++) {
+        if (i == 0 || byPassword[i].first != byPassword[i - 1].first) {
+            representatives.push_back(byPassword[i].second);
+        }
+        representativeOf[byPassword[i].second] = static_cast<uint32_t>(representatives.size() - 1);
+    }
+    byPassword.clear();
+    byPassword.shrink_to_fit();
+
+    vector<uint32_t> parent(representatives.size());
+    iota(parent.begin(), parent.end(), 0);
+    vector<pair<uint32_t, uint32_t>> bucket(representatives.size());
+    for (size_t band = 0; band < minHashBands; band++) {
+        for (size_t r = 0; r < representatives.size(); r++) {
+            bucket[r] = {sketches[representatives[r]].bandKeys[band], static_cast<uint32_t>(r)};
+        }
+        sort(bucket.begin(), bucket.end());
+        for (size_t begin = 0; begin < bucket.size();) {
+            size_t end = begin + 1;
+            while (end < bucket.size() && bucket[end].first == bucket[begin].first) {
+                end++;
+            }
+            const MinHashSketch& first = sketches[representatives[bucket[begin].second]];
+            for (size_t i = begin + 1; i < end; i++) {
+                uint32_t member = bucket[i].second;
+                if (findRoot(parent, member) != findRoot(parent, bucket[begin].second) &&
+                    first.similarity(sketches[representatives[member]]) >= threshold) {
+                    parent[findRoot(parent, member)] = findRoot(parent, bucket[begin].second);
+                }
+            }
+            begin = end;
+        }
+    }
+
+    // Number the clusters of more than one distinct password, in item order
+    vector<uint32_t> clusterSize(representatives.size(), 0);
+    for (size_t r = 0; r < representatives.size(); r++) {
+        clusterSize[findRoot(parent, static_cast<uint32_t>(r))]++;
+    }
+    vector<size_t> number(representatives.size(), 0);
+    for (size_t i = 0; i < sketches.size(); i++) {
+        if (representativeOf[i] == UINT32_MAX) {
+            continue;
+        }
+        uint32_t root = findRoot(parent, representativeOf[i]);
+        if (clusterSize[root] < 2) {
+            continue;
+        }
+        if (number[root] == 0) {
+            number[root] = ++groupCount;
+        }
+        groups[i] = number[root];
+    }
+    return groups;
+}
@@ -0,0 +1,105 @@
+#ifndef PASSWORDMANAGER_MINHASH_H
+#define PASSWORDMANAGER_MINHASH_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+/**
+ * @file MinHash.h
+ * @brief Near-duplicate password detection with MinHash signatures and locality-sensitive hashing.
+ */
+
+/**
+ * @brief Bands of a MinHash signature; two passwords become candidates when one band matches.
+ */
+
+const size_t minHashBands = 8;
+
+/**
+ * @brief MinHash values per band.
+ */
+
+const size_t minHashRows = 4;
+
+/**
+ * @brief MinHash values in a signature.
+ */
+
+const size_t minHashSize = minHashBands * minHashRows;
+
+/**
+ * @brief Compact MinHash signature of a password, for locality-sensitive hashing.
+ *
+ * The password is cut into overlapping three-character shingles ("you",
+ * "out", "utu", ...) after lowercasing, and each of minHashSize hash
+ * functions keeps its smallest value over the shingles. Two passwords
+ * agree on a value with probability equal to the Jaccard similarity of
+ * their shingle sets: 7/9 for "youtube123" and "youtube124".
+ *
+ * Only what the search needs is kept: a key for each band of minHashRows
+ * values, which buckets similar passwords together, and the low byte of
+ * every value, from which similarity is estimated (b-bit MinHash). That is
+ * 64 bytes a password, and no value that would let the password be read
+ * back.
+ */
+
+class MinHashSketch {
+public:
+    array<uint32_t, minHashBands> bandKeys{};   /**< Hash of the values of each band. */
+    array<uint8_t, minHashSize> lowBytes{};     /**< Low byte of every MinHash value. */
+    bool empty = true;                          /**< Whether the password had no characters. */
+
+    /**
+     * @brief Estimates the Jaccard similarity of the shingles of two passwords.
+     *
+     * Low bytes also agree by chance, one time in 256, which the estimate
+     * corrects for.
+     *
+     * @param other The other sketch.
+     * @return The similarity, 0 to 1.
+     */
+
+    double similarity(const MinHashSketch &other) const;
+};
+
+/**
+ * @brief Computes the MinHash sketch of a password.
+ * @param password The password; passwords shorter than three characters are one shingle.
+ * @param seed Seed of the hash functions; sketches are only comparable under the same seed.
+ * @return The sketch.
+ */
+
+MinHashSketch minHashSketch(string_view password, uint64_t seed);
+
+/**
+ * @brief Default similarity above which two different passwords are near-duplicates.
+ */
+
+const double nearDuplicateThreshold = 0.6;
+
+/**
+ * @brief Clusters passwords that are small variations of each other.
+ *
+ * Identical passwords are folded into one first. Then every band of every
+ * sketch is bucketed by sorting the band keys, so passwords that agree on a
+ * whole band meet in a bucket: with 8 bands of 4 values, pairs with a
+ * similarity of 0.78 meet 97% of the time, pairs of 0.3 only 6%. Each
+ * password of a bucket is compared with the first one and joined to its
+ * cluster when the estimated similarity reaches the threshold, so the cost
+ * grows as n log n, not with the number of pairs.
+ *
+ * @param sketches Sketch of each item; empty sketches are left out.
+ * @param passwordHashes Hash of the password of each item, equal for identical passwords.
+ * @param groupCount Receives the number of clusters.
+ * @param threshold Similarity from which two passwords are near-duplicates.
+ * @return Cluster of each item, numbered from 1, or 0 when no other password is similar to it.
+ */
+
+vector<size_t> findNearDuplicates(const vector<MinHashSketch> &sketches, const vector<uint64_t> &passwordHashes,
+                                  size_t &groupCount, double threshold = nearDuplicateThreshold);
+
+#endif //PASSWORDMANAGER_MINHASH_H
@@ -0,0 +1,348 @@
+/**
+ * @file PasswordGenerator.cpp
+ * @brief Implementation of the buffered random source and the password generator.
+ */
+
+#include "PasswordGenerator.h"
+#include "Crypto.h"
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstring>
+using namespace std;
+
+// SECURE RANDOM
+/**
+     * @brief Constructor.
+     * Takes the pool from the secure arena; it is filled on first use.
+     */
+
+SecureRandom::SecureRandom()
+    : pool(static_cast<uint8_t*>(SecureArena::instance().allocate(poolSize))), position(poolSize) {}
+
+/**
+ * @brief Destructor.
+ * Wipes the pool, used and unused bytes alike, and returns it to the arena.
+ */
+
+SecureRandom::~SecureRandom() {
+    SecureArena::instance().deallocate(pool, poolSize, poolSize);
+}
+
+/**
+     * @brief Fetches a full pool of bytes from the operating system.
+     */
+
+void SecureRandom::refill() {
+    fillRandom(pool, poolSize);
+    position = 0;
+}
+
+/**
+     * @brief Copies random bytes out of the pool, refilling it as often as needed.
+     * @param out The buffer.
+     * @param length Number of bytes.
+     */
+
+void SecureRandom::fill(uint8_t* out, size_t length) {
+    while (length > 0) {
+        if (position == poolSize) {
+            refill();
+        }
+        size_t take = min(length, poolSize - position);
+        memcpy(out, pool + position, take);
+        position += take;
+        out += take;
+        length -= take;
+    }
+}
+
+/**
+     * @brief Draws a number below the bound, rejecting the values that would bias the result.
+     * @param bound Exclusive upper bound.
+     * @return The number.
+     */
+
+uint32_t SecureRandom::uniform(uint32_t bound) {
+    if (bound <= 1) {
+        return 0;
+    }
+    if (bound <= 0x10000) {
+        // Two bytes are enough for small bounds, such as shuffling a password. The
+        // multiply maps 16 random bits onto the bound (Lemire); the division that
+        // finds the biased products only runs in the rare case one is possible.
+        uint32_t product = (static_cast<uint32_t>(nextByte()) << 8 | nextByte()) * bound;
+        if ((product & 0xFFFF) < bound) {
+            uint32_t threshold = (0x10000 - bound) % bound;
+            while ((product & 0xFFFF) < threshold) {
+                product = (static_cast<uint32_t>(nextByte()) << 8 | nextByte()) * bound;
+            }
+        }
+        return product >> 16;
+    }
+    // 2^32 mod bound values at the bottom would be drawn once more often than the rest
+    uint32_t threshold = (0u - bound) % bound;
+    uint32_t value;
+    do {
+        fill(reinterpret_cast<uint8_t*>(&value), sizeof(value));
+    } while (value < threshold);
+    return value % bound;
+}
+
+// CHARACTER SET
+/**
+     * @brief Writes random characters, one accepted byte per character.
+     * @param random Source of randomness.
+     * @param out The buffer.
+     * @param length Number of characters.
+     */
+
+void CharacterSet::fill(SecureRandom& random, char* out, size_t length) const {
+    if (count == 0) {
+        return;
+    }
+    size_t written = 0;
+    while (written < length) {
+        unsigned value = random.nextByte();
+        if (value < limit) {
+            out[written++] = table[value];
+        }
+    }
+}
+
+namespace {
+
+const unsigned classCombinations = 1u << characterClassCount;
+
+/**
+ * @brief Builds the set of the classes in a mask.
+ * @param classMask The classes.
+ * @param excludeAmbiguous Whether to leave out ambiguous characters.
+ * @return The set.
+ */
+
+constexpr CharacterSet buildCharacterSet(unsigned classMask, bool excludeAmbiguous) {
+    char characters[256] = {};
+    size_t length = 0;
+    for (size_t index = 0; index < characterClassCount; index++) {
+        if (classMask & (1u << index)) {
+            for (char c : classCharacters[index]) {
+                characters[length++] = c;
+            }
+        }
+    }
+    return CharacterSet(string_view(characters, length), excludeAmbiguous ? ambiguousCharacters : "");
+}
+
+/**
+ * @brief Builds the sets of every combination of classes, without and then with ambiguous characters.
+ * @return The sets, indexed by classMask + (excludeAmbiguous ? classCombinations : 0).
+ */
+
+constexpr array<CharacterSet, 2 * classCombinations> buildCharacterSets() {
+    array<CharacterSet, 2 * classCombinations> sets;
+    for (unsigned mask = 0; mask < classCombinations; mask++) {
+        sets[mask] = buildCharacterSet(mask, false);
+        sets[classCombinations + mask] = buildCharacterSet(mask, true);
+    }
+    return sets;
+}
+
+constexpr array<CharacterSet, 2 * classCombinations> characterSets = buildCharacterSets();
+
+static_assert(characterSets[classCombinations - 1].size() == 89, "Every printable class together");
+static_assert(characterSets[2 * classCombinations - 1].size() == 82, "Without ambiguous characters");
+
+} // namespace
+
+/**
+     * @brief Looks up the set built at compile time.
+     * @param classMask The classes.
+     * @param excludeAmbiguous Whether to leave out ambiguous characters.
+     * @return The set.
+     */
+
+const CharacterSet& characterSetFor(unsigned classMask, bool excludeAmbiguous) {
+    return characterSets[(classMask % classCombinations) + (excludeAmbiguous ? classCombinations : 0)];
+}
+
+// PASSWORD GENERATOR
+/**
+     * @brief Constructor.
+     * @param characters Characters to draw from.
+     */
+
+PasswordGenerator::PasswordGenerator(string_view characters) : alphabet(characters) {}
+
+/**
+     * @brief Gets the alphabet.
+     * @return The distinct characters.
+     */
+
+string_view PasswordGenerator::characters() const {
+    return alphabet.characters();
+}
+
+/**
+     * @brief Gets the entropy of a password of the given length.
+     * @param length Password length.
+     * @return Bits of entropy.
+     */
+
+double PasswordGenerator::entropyBits(size_t length) const {
+    return alphabet.size() == 0 ? 0 : static_cast<double>(length) * log2(static_cast<double>(alphabet.size()));
+}
+
+// GENERATE
+/**
+     * @brief Writes random characters into a buffer.
+     * @param random Source of randomness.
+     * @param out The buffer.
+     * @param length Number of characters.
+     */
+
+void PasswordGenerator::fill(SecureRandom& random, char* out, size_t length) const {
+    alphabet.fill(random, out, length);
+}
+
+/**
+     * @brief Generates one password.
+     * @param random Source of randomness.
+     * @param length Password length.
+     * @return The password.
+     */
+
+SecretText PasswordGenerator::generate(SecureRandom& random, size_t length) const {
+    return generateBulk(random, 1, length);
+}
+
+/**
+     * @brief Generates passwords back to back into one buffer.
+     * @param random Source of randomness.
+     * @param count Number of passwords.
+     * @param length Length of each password.
+     * @return The passwords.
+     */
+
+SecretText PasswordGenerator::generateBulk(SecureRandom& random, size_t count, size_t length) const {
+    SecretText passwords;
+    if (alphabet.size() == 0) {
+        return passwords;
+    }
+    passwords.resize(count * length);
+    fill(random, passwords.data(), count * length);
+    return passwords;
+}
+
+// PASSWORD POLICY
+/**
+     * @brief Includes a class with a minimum number of characters.
+     * @param characterClass The class.
+     * @param minimum Required characters of the class.
+     */
+
+void PasswordPolicy::include(CharacterClass characterClass, size_t minimum) {
+    included[static_cast<size_t>(characterClass)] = true;
+    minimums[static_cast<size_t>(characterClass)] = minimum;
+}
+
+/**
+     * @brief Leaves a class out.
+     * @param characterClass The class.
+     */
+
+void PasswordPolicy::omit(CharacterClass characterClass) {
+    included[static_cast<size_t>(characterClass)] = false;
+}
+
+/**
+     * @brief Checks whether a class is included.
+     * @param characterClass The class.
+     * @return True if it is.
+     */
+
+bool PasswordPolicy::includes(CharacterClass characterClass) const {
+    return included[static_cast<size_t>(characterClass)];
+}
+
+/**
+     * @brief Gets the required characters of a class.
+     * @param characterClass The class.
+     * @return The minimum, or 0 when the class is left out.
+     */
+
+size_t PasswordPolicy::minimumOf(CharacterClass characterClass) const {
+    return includes(characterClass) ? minimums[static_cast<size_t>(characterClass)] : 0;
+}
+
+/**
+     * @brief Gets the included classes as a bit mask.
+     * @return The mask.
+     */
+
+unsigned PasswordPolicy::classMask() const {
+    unsigned mask = 0;
+    for (size_t index = 0; index < characterClassCount; index++) {
+        if (included[index]) {
+            mask |= 1u << index;
+        }
+    }
+    return mask;
+}
+
+/**
+     * @brief Adds up the minimums of the included classes.
+     * @return The required length.
+     */
+
+size_t PasswordPolicy::requiredLength() const {
+    size_t required = 0;
+    for (size_t index = 0; index < characterClassCount; index++) {
+        required += minimumOf(static_cast<CharacterClass>(index));
+    }
+    return required;
+}
+
+/**
+     * @brief Checks whether the policy can be met.
+     * @return True if it can.
+     */
+
+bool PasswordPolicy::isSatisfiable() const {
+    return classMask() != 0 && length > 0 && requiredLength() <= length;
+}
+
+// GENERATE FOR POLICY
+/**
+     * @brief Draws the required characters of each class, fills the rest from every included class and
+     * moves the required characters to random positions.
+     * @param random Source of randomness.
+     * @param policy The policy.
+     * @return The password.
+     */
+
+SecretText generateForPolicy(SecureRandom& random, const PasswordPolicy& policy) {
+    SecretText password;
+    if (!policy.isSatisfiable()) {
+        return password;
+    }
+    password.resize(policy.length);
+    char* out = password.data();
+
+    size_t position = 0;
+    for (size_t index = 0; index < characterClassCount; index++) {
+        size_t minimum = policy.minimumOf(static_cast<CharacterClass>(index));
+        characterSetFor(1u << index, policy.excludeAmbiguous).fill(random, out + position, minimum);
+        position += minimum;
+    }
+    characterSetFor(policy.classMask(), policy.excludeAmbiguous).fill(random, out + position, policy.length - position);
+
+    // Fisher-Yates, stopped once the required characters are placed: the filler
+    // characters are independent draws, so shuffling them among themselves
+    // would not change the distribution
+    for (size_t i = 0; i < position; i++) {
+        size_t j = i + random.uniform(static_cast<uint32_t>(policy.length - i));
+        swap(out[i], out[j]);
+    }
+    return password;
+}
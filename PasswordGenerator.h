@@ -0,0 +1,365 @@
+#ifndef PASSWORDMANAGER_PASSWORDGENERATOR_H
+#define PASSWORDMANAGER_PASSWORDGENERATOR_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include "SecureArena.h"
+using namespace std;
+
+/**
+ * @file PasswordGenerator.h
+ * @brief Buffered cryptographic randomness and unbiased password generation.
+ */
+
+/**
+ * @brief Random bytes from the operating system, fetched a pool at a time.
+ *
+ * The pool is refilled from getrandom (BCryptGenRandom on Windows) in 4 KiB
+ * requests, so generating a password costs no system call most of the time.
+ * The pool lives in the secure arena, each byte is handed out only once, and
+ * used bytes stay there only until the next refill overwrites them.
+ */
+
+class SecureRandom {
+private:
+    uint8_t *pool;              /**< Random bytes, in the secure arena. */
+    size_t position;            /**< Next unused byte of the pool. */
+
+    /**
+     * @brief Fills the pool with fresh bytes from the operating system.
+     */
+
+    void refill();
+
+public:
+    static const size_t poolSize = 4096;    /**< Bytes fetched per refill. */
+
+    /**
+     * @brief Constructor for SecureRandom class; the pool is filled on first use.
+     */
+
+    SecureRandom();
+
+    /**
+     * @brief Destructor; wipes the pool.
+     */
+
+    ~SecureRandom();
+
+    SecureRandom(const SecureRandom &) = delete;
+    SecureRandom &operator=(const SecureRandom &) = delete;
+
+    // BYTES
+    /**
+     * @brief Gets the next random byte.
+     * @return The byte.
+     */
+
+    uint8_t nextByte() {
+        if (position == poolSize) {
+            refill();
+        }
+        return pool[position++];
+    }
+
+    /**
+     * @brief Fills a buffer with random bytes.
+     * @param out The buffer.
+     * @param length Number of bytes.
+     */
+
+    void fill(uint8_t *out, size_t length);
+
+    // UNIFORM
+    /**
+     * @brief Draws a uniformly distributed number by rejection sampling.
+     * @param bound Exclusive upper bound; at least 1.
+     * @return A number in [0, bound).
+     */
+
+    uint32_t uniform(uint32_t bound);
+};
+
+/**
+ * @brief A class of characters a password policy can ask for.
+ */
+
+enum class CharacterClass {
+    Uppercase,      ///< A to Z
+    Lowercase,      ///< a to z
+    Digits,         ///< 0 to 9
+    Special         ///< Punctuation and symbols
+};
+
+const size_t characterClassCount = 4;   /**< Number of CharacterClass values. */
+
+/**
+ * @brief Characters of each class, in CharacterClass order.
+ */
+
+constexpr string_view classCharacters[characterClassCount] = {
+    "ABCDEFGHIJKLMNOPQRSTUVWXYZ",
+    "abcdefghijklmnopqrstuvwxyz",
+    "0123456789",
+    "!@#$%^&*()_+-=[]{}|;:,.<>?/"
+};
+
+/**
+ * @brief Characters that are easily mistaken for one another when read or typed.
+ */
+
+constexpr string_view ambiguousCharacters = "0Oo1Il|";
+
+/**
+ * @brief A set of distinct characters with a table for drawing one uniformly.
+ *
+ * Each character costs one random byte in the common case. A byte is mapped
+ * to a character through a 256-entry table, and bytes at or above the
+ * largest multiple of the set size are rejected, so every character is
+ * exactly equally likely. A plain "byte % size" would favour the first
+ * characters of the set.
+ *
+ * Construction is constexpr, so the sets of the character classes are
+ * built once at compile time (see characterSetFor).
+ */
+
+class CharacterSet {
+private:
+    char symbols[256] = {};     /**< The distinct characters, in first-seen order. */
+    char table[256] = {};       /**< Character of each accepted byte value. */
+    unsigned count = 0;         /**< Number of distinct characters. */
+    unsigned limit = 0;         /**< Bytes below this are accepted. */
+
+public:
+    /**
+     * @brief Constructor for CharacterSet class; the set starts empty.
+     */
+
+    constexpr CharacterSet() = default;
+
+    /**
+     * @brief Constructor for CharacterSet class.
+     * @param characters Characters of the set; duplicates are dropped.
+     * @param excluded Characters to leave out.
+     */
+
+    constexpr explicit CharacterSet(string_view characters, string_view excluded = "") {
+        bool seen[256] = {};
+        for (char c : excluded) {
+            seen[static_cast<unsigned char>(c)] = true;
+        }
+        for (char c : characters) {
+            if (!seen[static_cast<unsigned char>(c)]) {
+                seen[static_cast<unsigned char>(c)] = true;
+                symbols[count++] = c;
+            }
+        }
+
+        limit = count == 0 ? 0 : 256 - 256 % count;
+        for (unsigned value = 0; value < limit; value++) {
+            table[value] = symbols[value % count];
+        }
+    }
+
+    /**
+     * @brief Gets the characters of the set.
+     * @return The distinct characters.
+     */
+
+    constexpr string_view characters() const {
+        return string_view(symbols, count);
+    }
+
+    /**
+     * @brief Gets the number of characters in the set.
+     * @return The size.
+     */
+
+    constexpr size_t size() const {
+        return count;
+    }
+
+    /**
+     * @brief Draws one character.
+     * @param random Source of randomness.
+     * @return The character; the set must not be empty.
+     */
+
+    char draw(SecureRandom &random) const {
+        unsigned value;
+        do {
+            value = random.nextByte();
+        } while (value >= limit);
+        return table[value];
+    }
+
+    /**
+     * @brief Writes random characters into a buffer.
+     * @param random Source of randomness.
+     * @param out The buffer.
+     * @param length Number of characters; nothing is written if the set is empty.
+     */
+
+    void fill(SecureRandom &random, char *out, size_t length) const;
+};
+
+/**
+ * @brief Gets the precomputed set of one or more character classes.
+ * @param classMask Bit (1 << class) set for every class to include.
+ * @param excludeAmbiguous Whether to leave out ambiguousCharacters.
+ * @return The set, built at compile time.
+ */
+
+const CharacterSet &characterSetFor(unsigned classMask, bool excludeAmbiguous);
+
+/**
+ * @brief Draws passwords uniformly from an alphabet.
+ */
+
+class PasswordGenerator {
+private:
+    CharacterSet alphabet;      /**< Distinct characters to draw from. */
+
+public:
+    /**
+     * @brief Constructor for PasswordGenerator class.
+     * @param characters Characters to draw from; duplicates are dropped.
+     */
+
+    explicit PasswordGenerator(string_view characters);
+
+    /**
+     * @brief Gets the distinct characters passwords are drawn from.
+     * @return The alphabet.
+     */
+
+    string_view characters() const;
+
+    /**
+     * @brief Gets the entropy of a password of the given length.
+     * @param length Password length.
+     * @return Bits of entropy: length * log2(alphabet size).
+     */
+
+    double entropyBits(size_t length) const;
+
+    // GENERATE
+    /**
+     * @brief Writes random characters into a buffer.
+     * @param random Source of randomness.
+     * @param out The buffer.
+     * @param length Number of characters; nothing is written if the alphabet is empty.
+     */
+
+    void fill(SecureRandom &random, char *out, size_t length) const;
+
+    /**
+     * @brief Generates one password.
+     * @param random Source of randomness.
+     * @param length Password length.
+     * @return The password; empty if the alphabet is empty.
+     */
+
+    SecretText generate(SecureRandom &random, size_t length) const;
+
+    /**
+     * @brief Generates many passwords of one length into a single buffer.
+     *
+     * Password i occupies bytes [i * length, (i + 1) * length) of the result,
+     * so the batch costs one allocation however many passwords it holds.
+     *
+     * @param random Source of randomness.
+     * @param count Number of passwords.
+     * @param length Length of each password.
+     * @return The passwords, back to back; empty if the alphabet is empty.
+     */
+
+    SecretText generateBulk(SecureRandom &random, size_t count, size_t length) const;
+};
+
+/**
+ * @brief What a generated password must look like.
+ *
+ * Every class starts out included with a minimum of one character.
+ */
+
+class PasswordPolicy {
+private:
+    bool included[characterClassCount] = {true, true, true, true};     /**< Whether each class may appear. */
+    size_t minimums[characterClassCount] = {1, 1, 1, 1};               /**< Characters each included class must contribute. */
+
+public:
+    size_t length = 16;             /**< Length of the password. */
+    bool excludeAmbiguous = false;  /**< Whether to leave out characters such as 0, O, 1 and l. */
+
+    /**
+     * @brief Includes a class and sets how many of its characters are required.
+     * @param characterClass The class.
+     * @param minimum Characters of the class the password must contain.
+     */
+
+    void include(CharacterClass characterClass, size_t minimum = 1);
+
+    /**
+     * @brief Leaves a class out of the password.
+     * @param characterClass The class.
+     */
+
+    void omit(CharacterClass characterClass);
+
+    /**
+     * @brief Checks whether a class may appear in the password.
+     * @param characterClass The class.
+     * @return True if the class is included.
+     */
+
+    bool includes(CharacterClass characterClass) const;
+
+    /**
+     * @brief Gets how many characters of a class are required.
+     * @param characterClass The class.
+     * @return The minimum; 0 if the class is left out.
+     */
+
+    size_t minimumOf(CharacterClass characterClass) const;
+
+    /**
+     * @brief Gets the included classes as a mask for characterSetFor.
+     * @return Bit (1 << class) set for every included class.
+     */
+
+    unsigned classMask() const;
+
+    /**
+     * @brief Gets the length the required characters add up to.
+     * @return Sum of the minimums of the included classes.
+     */
+
+    size_t requiredLength() const;
+
+    /**
+     * @brief Checks whether a password can meet the policy.
+     * @return True if a class is included and the required characters fit in the length.
+     */
+
+    bool isSatisfiable() const;
+};
+
+/**
+ * @brief Generates a password that meets a policy, in one pass.
+ *
+ * The required characters of each class are drawn first, the rest of the
+ * length is drawn from all included classes together, and a partial
+ * Fisher-Yates shuffle moves the required characters to random positions.
+ * No password is ever thrown away and redrawn.
+ *
+ * @param random Source of randomness.
+ * @param policy The policy.
+ * @return The password; empty if the policy cannot be met.
+ */
+
+SecretText generateForPolicy(SecureRandom &random, const PasswordPolicy &policy);
+
+#endif //PASSWORDMANAGER_PASSWORDGENERATOR_H
@@ -4,14 +4,68 @@
  */
 
 #include "DataStorage.h"
+#include "TextFold.h"
+#include "KeyRotation.h"
 #include <iostream>
 #include <fstream>
 #include <vector>
 #include <cstdlib>
 #include <ctime>
 #include <iomanip>
+#include <sstream>
+#include <atomic>
 using namespace std;
 
+/**
+ * @brief Number of entries a worker encrypts or decrypts per claimed chunk.
+ */
+
+static const size_t cipherChunk = 256;
+
+/**
+ * @brief Number of entries a worker audits per claimed chunk; a strength estimate costs microseconds.
+ */
+
+static const size_t auditChunk = 64;
+
+/**
+ * @brief Time a master-password derivation should take on the machine that sets it.
+ */
+
+static const double unlockTargetMilliseconds = 500;
+
+/**
+ * @brief Text encrypted under the vault key to recognize a wrong master password.
+ */
+
+static const string keyCheckText = "PasswordManager Key Check";
+
+/**
+ * @brief Returns the current time in seconds since the epoch.
+ */
+
+static int64_t currentEpochTime() {
+    return static_cast<int64_t>(time(nullptr));
+}
+
+/**
+ * @brief Formats an entry as it is stored in the vault file, wiping the previous text first.
+ */
+
+static void formatRecord(const KeyData& entry, SecretText& record) {
+    record.clear();
+    record.reserve(128 + entry.name.size() + entry.password.size() + entry.category.size() + entry.website.size() +
+                   entry.login.size());
+    record.append("Name: ").append(entry.name).append("\n");
+    record.append(entry.encrypted ? encryptedPasswordField : "Password: ").append(entry.password).append("\n");
+    record.append("Category: ").append(entry.category).append("\n");
+    record.append("Website: ").append(entry.website).append("\n");
+    record.append("Login: ").append(entry.login).append("\n");
+    record.append("Created: ").append(to_string(entry.created)).append("\n");
+    record.append("Modified: ").append(to_string(entry.modified)).append("\n");
+    record.append("----------\n");
+}
+
 /**
  * @class PasswordKeeper
  * @brief Manages password storage and operations.
@@ -27,7 +81,6 @@ PasswordKeeper::PasswordKeeper() : PasswordKeeper("Login"){}
 
 PasswordKeeper::PasswordKeeper(const string& filePath) {
     sourceFilePath = filePath;
-    encryptionKey = 10;
     loadPasswordsFromFile();
 }
 
@@ -90,14 +143,20 @@ void PasswordKeeper::addPassword(const string& name, const string& passwordText,
 
     if (it != passwords.end()) {
         it->password = passwordText;
+        it->encrypted = false;
+        it->dirty = true;
         it->category = category;
         it->website = website;
         it->login = login;
+        it->modified = currentEpochTime();
+        indexEntry(it - passwords.begin());
         cout << "Password Entry Updated Successfully!\n";
     } else {
         // Add new password entry to the in-memory storage
         KeyData entry = {name, passwordText, category, website, login};
+        entry.created = entry.modified = currentEpochTime();
         passwords.push_back(entry);
+        indexEntry(passwords.size() - 1);
         cout << "Password Entry Added Successfully!\n";
     }
 }
@@ -105,35 +164,116 @@ void PasswordKeeper::addPassword(const string& name, const string& passwordText,
 // GENERATE PASSWORD
 /**
      * @brief Generates a random password.
-     * @param length The length of the generated password.
-     * @param useUpper Flag indicating whether to use uppercase letters.
-     * @param useLower Flag indicating whether to use lowercase letters.
-     * @param useSpecial Flag indicating whether to use special characters.
+     * @param policy Length and character classes of the password.
      * @return The generated password.
      */
 
-string PasswordKeeper::generatePassword(int length, bool useUpper, bool useLower, bool useSpecial) {
-    string allowedChars = "";
-    string password = "";
+SecretText PasswordKeeper::generatePassword(const PasswordPolicy& policy) {
+    return generateForPolicy(randomSource, policy);
+}
 
-    if (useUpper) {
-        allowedChars += "ABCDEFGHIJKLMNOPQRSTUVWXYZ";
-    }
+// GENERATE PASSPHRASE
+/**
+     * @brief Generates a passphrase, mapping the wordlist file if it is not mapped yet.
+     * @param wordCount Number of words.
+     * @param wordlistPath Path of the wordlist file.
+     * @param separator Text between two words.
+     * @return The generated passphrase.
+     */
 
-    if (useLower) {
-        allowedChars += "abcdefghijklmnopqrstuvwxyz";
+SecretText PasswordKeeper::generatePassphrase(size_t wordCount, const string& wordlistPath, string_view separator) {
+    if (wordlist.path() != wordlistPath || wordlist.size() == 0) {
+        if (!wordlist.open(wordlistPath)) {
+            cerr << "Error: Unable To Open The Wordlist File " << wordlistPath << "!" << endl;
+            return SecretText();
+        }
     }
+    return ::generatePassphrase(randomSource, wordlist, wordCount, separator);
+}
+
+/**
+     * @brief Gets the wordlist of the last passphrase.
+     * @return The wordlist.
+     */
 
-    if (useSpecial) {
-        allowedChars += "!@#$%^&*()_+-=[]{}|;:,.<>?/";
+const Wordlist& PasswordKeeper::getWordlist() const {
+    return wordlist;
+}
+
+// BREACH CHECK
+/**
+     * @brief Checks a password against the breach corpus, mapping the corpus file if it is not mapped yet.
+     * @param password The password.
+     * @return True if the password is in the corpus.
+     */
+
+bool PasswordKeeper::isBreached(string_view password) {
+    return loadBreachCorpus() && breachCorpus.contains(password);
+}
+
+/**
+     * @brief Maps the default breach corpus file unless a corpus is mapped already.
+     * @return True if a corpus is available.
+     */
+
+bool PasswordKeeper::loadBreachCorpus() {
+    return breachCorpus.isOpen() || breachCorpus.open(defaultBreachCorpusFile);
+}
+
+/**
+     * @brief Gets the breach corpus.
+     * @return The corpus.
+     */
+
+const BreachCorpus& PasswordKeeper::getBreachCorpus() const {
+    return breachCorpus;
+}
+
+// AUDIT
+/**
+     * @brief Examines every password in parallel, decrypting a copy of it, then builds the report.
+     * @param options Settings of the audit.
+     * @return The report.
+     */
+
+AuditReport PasswordKeeper::auditVault(AuditOptions options) {
+    bool anyEncrypted = any_of(passwords.begin(), passwords.end(), [](const KeyData& entry) {
+        return entry.encrypted;
+    });
+    if (anyEncrypted && !requireUnlocked()) {
+        return AuditReport();
+    }
+    if (options.now == 0) {
+        options.now = static_cast<int64_t>(time(nullptr));
     }
 
-    srand(time(nullptr));
-    for (int i = 0; i < length; i++) {
-        int index = rand() % allowedChars.size();
-        password += allowedChars[index];
+    uint64_t seed = 0;
+    randomSource.fill(reinterpret_cast<uint8_t*>(&seed), sizeof(seed));
+    const BreachCorpus* corpus = loadBreachCorpus() ? &breachCorpus : nullptr;
+    unique_ptr<ChaCha20Poly1305> cipher;
+    if (anyEncrypted) {
+        cipher = make_unique<ChaCha20Poly1305>(encryptionKey.data());
     }
-    return password;
+
+    vector<PasswordTraits> traits(passwords.size());
+    workers().parallelFor(passwords.size(), auditChunk, [&](size_t begin, size_t end) {
+        SecretText plaintext;
+        for (size_t i = begin; i < end; i++) {
+            const KeyData& entry = passwords[i];
+            if (isCategoryPlaceholder(entry)) {
+                continue;
+            }
+            if (!entry.encrypted) {
+                traits[i] = examinePassword(entry.password, seed, corpus);
+                continue;
+            }
+            plaintext = entry.password;
+            if (decryptTextInPlace(*cipher, plaintext, entry.name)) {
+                traits[i] = examinePassword(plaintext, seed, corpus);
+            }
+        }
+    });
+    return buildAuditReport(passwords, traits, options);
 }
 
 // EDIT PASSWORD
@@ -150,6 +290,10 @@ void PasswordKeeper::editPassword(const string& name, const string& newPassword)
 
     if (it != passwords.end()) {
         it->password = newPassword;
+        it->encrypted = false;
+        it->dirty = true;
+        it->modified = currentEpochTime();
+        indexEntry(it - passwords.begin());
         cout << "Password Updated Successfully!" << endl;
     } else {
         cout << "Password Entry Not Found." << endl;
@@ -165,6 +309,7 @@ void PasswordKeeper::editPassword(const string& name, const string& newPassword)
 void PasswordKeeper::deletePassword(const string& name) {
     for (auto it = passwords.begin(); it != passwords.end(); ++it) {
         if (it->name == name) {
+            unindexEntry(it - passwords.begin());
             passwords.erase(it);
             savePasswordsToFile();
             cout << "Password '" << name << "' Has Been Deleted.\n";
@@ -181,6 +326,8 @@ void PasswordKeeper::deletePassword(const string& name) {
 
 void PasswordKeeper::deleteAllPasswords() {
     passwords.clear();
+    rebuildIndexes();
+    vaultDirty = true;
     savePasswordsToFile();
     cout << "All Passwords Have Been Deleted.\n";
 }
@@ -198,57 +345,125 @@ void PasswordKeeper::loadPasswordsFromFile() {
         return;
     }
 
+    // Keep the text of each record, so saving it again needs no formatting while it is unchanged
     string line;
+    SecretText record;
     KeyData entry;
+    int format = 0;
+    bool encryptedField = false;
     while (getline(inputFile, line)) {
-        if (line.find("Name: ") == 0) {
+        if (vaultFormatOf(line) == 0 && line.find("Key Derivation: ") != 0 && line.find("Key Check: ") != 0 &&
+            line.find("Timestamp: ") != 0) {
+            record.append(line).append("\n");
+        }
+        if (vaultFormatOf(line) != 0) {
+            format = vaultFormatOf(line);
+        } else if (line.find("Key Derivation: ") == 0) {
+            hasKeyDerivation = keyDerivation.fromText(line.substr(16));
+            if (!hasKeyDerivation) {
+                cerr << "Error: Unknown Key Derivation Parameters!" << endl;
+            }
+        } else if (line.find("Key Check: ") == 0) {
+            keyCheck = line.substr(11);
+        } else if (line.find("Name: ") == 0) {
             entry.name = line.substr(6);
         } else if (line.find("Password: ") == 0) {
-            entry.password = line.substr(10);
+            entry.password = string_view(line).substr(10);
+            encryptedField = false;
+            secureZero(line.data(), line.size());
+        } else if (line.find(encryptedPasswordField) == 0) {
+            entry.password = string_view(line).substr(encryptedPasswordField.size());
+            encryptedField = true;
+            secureZero(line.data(), line.size());
         } else if (line.find("Category: ") == 0) {
             entry.category = line.substr(10);
         } else if (line.find("Website: ") == 0) {
             entry.website = line.substr(9);
         } else if (line.find("Login: ") == 0) {
             entry.login = line.substr(7);
+        } else if (line.find("Created: ") == 0) {
+            entry.created = strtoll(line.c_str() + 9, nullptr, 10);
+        } else if (line.find("Modified: ") == 0) {
+            entry.modified = strtoll(line.c_str() + 10, nullptr, 10);
         } else if (line == "----------") {
+            // Older vaults did not store the state; their encrypted passwords are told apart by the prefix
+            entry.encrypted = encryptedField || (format < 2 && isEncryptedText(entry.password));
+            entry.dirty = format < 2 && entry.encrypted;
             passwords.push_back(entry);
+            savedRecords.push_back(std::move(record));
             entry = KeyData();
+            encryptedField = false;
         }
     }
     inputFile.close();
+    rebuildIndexes();
+    // An older vault is rewritten in the current format at the next save
+    legacyFormat = format < 3;
+    vaultDirty = legacyFormat && !passwords.empty();
 }
 
 // GET PASSWORD
 /**
-     * @brief Retrieves the stored passwords.
-     * @return A reference to the vector containing the stored passwords.
+     * @brief Gets the password entries for reading only.
+     * @return Vector of password entries.
      */
 
-vector<KeyData>& PasswordKeeper::getPasswords() {
+const vector<KeyData>& PasswordKeeper::getPasswords() const {
     return passwords;
 }
 
+/**
+     * @brief Looks the id up in the position map.
+     * @param id The id.
+     * @return The entry, or nullptr.
+     */
+
+const KeyData* PasswordKeeper::findEntry(uint64_t id) const {
+    auto it = positions.find(id);
+    return it != positions.end() ? &passwords[it->second] : nullptr;
+}
+
 // SAVE PASSWORD
 /**
      * @brief Saves the passwords to the source file.
      */
 
 void PasswordKeeper::savePasswordsToFile() {
+    bool changed = vaultDirty;
+    for (const auto& entry : passwords) {
+        changed = changed || entry.dirty;
+    }
+    if (!changed) {
+        return;
+    }
+
     ofstream outputFile(sourceFilePath);
     if (!outputFile) {
         cerr << "Error Opening The File" << endl;
         return;
     }
 
-    // Save the passwords to the file
-    for (const auto& entry : passwords) {
-        outputFile << "Name: " << entry.name << endl;
-        outputFile << "Password: " << entry.password << endl;
-        outputFile << "Category: " << entry.category << endl;
-        outputFile << "Website: " << entry.website << endl;
-        outputFile << "Login: " << entry.login << endl;
-        outputFile << "----------" << endl;
+    // Until its unbound passwords are migrated at unlock, an older vault stays readable as one
+    bool unbound = legacyFormat && any_of(passwords.begin(), passwords.end(), [](const KeyData& entry) {
+        return entry.encrypted && isLegacyEncryptedText(entry.password);
+    });
+    if (unbound) {
+        outputFile << vaultFormatField << 2 << endl;
+    } else {
+        outputFile << vaultFormatLine << endl;
+    }
+    if (hasKeyDerivation) {
+        outputFile << "Key Derivation: " << keyDerivation.toText() << endl;
+        outputFile << "Key Check: " << keyCheck << endl;
+    }
+
+    // Save the passwords to the file, formatting only the entries that changed
+    for (size_t i = 0; i < passwords.size(); i++) {
+        if (passwords[i].dirty || savedRecords[i].empty()) {
+            formatRecord(passwords[i], savedRecords[i]);
+            passwords[i].dirty = false;
+        }
+        outputFile << savedRecords[i];
     }
 
     // Get the current timestamp
@@ -261,6 +476,12 @@ void PasswordKeeper::savePasswordsToFile() {
     outputFile << "Timestamp: " << timestamp << endl;
 
     outputFile.close();
+
+    // Rewrite the whole file next time if this write did not make it to disk
+    vaultDirty = outputFile.fail();
+    if (vaultDirty) {
+        cerr << "Error: Unable To Write The Vault File!" << endl;
+    }
 }
 
 // SEARCH PASSWORD
@@ -270,18 +491,88 @@ void PasswordKeeper::savePasswordsToFile() {
      * @return A vector of KeyData entries matching the search query.
      */
 
-vector<KeyData> PasswordKeeper::searchPasswords(const string& query) {
+vector<KeyData> PasswordKeeper::searchPasswords(const string& query, bool caseSensitive) {
     vector<KeyData> results;
+    vector<uint64_t> ids;
+
+    // Fold the query once; the entries were folded when they were loaded or changed
+    string foldedQuery = caseSensitive ? query : foldForSearch(query);
+    string cacheKey = (caseSensitive ? "=" : "~") + query;
+
+    if (!searchCache.find(cacheKey, generation, ids)) {
+        for (size_t i = 0; i < passwords.size(); i++) {
+            const KeyData& entry = passwords[i];
+            bool matches;
+            if (caseSensitive) {
+                matches = entry.name.find(query) != string::npos ||
+                          entry.category.find(query) != string::npos ||
+                          entry.website.find(query) != string::npos ||
+                          entry.login.find(query) != string::npos;
+            } else {
+                const SearchColumns& columns = searchColumns[i];
+                matches = columns.name.find(foldedQuery) != string::npos ||
+                          columns.category.find(foldedQuery) != string::npos ||
+                          columns.website.find(foldedQuery) != string::npos ||
+                          columns.login.find(foldedQuery) != string::npos;
+            }
+            // Search by password as well; passwords are never folded, and ciphertext is never searched
+            if (matches || (!entry.encrypted && entry.password.find(query) != string::npos)) {
+                ids.push_back(entry.id);
+            }
+        }
+        searchCache.store(cacheKey, generation, ids);
+    }
 
-    for (const KeyData& entry : passwords) {
-        if (entry.name.find(query) != string::npos ||
-            entry.category.find(query) != string::npos ||
-            entry.website.find(query) != string::npos ||
-            entry.login.find(query) != string::npos ||
-            entry.password.find(query) != string::npos) { // Search by password as well
+    results.reserve(ids.size());
+    for (uint64_t id : ids) {
+        results.push_back(passwords[positions.at(id)]);
+    }
+    return results;
+}
 
-            results.push_back(entry);
+// FIND BY WEBSITE
+/**
+     * @brief Finds the password entries registered for a website or one of its parent domains.
+     * @param url The website or URL to look up.
+     * @param includeSubdomains Whether to also return entries of subdomains.
+     * @return A vector of KeyData entries belonging to the website.
+     */
+
+vector<KeyData> PasswordKeeper::findByWebsite(const string& url, bool includeSubdomains) {
+    vector<KeyData> results;
+
+    for (uint64_t id : websiteIndex.lookup(normalizeWebsite(url), includeSubdomains)) {
+        results.push_back(passwords[positions.at(id)]);
+    }
+    return results;
+}
+
+// BLIND INDEX SEARCH
+/**
+     * @brief Finds entries by the keyed tokens of a normalized query.
+     * @param field The field to search.
+     * @param query The value or words to find.
+     * @param wordMatch Whether to match words instead of the whole field.
+     * @return A vector of matching KeyData entries.
+     */
+
+vector<KeyData> PasswordKeeper::findByBlindIndex(BlindField field, const string& query, bool wordMatch) {
+    vector<KeyData> results;
+    if (!requireUnlocked()) {
+        return results;
+    }
+
+    if (!blindIndexBuilt) {
+        // Built on first use: the tokens cost several HMACs per entry, too much to pay at every unlock
+        for (size_t i = 0; i < passwords.size(); i++) {
+            blindIndex.insert(passwords[i].id, searchColumns[i].name, searchColumns[i].host, searchColumns[i].login);
         }
+        blindIndexBuilt = true;
+    }
+    string normalized = field == BlindField::Website ? normalizeWebsite(query) : foldForSearch(query);
+    vector<uint64_t> ids = wordMatch ? blindIndex.findWords(field, normalized) : blindIndex.findExact(field, normalized);
+    for (uint64_t id : ids) {
+        results.push_back(passwords[positions.at(id)]);
     }
     return results;
 }
@@ -289,34 +580,111 @@ vector<KeyData> PasswordKeeper::searchPasswords(const string& query) {
 // SORT PASSWORD
 /**
      * @brief Sorts the passwords based on the specified criteria.
-     * @param sortBy The sort criteria ("name" or "category").
+     * @param sortBy The sort specification (e.g. "name" or "category,name:desc").
      */
 
 void PasswordKeeper::sortPasswords(const string& sortBy) {
-    vector<KeyData>& passwordList = getPasswords();
-
-    if (sortBy == "name") {
-        sort(passwordList.begin(), passwordList.end(), [](const KeyData& a, const KeyData& b) {
-            return a.name < b.name;
-        });
-    } else if (sortBy == "category") {
-        sort(passwordList.begin(), passwordList.end(), [](const KeyData& a, const KeyData& b) {
-            return a.category < b.category;
-        });
-    } else {
+    vector<SortKey> keys;
+    if (!parseSortKeys(sortBy, keys)) {
         cout << "Invalid Sort Criteria.\n";
         return;
     }
+    sortPasswords(keys);
+}
+
+/**
+     * @brief Prints the passwords sorted by several keys, decrypting encrypted ones through revealPassword.
+     * @param keys The sort keys, most significant first.
+     */
 
+void PasswordKeeper::sortPasswords(const vector<SortKey>& keys) {
     cout << "Sorted Passwords:\n";
-    for (const auto& entry : passwordList) {
-        cout << "Name: " << entry.name << endl;
-        cout << "Password: " << entry.password << endl;
-        cout << "Category: " << entry.category << endl;
-        cout << "Website: " << entry.website << endl;
-        cout << "Login: " << entry.login << endl;
-        cout << "----------\n";
+    for (const auto& entry : getSortedPasswords(keys)) {
+        cout << "Name: " << entry.name << '\n'
+             << "Password: " << revealPassword(entry) << '\n'
+             << "Category: " << entry.category << '\n'
+             << "Website: " << entry.website << '\n'
+             << "Login: " << entry.login << '\n'
+             << "----------\n";
+    }
+    cout.flush();
+}
+
+/**
+     * @brief Returns the passwords in sorted order, leaving the storage order untouched.
+     * @param keys The sort keys, most significant first.
+     * @return A vector of KeyData entries in sorted order.
+     */
+
+vector<KeyData> PasswordKeeper::getSortedPasswords(const vector<SortKey>& keys) {
+    vector<KeyData> sorted;
+    sorted.reserve(passwords.size());
+
+    vector<uint64_t> ids;
+    if (keys.size() == 1 && sortedViews.orderedIds(keys.front(), ids)) {
+        for (uint64_t id : ids) {
+            sorted.push_back(passwords[positions.at(id)]);
+        }
+        return sorted;
+    }
+
+    WorkerPool* pool = passwords.size() >= parallelSortThreshold ? &workers() : nullptr;
+    for (size_t index : sortedOrder(searchColumns, keys, pool)) {
+        sorted.push_back(passwords[index]);
     }
+    return sorted;
+}
+
+/**
+     * @brief Returns one page of the passwords in sorted order.
+     * @param keys The sort keys, most significant first.
+     * @param offset The number of sorted entries to skip.
+     * @param limit The maximum number of entries to return.
+     * @return A vector of at most limit KeyData entries.
+     */
+
+vector<KeyData> PasswordKeeper::getSortedPasswords(const vector<SortKey>& keys, size_t offset, size_t limit) {
+    vector<KeyData> page;
+    if (offset >= passwords.size() || limit == 0) {
+        return page;
+    }
+    size_t end = offset + min(limit, passwords.size() - offset);
+    page.reserve(end - offset);
+
+    vector<uint64_t> ids;
+    if (keys.size() == 1 && sortedViews.orderedIds(keys.front(), ids, offset, limit)) {
+        for (uint64_t id : ids) {
+            page.push_back(passwords[positions.at(id)]);
+        }
+        return page;
+    }
+
+    WorkerPool* pool = passwords.size() >= parallelSortThreshold ? &workers() : nullptr;
+    vector<size_t> order = topOrder(searchColumns, keys, end, pool);
+    for (size_t i = offset; i < end; i++) {
+        page.push_back(passwords[order[i]]);
+    }
+    return page;
+}
+
+// GET PASSWORDS MODIFIED BETWEEN
+/**
+     * @brief Returns the passwords modified within a time range, read from the modification view.
+     * @param from Start of the range, in seconds since the epoch (inclusive).
+     * @param to End of the range, in seconds since the epoch (inclusive).
+     * @return A vector of KeyData entries, oldest first.
+     */
+
+vector<KeyData> PasswordKeeper::getPasswordsModifiedBetween(int64_t from, int64_t to) {
+    vector<KeyData> results;
+    vector<uint64_t> ids;
+
+    sortedViews.modifiedBetween(from, to, ids);
+    results.reserve(ids.size());
+    for (uint64_t id : ids) {
+        results.push_back(passwords[positions.at(id)]);
+    }
+    return results;
 }
 
 // ENCRYPT PASSWORD
@@ -327,23 +695,294 @@ void PasswordKeeper::sortPasswords(const string& sortBy) {
     */
 
 string PasswordKeeper::encrypt(const string& password) {
-    string encryptedPassword = password;
+    if (!requireUnlocked()) {
+        return password;
+    }
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    return encryptText(cipher, password, "");
+}
+
+// MASTER PASSWORD
+/**
+     * @brief Checks whether the vault has a master password.
+     * @return True if key derivation parameters were loaded or set.
+     */
+
+bool PasswordKeeper::hasMasterPassword() const {
+    return hasKeyDerivation;
+}
+
+/**
+     * @brief Derives the session key from the master password, setting the master password on first use.
+     * @param masterPassword The master password.
+     * @return False if the master password is wrong or empty.
+     */
+
+bool PasswordKeeper::unlock(const string& masterPassword) {
+    if (masterPassword.empty()) {
+        cout << "The Master Password Cannot Be Empty.\n";
+        return false;
+    }
+
+    if (!hasKeyDerivation) {
+        // New master password: calibrate the cost on this machine and remember it with the vault
+        keyDerivation.iterations = calibrateIterations(unlockTargetMilliseconds);
+        fillRandom(keyDerivation.salt, KdfParameters::saltSize);
+        pbkdf2HmacSha256(masterPassword, keyDerivation.salt, KdfParameters::saltSize, keyDerivation.iterations,
+                         encryptionKey.data(), LockedKey::size);
+        ChaCha20Poly1305 cipher(encryptionKey.data());
+        keyCheck = encryptText(cipher, keyCheckText, "");
+        hasKeyDerivation = true;
+        unlocked = true;
+        blindIndex.setKey(encryptionKey.data());
+        blindIndexBuilt = false;
+        if (legacyFormat) {
+            migrateLegacyKey();
+        }
+        vaultDirty = true;
+        savePasswordsToFile();
+        cout << "Master Password Set (" << keyDerivation.iterations << " PBKDF2 Iterations).\n";
+        return true;
+    }
+
+    pbkdf2HmacSha256(masterPassword, keyDerivation.salt, KdfParameters::saltSize, keyDerivation.iterations,
+                     encryptionKey.data(), LockedKey::size);
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    string checkText = keyCheck;
+    bool opened = isLegacyEncryptedText(checkText) ? decryptLegacyTextInPlace(cipher, checkText)
+                                                   : decryptTextInPlace(cipher, checkText, "");
+    if (!opened || checkText != keyCheckText) {
+        encryptionKey.wipe();
+        unlocked = false;
+        cerr << "Error: Wrong Master Password!" << endl;
+        return false;
+    }
+    unlocked = true;
+    blindIndex.setKey(encryptionKey.data());
+    blindIndexBuilt = false;
+    if (legacyFormat) {
+        bindLegacyCiphertext();
+    }
+    cout << "Vault Unlocked.\n";
+    return true;
+}
+
+/**
+     * @brief Derives a key from the new master password and rotates the vault file and memory to it.
+     * @param currentPassword The current master password.
+     * @param newPassword The new master password.
+     * @return False if the current master password is wrong or the rotation failed.
+     */
+
+bool PasswordKeeper::changeMasterPassword(const string& currentPassword, const string& newPassword) {
+    if (!requireUnlocked()) {
+        return false;
+    }
+    if (newPassword.empty()) {
+        cout << "The Master Password Cannot Be Empty.\n";
+        return false;
+    }
+
+    LockedKey currentKey;
+    pbkdf2HmacSha256(currentPassword, keyDerivation.salt, KdfParameters::saltSize, keyDerivation.iterations,
+                     currentKey.data(), LockedKey::size);
+    uint8_t difference = 0;
+    for (size_t i = 0; i < LockedKey::size; i++) {
+        difference |= currentKey.data()[i] ^ encryptionKey.data()[i];
+    }
+    if (difference != 0) {
+        cerr << "Error: Wrong Master Password!" << endl;
+        return false;
+    }
+
+    // Every encrypted entry must open under the current key before anything is rotated;
+    // one that does not would stay sealed under a key that no longer exists
+    ChaCha20Poly1305 oldCipher(encryptionKey.data());
+    atomic<size_t> failed{0};
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        SecretText plaintext;
+        for (size_t i = begin; i < end; i++) {
+            if (!passwords[i].encrypted) {
+                continue;
+            }
+            plaintext = passwords[i].password;
+            if (!decryptTextInPlace(oldCipher, plaintext, passwords[i].name)) {
+                failed++;
+            }
+        }
+    });
+    if (failed > 0) {
+        cerr << "Error: " << failed << " Password(s) Failed Authentication; The Master Password Was Not Changed!"
+             << endl;
+        return false;
+    }
+
+    KdfParameters newDerivation;
+    LockedKey newKey;
+    newDerivation.iterations = calibrateIterations(unlockTargetMilliseconds);
+    fillRandom(newDerivation.salt, KdfParameters::saltSize);
+    pbkdf2HmacSha256(newPassword, newDerivation.salt, KdfParameters::saltSize, newDerivation.iterations,
+                     newKey.data(), LockedKey::size);
+
+    ChaCha20Poly1305 newCipher(newKey.data());
+    string newKeyCheck = encryptText(newCipher, keyCheckText, "");
+    vector<string> header = {"Key Derivation: " + newDerivation.toText(), "Key Check: " + newKeyCheck};
+
+    ifstream existing(sourceFilePath);
+    bool fileExists = existing.good();
+    existing.close();
+    if (fileExists && !rotateVaultKey(sourceFilePath, oldCipher, newCipher, header, workers())) {
+        return false;
+    }
+
+    // The file now uses the new key; bring the entries in memory along, including unsaved ones
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            KeyData& entry = passwords[i];
+            if (entry.encrypted && decryptTextInPlace(oldCipher, entry.password, entry.name)) {
+                encryptTextInPlace(newCipher, entry.password, entry.name);
+                entry.dirty = true;
+            }
+        }
+    });
+
+    memcpy(encryptionKey.data(), newKey.data(), LockedKey::size);
+    keyDerivation = newDerivation;
+    keyCheck = newKeyCheck;
+    vaultDirty = true;
+    blindIndex.setKey(encryptionKey.data());
+    blindIndexBuilt = false;
+    revealCache.clear();
+    generation++;
+    cout << "Master Password Changed Successfully!\n";
+    return true;
+}
+
+/**
+     * @brief Wipes the session key and any revealed passwords.
+     */
+
+void PasswordKeeper::lock() {
+    encryptionKey.wipe();
+    revealCache.clear();
+    blindIndex.forgetKey();
+    blindIndexBuilt = false;
+    unlocked = false;
+}
+
+/**
+     * @brief Checks whether the session key is available.
+     * @return True if unlocked.
+     */
 
-    for (char& i : encryptedPassword) {
-        i ^= encryptionKey;
+bool PasswordKeeper::isUnlocked() const {
+    return unlocked;
+}
+
+/**
+     * @brief Reports an error unless the vault is unlocked.
+     * @return True if the session key is available.
+     */
+
+bool PasswordKeeper::requireUnlocked() const {
+    if (!unlocked) {
+        cerr << "Error: Enter The Master Password First!" << endl;
     }
-    return encryptedPassword;
+    return unlocked;
+}
+
+/**
+     * @brief Re-encrypts passwords that older versions encrypted under a fixed key.
+     */
+
+void PasswordKeeper::migrateLegacyKey() {
+    uint8_t legacyKey[ChaCha20Poly1305::keySize];
+    fill(begin(legacyKey), end(legacyKey), 10);
+    ChaCha20Poly1305 legacyCipher(legacyKey);
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    secureZero(legacyKey, sizeof(legacyKey));
+
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            if (passwords[i].encrypted && decryptLegacyTextInPlace(legacyCipher, passwords[i].password)) {
+                encryptTextInPlace(cipher, passwords[i].password, passwords[i].name);
+                passwords[i].dirty = true;
+            }
+        }
+    });
+    generation++;
+}
+
+/**
+     * @brief Opens every password in the legacy format under the session key and seals it again with its name,
+     * so it can no longer be moved to another entry, then saves the vault.
+     */
+
+void PasswordKeeper::bindLegacyCiphertext() {
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    atomic<size_t> bound{0};
+    atomic<size_t> failed{0};
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            KeyData& entry = passwords[i];
+            if (!entry.encrypted || !isLegacyEncryptedText(entry.password)) {
+                continue;
+            }
+            if (decryptLegacyTextInPlace(cipher, entry.password)) {
+                encryptTextInPlace(cipher, entry.password, entry.name);
+                entry.dirty = true;
+                bound++;
+            } else {
+                failed++;
+            }
+        }
+    });
+    if (isLegacyEncryptedText(keyCheck)) {
+        keyCheck = encryptText(cipher, keyCheckText, "");
+        vaultDirty = true;
+    }
+    if (failed > 0) {
+        cerr << "Error: " << failed << " Password(s) Failed Authentication And Were Left In The Old Format!" << endl;
+    } else {
+        legacyFormat = false;
+        vaultDirty = true;
+    }
+    if (bound > 0) {
+        revealCache.clear();
+        generation++;
+    }
+    savePasswordsToFile();
 }
 
 //ENCRYPT ALL PASSWORD
 /**
-     * @brief Encrypts all passwords and saves them to the source file.
+     * @brief Encrypts the passwords that are not encrypted yet and saves the changed entries.
      */
 
 void PasswordKeeper::encryptAllPasswords() {
-    for (auto& entry : passwords) {
-        entry.password = encrypt(entry.password);
+    if (!requireUnlocked()) {
+        return;
+    }
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    atomic<size_t> changed{0};
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        size_t chunkChanged = 0;
+        for (size_t i = begin; i < end; i++) {
+            if (!passwords[i].encrypted) {
+                encryptTextInPlace(cipher, passwords[i].password, passwords[i].name);
+                passwords[i].encrypted = true;
+                passwords[i].dirty = true;
+                chunkChanged++;
+            }
+        }
+        changed += chunkChanged;
+    });
+    if (changed == 0) {
+        cout << "All Passwords Are Already Encrypted.\n";
+        return;
     }
+    revealCache.clear();
+    generation++;
     savePasswordsToFile();
     cout << "All Passwords Have Been Encrypted And Saved To File.\n";
 }
@@ -356,27 +995,134 @@ void PasswordKeeper::encryptAllPasswords() {
      */
 
 string PasswordKeeper::decrypt(const string& encryptedPassword) {
-    string decryptedPassword = encryptedPassword;
+    string decryptedPassword;
 
-    for (char& i : decryptedPassword) {
-        i ^= encryptionKey;
+    if (!isEncryptedText(encryptedPassword) || !requireUnlocked()) {
+        return encryptedPassword;
+    }
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    if (!decryptText(cipher, encryptedPassword, "", decryptedPassword)) {
+        cerr << "Error: Password Failed Authentication!" << endl;
+        return encryptedPassword;
     }
     return decryptedPassword;
 }
 
 // DECRYPT ALL PASSWORD
 /**
-     * @brief Decrypts all passwords and saves them to the source file.
+     * @brief Decrypts the encrypted passwords and saves the changed entries.
      */
 
 void PasswordKeeper::decryptAllPasswords() {
-    for (auto& entry : passwords) {
-        entry.password = decrypt(entry.password);
+    if (!requireUnlocked()) {
+        return;
+    }
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    atomic<size_t> changed{0};
+    atomic<size_t> failed{0};
+    workers().parallelFor(passwords.size(), cipherChunk, [&](size_t begin, size_t end) {
+        size_t chunkChanged = 0;
+        size_t chunkFailed = 0;
+        for (size_t i = begin; i < end; i++) {
+            KeyData& entry = passwords[i];
+            if (entry.encrypted) {
+                if (decryptTextInPlace(cipher, entry.password, entry.name)) {
+                    entry.encrypted = false;
+                    entry.dirty = true;
+                    chunkChanged++;
+                } else {
+                    chunkFailed++;
+                }
+            }
+        }
+        changed += chunkChanged;
+        failed += chunkFailed;
+    });
+    if (failed > 0) {
+        cerr << "Error: " << failed << " Password(s) Failed Authentication And Were Left Encrypted!" << endl;
+    }
+    if (changed == 0) {
+        if (failed == 0) {
+            cout << "All Passwords Are Already Decrypted.\n";
+        }
+        return;
     }
+    revealCache.clear();
+    generation++;
     savePasswordsToFile();
     cout << "All Passwords Have Been Decrypted And Saved To File.\n";
 }
 
+// REVEAL PASSWORD
+/**
+     * @brief Gets the password of an entry, decrypting it on demand if it is encrypted.
+     * @param entry The entry.
+     * @return The password; the encrypted text unchanged if it fails authentication.
+     */
+
+SecretText PasswordKeeper::revealPassword(const KeyData& entry) {
+    if (!entry.encrypted) {
+        return entry.password;
+    }
+
+    SecretText password;
+    revealCache.purgeExpired();
+    if (revealCache.find(entry.id, entry.password, password)) {
+        return password;
+    }
+
+    if (!requireUnlocked()) {
+        return entry.password;
+    }
+    ChaCha20Poly1305 cipher(encryptionKey.data());
+    password = entry.password;
+    if (!decryptTextInPlace(cipher, password, entry.name)) {
+        cerr << "Error: Password Failed Authentication!" << endl;
+        return entry.password;
+    }
+    revealCache.store(entry.id, entry.password, password);
+    return password;
+}
+
+/**
+     * @brief Sets how long revealed passwords are cached.
+     * @param seconds The lifetime in seconds; 0 disables caching.
+     */
+
+void PasswordKeeper::setRevealCacheLifetime(int seconds) {
+    revealCache.setLifetime(chrono::seconds(max(seconds, 0)));
+}
+
+// LEGACY IMPORT
+/**
+     * @brief XORs every byte of the unencrypted passwords with the fixed key 10 of the first version and saves them.
+     * @return Number of passwords decoded.
+     */
+
+size_t PasswordKeeper::decodeLegacyXorPasswords() {
+    if (hasKeyDerivation) {
+        cerr << "Error: This Vault Has A Master Password, So It Was Not Encrypted By The First Version!" << endl;
+        return 0;
+    }
+    const char legacyKey = 10;
+    size_t decoded = 0;
+    for (size_t i = 0; i < passwords.size(); i++) {
+        KeyData& entry = passwords[i];
+        if (entry.encrypted || entry.password.empty()) {
+            continue;
+        }
+        char* text = entry.password.data();
+        for (size_t j = 0; j < entry.password.size(); j++) {
+            text[j] ^= legacyKey;
+        }
+        entry.dirty = true;
+        indexEntry(i);
+        decoded++;
+    }
+    savePasswordsToFile();
+    return decoded;
+}
+
 // ADD CATEGORY
 /**
  * @brief Adds a new category to the password storage.
@@ -392,8 +1138,10 @@ void PasswordKeeper::addCategory(const string& categoryName) {
     }
     KeyData categoryEntry;
     categoryEntry.category = categoryName;
+    categoryEntry.created = categoryEntry.modified = currentEpochTime();
 
     passwords.push_back(categoryEntry);
+    indexEntry(passwords.size() - 1);
 
     cout << "Category '" << categoryName << "' Added Successfully!\n";
 }
@@ -410,6 +1158,7 @@ void PasswordKeeper::deleteCategory(const string& categoryName) {
 
     for (auto it = passwords.begin(); it != passwords.end(); ) {
         if (it->category == categoryName) {
+            unindexEntry(it - passwords.begin());
             it = passwords.erase(it);
             categoryFound = true;
         } else {
@@ -442,6 +1191,7 @@ void PasswordKeeper::selectSourceFile() {
     }
 
     sourceFilePath = filePath;
+    vaultDirty = true;
 
     // Read the file content
     string fileContent((istreambuf_iterator<char>(inputFile)), istreambuf_iterator<char>());
@@ -464,4 +1214,101 @@ void PasswordKeeper::selectSourceFile() {
     } else {
         cout << "Error: Failed To Open The Timestamps File." << endl;
     }
-}
\ No newline at end of file
+}
+
+// SEARCH INDEXES
+/**
+     * @brief Refreshes the folded search columns of the entry at the given position.
+     * @param index Position of the entry in the passwords vector.
+     */
+
+void PasswordKeeper::indexEntry(size_t index) {
+    if (searchColumns.size() <= index) {
+        searchColumns.resize(index + 1);
+    }
+    if (savedRecords.size() <= index) {
+        savedRecords.resize(index + 1);
+    }
+    KeyData& entry = passwords[index];
+    SearchColumns& columns = searchColumns[index];
+    generation++;
+    if (entry.id == 0) {
+        entry.id = nextEntryId++;
+    }
+    positions[entry.id] = index;
+    if (columns.revision != 0) {
+        sortedViews.erase(columns, entry.id);
+    }
+
+    columns.name = foldForSearch(entry.name);
+    columns.category = foldForSearch(entry.category);
+    columns.website = foldForSearch(entry.website);
+    columns.login = foldForSearch(entry.login);
+
+    websiteIndex.remove(columns.host, entry.id);
+    columns.host = normalizeWebsite(entry.website);
+    websiteIndex.insert(columns.host, entry.id);
+
+    columns.created = entry.created;
+    columns.modified = entry.modified;
+    columns.revision = generation;
+    sortedViews.insert(columns, entry.id);
+    if (blindIndexBuilt) {
+        blindIndex.insert(entry.id, columns.name, columns.host, columns.login);
+    }
+}
+
+/**
+     * @brief Drops the folded search columns of the entry at the given position.
+     * @param index Position of the entry in the passwords vector.
+     */
+
+void PasswordKeeper::unindexEntry(size_t index) {
+    const KeyData& entry = passwords[index];
+    generation++;
+    websiteIndex.remove(searchColumns[index].host, entry.id);
+    sortedViews.erase(searchColumns[index], entry.id);
+    if (blindIndexBuilt) {
+        blindIndex.remove(entry.id);
+    }
+    positions.erase(entry.id);
+
+    // Entries behind the erased one move down by one slot
+    for (size_t i = index + 1; i < passwords.size(); i++) {
+        positions[passwords[i].id] = i - 1;
+    }
+    searchColumns.erase(searchColumns.begin() + index);
+    savedRecords.erase(savedRecords.begin() + index);
+    vaultDirty = true;
+}
+
+/**
+     * @brief Recomputes the folded search columns of every entry.
+     */
+
+void PasswordKeeper::rebuildIndexes() {
+    searchColumns.clear();
+    searchColumns.reserve(passwords.size());
+    savedRecords.resize(passwords.size());
+    websiteIndex.clear();
+    sortedViews.clear();
+    blindIndex.clear();
+    blindIndexBuilt = false;
+    positions.clear();
+    generation++;
+    for (size_t i = 0; i < passwords.size(); i++) {
+        indexEntry(i);
+    }
+}
+
+/**
+     * @brief Gets the worker pool, starting its threads on first use.
+     * @return The worker pool.
+     */
+
+WorkerPool& PasswordKeeper::workers() {
+    if (!workerPool) {
+        workerPool = make_unique<WorkerPool>();
+    }
+    return *workerPool;
+}
@@ -0,0 +1,149 @@
+#ifndef PASSWORDMANAGER_PERFECTHASH_H
+#define PASSWORDMANAGER_PERFECTHASH_H
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+using namespace std;
+
+/**
+ * @file PerfectHash.h
+ * @brief Perfect hash tables of fixed word lists, built at compile time.
+ */
+
+/**
+ * @brief Hashes a key with a seed; FNV-1a followed by a 64-bit finalizer.
+ * @param key The key.
+ * @param seed The seed; each seed gives an unrelated hash function.
+ * @return The hash.
+ */
+
+constexpr uint64_t perfectHashOf(string_view key, uint64_t seed) {
+    uint64_t hash = 14695981039346656037ull ^ (seed * 0x9E3779B97F4A7C15ull);
+    for (char c : key) {
+        hash ^= static_cast<unsigned char>(c);
+        hash *= 1099511628211ull;
+    }
+    hash ^= hash >> 29;
+    hash *= 0xBF58476D1CE4E5B9ull;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+/**
+ * @brief A collision-free table of a fixed list of words, built by hash and displace.
+ *
+ * The words are spread over buckets by one hash. Largest bucket first, each
+ * bucket is given the smallest seed under which a second hash sends all its
+ * words to free slots. A lookup is therefore two hashes and one comparison,
+ * with no probing, whatever word is asked for. The table is meant to be
+ * declared constexpr, so the seeds are searched by the compiler and the
+ * program only carries the finished arrays.
+ *
+ * Repeated words keep their first position, and the index returned by find
+ * is the position in the list, so a list in frequency order gives ranks.
+ *
+ * @tparam N Number of words.
+ */
+
+template <size_t N>
+class PerfectHashTable {
+public:
+    static constexpr size_t bucketCount = bit_ceil(N / 2 + 1);     /**< Buckets; about two words each. */
+    static constexpr size_t slotCount = bit_ceil(2 * N);           /**< Slots; at least half of them empty. */
+
+private:
+    const string_view *words;                   /**< The list the table was built from. */
+    array<uint16_t, bucketCount> seeds{};       /**< Seed of the second hash for each bucket. */
+    array<uint16_t, slotCount> slots{};         /**< Position + 1 of the word in each slot; 0 when empty. */
+
+public:
+    /**
+     * @brief Constructor for PerfectHashTable class; searches the seeds.
+     * @param list The words; must outlive the table.
+     */
+
+    constexpr explicit PerfectHashTable(const string_view (&list)[N]) : words(list) {
+        static_assert(N < UINT16_MAX, "Word positions are stored in 16 bits");
+        array<uint16_t, N> bucketOf{};
+        array<uint16_t, bucketCount> bucketSize{};
+        for (size_t i = 0; i < N; i++) {
+            bucketOf[i] = static_cast<uint16_t>(perfectHashOf(words[i], 0) & (bucketCount - 1));
+            bucketSize[bucketOf[i]]++;
+        }
+
+        array<uint16_t, bucketCount> order{};
+        for (size_t b = 0; b < bucketCount; b++) {
+            order[b] = static_cast<uint16_t>(b);
+        }
+        sort(order.begin(), order.end(), [&](uint16_t a, uint16_t b) {
+            return bucketSize[a] > bucketSize[b];
+        });
+
+        array<uint16_t, N> members{};
+        array<size_t, N> chosen{};
+        for (uint16_t bucket : order) {
+            // Words of the bucket, without repeats
+            size_t count = 0;
+            for (size_t i = 0; i < N; i++) {
+                if (bucketOf[i] != bucket) {
+                    continue;
+                }
+                bool repeat = false;
+                for (size_t m = 0; m < count; m++) {
+                    repeat = repeat || words[members[m]] == words[i];
+                }
+                if (!repeat) {
+                    members[count++] = static_cast<uint16_t>(i);
+                }
+            }
+            if (count == 0) {
+                continue;
+            }
+
+            for (uint16_t seed = 1;; seed++) {
+                bool fits = true;
+                for (size_t m = 0; m < count && fits; m++) {
+                    chosen[m] = perfectHashOf(words[members[m]], seed) & (slotCount - 1);
+                    fits = slots[chosen[m]] == 0;
+                    for (size_t earlier = 0; earlier < m && fits; earlier++) {
+                        fits = chosen[earlier] != chosen[m];
+                    }
+                }
+                if (fits) {
+                    seeds[bucket] = seed;
+                    for (size_t m = 0; m < count; m++) {
+                        slots[chosen[m]] = static_cast<uint16_t>(members[m] + 1);
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    /**
+     * @brief Looks a word up.
+     * @param key The word.
+     * @return Position of the word in the list, or -1 if it is not in the list.
+     */
+
+    constexpr int find(string_view key) const {
+        uint64_t seed = seeds[perfectHashOf(key, 0) & (bucketCount - 1)];
+        uint16_t slot = slots[perfectHashOf(key, seed) & (slotCount - 1)];
+        return slot != 0 && words[slot - 1] == key ? slot - 1 : -1;
+    }
+
+    /**
+     * @brief Gets the number of words in the list.
+     * @return The number of words, counting repeats.
+     */
+
+    static constexpr size_t size() {
+        return N;
+    }
+};
+
+#endif //PASSWORDMANAGER_PERFECTHASH_H
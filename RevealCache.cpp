@@ -0,0 +1,125 @@
+/**
+ * @file RevealCache.cpp
+ * @brief Implementation of the short-lived cache of decrypted passwords.
+ */
+
+#include "RevealCache.h"
+using namespace std;
+
+/**
+     * @brief Constructor.
+     * @param lifetime How long a plaintext is kept; 0 disables the cache.
+     * @param capacity Maximum number of plaintexts to keep.
+     */
+
+RevealCache::RevealCache(chrono::seconds lifetime, size_t capacity) : lifetime(lifetime), capacity(capacity) {}
+
+/**
+ * @brief Destructor.
+ * Wipes every cached plaintext.
+ */
+
+RevealCache::~RevealCache() {
+    clear();
+}
+
+/**
+     * @brief Wipes a plaintext and removes it from the cache.
+     * @param it Position of the plaintext.
+     */
+
+void RevealCache::evict(unordered_map<uint64_t, Entry>::iterator it) {
+    // The plaintext wipes itself when it is destroyed
+    entries.erase(it);
+}
+
+// LIFETIME
+/**
+     * @brief Sets the lifetime of cached plaintexts and drops the current ones.
+     * @param seconds The new lifetime; 0 disables the cache.
+     */
+
+void RevealCache::setLifetime(chrono::seconds seconds) {
+    lifetime = seconds;
+    clear();
+}
+
+// FIND
+/**
+     * @brief Returns a cached plaintext if it is unexpired and matches the encrypted text.
+     * @param id Id of the entry.
+     * @param encryptedText The entry's current encrypted text.
+     * @param plaintext Receives the plaintext on a hit.
+     * @return True on a hit.
+     */
+
+bool RevealCache::find(uint64_t id, string_view encryptedText, SecretText& plaintext) {
+    auto it = entries.find(id);
+    if (it == entries.end()) {
+        return false;
+    }
+
+    if (it->second.expires <= chrono::steady_clock::now() || it->second.encryptedText != encryptedText) {
+        // Expired, or the entry was re-encrypted or changed since
+        evict(it);
+        return false;
+    }
+    plaintext = it->second.plaintext;
+    return true;
+}
+
+// STORE
+/**
+     * @brief Caches a plaintext until its lifetime runs out.
+     * @param id Id of the entry.
+     * @param encryptedText The encrypted text the plaintext was decrypted from.
+     * @param plaintext The plaintext.
+     */
+
+void RevealCache::store(uint64_t id, string_view encryptedText, const SecretText& plaintext) {
+    if (lifetime.count() <= 0 || capacity == 0) {
+        return;
+    }
+
+    auto it = entries.find(id);
+    if (it != entries.end()) {
+        evict(it);
+    } else if (entries.size() >= capacity) {
+        purgeExpired();
+        if (entries.size() >= capacity) {
+            auto oldest = entries.begin();
+            for (auto candidate = entries.begin(); candidate != entries.end(); ++candidate) {
+                if (candidate->second.expires < oldest->second.expires) {
+                    oldest = candidate;
+                }
+            }
+            evict(oldest);
+        }
+    }
+    entries.emplace(id, Entry{string(encryptedText), plaintext, chrono::steady_clock::now() + lifetime});
+}
+
+// PURGE
+/**
+     * @brief Wipes every plaintext whose lifetime has run out.
+     */
+
+void RevealCache::purgeExpired() {
+    auto now = chrono::steady_clock::now();
+    for (auto it = entries.begin(); it != entries.end();) {
+        if (it->second.expires <= now) {
+            it = entries.erase(it);
+        } else {
+            ++it;
+        }
+    }
+}
+
+// CLEAR
+/**
+     * @brief Wipes every cached plaintext.
+     */
+
+void RevealCache::clear() {
+    entries.clear();
+}
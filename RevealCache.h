@@ -0,0 +1,112 @@
+#ifndef PASSWORDMANAGER_REVEALCACHE_H
+#define PASSWORDMANAGER_REVEALCACHE_H
+
+#include <chrono>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include "SecureArena.h"
+using namespace std;
+
+/**
+ * @file RevealCache.h
+ * @brief Short-lived cache of decrypted passwords.
+ */
+
+/**
+ * @brief Keeps recently decrypted passwords for a few seconds, so paging back and forth does not decrypt again.
+ *
+ * Every plaintext is stored with the encrypted text it came from and is only
+ * served while the entry still holds exactly that text. Plaintexts live in
+ * the secure arena and are wiped when they expire, are evicted, or the cache
+ * is cleared or destroyed.
+ */
+
+class RevealCache {
+private:
+    /**
+     * @brief A cached plaintext.
+     */
+
+    struct Entry {
+        string encryptedText;                       /**< Encrypted text the plaintext was decrypted from. */
+        SecretText plaintext;                       /**< The decrypted password. */
+        chrono::steady_clock::time_point expires;   /**< When the plaintext is dropped. */
+    };
+
+    chrono::seconds lifetime;                   /**< How long a plaintext is kept; 0 disables the cache. */
+    size_t capacity;                            /**< Maximum number of cached plaintexts. */
+    unordered_map<uint64_t, Entry> entries;     /**< Entry id to cached plaintext. */
+
+    /**
+     * @brief Wipes and removes one cached plaintext.
+     * @param it Position of the plaintext in entries.
+     */
+
+    void evict(unordered_map<uint64_t, Entry>::iterator it);
+
+public:
+
+    /**
+     * @brief Constructor for RevealCache class.
+     * @param lifetime How long a plaintext is kept; 0 disables the cache.
+     * @param capacity Maximum number of plaintexts to keep.
+     */
+
+    explicit RevealCache(chrono::seconds lifetime = chrono::seconds(30), size_t capacity = 64);
+
+    /**
+     * @brief Destructor; wipes every cached plaintext.
+     */
+
+    ~RevealCache();
+
+    RevealCache(const RevealCache &) = delete;
+    RevealCache &operator=(const RevealCache &) = delete;
+
+    // LIFETIME
+    /**
+     * @brief Changes how long plaintexts are kept and drops the cached ones.
+     * @param seconds The new lifetime; 0 disables the cache.
+     */
+
+    void setLifetime(chrono::seconds seconds);
+
+    // FIND
+    /**
+     * @brief Looks up the plaintext of an entry.
+     * @param id Id of the entry.
+     * @param encryptedText The entry's current encrypted text.
+     * @param plaintext Receives the plaintext on a hit.
+     * @return True if an unexpired plaintext of exactly this encrypted text was found.
+     */
+
+    bool find(uint64_t id, string_view encryptedText, SecretText &plaintext);
+
+    // STORE
+    /**
+     * @brief Caches the plaintext of an entry, evicting the one closest to expiry when full.
+     * @param id Id of the entry.
+     * @param encryptedText The encrypted text the plaintext was decrypted from.
+     * @param plaintext The plaintext.
+     */
+
+    void store(uint64_t id, string_view encryptedText, const SecretText &plaintext);
+
+    // PURGE
+    /**
+     * @brief Wipes every expired plaintext.
+     */
+
+    void purgeExpired();
+
+    // CLEAR
+    /**
+     * @brief Wipes every cached plaintext.
+     */
+
+    void clear();
+};
+
+#endif //PASSWORDMANAGER_REVEALCACHE_H
@@ -0,0 +1,80 @@
+/**
+ * @file SearchCache.cpp
+ * @brief Implementation of the generation-stamped LRU search cache.
+ */
+
+#include "SearchCache.h"
+using namespace std;
+
+/**
+     * @brief Constructor.
+     * @param capacity Maximum number of results to keep.
+     */
+
+SearchCache::SearchCache(size_t capacity) : capacity(capacity) {}
+
+// FIND
+/**
+     * @brief Returns a cached result if it was computed at the current generation.
+     * @param key Search key.
+     * @param generation Current vault generation.
+     * @param ids Receives the ids of the matching entries on a hit.
+     * @return True on a hit.
+     */
+
+bool SearchCache::find(const string& key, uint64_t generation, vector<uint64_t>& ids) {
+    auto it = lookup.find(key);
+    if (it == lookup.end()) {
+        return false;
+    }
+
+    if (it->second->generation != generation) {
+        // The vault changed since this result was computed
+        entries.erase(it->second);
+        lookup.erase(it);
+        return false;
+    }
+
+    entries.splice(entries.begin(), entries, it->second);
+    ids = it->second->ids;
+    return true;
+}
+
+// STORE
+/**
+     * @brief Caches a result as the most recently used one.
+     * @param key Search key.
+     * @param generation Vault generation the result was computed at.
+     * @param ids Ids of the matching entries.
+     */
+
+void SearchCache::store(const string& key, uint64_t generation, const vector<uint64_t>& ids) {
+    if (capacity == 0) {
+        return;
+    }
+
+    auto it = lookup.find(key);
+    if (it != lookup.end()) {
+        it->second->generation = generation;
+        it->second->ids = ids;
+        entries.splice(entries.begin(), entries, it->second);
+        return;
+    }
+
+    if (entries.size() >= capacity) {
+        lookup.erase(entries.back().key);
+        entries.pop_back();
+    }
+    entries.push_front({key, generation, ids});
+    lookup[key] = entries.begin();
+}
+
+// CLEAR
+/**
+     * @brief Drops every cached result.
+     */
+
+void SearchCache::clear() {
+    entries.clear();
+    lookup.clear();
+}
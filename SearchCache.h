@@ -0,0 +1,78 @@
+#ifndef PASSWORDMANAGER_SEARCHCACHE_H
+#define PASSWORDMANAGER_SEARCHCACHE_H
+
+#include <cstdint>
+#include <list>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+/**
+ * @file SearchCache.h
+ * @brief LRU cache of search results stamped with the vault generation.
+ */
+
+/**
+ * @brief Least-recently-used cache mapping a search key to the ids of the matching entries.
+ *
+ * Every result is stored with the vault generation it was computed at.
+ * A lookup with a different generation treats the result as stale and drops it,
+ * so a result is never served after the vault has changed.
+ */
+
+class SearchCache {
+private:
+    /**
+     * @brief A cached search result.
+     */
+
+    struct Entry {
+        string key;             /**< Search key the result belongs to. */
+        uint64_t generation;    /**< Vault generation the result was computed at. */
+        vector<uint64_t> ids;   /**< Ids of the matching entries. */
+    };
+
+    size_t capacity;                                        /**< Maximum number of cached results. */
+    list<Entry> entries;                                    /**< Results, most recently used first. */
+    unordered_map<string, list<Entry>::iterator> lookup;    /**< Key to position in entries. */
+
+public:
+
+    /**
+     * @brief Constructor for SearchCache class.
+     * @param capacity Maximum number of results to keep.
+     */
+
+    explicit SearchCache(size_t capacity = 64);
+
+    // FIND
+    /**
+     * @brief Looks up a cached result.
+     * @param key Search key.
+     * @param generation Current vault generation.
+     * @param ids Receives the ids of the matching entries on a hit.
+     * @return True if a result computed at this generation was found.
+     */
+
+    bool find(const string &key, uint64_t generation, vector<uint64_t> &ids);
+
+    // STORE
+    /**
+     * @brief Caches a result, evicting the least recently used one when full.
+     * @param key Search key.
+     * @param generation Vault generation the result was computed at.
+     * @param ids Ids of the matching entries.
+     */
+
+    void store(const string &key, uint64_t generation, const vector<uint64_t> &ids);
+
+    // CLEAR
+    /**
+     * @brief Drops every cached result.
+     */
+
+    void clear();
+};
+
+#endif //PASSWORDMANAGER_SEARCHCACHE_H
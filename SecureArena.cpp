@@ -0,0 +1,574 @@
+/**
+ * @file SecureArena.cpp
+ * @brief Implementation of the locked secret arena and SecretText.
+ */
+
+#include "SecureArena.h"
+#include "Crypto.h"
+#include <algorithm>
+#include <bit>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Gets the size class serving a request; SIZE_MAX for blocks with pages of their own.
+ */
+
+size_t sizeClass(size_t size) {
+    if (size > SecureArena::largestClass) {
+        return SIZE_MAX;
+    }
+    return size <= 16 ? 0 : bit_width(size - 1) - 4;
+}
+
+/**
+ * @brief Rounds a size up to whole pages.
+ */
+
+size_t wholePages(size_t size) {
+    size_t page = lockedPageSize();
+    return (size + page - 1) / page * page;
+}
+
+/**
+ * @brief Stops the program when the system is out of memory for secrets.
+ */
+
+[[noreturn]] void outOfSecureMemory() {
+    cerr << "Error: Unable To Allocate Memory For Secrets!" << endl;
+    abort();
+}
+
+} // namespace
+
+// LOCKED PAGES
+/**
+     * @brief Gets the page size of the system.
+     * @return The page size in bytes.
+     */
+
+size_t lockedPageSize() {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwPageSize;
+#else
+    return static_cast<size_t>(sysconf(_SC_PAGESIZE));
+#endif
+}
+
+/**
+     * @brief Maps private pages and locks them in RAM where the system allows it.
+     * @param size Number of bytes.
+     * @param locked Receives whether mlock or VirtualLock succeeded.
+     * @return The pages, or nullptr.
+     */
+
+uint8_t* mapLockedPages(size_t size, bool& locked) {
+    uint8_t* pages = nullptr;
+    locked = false;
+#if defined(_WIN32)
+    pages = static_cast<uint8_t*>(VirtualAlloc(nullptr, size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+    if (pages) {
+        locked = VirtualLock(pages, size) != 0;
+    }
+#else
+    void* mapping = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    pages = mapping == MAP_FAILED ? nullptr : static_cast<uint8_t*>(mapping);
+    if (pages) {
+        locked = mlock(pages, size) == 0;
+#ifdef MADV_DONTDUMP
+        madvise(pages, size, MADV_DONTDUMP);
+#endif
+    }
+#endif
+    return pages;
+}
+
+/**
+     * @brief Wipes the pages, then unlocks and releases them.
+     * @param pages The pages.
+     * @param size Number of bytes.
+     * @param locked Whether the pages were locked.
+     */
+
+void unmapLockedPages(uint8_t* pages, size_t size, bool locked) {
+    secureZero(pages, size);
+#if defined(_WIN32)
+    if (locked) {
+        VirtualUnlock(pages, size);
+    }
+    VirtualFree(pages, 0, MEM_RELEASE);
+#else
+    if (locked) {
+        munlock(pages, size);
+    }
+    munmap(pages, size);
+#endif
+}
+
+// INSTANCE
+/**
+     * @brief Gets the arena of the process, created on first use and never destroyed.
+     * @return The arena.
+     */
+
+SecureArena& SecureArena::instance() {
+    static SecureArena* arena = new SecureArena();
+    return *arena;
+}
+
+/**
+     * @brief Gets the block size serving a request.
+     * @param size Requested bytes.
+     * @return The size class, or whole pages above the largest class.
+     */
+
+size_t SecureArena::blockSize(size_t size) {
+    size_t index = sizeClass(size);
+    return index == SIZE_MAX ? wholePages(size) : size_t(16) << index;
+}
+
+// THREAD CACHE
+/**
+ * @brief Destructor.
+ * Returns the blocks of the ending thread to the arena.
+ */
+
+SecureArena::ThreadCache::~ThreadCache() {
+    for (size_t index = 0; index < classCount; index++) {
+        SecureArena::instance().drain(index, *this, 0);
+    }
+}
+
+/**
+     * @brief Gets the cache of the calling thread.
+     * @return The cache.
+     */
+
+SecureArena::ThreadCache& SecureArena::threadCache() {
+    thread_local ThreadCache cache;
+    return cache;
+}
+
+/**
+     * @brief Moves up to a batch of free blocks into the cache, cutting the rest from the newest chunk.
+     * @param index The size class.
+     * @param cache The cache.
+     */
+
+void SecureArena::refill(size_t index, ThreadCache& cache) {
+    size_t block = size_t(16) << index;
+    lock_guard<mutex> lock(guard);
+    for (size_t i = 0; i < batchSize; i++) {
+        FreeBlock* head = freeLists[index];
+        if (head) {
+            freeLists[index] = head->next;
+        } else {
+            if (chunkRemaining < block) {
+                // The tail of the old chunk is left unused; chunks are never returned, so nothing is lost for good
+                bool locked;
+                chunk = mapLockedPages(chunkSize, locked);
+                if (!chunk) {
+                    outOfSecureMemory();
+                }
+                allLocked = allLocked && locked;
+                mapped += chunkSize;
+                chunkRemaining = chunkSize;
+            }
+            head = reinterpret_cast<FreeBlock*>(chunk);
+            chunk += block;
+            chunkRemaining -= block;
+        }
+        head->next = cache.lists[index];
+        cache.lists[index] = head;
+        cache.counts[index]++;
+        inUse += block;
+    }
+}
+
+/**
+     * @brief Moves blocks from the cache back to the free list of the arena.
+     * @param index The size class.
+     * @param cache The cache.
+     * @param keep Number of blocks left in the cache.
+     */
+
+void SecureArena::drain(size_t index, ThreadCache& cache, size_t keep) {
+    lock_guard<mutex> lock(guard);
+    while (cache.counts[index] > keep) {
+        FreeBlock* head = cache.lists[index];
+        cache.lists[index] = head->next;
+        cache.counts[index]--;
+        head->next = freeLists[index];
+        freeLists[index] = head;
+        inUse -= size_t(16) << index;
+    }
+}
+
+// ALLOCATE
+/**
+     * @brief Pops a block from the thread cache, refilling it from the arena when it is empty.
+     * @param size Requested bytes.
+     * @return The block.
+     */
+
+void* SecureArena::allocate(size_t size) {
+    size_t index = sizeClass(size);
+    if (index == SIZE_MAX) {
+        // Large secrets are rare; give them pages of their own
+        bool locked;
+        uint8_t* pages = mapLockedPages(wholePages(size), locked);
+        if (!pages) {
+            outOfSecureMemory();
+        }
+        lock_guard<mutex> lock(guard);
+        allLocked = allLocked && locked;
+        mapped += wholePages(size);
+        inUse += wholePages(size);
+        return pages;
+    }
+
+    ThreadCache& cache = threadCache();
+    if (!cache.lists[index]) {
+        refill(index, cache);
+    }
+    FreeBlock* head = cache.lists[index];
+    cache.lists[index] = head->next;
+    cache.counts[index]--;
+    head->next = nullptr;
+    return head;
+}
+
+// DEALLOCATE
+/**
+     * @brief Wipes the used bytes of a block and pushes it on the thread cache, draining the cache when it is full.
+     * @param block The block.
+     * @param size The requested size.
+     * @param used Bytes that may be non-zero.
+     */
+
+void SecureArena::deallocate(void* block, size_t size, size_t used) {
+    size_t index = sizeClass(size);
+    if (index == SIZE_MAX) {
+        // Unlocking pages the system refused to lock is harmless
+        unmapLockedPages(static_cast<uint8_t*>(block), wholePages(size), true);
+        lock_guard<mutex> lock(guard);
+        mapped -= wholePages(size);
+        inUse -= wholePages(size);
+        return;
+    }
+
+    // Only the bytes that were written can hold a secret; the rest of the block is still zero
+    secureZero(block, max(used, sizeof(FreeBlock)));
+    ThreadCache& cache = threadCache();
+    FreeBlock* head = static_cast<FreeBlock*>(block);
+    head->next = cache.lists[index];
+    cache.lists[index] = head;
+    if (++cache.counts[index] > 2 * batchSize) {
+        drain(index, cache, batchSize);
+    }
+}
+
+// STATISTICS
+/**
+     * @brief Gets the bytes of pages mapped.
+     * @return The mapped bytes.
+     */
+
+size_t SecureArena::mappedBytes() const {
+    lock_guard<mutex> lock(guard);
+    return mapped;
+}
+
+/**
+     * @brief Gets the bytes of blocks handed out.
+     * @return The bytes in use.
+     */
+
+size_t SecureArena::bytesInUse() const {
+    lock_guard<mutex> lock(guard);
+    return inUse;
+}
+
+/**
+     * @brief Checks whether every page is locked.
+     * @return True if no lock request was refused.
+     */
+
+bool SecureArena::isLocked() const {
+    lock_guard<mutex> lock(guard);
+    return allLocked;
+}
+
+// SECRET TEXT
+/**
+     * @brief Constructor.
+     * @param text Text to copy.
+     */
+
+SecretText::SecretText(string_view text) {
+    append(text);
+}
+
+/**
+     * @brief Constructor.
+     * @param text Text to copy.
+     */
+
+SecretText::SecretText(const string& text) : SecretText(string_view(text)) {}
+
+/**
+     * @brief Constructor.
+     * @param text Zero-terminated text to copy.
+     */
+
+SecretText::SecretText(const char* text) : SecretText(string_view(text)) {}
+
+/**
+     * @brief Copy constructor; the copy gets a block of its own.
+     * @param other The text to copy.
+     */
+
+SecretText::SecretText(const SecretText& other) : SecretText(string_view(other)) {}
+
+/**
+     * @brief Move constructor; takes over the block.
+     * @param other The text to move; left empty.
+     */
+
+SecretText::SecretText(SecretText&& other) noexcept
+    : bytes(other.bytes), length(other.length), capacity(other.capacity) {
+    other.bytes = nullptr;
+    other.length = 0;
+    other.capacity = 0;
+}
+
+/**
+     * @brief Copy assignment; reuses the block when it is large enough.
+     * @param other The text to copy.
+     * @return This text.
+     */
+
+SecretText& SecretText::operator=(const SecretText& other) {
+    return *this = string_view(other);
+}
+
+/**
+     * @brief Move assignment; wipes the current text and takes over the block.
+     * @param other The text to move; left empty.
+     * @return This text.
+     */
+
+SecretText& SecretText::operator=(SecretText&& other) noexcept {
+    if (this != &other) {
+        release();
+        swap(bytes, other.bytes);
+        swap(length, other.length);
+        swap(capacity, other.capacity);
+    }
+    return *this;
+}
+
+/**
+     * @brief Replaces the text.
+     * @param text The new text.
+     * @return This text.
+     */
+
+SecretText& SecretText::operator=(string_view text) {
+    if (bytes && text.data() >= bytes && text.data() <= bytes + length) {
+        // Assigning a part of this text to itself
+        SecretText copy(text);
+        return *this = std::move(copy);
+    }
+    clear();
+    return append(text);
+}
+
+/**
+     * @brief Replaces the text.
+     * @param text The new text.
+     * @return This text.
+     */
+
+SecretText& SecretText::operator=(const string& text) {
+    return *this = string_view(text);
+}
+
+/**
+     * @brief Replaces the text.
+     * @param text The new zero-terminated text.
+     * @return This text.
+     */
+
+SecretText& SecretText::operator=(const char* text) {
+    return *this = string_view(text);
+}
+
+/**
+ * @brief Destructor.
+ * Wipes the text and returns its block to the arena.
+ */
+
+SecretText::~SecretText() {
+    release();
+}
+
+/**
+     * @brief Moves the text to a larger block, wiping the old one.
+     * @param minimum Required capacity.
+     */
+
+void SecretText::grow(size_t minimum) {
+    size_t wanted = max(minimum + 1, capacity * 2 + 2);
+    size_t block = SecureArena::blockSize(wanted);
+    char* larger = static_cast<char*>(SecureArena::instance().allocate(block));
+    if (bytes) {
+        memcpy(larger, bytes, length);
+        SecureArena::instance().deallocate(bytes, capacity + 1, length + 1);
+    }
+    bytes = larger;
+    capacity = block - 1;
+}
+
+/**
+     * @brief Wipes the text and returns the block.
+     */
+
+void SecretText::release() {
+    if (bytes) {
+        SecureArena::instance().deallocate(bytes, capacity + 1, length + 1);
+    }
+    bytes = nullptr;
+    length = 0;
+    capacity = 0;
+}
+
+/**
+     * @brief Gets the text.
+     * @return The zero-terminated text; "" if nothing was stored.
+     */
+
+const char* SecretText::data() const {
+    return bytes ? bytes : "";
+}
+
+/**
+     * @brief Gets the text for writing.
+     * @return The text; nullptr if nothing was stored.
+     */
+
+char* SecretText::data() {
+    return bytes;
+}
+
+/**
+     * @brief Gets the length.
+     * @return Number of bytes.
+     */
+
+size_t SecretText::size() const {
+    return length;
+}
+
+/**
+     * @brief Checks for empty text.
+     * @return True if empty.
+     */
+
+bool SecretText::empty() const {
+    return length == 0;
+}
+
+/**
+     * @brief Changes the length; cut-off bytes are wiped and new bytes are zero.
+     * @param size The new length.
+     */
+
+void SecretText::resize(size_t size) {
+    if (size > capacity) {
+        grow(size);
+    }
+    if (size < length) {
+        secureZero(bytes + size, length - size);
+    } else if (bytes) {
+        memset(bytes + length, 0, size - length);
+    }
+    length = size;
+}
+
+/**
+     * @brief Grows the block ahead of appends.
+     * @param size The length to make room for.
+     */
+
+void SecretText::reserve(size_t size) {
+    if (size > capacity) {
+        grow(size);
+    }
+}
+
+/**
+     * @brief Wipes the text and keeps the block.
+     */
+
+void SecretText::clear() {
+    resize(0);
+}
+
+/**
+     * @brief Appends text, growing the block if needed.
+     * @param text Text to append.
+     * @return This text.
+     */
+
+SecretText& SecretText::append(string_view text) {
+    if (text.empty()) {
+        return *this;
+    }
+    if (length + text.size() > capacity) {
+        if (bytes && text.data() >= bytes && text.data() <= bytes + length) {
+            // Appending a part of this text; copy it before the block moves
+            SecretText copy(text);
+            return append(copy);
+        }
+        grow(length + text.size());
+    }
+    memcpy(bytes + length, text.data(), text.size());
+    length += text.size();
+    bytes[length] = '\0';
+    return *this;
+}
+
+/**
+     * @brief Finds a substring.
+     * @param text The substring.
+     * @param position Where to start.
+     * @return Position of the match, or npos.
+     */
+
+size_t SecretText::find(string_view text, size_t position) const {
+    return string_view(*this).find(text, position);
+}
+
+/**
+     * @brief Views the text.
+     * @return A view of the text.
+     */
+
+SecretText::operator string_view() const {
+    return string_view(data(), length);
+}
@@ -0,0 +1,333 @@
+#ifndef PASSWORDMANAGER_SECUREARENA_H
+#define PASSWORDMANAGER_SECUREARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <string_view>
+using namespace std;
+
+/**
+ * @file SecureArena.h
+ * @brief Locked, zeroizing memory for plaintext secrets.
+ */
+
+// LOCKED PAGES
+/**
+ * @brief Gets the size of a memory page, the unit pages are locked in.
+ * @return The page size in bytes.
+ */
+
+size_t lockedPageSize();
+
+/**
+ * @brief Maps private pages and asks the system to keep them in RAM and out of core dumps.
+ * @param size Number of bytes; a multiple of the page size.
+ * @param locked Receives whether the pages could be locked in RAM.
+ * @return The zeroed pages, or nullptr if they could not be mapped.
+ */
+
+uint8_t *mapLockedPages(size_t size, bool &locked);
+
+/**
+ * @brief Wipes, unlocks and releases pages from mapLockedPages.
+ * @param pages The pages.
+ * @param size Number of bytes mapped.
+ * @param locked Whether the pages were locked.
+ */
+
+void unmapLockedPages(uint8_t *pages, size_t size, bool locked);
+
+/**
+ * @brief Pool of small blocks carved out of locked pages, shared by every secret in the process.
+ *
+ * Blocks come in power-of-two size classes from 16 to 4096 bytes. Each class
+ * keeps a free list, and new blocks are cut from 64 KiB chunks of locked
+ * pages, so one mapping serves thousands of passwords. Every thread keeps a
+ * small cache per class that it refills and drains in batches, so most
+ * allocations and frees are a pointer pop or push without taking the lock.
+ * Larger blocks get pages of their own.
+ * Every block is handed out zeroed: freed blocks are wiped before they go
+ * back on a free list.
+ *
+ * The arena is never destroyed, so secrets held by static objects can still
+ * be released while the program exits.
+ */
+
+class SecureArena {
+private:
+    /**
+     * @brief A free block, linked through its first bytes.
+     */
+
+    struct FreeBlock {
+        FreeBlock *next;    /**< Next free block of the same class. */
+    };
+
+    static const size_t classCount = 9;     /**< Size classes 16, 32, ..., 4096. */
+    static const size_t batchSize = 32;     /**< Blocks moved between a thread cache and the arena at a time. */
+
+    /**
+     * @brief Free blocks a thread keeps for itself; returned to the arena when the thread ends.
+     */
+
+    struct ThreadCache {
+        FreeBlock *lists[classCount] = {};  /**< Free blocks of each size class. */
+        size_t counts[classCount] = {};     /**< Number of blocks in each list. */
+
+        ~ThreadCache();
+    };
+
+    FreeBlock *freeLists[classCount] = {};  /**< Free blocks of each size class. */
+    uint8_t *chunk = nullptr;               /**< Unused tail of the newest chunk. */
+    size_t chunkRemaining = 0;              /**< Bytes left in the newest chunk. */
+    size_t mapped = 0;                      /**< Bytes of pages mapped for the arena. */
+    size_t inUse = 0;                       /**< Bytes of blocks handed out or held by thread caches. */
+    bool allLocked = true;                  /**< Whether every page was locked in RAM. */
+    mutable mutex guard;                    /**< Serializes allocations from worker threads. */
+
+    SecureArena() = default;
+
+    /**
+     * @brief Gets the cache of the calling thread.
+     * @return The cache.
+     */
+
+    static ThreadCache &threadCache();
+
+    /**
+     * @brief Moves a batch of blocks of one class into a thread cache, cutting new ones if needed.
+     * @param index The size class.
+     * @param cache The cache to fill.
+     */
+
+    void refill(size_t index, ThreadCache &cache);
+
+    /**
+     * @brief Moves blocks of one class from a thread cache back to the arena.
+     * @param index The size class.
+     * @param cache The cache to drain.
+     * @param keep Number of blocks the cache keeps.
+     */
+
+    void drain(size_t index, ThreadCache &cache, size_t keep);
+
+public:
+    static const size_t chunkSize = 64 * 1024;  /**< Bytes mapped at a time for small blocks. */
+    static const size_t largestClass = 4096;    /**< Largest block served from a size class. */
+
+    SecureArena(const SecureArena &) = delete;
+    SecureArena &operator=(const SecureArena &) = delete;
+
+    /**
+     * @brief Gets the arena of the process.
+     * @return The arena.
+     */
+
+    static SecureArena &instance();
+
+    /**
+     * @brief Gets the usable size of the block allocate() returns for a request.
+     * @param size Requested bytes.
+     * @return The size of the block.
+     */
+
+    static size_t blockSize(size_t size);
+
+    // ALLOCATE
+    /**
+     * @brief Allocates a block of at least the given size.
+     * @param size Requested bytes; at least 1.
+     * @return The block, filled with zeroes.
+     */
+
+    void *allocate(size_t size);
+
+    // DEALLOCATE
+    /**
+     * @brief Wipes a block and returns it to the pool.
+     * @param block The block.
+     * @param size The size it was requested with.
+     * @param used Number of leading bytes that may be non-zero; the rest of the block must be zero.
+     */
+
+    void deallocate(void *block, size_t size, size_t used);
+
+    // STATISTICS
+    /**
+     * @brief Gets the number of bytes of locked pages mapped so far.
+     * @return The mapped bytes.
+     */
+
+    size_t mappedBytes() const;
+
+    /**
+     * @brief Gets the number of bytes handed out, counting blocks cached by threads as in use.
+     * @return The bytes in use.
+     */
+
+    size_t bytesInUse() const;
+
+    /**
+     * @brief Checks whether the system agreed to lock every page in RAM.
+     * @return False once the locked-memory limit was reached.
+     */
+
+    bool isLocked() const;
+};
+
+/**
+ * @brief A string of plaintext secret bytes kept in the secure arena.
+ *
+ * Unlike std::string there is no small-string buffer, so even a short
+ * password never lands in ordinary heap or stack memory, and every copy and
+ * every buffer it outgrows is wiped when released.
+ */
+
+class SecretText {
+private:
+    char *bytes = nullptr;      /**< Zero-terminated text in the arena; null until something is stored. */
+    size_t length = 0;          /**< Number of bytes of text. */
+    size_t capacity = 0;        /**< Bytes the block can hold, excluding the terminator. */
+
+    /**
+     * @brief Moves the text to a block of at least the given capacity.
+     * @param minimum Required capacity.
+     */
+
+    void grow(size_t minimum);
+
+    /**
+     * @brief Wipes and frees the block.
+     */
+
+    void release();
+
+public:
+    static const size_t npos = string_view::npos;   /**< Returned by find when nothing matches. */
+
+    /**
+     * @brief Constructor for SecretText class; the text starts empty.
+     */
+
+    SecretText() = default;
+
+    /**
+     * @brief Constructor for SecretText class.
+     * @param text Text to copy into the arena.
+     */
+
+    SecretText(string_view text);
+
+    /**
+     * @brief Constructor for SecretText class.
+     * @param text Text to copy into the arena.
+     */
+
+    SecretText(const string &text);
+
+    /**
+     * @brief Constructor for SecretText class.
+     * @param text Zero-terminated text to copy into the arena.
+     */
+
+    SecretText(const char *text);
+
+    SecretText(const SecretText &other);
+    SecretText(SecretText &&other) noexcept;
+    SecretText &operator=(const SecretText &other);
+    SecretText &operator=(SecretText &&other) noexcept;
+    SecretText &operator=(string_view text);
+    SecretText &operator=(const string &text);
+    SecretText &operator=(const char *text);
+
+    /**
+     * @brief Destructor; wipes and frees the text.
+     */
+
+    ~SecretText();
+
+    /**
+     * @brief Gets the text bytes.
+     * @return Pointer to the zero-terminated text.
+     */
+
+    const char *data() const;
+
+    /**
+     * @brief Gets the text bytes for writing.
+     * @return Pointer to the text.
+     */
+
+    char *data();
+
+    /**
+     * @brief Gets the length of the text.
+     * @return Number of bytes.
+     */
+
+    size_t size() const;
+
+    /**
+     * @brief Checks whether the text is empty.
+     * @return True if the text has no bytes.
+     */
+
+    bool empty() const;
+
+    /**
+     * @brief Changes the length of the text; new bytes are zero.
+     * @param size The new length.
+     */
+
+    void resize(size_t size);
+
+    /**
+     * @brief Makes room for text of the given length without changing the text.
+     * @param size The length to make room for.
+     */
+
+    void reserve(size_t size);
+
+    /**
+     * @brief Wipes the text; the block is kept for reuse.
+     */
+
+    void clear();
+
+    /**
+     * @brief Appends text.
+     * @param text Text to append.
+     * @return This text.
+     */
+
+    SecretText &append(string_view text);
+
+    /**
+     * @brief Finds the first occurrence of a substring.
+     * @param text The substring.
+     * @param position Where to start.
+     * @return Position of the match, or npos.
+     */
+
+    size_t find(string_view text, size_t position = 0) const;
+
+    /**
+     * @brief Views the text without copying it.
+     * @return A view of the text.
+     */
+
+    operator string_view() const;
+
+    friend bool operator==(const SecretText &a, string_view b) {
+        return string_view(a) == b;
+    }
+
+    friend ostream &operator<<(ostream &out, const SecretText &text) {
+        return out.write(text.data(), static_cast<streamsize>(text.size()));
+    }
+};
+
+#endif //PASSWORDMANAGER_SECUREARENA_H
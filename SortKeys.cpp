@@ -0,0 +1,390 @@
+/**
+ * @file SortKeys.cpp
+ * @brief Implementation of sort specification parsing and the packed-prefix multi-key sort.
+ */
+
+#include "SortKeys.h"
+#include "DataStorage.h"
+#include "WorkerPool.h"
+#include <algorithm>
+#include <sstream>
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Returns the folded column a sort field refers to.
+ */
+
+const string& fieldOf(const SearchColumns& columns, SortField field) {
+    switch (field) {
+        case SortField::Category: return columns.category;
+        case SortField::Website: return columns.host;
+        case SortField::Login: return columns.login;
+        case SortField::Name:
+        default: return columns.name;
+    }
+}
+
+/**
+ * @brief Whether a field is a number that its packed key represents exactly.
+ */
+
+bool isTimeField(SortField field) {
+    return field == SortField::Created || field == SortField::Modified;
+}
+
+/**
+ * @brief Packs the sort key of one field; times are packed exactly.
+ */
+
+uint64_t prefixOf(const SearchColumns& columns, SortField field) {
+    if (isTimeField(field)) {
+        // Flip the sign bit so signed times order correctly as unsigned integers
+        int64_t time = field == SortField::Created ? columns.created : columns.modified;
+        return static_cast<uint64_t>(time) ^ (uint64_t(1) << 63);
+    }
+    return packPrefix(fieldOf(columns, field));
+}
+
+/**
+ * @brief Packs bytes 8 to 15 of a string the way packPrefix packs the first eight; 0 for times.
+ */
+
+uint64_t tailOf(const SearchColumns& columns, SortField field) {
+    if (isTimeField(field)) {
+        return 0;
+    }
+    const string& text = fieldOf(columns, field);
+    uint64_t tail = 0;
+    for (size_t i = 8; i < 16; i++) {
+        tail = (tail << 8) | (i < text.size() ? static_cast<unsigned char>(text[i]) : 0);
+    }
+    return tail;
+}
+
+/**
+ * @brief Length of a string key as kept for the sort, capped at 17 (longer than both packed words); 0 for times.
+ */
+
+uint8_t lengthOf(const SearchColumns& columns, SortField field) {
+    return isTimeField(field) ? 0 : static_cast<uint8_t>(min<size_t>(fieldOf(columns, field).size(), 17));
+}
+
+/**
+ * @brief Number of keys whose packed prefixes are carried inside the sort records.
+ */
+
+const size_t inlineKeys = 3;
+
+/**
+ * @brief An entry being sorted, carrying the packed prefixes of its leading keys inline.
+ */
+
+struct SortRecord {
+    uint64_t prefix[inlineKeys];    /**< Packed prefixes of the most significant keys. */
+    uint64_t tail[inlineKeys];      /**< Packed bytes 8 to 15 of the same keys. */
+    uint32_t index;                 /**< Position of the entry. */
+    uint8_t lengths[inlineKeys];    /**< Capped lengths of the inline keys (see lengthOf). */
+};
+
+/**
+ * @brief Items per chunk when the sort records are built on the pool.
+ */
+
+const size_t recordChunk = 4096;
+
+/**
+ * @brief Runs body(begin, end) over [0, count) in chunks on the pool, or in one call without one.
+ */
+
+void parallelFor(WorkerPool* pool, size_t count, size_t chunk, const function<void(size_t, size_t)>& body) {
+    if (pool) {
+        pool->parallelFor(count, chunk, body);
+    } else if (count > 0) {
+        body(0, count);
+    }
+}
+
+/**
+ * @brief Finds how many elements of a come first when merging the first `rank` outputs of a and b.
+ *
+ * Ties are taken from a first, matching std::merge.
+ */
+
+template <typename Iterator, typename Less>
+size_t coRank(size_t rank, Iterator a, size_t sizeA, Iterator b, size_t sizeB, const Less& less) {
+    size_t low = rank > sizeB ? rank - sizeB : 0;
+    size_t high = min(rank, sizeA);
+    while (low < high) {
+        size_t i = (low + high) / 2;
+        size_t j = rank - i;
+        if (j > 0 && !less(b[j - 1], a[i])) {
+            low = i + 1;
+        } else {
+            high = i;
+        }
+    }
+    return low;
+}
+
+/**
+ * @brief Parallel merge sort: sorts one run per thread, then merges runs pairwise.
+ *
+ * Every merge is itself split across the threads by co-ranking, so the last
+ * rounds, which have fewer runs than threads, still use every thread.
+ */
+
+template <typename Record, typename Less>
+void parallelSort(vector<Record>& records, const Less& less, WorkerPool& pool) {
+    unsigned threads = pool.size();
+    size_t count = records.size();
+    vector<size_t> bounds;
+    for (unsigned t = 0; t <= threads; t++) {
+        bounds.push_back(count * t / threads);
+    }
+
+    parallelFor(&pool, threads, 1, [&](size_t begin, size_t end) {
+        for (size_t run = begin; run < end; run++) {
+            sort(records.begin() + bounds[run], records.begin() + bounds[run + 1], less);
+        }
+    });
+
+    vector<Record> buffer(count);
+    while (bounds.size() > 2) {
+        vector<size_t> merged;
+        size_t pairs = bounds.size() / 2;
+        unsigned partsPerPair = max<unsigned>(1, threads / pairs);
+
+        parallelFor(&pool, pairs * partsPerPair, 1, [&](size_t begin, size_t end) {
+            for (size_t task = begin; task < end; task++) {
+                size_t pair = task / partsPerPair;
+                size_t part = task % partsPerPair;
+                size_t low = bounds[2 * pair];
+                size_t middle = bounds[2 * pair + 1];
+                size_t high = 2 * pair + 2 < bounds.size() ? bounds[2 * pair + 2] : middle;
+
+                auto a = records.begin() + low;
+                auto b = records.begin() + middle;
+                size_t sizeA = middle - low;
+                size_t sizeB = high - middle;
+                size_t total = sizeA + sizeB;
+                size_t first = total * part / partsPerPair;
+                size_t last = total * (part + 1) / partsPerPair;
+                size_t firstA = coRank(first, a, sizeA, b, sizeB, less);
+                size_t lastA = coRank(last, a, sizeA, b, sizeB, less);
+
+                merge(a + firstA, a + lastA, b + (first - firstA), b + (last - lastA),
+                      buffer.begin() + low + first, less);
+            }
+        });
+
+        for (size_t pair = 0; pair < pairs; pair++) {
+            merged.push_back(bounds[2 * pair]);
+        }
+        merged.push_back(count);
+        records.swap(buffer);
+        bounds = merged;
+    }
+}
+
+} // namespace
+
+// PARSE SORT KEYS
+/**
+     * @brief Parses a comma-separated sort specification.
+     * @param spec The sort specification.
+     * @param keys Receives the parsed keys.
+     * @return True if the specification is valid.
+     */
+
+bool parseSortKeys(const string& spec, vector<SortKey>& keys) {
+    vector<SortKey> parsed;
+    stringstream stream(spec);
+    string part;
+
+    while (getline(stream, part, ',')) {
+        SortKey key;
+        size_t colon = part.find(':');
+        string fieldName = part.substr(0, colon);
+        string direction = colon == string::npos ? "asc" : part.substr(colon + 1);
+
+        if (fieldName == "name") {
+            key.field = SortField::Name;
+        } else if (fieldName == "category") {
+            key.field = SortField::Category;
+        } else if (fieldName == "website") {
+            key.field = SortField::Website;
+        } else if (fieldName == "login") {
+            key.field = SortField::Login;
+        } else if (fieldName == "created") {
+            key.field = SortField::Created;
+        } else if (fieldName == "modified" || fieldName == "timestamp") {
+            key.field = SortField::Modified;
+        } else {
+            return false;
+        }
+
+        if (direction == "desc") {
+            key.descending = true;
+        } else if (direction != "asc") {
+            return false;
+        }
+        parsed.push_back(key);
+    }
+
+    if (parsed.empty()) {
+        return false;
+    }
+    keys = parsed;
+    return true;
+}
+
+// PACK PREFIX
+/**
+     * @brief Packs up to eight leading bytes of a string, big-endian, into an integer.
+     * @param text The string to pack.
+     * @return The packed prefix.
+     */
+
+uint64_t packPrefix(const string& text) {
+    uint64_t prefix = 0;
+    size_t length = min<size_t>(text.size(), 8);
+    for (size_t i = 0; i < 8; i++) {
+        prefix <<= 8;
+        if (i < length) {
+            prefix |= static_cast<unsigned char>(text[i]);
+        }
+    }
+    return prefix;
+}
+
+/**
+     * @brief Orders entry positions by the given keys using precomputed packed prefixes.
+     * @param columns Folded columns of the entries.
+     * @param keys Sort keys, most significant first.
+     * @param limit Number of leading positions wanted; fewer than the entry count selects a partial sort.
+     * @param pool Pool to build the records and sort on, or null for the calling thread only.
+     * @return The first limit positions of the entries in sorted order.
+     */
+
+static vector<size_t> orderEntries(const vector<SearchColumns>& columns, const vector<SortKey>& keys,
+                                   size_t limit, WorkerPool* pool) {
+    size_t count = columns.size();
+    size_t keyCount = keys.size();
+    if (pool && (pool->size() <= 1 || count < pool->size())) {
+        pool = nullptr;
+    }
+
+    // Row-major tables of the first and second eight bytes of every key and of its
+    // capped length; descending keys are inverted so that integer order always
+    // means output order
+    vector<uint64_t> prefixes(count * keyCount);
+    vector<uint64_t> tails(count * keyCount);
+    vector<uint8_t> lengths(count * keyCount);
+    vector<SortRecord> records(count);
+    parallelFor(pool, count, recordChunk, [&](size_t begin, size_t end) {
+        for (size_t i = begin; i < end; i++) {
+            for (size_t k = 0; k < keyCount; k++) {
+                uint64_t prefix = prefixOf(columns[i], keys[k].field);
+                uint64_t tail = tailOf(columns[i], keys[k].field);
+                prefixes[i * keyCount + k] = keys[k].descending ? ~prefix : prefix;
+                tails[i * keyCount + k] = keys[k].descending ? ~tail : tail;
+                lengths[i * keyCount + k] = lengthOf(columns[i], keys[k].field);
+            }
+            records[i] = {};
+            for (size_t k = 0; k < min(keyCount, inlineKeys); k++) {
+                records[i].prefix[k] = prefixes[i * keyCount + k];
+                records[i].tail[k] = tails[i * keyCount + k];
+                records[i].lengths[k] = lengths[i * keyCount + k];
+            }
+            records[i].index = static_cast<uint32_t>(i);
+        }
+    });
+
+    auto less = [&](const SortRecord& a, const SortRecord& b) {
+        for (size_t k = 0; k < keyCount; k++) {
+            // The inline prefixes decide most comparisons without leaving the records
+            bool inlined = k < inlineKeys;
+            size_t slotA = a.index * keyCount + k;
+            size_t slotB = b.index * keyCount + k;
+            uint64_t pa = inlined ? a.prefix[k] : prefixes[slotA];
+            uint64_t pb = inlined ? b.prefix[k] : prefixes[slotB];
+            if (pa != pb) {
+                return pa < pb;
+            }
+            if (isTimeField(keys[k].field)) {
+                continue;
+            }
+
+            // Equal prefixes: the next eight bytes, then the lengths, settle strings of up to 16 bytes
+            uint8_t la = inlined ? a.lengths[k] : lengths[slotA];
+            uint8_t lb = inlined ? b.lengths[k] : lengths[slotB];
+            if (la > 8 || lb > 8) {
+                uint64_t ta = inlined ? a.tail[k] : tails[slotA];
+                uint64_t tb = inlined ? b.tail[k] : tails[slotB];
+                if (ta != tb) {
+                    return ta < tb;
+                }
+            }
+            if (la <= 16 && lb <= 16) {
+                // Both strings fit in the packed words; equal words differ only in trailing NULs
+                if (la != lb) {
+                    return (la < lb) != keys[k].descending;
+                }
+                continue;
+            }
+
+            const string& sa = fieldOf(columns[a.index], keys[k].field);
+            const string& sb = fieldOf(columns[b.index], keys[k].field);
+            int order = sa.compare(sb);
+            if (order != 0) {
+                return (order < 0) != keys[k].descending;
+            }
+        }
+        return a.index < b.index;
+    };
+
+    if (limit < count) {
+        partial_sort(records.begin(), records.begin() + limit, records.end(), less);
+        records.resize(limit);
+    } else if (pool) {
+        parallelSort(records, less, *pool);
+    } else {
+        sort(records.begin(), records.end(), less);
+    }
+
+    vector<size_t> order(records.size());
+    for (size_t i = 0; i < records.size(); i++) {
+        order[i] = records[i].index;
+    }
+    return order;
+}
+
+// SORTED ORDER
+/**
+     * @brief Sorts entry positions by the given keys using precomputed packed prefixes.
+     * @param columns Folded columns of the entries.
+     * @param keys Sort keys, most significant first.
+     * @param pool Pool to sort on, or null for the calling thread only.
+     * @return Positions of the entries in sorted order.
+     */
+
+vector<size_t> sortedOrder(const vector<SearchColumns>& columns, const vector<SortKey>& keys, WorkerPool* pool) {
+    return orderEntries(columns, keys, columns.size(), pool);
+}
+
+// TOP ORDER
+/**
+     * @brief Finds the first positions of the sorted order with a partial sort.
+     * @param columns Folded columns of the entries.
+     * @param keys Sort keys, most significant first.
+     * @param limit Number of positions wanted.
+     * @param pool Pool to build the records on, or null for the calling thread only.
+     * @return Up to limit positions in sorted order.
+     */
+
+vector<size_t> topOrder(const vector<SearchColumns>& columns, const vector<SortKey>& keys, size_t limit,
+                        WorkerPool* pool) {
+    return orderEntries(columns, keys, limit, pool);
+}
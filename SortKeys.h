@@ -0,0 +1,113 @@
+#ifndef PASSWORDMANAGER_SORTKEYS_H
+#define PASSWORDMANAGER_SORTKEYS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+using namespace std;
+
+class SearchColumns;
+class WorkerPool;
+
+/**
+ * @file SortKeys.h
+ * @brief Multi-key sort specifications and the packed-prefix sort used by PasswordKeeper.
+ */
+
+/**
+ * @brief Field of a password entry that can be sorted by.
+ */
+
+enum class SortField {
+    Name,               ///< Sort by name
+    Category,           ///< Sort by category
+    Website,            ///< Sort by website
+    Login,              ///< Sort by login
+    Created,            ///< Sort by creation time
+    Modified            ///< Sort by last modification time
+};
+
+/**
+ * @brief One level of a multi-key sort.
+ */
+
+class SortKey {
+public:
+    SortField field = SortField::Name;  /**< Field to compare. */
+    bool descending = false;            /**< Whether this key sorts in descending order. */
+};
+
+// PARSE SORT KEYS
+/**
+ * @brief Parses a sort specification such as "category,website:desc,name".
+ *
+ * Keys are separated by commas and applied from left to right. Each key is a
+ * field name (name, category, website, login, created, modified; "timestamp"
+ * is an alias of modified), optionally followed by ":asc" or ":desc".
+ *
+ * @param spec The sort specification.
+ * @param keys Receives the parsed keys.
+ * @return True if the specification is valid.
+ */
+
+bool parseSortKeys(const string &spec, vector<SortKey> &keys);
+
+// PACK PREFIX
+/**
+ * @brief Packs the first eight bytes of a string into an integer that orders like the string.
+ * @param text The string to pack.
+ * @return The big-endian packed prefix, zero padded.
+ */
+
+uint64_t packPrefix(const string &text);
+
+/**
+ * @brief Vault size from which PasswordKeeper sorts on its worker pool.
+ */
+
+const size_t parallelSortThreshold = 1 << 17;
+
+// SORTED ORDER
+/**
+ * @brief Computes the order of the entries under a multi-key sort.
+ *
+ * The folded columns are compared, so the order ignores case, and websites are
+ * compared by their normalized host. For every entry
+ * and key, the first sixteen bytes are packed into two integers up front; the
+ * full strings are only compared when both packed words are equal and both
+ * strings are longer than them. Ties keep the storage order, in either
+ * direction; ids are handed out in storage order, so this matches
+ * SortedViews::orderedIds.
+ *
+ * Given a pool, the entries are sorted with a parallel merge sort: each
+ * thread of the pool sorts one run of the index records, and the runs are
+ * merged pairwise with every merge split across the threads. The result is
+ * identical to the serial sort.
+ *
+ * @param columns Folded columns of the entries.
+ * @param keys Sort keys, most significant first.
+ * @param pool Pool to sort on, or null for the calling thread only (see parallelSortThreshold).
+ * @return Positions of the entries in sorted order.
+ */
+
+vector<size_t> sortedOrder(const vector<SearchColumns> &columns, const vector<SortKey> &keys,
+                           WorkerPool *pool = nullptr);
+
+// TOP ORDER
+/**
+ * @brief Computes only the first entries of a multi-key sort.
+ *
+ * Uses the same keys and tie-breaking as sortedOrder, but selects the first
+ * limit entries with a partial sort in O(n log limit) instead of sorting all of them.
+ *
+ * @param columns Folded columns of the entries.
+ * @param keys Sort keys, most significant first.
+ * @param limit Number of entries wanted.
+ * @param pool Pool to pack the keys on, or null for the calling thread only.
+ * @return Positions of at most limit entries, in sorted order.
+ */
+
+vector<size_t> topOrder(const vector<SearchColumns> &columns, const vector<SortKey> &keys, size_t limit,
+                        WorkerPool *pool = nullptr);
+
+#endif //PASSWORDMANAGER_SORTKEYS_H
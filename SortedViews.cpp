@@ -0,0 +1,138 @@
+/**
+ * @file SortedViews.cpp
+ * @brief Implementation of the incrementally maintained sorted views.
+ */
+
+#include "SortedViews.h"
+#include "DataStorage.h"
+#include <iterator>
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Appends up to limit ids of a view after skipping offset, walking the view only that far.
+ */
+
+template <typename Iterator>
+void appendIds(Iterator it, Iterator end, size_t offset, size_t limit, vector<uint64_t>& ids) {
+    for (; it != end && offset > 0; ++it, --offset) {
+    }
+    for (; it != end && limit > 0; ++it, --limit) {
+        ids.push_back(it->second);
+    }
+}
+
+/**
+ * @brief Appends a page of the ids of a view in ascending or descending order.
+ *
+ * Descending order reverses the keys only: each run of equal keys is still
+ * read in ascending id order.
+ */
+
+template <typename View>
+void appendIds(const View& view, bool descending, size_t offset, size_t limit, vector<uint64_t>& ids) {
+    if (!descending) {
+        appendIds(view.begin(), view.end(), offset, limit, ids);
+        return;
+    }
+    auto runEnd = view.end();
+    while (runEnd != view.begin() && limit > 0) {
+        // Ids start at 1, so id 0 finds the first item with the key
+        typename View::value_type first = *prev(runEnd);
+        first.second = 0;
+        auto runBegin = view.lower_bound(first);
+        size_t runSize = static_cast<size_t>(distance(runBegin, runEnd));
+        if (offset >= runSize) {
+            offset -= runSize;
+        } else {
+            size_t before = ids.size();
+            appendIds(runBegin, runEnd, offset, limit, ids);
+            limit -= ids.size() - before;
+            offset = 0;
+        }
+        runEnd = runBegin;
+    }
+}
+
+} // namespace
+
+// INSERT
+/**
+     * @brief Adds an entry to every view.
+     * @param columns Folded columns of the entry.
+     * @param id Identifier of the entry.
+     */
+
+void SortedViews::insert(const SearchColumns& columns, uint64_t id) {
+    byName.emplace(columns.name, id);
+    byCategory.emplace(columns.category, id);
+    byModified.emplace(columns.modified, id);
+}
+
+// ERASE
+/**
+     * @brief Removes an entry from every view.
+     * @param columns Folded columns the entry was inserted with.
+     * @param id Identifier of the entry.
+     */
+
+void SortedViews::erase(const SearchColumns& columns, uint64_t id) {
+    byName.erase({columns.name, id});
+    byCategory.erase({columns.category, id});
+    byModified.erase({columns.modified, id});
+}
+
+// CLEAR
+/**
+     * @brief Empties every view.
+     */
+
+void SortedViews::clear() {
+    byName.clear();
+    byCategory.clear();
+    byModified.clear();
+}
+
+// ORDERED IDS
+/**
+     * @brief Reads the entry ids in the order of a single sort key.
+     * @param key The sort key.
+     * @param ids Receives the ids in sorted order.
+     * @param offset Number of ids to skip.
+     * @param limit Maximum number of ids to read.
+     * @return False if there is no view for the key's field.
+     */
+
+bool SortedViews::orderedIds(const SortKey& key, vector<uint64_t>& ids, size_t offset, size_t limit) const {
+    ids.clear();
+    switch (key.field) {
+        case SortField::Name:
+            appendIds(byName, key.descending, offset, limit, ids);
+            return true;
+        case SortField::Category:
+            appendIds(byCategory, key.descending, offset, limit, ids);
+            return true;
+        case SortField::Modified:
+            appendIds(byModified, key.descending, offset, limit, ids);
+            return true;
+        default:
+            return false;
+    }
+}
+
+// MODIFIED BETWEEN
+/**
+     * @brief Reads the ids of the entries modified within a time range.
+     * @param from Start of the range (inclusive).
+     * @param to End of the range (inclusive).
+     * @param ids Receives the ids, oldest first.
+     */
+
+void SortedViews::modifiedBetween(int64_t from, int64_t to, vector<uint64_t>& ids) const {
+    ids.clear();
+    auto it = byModified.lower_bound({from, 0});
+    for (; it != byModified.end() && it->first <= to; ++it) {
+        ids.push_back(it->second);
+    }
+}
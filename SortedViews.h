@@ -0,0 +1,88 @@
+#ifndef PASSWORDMANAGER_SORTEDVIEWS_H
+#define PASSWORDMANAGER_SORTEDVIEWS_H
+
+#include "SortKeys.h"
+#include <cstdint>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+using namespace std;
+
+class SearchColumns;
+
+/**
+ * @file SortedViews.h
+ * @brief Ordered views of the vault that are kept up to date on every mutation.
+ */
+
+/**
+ * @brief Persistent orderings of the entry ids by name, by category and by modification time.
+ *
+ * Each view is a balanced search tree, so adding, changing or removing an entry
+ * costs O(log n) and reading an ordering costs no sort. The views only hold ids
+ * and keys; the storage order of the vault is never touched.
+ */
+
+class SortedViews {
+private:
+    set<pair<string, uint64_t>> byName;         /**< (folded name, id). */
+    set<pair<string, uint64_t>> byCategory;     /**< (folded category, id). */
+    set<pair<int64_t, uint64_t>> byModified;    /**< (modification time, id). */
+
+public:
+
+    // INSERT
+    /**
+     * @brief Adds an entry to every view.
+     * @param columns Folded columns of the entry.
+     * @param id Identifier of the entry.
+     */
+
+    void insert(const SearchColumns &columns, uint64_t id);
+
+    // ERASE
+    /**
+     * @brief Removes an entry from every view.
+     * @param columns Folded columns the entry was inserted with.
+     * @param id Identifier of the entry.
+     */
+
+    void erase(const SearchColumns &columns, uint64_t id);
+
+    // CLEAR
+    /**
+     * @brief Empties every view.
+     */
+
+    void clear();
+
+    // ORDERED IDS
+    /**
+     * @brief Reads the entry ids in the order of a single sort key.
+     *
+     * Entries with equal keys come in ascending id order in both directions,
+     * which is the storage order sortedOrder breaks ties by. Only the first
+     * offset + limit items of the view are visited.
+     *
+     * @param key The sort key.
+     * @param ids Receives the ids in sorted order.
+     * @param offset Number of ids to skip.
+     * @param limit Maximum number of ids to read.
+     * @return False if there is no view for the key's field.
+     */
+
+    bool orderedIds(const SortKey &key, vector<uint64_t> &ids, size_t offset = 0, size_t limit = SIZE_MAX) const;
+
+    // MODIFIED BETWEEN
+    /**
+     * @brief Reads the ids of the entries modified within a time range, oldest first.
+     * @param from Start of the range, in seconds since the epoch (inclusive).
+     * @param to End of the range, in seconds since the epoch (inclusive).
+     * @param ids Receives the ids.
+     */
+
+    void modifiedBetween(int64_t from, int64_t to, vector<uint64_t> &ids) const;
+};
+
+#endif //PASSWORDMANAGER_SORTEDVIEWS_H
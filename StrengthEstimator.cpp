@@ -0,0 +1,902 @@
+/**
+ * @file StrengthEstimator.cpp
+ * @brief Implementation of the pattern-based password strength estimator.
+ */
+
+#include "StrengthEstimator.h"
+#include "PerfectHash.h"
+#include "Crypto.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iterator>
+#include <span>
+using namespace std;
+
+namespace {
+
+// DICTIONARIES
+/**
+ * @brief Most common passwords, most common first.
+ */
+
+constexpr string_view commonPasswords[] = {
+    "123456", "password", "12345678", "qwerty", "123456789", "12345", "1234", "111111", "1234567", "dragon",
+    "123123", "baseball", "abc123", "football", "monkey", "letmein", "696969", "shadow", "master", "666666",
+    "qwertyuiop", "123321", "mustang", "1234567890", "michael", "654321", "superman", "1qaz2wsx", "7777777",
+    "121212", "000000", "qazwsx", "123qwe", "killer", "trustno1", "jordan", "jennifer", "zxcvbnm", "asdfgh",
+    "hunter", "buster", "soccer", "harley", "batman", "andrew", "tigger", "sunshine", "iloveyou", "2000",
+    "charlie", "robert", "thomas", "hockey", "ranger", "daniel", "starwars", "klaster", "112233", "george",
+    "computer", "michelle", "jessica", "pepper", "1111", "zxcvbn", "555555", "11111111", "131313", "freedom",
+    "777777", "pass", "maggie", "159753", "aaaaaa", "ginger", "princess", "joshua", "cheese", "amanda",
+    "summer", "love", "ashley", "nicole", "chelsea", "biteme", "matthew", "access", "yankees", "987654321",
+    "dallas", "austin", "thunder", "taylor", "matrix", "william", "corvette", "hello", "martin", "heather",
+    "secret", "merlin", "diamond", "1234qwer", "gfhjkm", "hammer", "silver", "222222", "88888888", "anthony",
+    "justin", "test", "bailey", "q1w2e3r4t5", "patrick", "internet", "scooter", "orange", "11111", "golfer",
+    "cookie", "richard", "samantha", "bigdog", "guitar", "jackson", "whatever", "mickey", "chicken", "sparky",
+    "snoopy", "maverick", "phoenix", "camaro", "peanut", "morgan", "welcome", "falcon", "cowboy", "ferrari",
+    "samsung", "andrea", "smokey", "steelers", "joseph", "mercedes", "dakota", "arsenal", "eagles", "melissa",
+    "boomer", "booboo", "spider", "nascar", "monster", "tigers", "yellow", "xxxxxx", "123123123", "gateway",
+    "marina", "diablo", "bulldog", "qwer1234", "compaq", "purple", "banana", "junior", "hannah", "123654",
+    "porsche", "lakers", "iceman", "money", "cowboys", "987654", "london", "tennis", "999999", "ncc1701",
+    "coffee", "scooby", "0000", "miller", "boston", "q1w2e3r4", "brandon", "yamaha", "chester", "mother",
+    "forever", "johnny", "edward", "333333", "oliver", "redsox", "player", "nikita", "knight", "fender",
+    "barney", "midnight", "please", "brandy", "chicago", "badboy", "slayer", "rangers", "charles", "angel",
+    "flower", "rabbit", "wizard", "jasper", "enter", "rachel", "chris", "steven", "winner", "adidas",
+    "victoria", "natasha", "1q2w3e4r", "jasmine", "winter", "prince", "marine", "ghbdtn", "fishing", "cocacola",
+    "casper", "james", "232323", "raiders", "888888", "marlboro", "gandalf", "asdfasdf", "crystal", "87654321",
+    "12344321", "golden", "8675309", "admin", "welcome1", "password1", "passw0rd", "qwerty123", "1q2w3e",
+    "letmein1", "login", "zaq12wsx", "qazwsxedc", "trustme", "changeme", "default", "guest", "root", "toor",
+    "administrator", "abcdef", "abcd1234", "aa123456", "iloveu", "lovely", "babygirl", "sunflower", "butterfly",
+    "qwertyui", "asdfghjkl", "zxcvbnm123", "pokemon", "minecraft", "liverpool", "juventus", "barcelona"
+};
+
+/**
+ * @brief Common English words, most common first.
+ */
+
+constexpr string_view englishWords[] = {
+    "the", "and", "you", "that", "was", "for", "are", "with", "his", "they", "this", "have", "from", "one",
+    "had", "word", "but", "not", "what", "all", "were", "when", "your", "can", "said", "there", "use", "each",
+    "which", "she", "how", "their", "will", "other", "about", "out", "many", "then", "them", "these", "some",
+    "her", "would", "make", "like", "him", "into", "time", "has", "look", "two", "more", "write", "see",
+    "number", "way", "could", "people", "than", "first", "water", "been", "call", "who", "oil", "its", "now",
+    "find", "long", "down", "day", "did", "get", "come", "made", "may", "part", "over", "new", "sound",
+    "take", "only", "little", "work", "know", "place", "year", "live", "back", "give", "most", "very",
+    "after", "thing", "our", "just", "name", "good", "sentence", "man", "think", "say", "great", "where",
+    "help", "through", "much", "before", "line", "right", "too", "mean", "old", "any", "same", "tell", "boy",
+    "follow", "came", "want", "show", "also", "around", "form", "three", "small", "set", "put", "end",
+    "does", "another", "well", "large", "must", "big", "even", "such", "because", "turn", "here", "why",
+    "ask", "went", "men", "read", "need", "land", "different", "home", "move", "try", "kind", "hand",
+    "picture", "again", "change", "off", "play", "spell", "air", "away", "animal", "house", "point", "page",
+    "letter", "mother", "answer", "found", "study", "still", "learn", "should", "world", "high", "every",
+    "near", "add", "food", "between", "own", "below", "country", "plant", "last", "school", "father", "keep",
+    "tree", "never", "start", "city", "earth", "eye", "light", "thought", "head", "under", "story", "saw",
+    "left", "few", "while", "along", "might", "close", "something", "seem", "next", "hard", "open",
+    "example", "begin", "life", "always", "those", "both", "paper", "together", "got", "group", "often",
+    "run", "important", "until", "children", "side", "feet", "car", "mile", "night", "walk", "white", "sea",
+    "began", "grow", "took", "river", "four", "carry", "state", "once", "book", "hear", "stop", "without",
+    "second", "later", "miss", "idea", "enough", "eat", "face", "watch", "far", "indian", "really", "almost",
+    "let", "above", "girl", "sometimes", "mountain", "cut", "young", "talk", "soon", "list", "song", "being",
+    "leave", "family", "love", "baby", "angel", "sun", "star", "moon", "sky", "fire", "ice", "snow", "rain",
+    "storm", "thunder", "lightning", "rainbow", "flower", "rose", "heart", "soul", "dream", "magic", "power",
+    "dragon", "tiger", "lion", "wolf", "bear", "eagle", "horse", "dog", "cat", "kitty", "puppy", "monkey",
+    "fish", "bird", "butterfly", "dolphin", "shadow", "secret", "silver", "gold", "golden", "diamond",
+    "crystal", "black", "blue", "red", "green", "yellow", "purple", "orange", "pink", "brown", "apple",
+    "banana", "cherry", "cookie", "chocolate", "candy", "sugar", "honey", "sweet", "happy", "lucky", "crazy",
+    "funny", "pretty", "cool", "hot", "cold", "summer", "winter", "spring", "autumn", "morning", "sunshine",
+    "freedom", "peace", "hope", "faith", "grace", "heaven", "hell", "devil", "ghost", "death", "blood",
+    "king", "queen", "prince", "princess", "lady", "hero", "master", "killer", "hunter", "soldier", "knight",
+    "pirate", "ninja", "wizard", "monster", "music", "game", "football", "soccer", "baseball", "hockey",
+    "money", "computer", "internet", "welcome", "hello", "password", "forever", "friend", "brother",
+    "sister", "ocean", "island", "forest", "garden", "planet", "space", "rocket", "street", "market",
+    "correct", "battery", "staple", "table", "window", "door", "glass", "stone", "rock", "metal", "wood",
+    "teacher", "doctor", "party", "pizza", "coffee", "cheese", "chicken", "bread", "butter", "cream", "milk"
+};
+
+/**
+ * @brief Common first names, most common first.
+ */
+
+constexpr string_view firstNames[] = {
+    "michael", "james", "john", "robert", "david", "william", "mary", "christopher", "joseph", "richard",
+    "daniel", "thomas", "matthew", "jennifer", "charles", "anthony", "patricia", "linda", "mark",
+    "elizabeth", "joshua", "steven", "andrew", "kevin", "brian", "barbara", "jessica", "jason", "susan",
+    "timothy", "paul", "kenneth", "lisa", "ryan", "sarah", "karen", "jeffrey", "donald", "ashley", "eric",
+    "jacob", "nicholas", "jonathan", "ronald", "michelle", "kimberly", "nancy", "justin", "sandra", "amanda",
+    "brandon", "stephanie", "emily", "melissa", "gary", "edward", "stephen", "scott", "george", "donna",
+    "jose", "rebecca", "deborah", "laura", "cynthia", "carol", "amy", "margaret", "gregory", "sharon",
+    "larry", "angela", "maria", "alexander", "benjamin", "nicole", "kathleen", "patrick", "samantha",
+    "tyler", "samuel", "betty", "brenda", "pamela", "aaron", "kelly", "heather", "rachel", "adam",
+    "christine", "zachary", "debra", "katherine", "dennis", "nathan", "christina", "julie", "jordan",
+    "kyle", "anna", "jose", "peter", "helen", "henry", "ruth", "jack", "oliver", "harry", "lucas", "ethan",
+    "noah", "liam", "mason", "logan", "alex", "emma", "olivia", "sophia", "isabella", "mia", "charlotte",
+    "amelia", "grace", "chloe", "lily", "hannah", "victoria", "natasha", "diana", "julia", "kate", "katie",
+    "sophie", "lucy", "alice", "jasmine", "max", "buddy", "charlie", "bella", "molly", "daisy", "rocky",
+    "maggie", "sam", "tom", "ben", "dan", "joe", "mike", "chris", "nick", "tony", "steve", "jake", "anne"
+};
+
+constexpr PerfectHashTable passwordTable(commonPasswords);
+constexpr PerfectHashTable englishTable(englishWords);
+constexpr PerfectHashTable nameTable(firstNames);
+
+static_assert(passwordTable.find("password") == 1, "Ranks follow the order of the list");
+static_assert(englishTable.find("qwerty") == -1, "Words outside the list are not found");
+
+const size_t minWordLength = 3;     /**< Shortest substring looked up in the dictionaries. */
+
+/**
+ * @brief Gets the length of the longest word of the dictionaries.
+ */
+
+constexpr size_t longestWord() {
+    size_t longest = 0;
+    for (const auto& list : {span<const string_view>(commonPasswords), span<const string_view>(englishWords),
+                             span<const string_view>(firstNames)}) {
+        for (string_view word : list) {
+            longest = max(longest, word.size());
+        }
+    }
+    return longest;
+}
+
+constexpr size_t maxWordLength = longestWord();     /**< Longest substring looked up in the dictionaries. */
+
+/**
+ * @brief Gets the bucket of the first three characters of a word: each is a letter or "anything else".
+ */
+
+constexpr size_t prefixBucket(const char* word) {
+    auto code = [](char c) {
+        return c >= 'a' && c <= 'z' ? static_cast<size_t>(c - 'a') : 26;
+    };
+    return code(word[0]) * 27 * 27 + code(word[1]) * 27 + code(word[2]);
+}
+
+/**
+ * @brief Marks the buckets of the first three characters of every dictionary word.
+ */
+
+constexpr array<uint64_t, 27 * 27 * 27 / 64 + 1> buildPrefixFilter() {
+    array<uint64_t, 27 * 27 * 27 / 64 + 1> filter{};
+    for (const auto& list : {span<const string_view>(commonPasswords), span<const string_view>(englishWords),
+                             span<const string_view>(firstNames)}) {
+        for (string_view word : list) {
+            size_t bucket = prefixBucket(word.data());
+            filter[bucket / 64] |= uint64_t(1) << (bucket % 64);
+        }
+    }
+    return filter;
+}
+
+constexpr array<uint64_t, 27 * 27 * 27 / 64 + 1> prefixFilter = buildPrefixFilter();
+
+/**
+ * @brief Checks whether some dictionary word could start with the first three characters of a text.
+ * @param text At least three characters.
+ * @return False when no word starts that way, so the text need not be hashed.
+ */
+
+bool mayStartWord(const char* text) {
+    size_t bucket = prefixBucket(text);
+    return (prefixFilter[bucket / 64] >> (bucket % 64)) & 1;
+}
+
+/**
+ * @brief Looks a lowercase word up in every dictionary.
+ * @param word The word.
+ * @param found Called with the dictionary and the rank, from 1, of every list that holds the word.
+ */
+
+template <typename Found>
+void lookupWord(string_view word, Found found) {
+    if (int position = passwordTable.find(word); position >= 0) {
+        found(Dictionary::Passwords, static_cast<size_t>(position) + 1);
+    }
+    if (int position = englishTable.find(word); position >= 0) {
+        found(Dictionary::EnglishWords, static_cast<size_t>(position) + 1);
+    }
+    if (int position = nameTable.find(word); position >= 0) {
+        found(Dictionary::Names, static_cast<size_t>(position) + 1);
+    }
+}
+
+// L33T
+/**
+ * @brief Builds the letter each l33t character stands for.
+ * @param ambiguous Letter for the characters that stand for either i or l.
+ * @return The letter of each byte, or 0 for bytes that are not l33t.
+ */
+
+constexpr array<char, 256> buildL33tTable(char ambiguous) {
+    array<char, 256> table{};
+    constexpr pair<char, char> substitutions[] = {
+        {'4', 'a'}, {'@', 'a'}, {'8', 'b'}, {'(', 'c'}, {'{', 'c'}, {'3', 'e'}, {'6', 'g'}, {'9', 'g'},
+        {'!', 'i'}, {'0', 'o'}, {'$', 's'}, {'5', 's'}, {'7', 't'}, {'+', 't'}, {'2', 'z'}
+    };
+    for (auto [symbol, letter] : substitutions) {
+        table[static_cast<unsigned char>(symbol)] = letter;
+    }
+    table['1'] = ambiguous;
+    table['|'] = ambiguous;
+    return table;
+}
+
+constexpr array<char, 256> l33tAsI = buildL33tTable('i');
+constexpr array<char, 256> l33tAsL = buildL33tTable('l');
+
+// KEYBOARD
+/**
+ * @brief Position of a key on a QWERTY keyboard.
+ */
+
+struct KeyPosition {
+    int8_t x = -1;          /**< Column, counting half-key offsets as in the rows below; -1 if not a key. */
+    int8_t y = -1;          /**< Row, from the number row down. */
+    bool shifted = false;   /**< Whether the character needs shift. */
+};
+
+/**
+ * @brief Lays the QWERTY rows out so that neighbouring keys differ by one of the six directions.
+ * @return The position of each byte.
+ */
+
+constexpr array<KeyPosition, 256> buildKeyboard() {
+    constexpr string_view rows[][2] = {
+        {"`1234567890-=", "~!@#$%^&*()_+"},
+        {"qwertyuiop[]\\", "QWERTYUIOP{}|"},
+        {"asdfghjkl;'", "ASDFGHJKL:\""},
+        {"zxcvbnm,./", "ZXCVBNM<>?"}
+    };
+    array<KeyPosition, 256> keyboard{};
+    for (int y = 0; y < 4; y++) {
+        // Each row sits half a key to the right of the one above it
+        int start = y == 0 ? 0 : 1;
+        for (size_t column = 0; column < rows[y][0].size(); column++) {
+            int8_t x = static_cast<int8_t>(start + column);
+            keyboard[static_cast<unsigned char>(rows[y][0][column])] = {x, static_cast<int8_t>(y), false};
+            keyboard[static_cast<unsigned char>(rows[y][1][column])] = {x, static_cast<int8_t>(y), true};
+        }
+    }
+    return keyboard;
+}
+
+constexpr array<KeyPosition, 256> keyboard = buildKeyboard();
+
+/**
+ * @brief Steps to the six neighbours of a key: left, right, up-left, up-right, down-left, down-right.
+ */
+
+constexpr int8_t neighbourSteps[6][2] = {{-1, 0}, {1, 0}, {0, -1}, {1, -1}, {-1, 1}, {0, 1}};
+
+/**
+ * @brief Finds the direction from one key to a neighbouring key.
+ * @return Index into neighbourSteps, or -1 if the keys are not neighbours.
+ */
+
+constexpr int keyDirection(char from, char to) {
+    KeyPosition a = keyboard[static_cast<unsigned char>(from)];
+    KeyPosition b = keyboard[static_cast<unsigned char>(to)];
+    if (a.x < 0 || b.x < 0) {
+        return -1;
+    }
+    for (int direction = 0; direction < 6; direction++) {
+        if (b.x - a.x == neighbourSteps[direction][0] && b.y - a.y == neighbourSteps[direction][1]) {
+            return direction;
+        }
+    }
+    return -1;
+}
+
+/**
+ * @brief Counts the keys of the keyboard, shifted and unshifted.
+ */
+
+constexpr size_t countKeys() {
+    size_t keys = 0;
+    for (const KeyPosition& key : keyboard) {
+        keys += key.x >= 0;
+    }
+    return keys;
+}
+
+/**
+ * @brief Gets the average number of neighbours of a key.
+ */
+
+constexpr double averageKeyDegree() {
+    size_t neighbours = 0;
+    for (unsigned from = 0; from < 256; from++) {
+        for (unsigned to = 0; to < 256; to++) {
+            neighbours += keyboard[from].x >= 0 && !keyboard[to].shifted &&
+                          keyDirection(static_cast<char>(from), static_cast<char>(to)) >= 0;
+        }
+    }
+    return static_cast<double>(neighbours) / static_cast<double>(countKeys());
+}
+
+constexpr size_t keyboardStartingPositions = countKeys();
+constexpr double keyboardAverageDegree = averageKeyDegree();
+
+// GUESS HELPERS
+/**
+ * @brief Computes n choose k.
+ */
+
+double binomial(size_t n, size_t k) {
+    if (k > n) {
+        return 0;
+    }
+    double result = 1;
+    for (size_t i = 1; i <= k; i++) {
+        result = result * static_cast<double>(n - k + i) / static_cast<double>(i);
+    }
+    return result;
+}
+
+/**
+ * @brief Counts the ways of choosing which of the variant characters differ: sum of C(total, i) for i = 1 to min(changed, unchanged).
+ */
+
+double variations(size_t changed, size_t unchanged) {
+    if (changed == 0) {
+        return 1;
+    }
+    if (unchanged == 0) {
+        return 2;
+    }
+    double total = 0;
+    for (size_t i = 1; i <= min(changed, unchanged); i++) {
+        total += binomial(changed + unchanged, i);
+    }
+    return total;
+}
+
+/**
+ * @brief Counts the capitalizations an attacker tries for a word.
+ * @param word The word as written in the password.
+ * @return 1 for lowercase, 2 for a capital first or last letter or all capitals, more for mixed case.
+ */
+
+double uppercaseVariations(string_view word) {
+    size_t upper = 0, lower = 0;
+    for (char c : word) {
+        upper += c >= 'A' && c <= 'Z';
+        lower += c >= 'a' && c <= 'z';
+    }
+    if (upper == 0) {
+        return 1;
+    }
+    bool firstOnly = upper == 1 && word.front() >= 'A' && word.front() <= 'Z';
+    bool lastOnly = upper == 1 && word.back() >= 'A' && word.back() <= 'Z';
+    if (firstOnly || lastOnly || lower == 0) {
+        return 2;
+    }
+    return variations(upper, lower);
+}
+
+/**
+ * @brief Counts the l33t spellings an attacker tries for a word.
+ * @param written The word as written, in lowercase.
+ * @param letters The word with its l33t characters replaced by letters.
+ * @return The number of spellings.
+ */
+
+double l33tVariations(string_view written, string_view letters) {
+    double result = 1;
+    bool counted[256] = {};
+    for (size_t i = 0; i < written.size(); i++) {
+        unsigned char symbol = static_cast<unsigned char>(written[i]);
+        if (written[i] == letters[i] || counted[symbol]) {
+            continue;
+        }
+        counted[symbol] = true;
+        size_t substituted = 0, plain = 0;
+        for (size_t j = 0; j < written.size(); j++) {
+            substituted += written[j] == written[i];
+            plain += written[j] == letters[i];
+        }
+        result *= variations(substituted, plain);
+    }
+    return result;
+}
+
+/**
+ * @brief Gets the year of today's date.
+ */
+
+int currentYear() {
+    static const int year = static_cast<int>(
+            chrono::year_month_day(chrono::floor<chrono::days>(chrono::system_clock::now())).year());
+    return year;
+}
+
+/**
+ * @brief Adds a pattern, applying the floor on guesses zxcvbn uses for anything that is not bruteforce.
+ */
+
+void addMatch(vector<PatternMatch>& matches, PatternMatch match, double guesses) {
+    match.guessesLog10 = log10(max(guesses, match.end - match.begin == 1 ? 10.0 : 50.0));
+    matches.push_back(match);
+}
+
+// MATCHERS
+/**
+ * @brief Finds dictionary words, forwards, backwards and in l33t.
+ *
+ * The password is lowercased, reversed and decoded from l33t once, so every
+ * candidate word is a view into one of these copies. A substring is only
+ * hashed when some dictionary word starts with its first three characters.
+ *
+ * @param password The password.
+ * @param lower The password in lowercase.
+ */
+
+void matchDictionaries(string_view password, string_view lower, vector<PatternMatch>& matches) {
+    size_t length = lower.size();
+    char reversed[maxEstimatedLength];
+    char readAsI[maxEstimatedLength];
+    char readAsL[maxEstimatedLength];
+    // Number of l33t characters, and of those read as either i or l, before each position
+    size_t l33tBefore[maxEstimatedLength + 1] = {};
+    size_t ambiguousBefore[maxEstimatedLength + 1] = {};
+    // Whether a word may start with the three characters before each position, read backwards
+    bool mayEndReversed[maxEstimatedLength + 1] = {};
+    for (size_t i = 0; i < length; i++) {
+        unsigned char c = static_cast<unsigned char>(lower[i]);
+        reversed[length - 1 - i] = lower[i];
+        readAsI[i] = l33tAsI[c] ? l33tAsI[c] : lower[i];
+        readAsL[i] = l33tAsL[c] ? l33tAsL[c] : lower[i];
+        l33tBefore[i + 1] = l33tBefore[i] + (l33tAsI[c] != 0);
+        ambiguousBefore[i + 1] = ambiguousBefore[i] + (l33tAsI[c] != l33tAsL[c]);
+    }
+    for (size_t end = minWordLength; end <= length; end++) {
+        mayEndReversed[end] = mayStartWord(reversed + (length - end));
+    }
+
+    for (size_t begin = 0; begin + minWordLength <= length; begin++) {
+        bool forwards = mayStartWord(lower.data() + begin);
+        bool asI = mayStartWord(readAsI + begin);
+        bool asL = mayStartWord(readAsL + begin);
+        for (size_t end = begin + minWordLength; end <= min(length, begin + maxWordLength); end++) {
+            string_view written = lower.substr(begin, end - begin);
+            auto capitals = [&] {
+                return uppercaseVariations(password.substr(begin, end - begin));
+            };
+
+            if (forwards) {
+                lookupWord(written, [&](Dictionary dictionary, size_t rank) {
+                    PatternMatch match{PatternKind::Dictionary, begin, end, 0, dictionary, rank, false, false};
+                    addMatch(matches, match, static_cast<double>(rank) * capitals());
+                });
+            }
+
+            string_view backwards(reversed + (length - end), end - begin);
+            if (mayEndReversed[end] && backwards != written) {
+                lookupWord(backwards, [&](Dictionary dictionary, size_t rank) {
+                    PatternMatch match{PatternKind::Dictionary, begin, end, 0, dictionary, rank, true, false};
+                    addMatch(matches, match, static_cast<double>(rank) * capitals() * 2);
+                });
+            }
+
+            // Characters such as 1 and | may stand for i or for l; both readings are tried
+            if (l33tBefore[end] == l33tBefore[begin]) {
+                continue;
+            }
+            auto lookupDecoded = [&](string_view decoded) {
+                lookupWord(decoded, [&](Dictionary dictionary, size_t rank) {
+                    PatternMatch match{PatternKind::Dictionary, begin, end, 0, dictionary, rank, false, true};
+                    addMatch(matches, match, static_cast<double>(rank) * capitals() * l33tVariations(written, decoded));
+                });
+            };
+            if (asI) {
+                lookupDecoded(string_view(readAsI + begin, end - begin));
+            }
+            if (asL && ambiguousBefore[end] > ambiguousBefore[begin]) {
+                lookupDecoded(string_view(readAsL + begin, end - begin));
+            }
+        }
+    }
+    secureZero(reversed, sizeof(reversed));
+    secureZero(readAsI, sizeof(readAsI));
+    secureZero(readAsL, sizeof(readAsL));
+}
+
+/**
+ * @brief Finds walks of three or more neighbouring keys.
+ * @param password The password.
+ */
+
+void matchKeyboardWalks(string_view password, vector<PatternMatch>& matches) {
+    size_t begin = 0;
+    while (begin + 2 < password.size()) {
+        size_t end = begin + 1;
+        size_t turns = 0;
+        int lastDirection = -1;
+        while (end < password.size()) {
+            int direction = keyDirection(password[end - 1], password[end]);
+            if (direction < 0) {
+                break;
+            }
+            turns += direction != lastDirection;
+            lastDirection = direction;
+            end++;
+        }
+
+        size_t length = end - begin;
+        if (length >= 3) {
+            double guesses = 0;
+            for (size_t i = 2; i <= length; i++) {
+                for (size_t j = 1; j <= min(turns, i - 1); j++) {
+                    guesses += binomial(i - 1, j - 1) * keyboardStartingPositions * pow(keyboardAverageDegree, j);
+                }
+            }
+            size_t shifted = 0;
+            for (size_t i = begin; i < end; i++) {
+                shifted += keyboard[static_cast<unsigned char>(password[i])].shifted;
+            }
+            guesses *= variations(shifted, length - shifted);
+
+            PatternMatch match;
+            match.kind = PatternKind::Spatial;
+            match.begin = begin;
+            match.end = end;
+            addMatch(matches, match, guesses);
+            begin = end - 1;
+        } else {
+            begin++;
+        }
+    }
+}
+
+/**
+ * @brief Finds a character or block repeated back to back, at every position.
+ * @param password The password.
+ */
+
+void matchRepeats(string_view password, vector<PatternMatch>& matches) {
+    for (size_t begin = 0; begin < password.size(); begin++) {
+        size_t bestBlock = 0, bestCount = 0;
+        for (size_t block = 1; begin + 2 * block <= password.size(); block++) {
+            size_t count = 1;
+            while (begin + (count + 1) * block <= password.size() &&
+                   password.compare(begin + count * block, block, password, begin, block) == 0) {
+                count++;
+            }
+            if (count >= 2 && count * block > bestCount * bestBlock) {
+                bestBlock = block;
+                bestCount = count;
+            }
+        }
+        if (bestCount * bestBlock < 3) {
+            continue;
+        }
+
+        // The block is guessed on its own, then the number of copies
+        StrengthEstimate block = estimateStrength(password.substr(begin, bestBlock));
+        PatternMatch match;
+        match.kind = PatternKind::Repeat;
+        match.begin = begin;
+        match.end = begin + bestCount * bestBlock;
+        addMatch(matches, match, pow(10.0, block.guessesLog10) * static_cast<double>(bestCount));
+    }
+}
+
+/**
+ * @brief Finds runs of three or more letters or digits with the same small step, such as "abc", "1357" or "zyx".
+ * @param password The password.
+ */
+
+void matchSequences(string_view password, vector<PatternMatch>& matches) {
+    auto kindOf = [](char c) {
+        return c >= 'a' && c <= 'z' ? 1 : c >= 'A' && c <= 'Z' ? 2 : c >= '0' && c <= '9' ? 3 : 0;
+    };
+    for (size_t begin = 0; begin + 2 < password.size(); begin++) {
+        int kind = kindOf(password[begin]);
+        int step = password[begin + 1] - password[begin];
+        if (kind == 0 || step == 0 || abs(step) > 5) {
+            continue;
+        }
+        size_t end = begin + 1;
+        while (end < password.size() && kindOf(password[end]) == kind && password[end] - password[end - 1] == step) {
+            end++;
+        }
+        if (end - begin < 3) {
+            continue;
+        }
+
+        char first = password[begin];
+        double base = string_view("aAzZ019").find(first) != string_view::npos ? 4 : kind == 3 ? 10 : 26;
+        if (step < 0) {
+            base *= 2;
+        }
+        PatternMatch match;
+        match.kind = PatternKind::Sequence;
+        match.begin = begin;
+        match.end = end;
+        addMatch(matches, match, base * static_cast<double>(end - begin));
+    }
+}
+
+/**
+ * @brief Reads a run of digits as a number.
+ */
+
+int digitsValue(string_view digits) {
+    int value = 0;
+    for (char c : digits) {
+        value = value * 10 + (c - '0');
+    }
+    return value;
+}
+
+/**
+ * @brief Checks three numbers as a day, month and year in some order and gives the distance of the year from now.
+ * @param parts The numbers as written.
+ * @return The smallest distance over the readings that are valid dates, or -1.
+ */
+
+int dateDistance(const string_view (&parts)[3]) {
+    // Year first, or year last with the day and month either way round
+    const int readings[][3] = {{0, 1, 2}, {2, 1, 0}, {2, 0, 1}};     // year, month, day
+    int best = -1;
+    for (const auto& reading : readings) {
+        string_view yearText = parts[reading[0]];
+        if ((yearText.size() != 2 && yearText.size() != 4) || parts[reading[1]].size() > 2 ||
+            parts[reading[2]].size() > 2) {
+            continue;
+        }
+        int year = digitsValue(yearText);
+        int month = digitsValue(parts[reading[1]]);
+        int day = digitsValue(parts[reading[2]]);
+        if (yearText.size() == 2) {
+            year += year > 50 ? 1900 : 2000;
+        }
+        if (year < 1000 || year > 2050 || month < 1 || month > 12 || day < 1 || day > 31) {
+            continue;
+        }
+        int distance = abs(year - currentYear());
+        best = best < 0 ? distance : min(best, distance);
+    }
+    return best;
+}
+
+/**
+ * @brief Finds dates of 4 to 8 digits, dates with separators, and recent years.
+ * @param password The password.
+ */
+
+void matchDates(string_view password, vector<PatternMatch>& matches) {
+    auto isDigit = [](char c) {
+        return c >= '0' && c <= '9';
+    };
+    for (size_t begin = 0; begin + 4 <= password.size(); begin++) {
+        for (size_t length = 4; length <= 10 && begin + length <= password.size(); length++) {
+            string_view text = password.substr(begin, length);
+            int distance = -1;
+            bool separated = false;
+
+            if (all_of(text.begin(), text.end(), isDigit)) {
+                if (length > 8) {
+                    continue;
+                }
+                if (length == 4 && (text.starts_with("19") || text.starts_with("20"))) {
+                    // A year on its own
+                    PatternMatch match;
+                    match.kind = PatternKind::Date;
+                    match.begin = begin;
+                    match.end = begin + length;
+                    addMatch(matches, match, max(abs(digitsValue(text) - currentYear()), 20));
+                }
+                for (size_t first = 1; first + 2 <= length; first++) {
+                    for (size_t second = first + 1; second < length; second++) {
+                        string_view parts[3] = {text.substr(0, first), text.substr(first, second - first),
+                                                text.substr(second)};
+                        int found = dateDistance(parts);
+                        if (found >= 0) {
+                            distance = distance < 0 ? found : min(distance, found);
+                        }
+                    }
+                }
+            } else if (length >= 6) {
+                // Digits, a separator, digits, the same separator, digits
+                size_t firstSeparator = text.find_first_not_of("0123456789");
+                char separator = text[firstSeparator];
+                size_t secondSeparator = text.find(separator, firstSeparator + 1);
+                if (string_view("/\\-._ ").find(separator) == string_view::npos || firstSeparator == 0 ||
+                    secondSeparator == string_view::npos || secondSeparator == firstSeparator + 1 ||
+                    secondSeparator + 1 == length) {
+                    continue;
+                }
+                string_view parts[3] = {text.substr(0, firstSeparator),
+                                        text.substr(firstSeparator + 1, secondSeparator - firstSeparator - 1),
+                                        text.substr(secondSeparator + 1)};
+                if (all_of(parts, parts + 3, [&](string_view part) {
+                        return all_of(part.begin(), part.end(), isDigit);
+                    })) {
+                    distance = dateDistance(parts);
+                    separated = true;
+                }
+            }
+
+            if (distance >= 0) {
+                PatternMatch match;
+                match.kind = PatternKind::Date;
+                match.begin = begin;
+                match.end = begin + length;
+                addMatch(matches, match, 365.0 * max(distance, 20) * (separated ? 4 : 1));
+            }
+        }
+    }
+}
+
+/**
+ * @brief Adds log10 values without leaving log space.
+ */
+
+double addLog10(double a, double b) {
+    double high = max(a, b), low = min(a, b);
+    return high + log10(1 + pow(10.0, low - high));
+}
+
+} // namespace
+
+/**
+     * @brief Converts the guesses to bits.
+     * @return The bits of entropy.
+     */
+
+double StrengthEstimate::entropyBits() const {
+    return guessesLog10 * log2(10.0);
+}
+
+// ESTIMATE
+/**
+     * @brief Collects every pattern, then picks the cheapest sequence of patterns and bruteforce covering the password.
+     * @param password The password.
+     * @return The estimate.
+     */
+
+StrengthEstimate estimateStrength(string_view password) {
+    StrengthEstimate estimate;
+    size_t length = min(password.size(), maxEstimatedLength);
+    string_view matched = password.substr(0, length);
+
+    char lowerText[maxEstimatedLength];
+    for (size_t i = 0; i < length; i++) {
+        lowerText[i] = static_cast<char>(tolower(static_cast<unsigned char>(matched[i])));
+    }
+    string_view lower(lowerText, length);
+
+    vector<PatternMatch> matches;
+    matchDictionaries(matched, lower, matches);
+    matchKeyboardWalks(matched, matches);
+    matchRepeats(matched, matches);
+    matchSequences(matched, matches);
+    matchDates(matched, matches);
+    secureZero(lowerText, sizeof(lowerText));
+
+    // best[k][l]: cheapest log10 product of l patterns covering characters 0..k; back[k][l]: the last of them,
+    // as an index into matches, or -1 - begin for bruteforce from begin. Two bruteforce parts are never
+    // next to each other in the cheapest cover, so it has at most 2 * matches + 1 parts.
+    const double none = INFINITY;
+    size_t maxParts = min(length, 2 * matches.size() + 1);
+    vector<double> best(length * (maxParts + 1), none);
+    vector<long> back(length * (maxParts + 1), 0);
+    auto at = [&](size_t k, size_t l) {
+        return k * (maxParts + 1) + l;
+    };
+    auto consider = [&](size_t begin, size_t end, double guessesLog10, long id) {
+        size_t k = end - 1;
+        if (begin == 0) {
+            if (guessesLog10 < best[at(k, 1)]) {
+                best[at(k, 1)] = guessesLog10;
+                back[at(k, 1)] = id;
+            }
+            return;
+        }
+        for (size_t l = 1; l <= min(begin, maxParts - 1); l++) {
+            double total = best[at(begin - 1, l)] + guessesLog10;
+            if (total < best[at(k, l + 1)]) {
+                best[at(k, l + 1)] = total;
+                back[at(k, l + 1)] = id;
+            }
+        }
+    };
+
+    sort(matches.begin(), matches.end(), [](const PatternMatch& a, const PatternMatch& b) {
+        return a.end < b.end;
+    });
+    size_t next = 0;
+    for (size_t end = 1; end <= length; end++) {
+        for (; next < matches.size() && matches[next].end == end; next++) {
+            consider(matches[next].begin, end, matches[next].guessesLog10, static_cast<long>(next));
+        }
+        for (size_t begin = 0; begin < end; begin++) {
+            double guessesLog10 = end - begin == 1 ? log10(11.0) : static_cast<double>(end - begin);
+            consider(begin, end, guessesLog10, -1 - static_cast<long>(begin));
+        }
+    }
+
+    if (length > 0) {
+        // l patterns cost l! orderings, and every pattern after the first at least 10^4 guesses
+        double bestTotal = none;
+        size_t bestCount = 0;
+        for (size_t l = 1; l <= maxParts; l++) {
+            if (best[at(length - 1, l)] == none) {
+                continue;
+            }
+            double total = addLog10(lgamma(static_cast<double>(l) + 1) / log(10.0) + best[at(length - 1, l)],
+                                    4.0 * static_cast<double>(l - 1));
+            if (total < bestTotal) {
+                bestTotal = total;
+                bestCount = l;
+            }
+        }
+        estimate.guessesLog10 = bestTotal;
+
+        for (size_t k = length - 1, l = bestCount; l > 0; l--) {
+            long id = back[at(k, l)];
+            PatternMatch match;
+            if (id >= 0) {
+                match = matches[static_cast<size_t>(id)];
+            } else {
+                match.begin = static_cast<size_t>(-1 - id);
+                match.end = k + 1;
+                match.guessesLog10 = match.end - match.begin == 1 ? log10(11.0) : static_cast<double>(k + 1 - match.begin);
+            }
+            estimate.sequence.push_back(match);
+            k = match.begin - 1;
+        }
+        reverse(estimate.sequence.begin(), estimate.sequence.end());
+    }
+
+    if (password.size() > length) {
+        // Characters past the matched part are bruteforced
+        PatternMatch rest;
+        rest.begin = length;
+        rest.end = password.size();
+        rest.guessesLog10 = static_cast<double>(password.size() - length);
+        estimate.sequence.push_back(rest);
+        estimate.guessesLog10 += rest.guessesLog10;
+    }
+
+    const double thresholds[] = {3, 6, 8, 10};
+    estimate.score = static_cast<int>(upper_bound(begin(thresholds), end(thresholds), estimate.guessesLog10) -
+                                      begin(thresholds));
+    return estimate;
+}
+
+// DESCRIBE
+/**
+     * @brief Gives the warning that fits a pattern.
+     * @param match The pattern.
+     * @return The warning.
+     */
+
+string describePattern(const PatternMatch& match) {
+    switch (match.kind) {
+        case PatternKind::Dictionary: {
+            string warning = match.dictionary == Dictionary::Passwords ? "Contains A Common Password"
+                           : match.dictionary == Dictionary::Names ? "Contains A Common Name"
+                           : "Contains A Dictionary Word";
+            if (match.reversed) {
+                warning += ", Spelled Backwards";
+            } else if (match.l33t) {
+                warning += ", With Predictable Substitutions";
+            }
+            return warning;
+        }
+        case PatternKind::Spatial:
+            return "Contains A Keyboard Pattern";
+        case PatternKind::Repeat:
+            return "Contains Repeated Characters";
+        case PatternKind::Sequence:
+            return "Contains A Sequence Such As abc Or 123";
+        case PatternKind::Date:
+            return "Contains A Date Or A Recent Year";
+        case PatternKind::Bruteforce:
+            break;
+    }
+    return "";
+}
@@ -0,0 +1,107 @@
+#ifndef PASSWORDMANAGER_STRENGTHESTIMATOR_H
+#define PASSWORDMANAGER_STRENGTHESTIMATOR_H
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+using namespace std;
+
+/**
+ * @file StrengthEstimator.h
+ * @brief Password strength estimation from the patterns an attacker would try first.
+ */
+
+/**
+ * @brief Kind of pattern found in a password.
+ */
+
+enum class PatternKind {
+    Dictionary,     ///< A common password, word or name, possibly reversed or in l33t
+    Spatial,        ///< A walk over neighbouring keyboard keys, such as "qwerty" or "zxcvb"
+    Repeat,         ///< A repeated character or block, such as "aaaa" or "abcabc"
+    Sequence,       ///< Evenly spaced characters, such as "abcd", "1357" or "9876"
+    Date,           ///< A date or a recent year
+    Bruteforce      ///< Anything else, guessed character by character
+};
+
+/**
+ * @brief Word list a dictionary pattern was found in.
+ */
+
+enum class Dictionary {
+    Passwords,      ///< Most common passwords
+    EnglishWords,   ///< Common English words
+    Names           ///< Common first names
+};
+
+/**
+ * @brief A pattern covering part of a password.
+ */
+
+class PatternMatch {
+public:
+    PatternKind kind = PatternKind::Bruteforce;     /**< What the pattern is. */
+    size_t begin = 0;                               /**< First character covered. */
+    size_t end = 0;                                 /**< One past the last character covered. */
+    double guessesLog10 = 0;                        /**< log10 of the guesses needed for this part. */
+    Dictionary dictionary = Dictionary::Passwords;  /**< List of a dictionary pattern. */
+    size_t rank = 0;                                /**< Position in the list of a dictionary pattern, from 1. */
+    bool reversed = false;                          /**< Whether a dictionary pattern is spelled backwards. */
+    bool l33t = false;                              /**< Whether a dictionary pattern has l33t substitutions. */
+};
+
+/**
+ * @brief How hard a password is to guess.
+ */
+
+class StrengthEstimate {
+public:
+    double guessesLog10 = 0;            /**< log10 of the guesses an informed attacker needs. */
+    int score = 0;                      /**< 0 (too guessable) to 4 (very unguessable). */
+    vector<PatternMatch> sequence;      /**< The patterns the estimate is built from, in order. */
+
+    /**
+     * @brief Gets the estimate as bits of entropy.
+     * @return log2 of the guesses.
+     */
+
+    double entropyBits() const;
+};
+
+/**
+ * @brief Number of characters of a password matched against patterns.
+ */
+
+const size_t maxEstimatedLength = 64;
+
+/**
+ * @brief Estimates how many guesses an attacker who knows common patterns needs, in the manner of zxcvbn.
+ *
+ * Every part of the password that matches a pattern is given a guess count:
+ * dictionary words by their rank, with extra guesses for capitals, l33t
+ * substitutions and reversal; keyboard walks by length, turns and shifted
+ * keys; repeats by their block; sequences by their step; dates by the
+ * distance of their year from now. The estimate is the cheapest way to
+ * cover the whole password with such parts and bruteforced characters,
+ * where using more parts costs extra guesses.
+ *
+ * The dictionaries are perfect hash tables built at compile time, so an
+ * estimate takes microseconds and can run on every keystroke. Only the first
+ * maxEstimatedLength characters are matched; the rest count as bruteforce.
+ *
+ * @param password The password.
+ * @return The estimate.
+ */
+
+StrengthEstimate estimateStrength(string_view password);
+
+/**
+ * @brief Describes the weakness a pattern points to, for feedback to the user.
+ * @param match The pattern.
+ * @return A short warning, such as "Contains A Common Password"; empty for bruteforce.
+ */
+
+string describePattern(const PatternMatch &match);
+
+#endif //PASSWORDMANAGER_STRENGTHESTIMATOR_H
@@ -0,0 +1,278 @@
+/**
+ * @file TextFold.cpp
+ * @brief Implementation of the NFC composition and case folding used for searching.
+ */
+
+#include "TextFold.h"
+#include <algorithm>
+#include <cstdint>
+#include <iterator>
+#include <vector>
+using namespace std;
+
+namespace {
+
+/**
+ * @brief A canonical composition: base followed by combining mark composes to a single code point.
+ */
+
+struct Composition {
+    char32_t base;          /**< Base character. */
+    char32_t mark;          /**< Combining mark following the base. */
+    char32_t composed;      /**< Precomposed character. */
+};
+
+// Sorted by (base, mark) so it can be binary searched.
+const Composition compositions[] = {
+        {0x0041, 0x0300, 0x00C0}, {0x0041, 0x0301, 0x00C1}, {0x0041, 0x0302, 0x00C2}, {0x0041, 0x0303, 0x00C3},
+        {0x0041, 0x0304, 0x0100}, {0x0041, 0x0306, 0x0102}, {0x0041, 0x0308, 0x00C4}, {0x0041, 0x030A, 0x00C5},
+        {0x0041, 0x0328, 0x0104}, {0x0043, 0x0301, 0x0106}, {0x0043, 0x0302, 0x0108}, {0x0043, 0x0307, 0x010A},
+        {0x0043, 0x030C, 0x010C}, {0x0043, 0x0327, 0x00C7}, {0x0044, 0x030C, 0x010E}, {0x0045, 0x0300, 0x00C8},
+        {0x0045, 0x0301, 0x00C9}, {0x0045, 0x0302, 0x00CA}, {0x0045, 0x0304, 0x0112}, {0x0045, 0x0306, 0x0114},
+        {0x0045, 0x0307, 0x0116}, {0x0045, 0x0308, 0x00CB}, {0x0045, 0x030C, 0x011A}, {0x0045, 0x0328, 0x0118},
+        {0x0047, 0x0302, 0x011C}, {0x0047, 0x0306, 0x011E}, {0x0047, 0x0307, 0x0120}, {0x0047, 0x0327, 0x0122},
+        {0x0048, 0x0302, 0x0124}, {0x0049, 0x0300, 0x00CC}, {0x0049, 0x0301, 0x00CD}, {0x0049, 0x0302, 0x00CE},
+        {0x0049, 0x0303, 0x0128}, {0x0049, 0x0304, 0x012A}, {0x0049, 0x0306, 0x012C}, {0x0049, 0x0307, 0x0130},
+        {0x0049, 0x0308, 0x00CF}, {0x0049, 0x0328, 0x012E}, {0x004A, 0x0302, 0x0134}, {0x004B, 0x0327, 0x0136},
+        {0x004C, 0x0301, 0x0139}, {0x004C, 0x030C, 0x013D}, {0x004C, 0x0327, 0x013B}, {0x004E, 0x0301, 0x0143},
+        {0x004E, 0x0303, 0x00D1}, {0x004E, 0x030C, 0x0147}, {0x004E, 0x0327, 0x0145}, {0x004F, 0x0300, 0x00D2},
+        {0x004F, 0x0301, 0x00D3}, {0x004F, 0x0302, 0x00D4}, {0x004F, 0x0303, 0x00D5}, {0x004F, 0x0304, 0x014C},
+        {0x004F, 0x0306, 0x014E}, {0x004F, 0x0308, 0x00D6}, {0x004F, 0x030B, 0x0150}, {0x0052, 0x0301, 0x0154},
+        {0x0052, 0x030C, 0x0158}, {0x0052, 0x0327, 0x0156}, {0x0053, 0x0301, 0x015A}, {0x0053, 0x0302, 0x015C},
+        {0x0053, 0x030C, 0x0160}, {0x0053, 0x0327, 0x015E}, {0x0054, 0x030C, 0x0164}, {0x0054, 0x0327, 0x0162},
+        {0x0055, 0x0300, 0x00D9}, {0x0055, 0x0301, 0x00DA}, {0x0055, 0x0302, 0x00DB}, {0x0055, 0x0303, 0x0168},
+        {0x0055, 0x0304, 0x016A}, {0x0055, 0x0306, 0x016C}, {0x0055, 0x0308, 0x00DC}, {0x0055, 0x030A, 0x016E},
+        {0x0055, 0x030B, 0x0170}, {0x0055, 0x0328, 0x0172}, {0x0057, 0x0302, 0x0174}, {0x0059, 0x0301, 0x00DD},
+        {0x0059, 0x0302, 0x0176}, {0x0059, 0x0308, 0x0178}, {0x005A, 0x0301, 0x0179}, {0x005A, 0x0307, 0x017B},
+        {0x005A, 0x030C, 0x017D}, {0x0061, 0x0300, 0x00E0}, {0x0061, 0x0301, 0x00E1}, {0x0061, 0x0302, 0x00E2},
+        {0x0061, 0x0303, 0x00E3}, {0x0061, 0x0304, 0x0101}, {0x0061, 0x0306, 0x0103}, {0x0061, 0x0308, 0x00E4},
+        {0x0061, 0x030A, 0x00E5}, {0x0061, 0x0328, 0x0105}, {0x0063, 0x0301, 0x0107}, {0x0063, 0x0302, 0x0109},
+        {0x0063, 0x0307, 0x010B}, {0x0063, 0x030C, 0x010D}, {0x0063, 0x0327, 0x00E7}, {0x0064, 0x030C, 0x010F},
+        {0x0065, 0x0300, 0x00E8}, {0x0065, 0x0301, 0x00E9}, {0x0065, 0x0302, 0x00EA}, {0x0065, 0x0304, 0x0113},
+        {0x0065, 0x0306, 0x0115}, {0x0065, 0x0307, 0x0117}, {0x0065, 0x0308, 0x00EB}, {0x0065, 0x030C, 0x011B},
+        {0x0065, 0x0328, 0x0119}, {0x0067, 0x0302, 0x011D}, {0x0067, 0x0306, 0x011F}, {0x0067, 0x0307, 0x0121},
+        {0x0067, 0x0327, 0x0123}, {0x0068, 0x0302, 0x0125}, {0x0069, 0x0300, 0x00EC}, {0x0069, 0x0301, 0x00ED},
+        {0x0069, 0x0302, 0x00EE}, {0x0069, 0x0303, 0x0129}, {0x0069, 0x0304, 0x012B}, {0x0069, 0x0306, 0x012D},
+        {0x0069, 0x0308, 0x00EF}, {0x0069, 0x0328, 0x012F}, {0x006A, 0x0302, 0x0135}, {0x006B, 0x0327, 0x0137},
+        {0x006C, 0x0301, 0x013A}, {0x006C, 0x030C, 0x013E}, {0x006C, 0x0327, 0x013C}, {0x006E, 0x0301, 0x0144},
+        {0x006E, 0x0303, 0x00F1}, {0x006E, 0x030C, 0x0148}, {0x006E, 0x0327, 0x0146}, {0x006F, 0x0300, 0x00F2},
+        {0x006F, 0x0301, 0x00F3}, {0x006F, 0x0302, 0x00F4}, {0x006F, 0x0303, 0x00F5}, {0x006F, 0x0304, 0x014D},
+        {0x006F, 0x0306, 0x014F}, {0x006F, 0x0308, 0x00F6}, {0x006F, 0x030B, 0x0151}, {0x0072, 0x0301, 0x0155},
+        {0x0072, 0x030C, 0x0159}, {0x0072, 0x0327, 0x0157}, {0x0073, 0x0301, 0x015B}, {0x0073, 0x0302, 0x015D},
+        {0x0073, 0x030C, 0x0161}, {0x0073, 0x0327, 0x015F}, {0x0074, 0x030C, 0x0165}, {0x0074, 0x0327, 0x0163},
+        {0x0075, 0x0300, 0x00F9}, {0x0075, 0x0301, 0x00FA}, {0x0075, 0x0302, 0x00FB}, {0x0075, 0x0303, 0x0169},
+        {0x0075, 0x0304, 0x016B}, {0x0075, 0x0306, 0x016D}, {0x0075, 0x0308, 0x00FC}, {0x0075, 0x030A, 0x016F},
+        {0x0075, 0x030B, 0x0171}, {0x0075, 0x0328, 0x0173}, {0x0077, 0x0302, 0x0175}, {0x0079, 0x0301, 0x00FD},
+        {0x0079, 0x0302, 0x0177}, {0x0079, 0x0308, 0x00FF}, {0x007A, 0x0301, 0x017A}, {0x007A, 0x0307, 0x017C},
+        {0x007A, 0x030C, 0x017E},
+};
+
+/**
+ * @brief Decodes UTF-8 into code points, replacing malformed sequences with U+FFFD.
+ */
+
+vector<char32_t> decodeUtf8(const string& text) {
+    vector<char32_t> codePoints;
+    codePoints.reserve(text.size());
+
+    size_t i = 0;
+    while (i < text.size()) {
+        auto lead = static_cast<unsigned char>(text[i]);
+        size_t length;
+        char32_t cp;
+        if (lead < 0x80) {
+            codePoints.push_back(lead);
+            ++i;
+            continue;
+        } else if ((lead & 0xE0) == 0xC0) {
+            length = 2;
+            cp = lead & 0x1F;
+        } else if ((lead & 0xF0) == 0xE0) {
+            length = 3;
+            cp = lead & 0x0F;
+        } else if ((lead & 0xF8) == 0xF0) {
+            length = 4;
+            cp = lead & 0x07;
+        } else {
+            codePoints.push_back(0xFFFD);
+            ++i;
+            continue;
+        }
+
+        bool valid = i + length <= text.size();
+        for (size_t k = 1; valid && k < length; k++) {
+            auto next = static_cast<unsigned char>(text[i + k]);
+            if ((next & 0xC0) != 0x80) {
+                valid = false;
+            } else {
+                cp = (cp << 6) | (next & 0x3F);
+            }
+        }
+        static const char32_t minimum[] = {0, 0, 0x80, 0x800, 0x10000};
+        if (!valid || cp < minimum[length] || cp > 0x10FFFF || (cp >= 0xD800 && cp <= 0xDFFF)) {
+            codePoints.push_back(0xFFFD);
+            ++i;
+            continue;
+        }
+        codePoints.push_back(cp);
+        i += length;
+    }
+    return codePoints;
+}
+
+/**
+ * @brief Appends the UTF-8 encoding of a code point.
+ */
+
+void appendUtf8(string& out, char32_t cp) {
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+    } else if (cp < 0x800) {
+        out += static_cast<char>(0xC0 | (cp >> 6));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else if (cp < 0x10000) {
+        out += static_cast<char>(0xE0 | (cp >> 12));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    } else {
+        out += static_cast<char>(0xF0 | (cp >> 18));
+        out += static_cast<char>(0x80 | ((cp >> 12) & 0x3F));
+        out += static_cast<char>(0x80 | ((cp >> 6) & 0x3F));
+        out += static_cast<char>(0x80 | (cp & 0x3F));
+    }
+}
+
+/**
+ * @brief Looks up the precomposed form of base + mark, or returns 0 when there is none.
+ */
+
+char32_t compose(char32_t base, char32_t mark) {
+    auto it = lower_bound(begin(compositions), end(compositions), Composition{base, mark, 0},
+                          [](const Composition& a, const Composition& b) {
+                              return a.base != b.base ? a.base < b.base : a.mark < b.mark;
+                          });
+    if (it != end(compositions) && it->base == base && it->mark == mark) {
+        return it->composed;
+    }
+    return 0;
+}
+
+/**
+ * @brief Maps singleton canonical decompositions to their NFC form.
+ */
+
+char32_t canonicalSingleton(char32_t cp) {
+    switch (cp) {
+        case 0x212A: return 0x004B;     // KELVIN SIGN
+        case 0x212B: return 0x00C5;     // ANGSTROM SIGN
+        case 0x2126: return 0x03A9;     // OHM SIGN
+        case 0x0374: return 0x02B9;     // GREEK NUMERAL SIGN
+        case 0x037E: return 0x003B;     // GREEK QUESTION MARK
+        case 0x0387: return 0x00B7;     // GREEK ANO TELEIA
+        default: return cp;
+    }
+}
+
+/**
+ * @brief Appends the case folding of a code point to the output.
+ */
+
+void appendFolded(string& out, char32_t cp) {
+    if (cp >= 'A' && cp <= 'Z') {
+        out += static_cast<char>(cp + 0x20);
+        return;
+    }
+    if (cp < 0x80) {
+        out += static_cast<char>(cp);
+        return;
+    }
+
+    if (cp == 0x00B5) {                                 // MICRO SIGN
+        cp = 0x03BC;
+    } else if (cp == 0x00DF) {                          // SHARP S
+        out += "ss";
+        return;
+    } else if (cp >= 0x00C0 && cp <= 0x00DE && cp != 0x00D7) {
+        cp += 0x20;
+    } else if (cp == 0x0130) {                          // CAPITAL I WITH DOT ABOVE
+        out += 'i';
+        cp = 0x0307;
+    } else if (cp == 0x0149) {                          // N PRECEDED BY APOSTROPHE
+        appendUtf8(out, 0x02BC);
+        cp = 'n';
+    } else if (cp == 0x0178) {                          // CAPITAL Y WITH DIAERESIS
+        cp = 0x00FF;
+    } else if (cp == 0x017F) {                          // LONG S
+        cp = 's';
+    } else if ((cp >= 0x0100 && cp <= 0x012F) || (cp >= 0x0132 && cp <= 0x0137) ||
+               (cp >= 0x014A && cp <= 0x0177)) {
+        cp |= 1;
+    } else if ((cp >= 0x0139 && cp <= 0x0148) || (cp >= 0x0179 && cp <= 0x017E)) {
+        cp += cp & 1;
+    } else if (cp >= 0x0391 && cp <= 0x03AB && cp != 0x03A2) {
+        cp += 0x20;
+    } else if (cp == 0x0386) {
+        cp = 0x03AC;
+    } else if (cp >= 0x0388 && cp <= 0x038A) {
+        cp += 0x25;
+    } else if (cp == 0x038C) {
+        cp = 0x03CC;
+    } else if (cp == 0x038E || cp == 0x038F) {
+        cp += 0x3F;
+    } else if (cp == 0x03C2) {                          // FINAL SIGMA
+        cp = 0x03C3;
+    } else if (cp >= 0x0400 && cp <= 0x040F) {
+        cp += 0x50;
+    } else if (cp >= 0x0410 && cp <= 0x042F) {
+        cp += 0x20;
+    }
+    appendUtf8(out, cp);
+}
+
+bool isAscii(const string& text) {
+    return all_of(text.begin(), text.end(), [](char c) {
+        return (static_cast<unsigned char>(c) & 0x80) == 0;
+    });
+}
+
+} // namespace
+
+// FOLD FOR SEARCH
+/**
+ * @brief Produces the NFC-composed, case-folded search form of a UTF-8 string.
+ * @param text The UTF-8 text to fold.
+ * @return The folded text.
+ */
+
+string foldForSearch(const string& text) {
+    string folded;
+    folded.reserve(text.size());
+
+    // Fast path: ASCII is already NFC and only needs A-Z lowered.
+    if (isAscii(text)) {
+        for (char c : text) {
+            folded += (c >= 'A' && c <= 'Z') ? static_cast<char>(c + 0x20) : c;
+        }
+        return folded;
+    }
+
+    vector<char32_t> codePoints = decodeUtf8(text);
+    vector<char32_t> composed;
+    composed.reserve(codePoints.size());
+    for (char32_t cp : codePoints) {
+        cp = canonicalSingleton(cp);
+        if (!composed.empty()) {
+            char32_t merged = compose(composed.back(), cp);
+            if (merged != 0) {
+                composed.back() = merged;
+                continue;
+            }
+        }
+        composed.push_back(cp);
+    }
+
+    for (char32_t cp : composed) {
+        appendFolded(folded, cp);
+    }
+    return folded;
+}
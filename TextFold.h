@@ -0,0 +1,29 @@
+#ifndef PASSWORDMANAGER_TEXTFOLD_H
+#define PASSWORDMANAGER_TEXTFOLD_H
+
+#include <string>
+using namespace std;
+
+/**
+ * @file TextFold.h
+ * @brief Case folding and Unicode normalization used by the search columns.
+ */
+
+// FOLD FOR SEARCH
+/**
+ * @brief Produces the search form of a UTF-8 string.
+ *
+ * The text is composed to NFC and then case folded, so "YouTube", "youtube"
+ * and "YOUTUBE" share one search form, as do "Café" typed with a precomposed
+ * "é" and with "e" followed by a combining acute accent.
+ * Composition covers the Latin-1 and Latin Extended-A precomposed letters;
+ * case folding covers ASCII, Latin-1, Latin Extended-A, Greek and Cyrillic.
+ * Invalid UTF-8 bytes are replaced by U+FFFD.
+ *
+ * @param text The UTF-8 text to fold.
+ * @return The folded text.
+ */
+
+string foldForSearch(const string &text);
+
+#endif //PASSWORDMANAGER_TEXTFOLD_H
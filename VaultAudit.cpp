@@ -0,0 +1,200 @@
+/**
+ * @file VaultAudit.cpp
+ * @brief Implementation of the whole-vault security audit.
+ */
+
+#include "VaultAudit.h"
+#include "DataStorage.h"
+#include "PerfectHash.h"
+#include "StrengthEstimator.h"
+#include <algorithm>
+#include <map>
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Checks whether a field holds anything but whitespace.
+ */
+
+bool isBlankField(const string& field) {
+    return all_of(field.begin(), field.end(), [](char c) {
+        return c == ' ' || c == '\t' || c == '\r' || c == '\n';
+    });
+}
+
+} // namespace
+
+// ISSUES
+/**
+     * @brief Gets the name of an issue.
+     * @param issue The issue.
+     * @return The name.
+     */
+
+string describeIssue(AuditIssue issue) {
+    switch (issue) {
+        case AuditIssue::Weak:
+            return "Weak";
+        case AuditIssue::Breached:
+            return "Breached";
+        case AuditIssue::Reused:
+            return "Reused";
+        case AuditIssue::NearDuplicate:
+            return "Near-Duplicate";
+        case AuditIssue::Stale:
+            return "Stale";
+        case AuditIssue::NoWebsite:
+            return "No Website";
+        case AuditIssue::NoLogin:
+            return "No Login";
+    }
+    return "";
+}
+
+/**
+     * @brief Checks whether the entry has an issue.
+     * @param issue The issue.
+     * @return True if it has.
+     */
+
+bool AuditFinding::has(AuditIssue issue) const {
+    return (issues >> static_cast<unsigned>(issue)) & 1;
+}
+
+// PLACEHOLDERS
+/**
+     * @brief Checks whether the entry has neither a name nor a password.
+     * @param entry The entry.
+     * @return True for a category placeholder.
+     */
+
+bool isCategoryPlaceholder(const KeyData& entry) {
+    return entry.name.empty() && entry.password.empty();
+}
+
+// EXAMINE PASSWORD
+/**
+     * @brief Hashes and sketches the password, estimates its strength and looks it up in the breach corpus.
+     * @param password The plaintext password.
+     * @param seed Seed of the hashes.
+     * @param corpus Breach corpus, or nullptr.
+     * @return The traits of the password.
+     */
+
+PasswordTraits examinePassword(string_view password, uint64_t seed, const BreachCorpus* corpus) {
+    PasswordTraits traits;
+    traits.examined = true;
+    traits.passwordHash = perfectHashOf(password, seed);
+    traits.score = estimateStrength(password).score;
+    traits.breached = corpus && corpus->contains(password);
+    traits.sketch = minHashSketch(password, seed + 1);
+    return traits;
+}
+
+// BUILD REPORT
+/**
+     * @brief Numbers the groups of reused and varied passwords, then files every entry under its category.
+     * @param entries The entries of the vault.
+     * @param traits Traits of each password.
+     * @param options Settings of the audit.
+     * @return The report.
+     */
+
+AuditReport buildAuditReport(const vector<KeyData>& entries, const vector<PasswordTraits>& traits,
+                             const AuditOptions& options) {
+    AuditReport report;
+
+    // Entries sorted by password hash: equal hashes are adjacent
+    vector<size_t> reuseGroup(entries.size(), 0);
+    vector<pair<uint64_t, size_t>> order;
+    order.reserve(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (isCategoryPlaceholder(entries[i])) {
+            continue;
+        }
+        report.entries++;
+        if (traits[i].examined) {
+            order.emplace_back(traits[i].passwordHash, i);
+        } else {
+            report.unreadable++;
+        }
+    }
+    sort(order.begin(), order.end());
+    for (size_t begin = 0; begin < order.size();) {
+        size_t end = begin + 1;
+        while (end < order.size() && order[end].first == order[begin].first) {
+            end++;
+        }
+        if (end - begin > 1) {
+            report.reuseGroups++;
+            for (size_t i = begin; i < end; i++) {
+                reuseGroup[order[i].second] = report.reuseGroups;
+            }
+        }
+        begin = end;
+    }
+
+    // Variations of one password, found among the sketches by locality-sensitive hashing
+    vector<MinHashSketch> sketches(entries.size());
+    vector<uint64_t> passwordHashes(entries.size());
+    for (size_t i = 0; i < entries.size(); i++) {
+        if (traits[i].examined && !isCategoryPlaceholder(entries[i])) {
+            sketches[i] = traits[i].sketch;
+            passwordHashes[i] = traits[i].passwordHash;
+        }
+    }
+    vector<size_t> similarGroup = findNearDuplicates(sketches, passwordHashes, report.similarGroups);
+
+    map<string, size_t> categoryPositions;
+    for (const KeyData& entry : entries) {
+        categoryPositions.emplace(entry.category, 0);
+    }
+    for (auto& [category, position] : categoryPositions) {
+        position = report.categories.size();
+        report.categories.emplace_back();
+        report.categories.back().category = category;
+    }
+
+    int64_t staleBefore = options.now - options.staleAfterDays * 86400;
+    for (size_t i = 0; i < entries.size(); i++) {
+        const KeyData& entry = entries[i];
+        if (isCategoryPlaceholder(entry)) {
+            continue;
+        }
+        const PasswordTraits& password = traits[i];
+        AuditFinding finding;
+        auto flag = [&](AuditIssue issue, bool present) {
+            if (present) {
+                finding.issues |= 1u << static_cast<unsigned>(issue);
+            }
+        };
+        int64_t changed = entry.modified != 0 ? entry.modified : entry.created;
+        flag(AuditIssue::Weak, password.examined && password.score <= options.weakScore);
+        flag(AuditIssue::Breached, password.examined && password.breached);
+        flag(AuditIssue::Reused, reuseGroup[i] != 0);
+        flag(AuditIssue::NearDuplicate, similarGroup[i] != 0);
+        flag(AuditIssue::Stale, changed != 0 && changed < staleBefore);
+        flag(AuditIssue::NoWebsite, isBlankField(entry.website));
+        flag(AuditIssue::NoLogin, isBlankField(entry.login));
+
+        CategoryAudit& category = report.categories[categoryPositions[entry.category]];
+        category.entries++;
+        if (finding.issues == 0) {
+            continue;
+        }
+        for (size_t issue = 0; issue < auditIssueCount; issue++) {
+            size_t present = (finding.issues >> issue) & 1;
+            category.counts[issue] += present;
+            report.counts[issue] += present;
+        }
+        finding.index = i;
+        finding.name = entry.name;
+        finding.score = password.score;
+        finding.reuseGroup = reuseGroup[i];
+        finding.similarGroup = similarGroup[i];
+        category.findings.push_back(move(finding));
+    }
+    return report;
+}
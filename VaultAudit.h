@@ -0,0 +1,155 @@
+#ifndef PASSWORDMANAGER_VAULTAUDIT_H
+#define PASSWORDMANAGER_VAULTAUDIT_H
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "MinHash.h"
+using namespace std;
+
+class KeyData;
+class BreachCorpus;
+
+/**
+ * @file VaultAudit.h
+ * @brief Whole-vault security audit: weak, breached, reused and neglected entries, grouped by category.
+ */
+
+/**
+ * @brief Problem the audit can find with an entry.
+ */
+
+enum class AuditIssue {
+    Weak,           ///< The password is easy to guess (see estimateStrength)
+    Breached,       ///< The password is in the local breach corpus
+    Reused,         ///< Another entry has the same password
+    NearDuplicate,  ///< Another entry has a small variation of the password, such as "youtube123" and "youtube124"
+    Stale,          ///< The password has not been changed for a long time
+    NoWebsite,      ///< The entry has no website
+    NoLogin         ///< The entry has no login
+};
+
+/**
+ * @brief Number of audit issues.
+ */
+
+const size_t auditIssueCount = 7;
+
+/**
+ * @brief Gets the name of an issue, for the report.
+ * @param issue The issue.
+ * @return A short name, such as "Reused".
+ */
+
+string describeIssue(AuditIssue issue);
+
+/**
+ * @brief Settings of an audit.
+ */
+
+class AuditOptions {
+public:
+    int64_t now = 0;                /**< Time of the audit, in seconds since the epoch. */
+    int64_t staleAfterDays = 365;   /**< Days without a change after which a password is stale. */
+    int weakScore = 1;              /**< Highest strength score (0 to 4) counted as weak. */
+};
+
+/**
+ * @brief What the audit keeps of a password; never the password itself.
+ */
+
+class PasswordTraits {
+public:
+    uint64_t passwordHash = 0;  /**< Hash of the password under the audit's seed, to find reuse. */
+    MinHashSketch sketch;       /**< MinHash sketch of the password, to find variations of it. */
+    int score = 0;              /**< Strength score, 0 to 4. */
+    bool breached = false;      /**< Whether the password is in the breach corpus. */
+    bool examined = false;      /**< Whether the password could be read; false if it failed to decrypt. */
+};
+
+/**
+ * @brief Checks whether an entry only marks a category, as PasswordKeeper::addCategory creates them.
+ * @param entry The entry.
+ * @return True if its name and password are both empty.
+ */
+
+bool isCategoryPlaceholder(const KeyData &entry);
+
+/**
+ * @brief Examines one password, for an audit.
+ * @param password The plaintext password.
+ * @param seed Seed of the hashes; random for each audit, so no hash outlives it.
+ * @param corpus Breach corpus to check the password against; nullptr to skip the check.
+ * @return The traits of the password.
+ */
+
+PasswordTraits examinePassword(string_view password, uint64_t seed, const BreachCorpus *corpus);
+
+/**
+ * @brief An entry with at least one issue.
+ */
+
+class AuditFinding {
+public:
+    size_t index = 0;           /**< Position of the entry in the vault. */
+    string name;                /**< Name of the entry. */
+    int score = 0;              /**< Strength score of the password. */
+    size_t reuseGroup = 0;      /**< Number shared by entries with the same password; 0 if not reused. */
+    size_t similarGroup = 0;    /**< Number shared by entries with variations of one password; 0 if none. */
+    unsigned issues = 0;        /**< Bit i is set for issue i. */
+
+    /**
+     * @brief Checks whether the entry has an issue.
+     * @param issue The issue.
+     * @return True if it has.
+     */
+
+    bool has(AuditIssue issue) const;
+};
+
+/**
+ * @brief Audit results of one category.
+ */
+
+class CategoryAudit {
+public:
+    string category;                                /**< Name of the category. */
+    size_t entries = 0;                             /**< Entries in the category, not counting its placeholder. */
+    array<size_t, auditIssueCount> counts{};        /**< Entries with each issue. */
+    vector<AuditFinding> findings;                  /**< Entries with an issue, in vault order. */
+};
+
+/**
+ * @brief Audit results of the whole vault.
+ */
+
+class AuditReport {
+public:
+    size_t entries = 0;                             /**< Entries audited; category placeholders are skipped. */
+    size_t unreadable = 0;                          /**< Entries whose password failed to decrypt. */
+    size_t reuseGroups = 0;                         /**< Distinct passwords used by more than one entry. */
+    size_t similarGroups = 0;                       /**< Groups of entries with variations of one password. */
+    array<size_t, auditIssueCount> counts{};        /**< Entries with each issue. */
+    vector<CategoryAudit> categories;               /**< Results of each category, by name. */
+};
+
+/**
+ * @brief Groups reused passwords and variations and checks every entry, once the passwords are examined.
+ *
+ * Reuse is found by sorting the password hashes, and variations by
+ * bucketing the MinHash sketches, so the cost grows
+ * as n log n rather than with the number of pairs of entries.
+ *
+ * @param entries The entries of the vault.
+ * @param traits Traits of each password, index-aligned with entries; ignored for category placeholders.
+ * @param options Settings of the audit.
+ * @return The report.
+ */
+
+AuditReport buildAuditReport(const vector<KeyData> &entries, const vector<PasswordTraits> &traits,
+                             const AuditOptions &options);
+
+#endif //PASSWORDMANAGER_VAULTAUDIT_H
@@ -0,0 +1,196 @@
+/**
+ * @file WebsiteIndex.cpp
+ * @brief Implementation of website normalization and the reverse-label trie.
+ */
+
+#include "WebsiteIndex.h"
+#include "TextFold.h"
+#include <algorithm>
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Splits a host into its labels, last label first.
+ */
+
+vector<string> reverseLabels(const string& host) {
+    vector<string> labels;
+    size_t end = host.size();
+    while (end > 0) {
+        size_t dot = host.rfind('.', end - 1);
+        size_t start = (dot == string::npos) ? 0 : dot + 1;
+        if (end > start) {
+            labels.push_back(host.substr(start, end - start));
+        }
+        if (dot == string::npos) {
+            break;
+        }
+        end = dot;
+    }
+    return labels;
+}
+
+} // namespace
+
+// NORMALIZE WEBSITE
+/**
+     * @brief Reduces a website or URL to its bare, case-folded host name.
+     * @param website The website or URL as entered by the user.
+     * @return The normalized host.
+     */
+
+string normalizeWebsite(const string& website) {
+    size_t begin = website.find_first_not_of(" \t\r\n");
+    if (begin == string::npos) {
+        return "";
+    }
+    size_t end = website.find_last_not_of(" \t\r\n") + 1;
+    string host = website.substr(begin, end - begin);
+
+    size_t scheme = host.find("://");
+    if (scheme != string::npos && host.find_first_of("/?#") > scheme) {
+        host.erase(0, scheme + 3);
+    }
+
+    host = host.substr(0, host.find_first_of("/?#"));
+
+    size_t at = host.rfind('@');
+    if (at != string::npos) {
+        host.erase(0, at + 1);
+    }
+
+    if (!host.empty() && host[0] == '[') {
+        // IPv6 literal, keep the brackets and drop the port
+        size_t close = host.find(']');
+        host = host.substr(0, close == string::npos ? host.size() : close + 1);
+    } else {
+        size_t colon = host.find(':');
+        if (colon != string::npos) {
+            host.erase(colon);
+        }
+    }
+
+    while (!host.empty() && host.back() == '.') {
+        host.pop_back();
+    }
+
+    host = foldForSearch(host);
+    if (host.rfind("www.", 0) == 0) {
+        host.erase(0, 4);
+    }
+    return host;
+}
+
+// INSERT
+/**
+     * @brief Registers an entry under the reversed labels of a host.
+     * @param host Normalized host.
+     * @param id Identifier of the password entry.
+     */
+
+void WebsiteIndex::insert(const string& host, uint64_t id) {
+    vector<string> labels = reverseLabels(host);
+    if (labels.empty()) {
+        return;
+    }
+
+    Node* node = &root;
+    for (const string& label : labels) {
+        unique_ptr<Node>& child = node->children[label];
+        if (!child) {
+            child = make_unique<Node>();
+        }
+        node = child.get();
+    }
+    node->ids.push_back(id);
+}
+
+// REMOVE
+/**
+     * @brief Unregisters an entry and prunes labels left without entries or children.
+     * @param host Normalized host the entry was inserted with.
+     * @param id Identifier of the password entry.
+     */
+
+void WebsiteIndex::remove(const string& host, uint64_t id) {
+    vector<string> labels = reverseLabels(host);
+    if (labels.empty()) {
+        return;
+    }
+
+    vector<Node*> path = {&root};
+    for (const string& label : labels) {
+        auto it = path.back()->children.find(label);
+        if (it == path.back()->children.end()) {
+            return;
+        }
+        path.push_back(it->second.get());
+    }
+
+    vector<uint64_t>& ids = path.back()->ids;
+    ids.erase(std::remove(ids.begin(), ids.end(), id), ids.end());
+
+    for (size_t depth = labels.size(); depth > 0; depth--) {
+        Node* node = path[depth];
+        if (!node->ids.empty() || !node->children.empty()) {
+            break;
+        }
+        path[depth - 1]->children.erase(labels[depth - 1]);
+    }
+}
+
+// LOOKUP
+/**
+     * @brief Finds the entries registered for a host and its parent domains.
+     * @param host Normalized host.
+     * @param includeSubdomains Whether to include entries of subdomains of the host.
+     * @return Identifiers of the matching entries.
+     */
+
+vector<uint64_t> WebsiteIndex::lookup(const string& host, bool includeSubdomains) const {
+    vector<uint64_t> results;
+    vector<string> labels = reverseLabels(host);
+
+    const Node* node = &root;
+    for (size_t depth = 0; depth < labels.size(); depth++) {
+        auto it = node->children.find(labels[depth]);
+        if (it == node->children.end()) {
+            return results;
+        }
+        node = it->second.get();
+
+        bool isBareTopLevel = depth == 0 && labels.size() > 1;
+        if (depth + 1 < labels.size()) {
+            if (!isBareTopLevel) {
+                results.insert(results.end(), node->ids.begin(), node->ids.end());
+            }
+        } else if (includeSubdomains) {
+            collectSubtree(*node, results);
+        } else {
+            results.insert(results.end(), node->ids.begin(), node->ids.end());
+        }
+    }
+    return results;
+}
+
+/**
+     * @brief Appends the ids of a node and of all nodes below it.
+     */
+
+void WebsiteIndex::collectSubtree(const Node& node, vector<uint64_t>& out) {
+    out.insert(out.end(), node.ids.begin(), node.ids.end());
+    for (const auto& child : node.children) {
+        collectSubtree(*child.second, out);
+    }
+}
+
+// CLEAR
+/**
+     * @brief Removes every entry from the index.
+     */
+
+void WebsiteIndex::clear() {
+    root.children.clear();
+    root.ids.clear();
+}
@@ -0,0 +1,100 @@
+#ifndef PASSWORDMANAGER_WEBSITEINDEX_H
+#define PASSWORDMANAGER_WEBSITEINDEX_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <unordered_map>
+#include <vector>
+using namespace std;
+
+/**
+ * @file WebsiteIndex.h
+ * @brief Reverse-domain index used to find the credentials belonging to a URL.
+ */
+
+// NORMALIZE WEBSITE
+/**
+ * @brief Reduces a website or URL to its bare host name.
+ *
+ * The scheme, user info, port, path, query, fragment, a trailing dot and a
+ * leading "www." are removed and the host is case folded, so
+ * "https://WWW.Google.com:443/mail?x=1" becomes "google.com".
+ *
+ * @param website The website or URL as entered by the user.
+ * @return The normalized host, or an empty string when there is none.
+ */
+
+string normalizeWebsite(const string &website);
+
+/**
+ * @brief Trie of host names keyed by their labels in reverse order.
+ *
+ * "accounts.google.com" is stored under com -> google -> accounts, so all
+ * entries registered for a host and its parent domains lie on one path and
+ * a lookup costs O(label count) plus the size of the result.
+ */
+
+class WebsiteIndex {
+private:
+    /**
+     * @brief A single label of the trie.
+     */
+
+    struct Node {
+        unordered_map<string, unique_ptr<Node>> children;   /**< Child labels (subdomains). */
+        vector<uint64_t> ids;                               /**< Entries registered for exactly this host. */
+    };
+
+    Node root;      /**< Root of the trie; its children are the top-level domains. */
+
+    /**
+     * @brief Collects the ids of a node and all of its descendants.
+     */
+
+    static void collectSubtree(const Node &node, vector<uint64_t> &out);
+
+public:
+
+    // INSERT
+    /**
+     * @brief Registers an entry for a normalized host.
+     * @param host Host as returned by normalizeWebsite; empty hosts are ignored.
+     * @param id Identifier of the password entry.
+     */
+
+    void insert(const string &host, uint64_t id);
+
+    // REMOVE
+    /**
+     * @brief Unregisters an entry from a normalized host, pruning empty labels.
+     * @param host Host the entry was inserted with.
+     * @param id Identifier of the password entry.
+     */
+
+    void remove(const string &host, uint64_t id);
+
+    // LOOKUP
+    /**
+     * @brief Finds the entries that belong to a host.
+     *
+     * Entries registered for the host itself and for each of its parent domains
+     * are returned, except for a bare top-level domain such as "com".
+     * With includeSubdomains, entries registered below the host are returned as well.
+     *
+     * @param host Normalized host to look up.
+     * @param includeSubdomains Whether to include entries of subdomains of the host.
+     * @return Identifiers of the matching entries, parent domains first.
+     */
+
+    vector<uint64_t> lookup(const string &host, bool includeSubdomains = false) const;
+
+    // CLEAR
+    /**
+     * @brief Removes every entry from the index.
+     */
+
+    void clear();
+};
+
+#endif //PASSWORDMANAGER_WEBSITEINDEX_H
@@ -0,0 +1,199 @@
+/**
+ * @file Wordlist.cpp
+ * @brief Implementation of memory-mapped wordlists and passphrase generation.
+ */
+
+#include "Wordlist.h"
+#include "MappedFile.h"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+using namespace std;
+
+namespace {
+
+/**
+ * @brief Checks for the whitespace that may surround a word.
+ */
+
+bool isBlank(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+} // namespace
+
+/**
+ * @brief Destructor.
+ * Unmaps the file.
+ */
+
+Wordlist::~Wordlist() {
+    close();
+}
+
+// OPEN
+/**
+     * @brief Maps the file and indexes its words.
+     * @param path Path of the file.
+     * @return True if the list is usable.
+     */
+
+bool Wordlist::open(const string& path) {
+    close();
+    size_t size = 0;
+    const char* view = mapFile(path, size);
+    if (!view) {
+        return false;
+    }
+    if (size > UINT32_MAX) {
+        // Word offsets are 32-bit; no real wordlist comes near 4 GiB
+        unmapFile(view, size);
+        return false;
+    }
+
+    text = view;
+    textSize = size;
+    source = path;
+    indexWords();
+    if (words.size() < 2) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+/**
+     * @brief Finds the word of each line, then sorts the table to drop duplicates.
+     */
+
+void Wordlist::indexWords() {
+    words.clear();
+    const char* end = text + textSize;
+    for (const char* line = text; line < end;) {
+        const char* lineEnd = static_cast<const char*>(memchr(line, '\n', static_cast<size_t>(end - line)));
+        if (!lineEnd) {
+            lineEnd = end;
+        }
+
+        const char* first = line;
+        while (first < lineEnd && isBlank(*first)) {
+            first++;
+        }
+        // Dice numbers in front of the word, as in "11111<tab>abacus"
+        const char* digits = first;
+        while (digits < lineEnd && *digits >= '0' && *digits <= '9') {
+            digits++;
+        }
+        if (digits > first && digits < lineEnd && isBlank(*digits)) {
+            first = digits;
+            while (first < lineEnd && isBlank(*first)) {
+                first++;
+            }
+        }
+        const char* last = lineEnd;
+        while (last > first && isBlank(last[-1])) {
+            last--;
+        }
+
+        if (last > first) {
+            words.push_back({static_cast<uint32_t>(first - text), static_cast<uint32_t>(last - first)});
+        }
+        line = lineEnd + 1;
+    }
+
+    auto wordOf = [this](const WordSpan& span) {
+        return string_view(text + span.offset, span.length);
+    };
+    auto before = [&](const WordSpan& a, const WordSpan& b) {
+        return wordOf(a) < wordOf(b);
+    };
+    // Published lists are already in alphabetical order
+    if (!is_sorted(words.begin(), words.end(), before)) {
+        sort(words.begin(), words.end(), before);
+    }
+    words.erase(unique(words.begin(), words.end(), [&](const WordSpan& a, const WordSpan& b) {
+        return wordOf(a) == wordOf(b);
+    }), words.end());
+    words.shrink_to_fit();
+}
+
+/**
+     * @brief Unmaps the file and forgets its words.
+     */
+
+void Wordlist::close() {
+    if (text) {
+        unmapFile(text, textSize);
+    }
+    text = nullptr;
+    textSize = 0;
+    words.clear();
+    source.clear();
+}
+
+/**
+     * @brief Gets the path of the open file.
+     * @return The path.
+     */
+
+const string& Wordlist::path() const {
+    return source;
+}
+
+// WORDS
+/**
+     * @brief Gets the number of distinct words.
+     * @return The number of words.
+     */
+
+size_t Wordlist::size() const {
+    return words.size();
+}
+
+/**
+     * @brief Gets the entropy of a passphrase of the given number of words.
+     * @param wordCount Number of words.
+     * @return Bits of entropy.
+     */
+
+double Wordlist::entropyBits(size_t wordCount) const {
+    return words.empty() ? 0 : static_cast<double>(wordCount) * log2(static_cast<double>(words.size()));
+}
+
+// GENERATE PASSPHRASE
+/**
+     * @brief Draws the words, then writes them and the separators into one buffer.
+     * @param random Source of randomness.
+     * @param wordlist The wordlist.
+     * @param wordCount Number of words.
+     * @param separator Text between two words.
+     * @return The passphrase.
+     */
+
+SecretText generatePassphrase(SecureRandom& random, const Wordlist& wordlist, size_t wordCount,
+                              string_view separator) {
+    SecretText passphrase;
+    if (wordlist.size() == 0 || wordCount == 0) {
+        return passphrase;
+    }
+
+    // The chosen indexes say which words the passphrase holds, so they are wiped too
+    SecretText chosen;
+    chosen.resize(wordCount * sizeof(uint32_t));
+    uint32_t* indexes = reinterpret_cast<uint32_t*>(chosen.data());
+    size_t length = (wordCount - 1) * separator.size();
+    for (size_t i = 0; i < wordCount; i++) {
+        indexes[i] = random.uniform(static_cast<uint32_t>(wordlist.size()));
+        length += wordlist.word(indexes[i]).size();
+    }
+
+    passphrase.reserve(length);
+    for (size_t i = 0; i < wordCount; i++) {
+        if (i > 0) {
+            passphrase.append(separator);
+        }
+        passphrase.append(wordlist.word(indexes[i]));
+    }
+    return passphrase;
+}
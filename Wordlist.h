@@ -0,0 +1,138 @@
+#ifndef PASSWORDMANAGER_WORDLIST_H
+#define PASSWORDMANAGER_WORDLIST_H
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "PasswordGenerator.h"
+using namespace std;
+
+/**
+ * @file Wordlist.h
+ * @brief Memory-mapped wordlists and diceware passphrase generation.
+ */
+
+/**
+ * @brief Name of the wordlist file used when none is given.
+ */
+
+const string defaultWordlistFile = "wordlist.txt";
+
+/**
+ * @brief A wordlist file mapped into memory, with the position of every distinct word.
+ *
+ * The file holds one word per line. Lines may start with diceware dice
+ * numbers ("11111<tab>abacus", as in the EFF lists), which are skipped, and
+ * blank lines are ignored. Opening the list maps the file read-only and
+ * records where each word starts and how long it is: the words themselves
+ * are never copied, so a 7776-word list costs one mapping and one 62 KiB
+ * table. Duplicate words are dropped, which keeps the reported entropy
+ * exact.
+ */
+
+class Wordlist {
+private:
+    /**
+     * @brief Position of a word in the mapped file.
+     */
+
+    struct WordSpan {
+        uint32_t offset;    /**< First byte of the word. */
+        uint32_t length;    /**< Number of bytes. */
+    };
+
+    const char *text = nullptr;     /**< The mapped file. */
+    size_t textSize = 0;            /**< Bytes mapped. */
+    vector<WordSpan> words;         /**< Distinct words, in byte order. */
+    string source;                  /**< Path of the mapped file. */
+
+    /**
+     * @brief Records the position of every distinct word of the mapped file.
+     */
+
+    void indexWords();
+
+public:
+    /**
+     * @brief Constructor for Wordlist class; no file is open.
+     */
+
+    Wordlist() = default;
+
+    /**
+     * @brief Destructor; unmaps the file.
+     */
+
+    ~Wordlist();
+
+    Wordlist(const Wordlist &) = delete;
+    Wordlist &operator=(const Wordlist &) = delete;
+
+    // OPEN
+    /**
+     * @brief Maps a wordlist file, replacing the one open before.
+     * @param path Path of the file.
+     * @return True if the file could be mapped and holds at least two distinct words.
+     */
+
+    bool open(const string &path);
+
+    /**
+     * @brief Unmaps the file; the list becomes empty.
+     */
+
+    void close();
+
+    /**
+     * @brief Gets the path of the open file.
+     * @return The path; empty if no file is open.
+     */
+
+    const string &path() const;
+
+    // WORDS
+    /**
+     * @brief Gets the number of distinct words.
+     * @return The number of words.
+     */
+
+    size_t size() const;
+
+    /**
+     * @brief Gets a word without copying it.
+     * @param index Index of the word, below size().
+     * @return A view into the mapped file.
+     */
+
+    string_view word(size_t index) const {
+        return string_view(text + words[index].offset, words[index].length);
+    }
+
+    /**
+     * @brief Gets the entropy of a passphrase drawn from the list.
+     * @param wordCount Number of words in the passphrase.
+     * @return Bits of entropy: wordCount * log2(size()).
+     */
+
+    double entropyBits(size_t wordCount) const;
+};
+
+/**
+ * @brief Generates a passphrase of words drawn uniformly and independently from a wordlist.
+ *
+ * The words are chosen first and the passphrase is written into a single
+ * buffer of the final length, so no word is ever copied to a temporary.
+ *
+ * @param random Source of randomness.
+ * @param wordlist The wordlist.
+ * @param wordCount Number of words.
+ * @param separator Text between two words.
+ * @return The passphrase; empty if the wordlist is empty.
+ */
+
+SecretText generatePassphrase(SecureRandom &random, const Wordlist &wordlist, size_t wordCount,
+                              string_view separator = " ");
+
+#endif //PASSWORDMANAGER_WORDLIST_H
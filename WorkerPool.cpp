@@ -0,0 +1,123 @@
+/**
+ * @file WorkerPool.cpp
+ * @brief Implementation of the worker thread pool.
+ */
+
+#include "WorkerPool.h"
+#include <algorithm>
+using namespace std;
+
+/**
+     * @brief Constructor.
+     * Starts threads - 1 workers; the caller of parallelFor is the remaining one.
+     * @param threads Total number of threads; 0 uses every hardware thread.
+     */
+
+WorkerPool::WorkerPool(unsigned threads) {
+    if (threads == 0) {
+        threads = max(1u, thread::hardware_concurrency());
+    }
+    for (unsigned i = 1; i < threads; i++) {
+        workers.emplace_back(&WorkerPool::workerLoop, this);
+    }
+}
+
+/**
+ * @brief Destructor.
+ * Wakes and joins every worker.
+ */
+
+WorkerPool::~WorkerPool() {
+    {
+        lock_guard<mutex> guard(stateLock);
+        stopping = true;
+    }
+    wake.notify_all();
+    for (thread& worker : workers) {
+        worker.join();
+    }
+}
+
+// SIZE
+/**
+     * @brief Gets the number of threads including the caller.
+     * @return The thread count.
+     */
+
+unsigned WorkerPool::size() const {
+    return static_cast<unsigned>(workers.size() + 1);
+}
+
+// PARALLEL FOR
+/**
+     * @brief Runs a chunked loop on every thread of the pool.
+     * @param count Number of items.
+     * @param chunk Number of items per chunk.
+     * @param body Function called with the bounds of each chunk.
+     */
+
+void WorkerPool::parallelFor(size_t count, size_t chunk, const function<void(size_t, size_t)>& body) {
+    chunk = max<size_t>(chunk, 1);
+    if (workers.empty() || count <= chunk) {
+        if (count > 0) {
+            body(0, count);
+        }
+        return;
+    }
+
+    lock_guard<mutex> call(callLock);
+    {
+        lock_guard<mutex> guard(stateLock);
+        job = &body;
+        jobCount = count;
+        jobChunk = chunk;
+        nextIndex = 0;
+        busyWorkers = workers.size();
+        jobGeneration++;
+    }
+    wake.notify_all();
+
+    runChunks();
+
+    unique_lock<mutex> guard(stateLock);
+    finished.wait(guard, [this] { return busyWorkers == 0; });
+    job = nullptr;
+}
+
+/**
+     * @brief Waits for jobs and runs their chunks until the pool stops.
+     */
+
+void WorkerPool::workerLoop() {
+    uint64_t seenGeneration = 0;
+    while (true) {
+        unique_lock<mutex> guard(stateLock);
+        wake.wait(guard, [&] { return stopping || jobGeneration != seenGeneration; });
+        if (stopping) {
+            return;
+        }
+        seenGeneration = jobGeneration;
+        guard.unlock();
+
+        runChunks();
+
+        guard.lock();
+        if (--busyWorkers == 0) {
+            finished.notify_all();
+        }
+    }
+}
+
+/**
+     * @brief Claims chunks of the current job until every item has been handed out.
+     */
+
+void WorkerPool::runChunks() {
+    while (true) {
+        size_t begin = nextIndex.fetch_add(jobChunk);
+        if (begin >= jobCount) {
+            return;
+        }
+        (*job)(begin, min(begin + jobChunk, jobCount));
+    }
+}
@@ -0,0 +1,91 @@
+#ifndef PASSWORDMANAGER_WORKERPOOL_H
+#define PASSWORDMANAGER_WORKERPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+using namespace std;
+
+/**
+ * @file WorkerPool.h
+ * @brief Fixed-size pool of worker threads for chunked data-parallel loops.
+ */
+
+/**
+ * @brief A pool of long-lived threads that run parallel loops in chunks.
+ *
+ * The calling thread takes part in every loop, so a pool of size n starts
+ * n - 1 threads. Chunks are handed out dynamically, so uneven work per item
+ * still balances across the threads.
+ */
+
+class WorkerPool {
+private:
+    vector<thread> workers;                             /**< Threads besides the caller. */
+    mutex stateLock;                                    /**< Guards the job fields below. */
+    mutex callLock;                                     /**< Serializes parallelFor calls. */
+    condition_variable wake;                            /**< Signals a new job or shutdown. */
+    condition_variable finished;                        /**< Signals that all workers left the job. */
+    const function<void(size_t, size_t)> *job = nullptr;   /**< Body of the current loop. */
+    size_t jobCount = 0;                                /**< Number of items of the current loop. */
+    size_t jobChunk = 1;                                /**< Items per chunk of the current loop. */
+    atomic<size_t> nextIndex{0};                        /**< First item not yet handed out. */
+    size_t busyWorkers = 0;                             /**< Workers still inside the current job. */
+    uint64_t jobGeneration = 0;                         /**< Incremented for every job. */
+    bool stopping = false;                              /**< Set when the pool shuts down. */
+
+    /**
+     * @brief Main loop of a worker thread.
+     */
+
+    void workerLoop();
+
+    /**
+     * @brief Runs chunks of the current job until none are left.
+     */
+
+    void runChunks();
+
+public:
+
+    /**
+     * @brief Constructor for WorkerPool class.
+     * @param threads Total number of threads including the caller; 0 uses every hardware thread.
+     */
+
+    explicit WorkerPool(unsigned threads = 0);
+
+    /**
+     * @brief Destructor; stops and joins the workers.
+     */
+
+    ~WorkerPool();
+
+    WorkerPool(const WorkerPool &) = delete;
+    WorkerPool &operator=(const WorkerPool &) = delete;
+
+    // SIZE
+    /**
+     * @brief Gets the number of threads that run a loop, including the caller.
+     * @return The thread count.
+     */
+
+    unsigned size() const;
+
+    // PARALLEL FOR
+    /**
+     * @brief Runs body(begin, end) over [0, count) in chunks on all threads and waits for it.
+     * @param count Number of items.
+     * @param chunk Number of items per chunk.
+     * @param body Function called with the bounds of each chunk.
+     */
+
+    void parallelFor(size_t count, size_t chunk, const function<void(size_t, size_t)> &body);
+};
+
+#endif //PASSWORDMANAGER_WORKERPOOL_H
@@ -4,6 +4,9 @@
  */
 
 #include "DataStorage.h"
+#include "StrengthEstimator.h"
+#include <chrono>
+#include <cmath>
 #include <iostream>
 #include <string>
 #define COLOR_MENU "\033[1;35m"
@@ -22,37 +25,45 @@ enum class PasswordStrength {
 PasswordKeeper keeper;                      ///< Instance of the PasswordKeeper class to manage passwords
 string name, category, website, login;      ///< Variables to store user input
 int length, option;                         ///< Variables to store user input
-bool useUpper, useLower, useSpecial;        ///< Variables to store user input
+bool useUpper, useLower, useDigits, useSpecial, excludeAmbiguous;  ///< Variables to store user input
 
 /**
  * @brief Checks the strength of a password.
  *
- * @param password The password to check.
+ * Weak passwords fall to fewer than a million guesses by an attacker who
+ * tries common passwords, words, keyboard walks and dates first (see
+ * estimateStrength); strong ones need more than ten billion.
+ *
+ * @param estimate The estimate of the password.
  * @return The strength of the password as a PasswordStrength enum value.
  */
 
-PasswordStrength checkPasswordStrength(const string& password) {
-    if (password.length() >= 6) {
-        bool hasUppercase = false;
-        bool hasLowercase = false;
-        bool hasNumber = false;
-
-        for (char c : password) {
-            if (isupper(c)) {
-                hasUppercase = true;
-            } else if (islower(c)) {
-                hasLowercase = true;
-            } else if (isdigit(c)) {
-                hasNumber = true;
-            }
-        }
-        if (hasUppercase && (hasLowercase || hasNumber)) {
-            return PasswordStrength::Strong;
-        } else {
-            return PasswordStrength::Moderate;
-        }
-    } else {
+PasswordStrength checkPasswordStrength(const StrengthEstimate& estimate) {
+    if (estimate.score <= 1) {
         return PasswordStrength::Weak;
+    } else if (estimate.score <= 3) {
+        return PasswordStrength::Moderate;
+    } else {
+        return PasswordStrength::Strong;
+    }
+}
+
+/**
+ * @brief Prints how many guesses a password needs and the patterns that make it guessable.
+ *
+ * @param estimate The estimate of the password.
+ */
+
+void printStrengthDetails(const StrengthEstimate& estimate) {
+    cout << "Estimated Guesses: 10^" << round(estimate.guessesLog10 * 10) / 10 << " ("
+         << round(estimate.entropyBits()) << " Bits)" << endl;
+    vector<string> warnings;
+    for (const PatternMatch& match : estimate.sequence) {
+        string warning = describePattern(match);
+        if (!warning.empty() && find(warnings.begin(), warnings.end(), warning) == warnings.end()) {
+            warnings.push_back(warning);
+            cout << "Warning: " << warning << "." << endl;
+        }
     }
 }
 
@@ -72,7 +83,9 @@ void displayMainMenu() {
     cout << "| (7) Delete Category                  |" << endl;
     cout << "| (8) Encrypt All Passwords            |" << endl;
     cout << "| (9) Decrypt All Passwords            |" << endl;
-    cout << "| (10) Exit                            |" << endl;
+    cout << "| (10) Change Master Password          |" << endl;
+    cout << "| (11) Audit Vault                     |" << endl;
+    cout << "| (12) Exit                            |" << endl;
     cout << "|--------------------------------------|" << endl;
     cout << "=>";
 }
@@ -107,14 +120,15 @@ void addPassword() {
     getline(cin, login);
 
     do {
-        cout << "Do You Want To Generate A Password? (1: Yes, 2: No): ";
+        cout << "Do You Want To Generate A Password? (1: Yes, 2: No, 3: Generate A Passphrase): ";
         cin >> option;
-        if (option != 1 && option != 2) {
+        if (option < 1 || option > 3) {
             cout << "Invalid Option. Please Try Again." << endl;
         }
-    } while (option != 1 && option != 2);
+    } while (option < 1 || option > 3);
 
-    string password;
+    // Wiped on every return, including the early ones
+    SecretText password;
     if (option == 1) {
         cout << "Enter The Password Length: ";
         cin >> length;
@@ -125,29 +139,79 @@ void addPassword() {
         cout << "Include Lowercase Letters? (1: Yes, 0: No): ";
         cin >> useLower;
 
+        cout << "Include Digits? (1: Yes, 0: No): ";
+        cin >> useDigits;
+
         cout << "Include Special Characters? (1: Yes, 0: No): ";
         cin >> useSpecial;
 
-        if (useUpper == 0 && useLower == 0 && useSpecial == 0) {
-            cout << "Error: At Least One Option (Uppercase, Lowercase, Special Characters) "
+        cout << "Exclude Ambiguous Characters Such As 0, O, 1 And l? (1: Yes, 0: No): ";
+        cin >> excludeAmbiguous;
+
+        if (!useUpper && !useLower && !useDigits && !useSpecial) {
+            cout << "Error: At Least One Option (Uppercase, Lowercase, Digits, Special Characters) "
                  << "Must Be Selected For Password Generation." << endl;
             return;
         }
 
-        if ((useUpper + useLower + useSpecial) > length) {
-            cout << "Error: The Sum Of 'Use Uppercase', 'Use Lowercase', And 'Use Special Characters' "
-                 << "Can Not Be Greater Than The Password Length." << endl;
+        // Every selected type contributes at least one character
+        PasswordPolicy policy;
+        policy.length = length > 0 ? static_cast<size_t>(length) : 0;
+        policy.excludeAmbiguous = excludeAmbiguous;
+        const pair<CharacterClass, bool> selections[] = {
+            {CharacterClass::Uppercase, useUpper},
+            {CharacterClass::Lowercase, useLower},
+            {CharacterClass::Digits, useDigits},
+            {CharacterClass::Special, useSpecial}
+        };
+        for (const auto& [characterClass, selected] : selections) {
+            if (selected) {
+                policy.include(characterClass);
+            } else {
+                policy.omit(characterClass);
+            }
+        }
+
+        if (!policy.isSatisfiable()) {
+            cout << "Error: The Password Length Must Be At Least " << policy.requiredLength()
+                 << " To Include Every Selected Character Type." << endl;
             cout << "Could Not Create Password. Please Try Again." << endl;
             return;
         }
 
-        password = keeper.generatePassword(length, useUpper, useLower, useSpecial);
+        password = keeper.generatePassword(policy);
         cout << "Generated Password: " << password << endl;
+    } else if (option == 3) {
+        cout << "Enter The Number Of Words: ";
+        cin >> length;
+
+        string wordlistPath;
+        cout << "Enter The Wordlist File (Leave Blank For " << defaultWordlistFile << "): ";
+        cin.ignore();
+        getline(cin, wordlistPath);
+
+        if (length <= 0) {
+            cout << "Error: The Number Of Words Must Be Greater Than Zero." << endl;
+            return;
+        }
+
+        password = keeper.generatePassphrase(length, wordlistPath.empty() ? defaultWordlistFile : wordlistPath);
+        if (password.empty()) {
+            cout << "Could Not Create Passphrase. Please Try Again." << endl;
+            return;
+        }
+        const Wordlist& wordlist = keeper.getWordlist();
+        cout << "Generated Passphrase: " << password << endl;
+        cout << "Entropy: " << round(wordlist.entropyBits(length) * 10) / 10 << " Bits (" << length
+             << " Words From A List Of " << wordlist.size() << ")" << endl;
     } else {
         while (true) {
+            string typed;
             cout << "Enter The Password: ";
             cin.ignore();
-            getline(cin, password);
+            getline(cin, typed);
+            password = typed;
+            secureZero(typed.data(), typed.size());
             if (!password.empty()) {
                 break;
             }
@@ -159,7 +223,7 @@ void addPassword() {
     bool hasLowercase = false;
     bool hasNumber = false;
 
-    for (char c : password) {
+    for (char c : string_view(password)) {
         if (isupper(c)) {
             hasUppercase = true;
         } else if (islower(c)) {
@@ -169,11 +233,18 @@ void addPassword() {
         }
     }
 
-    PasswordStrength strength = checkPasswordStrength(password);
+    StrengthEstimate estimate = estimateStrength(password);
+    PasswordStrength strength = checkPasswordStrength(estimate);
+    // Breached passwords are tried first, however unguessable they look
+    if (keeper.isBreached(password)) {
+        cout << "Warning: This Password Appears In A Known Data Breach!" << endl;
+        strength = PasswordStrength::Weak;
+    }
 
     cout << "Password Strength: ";
     if (strength == PasswordStrength::Weak) {
         cout << "Weak" << endl;
+        printStrengthDetails(estimate);
         cout << "Your Password Is Weak. Do You Want To Continue? (y/n): ";
         char choice;
         cin >> choice;
@@ -185,20 +256,17 @@ void addPassword() {
         cout << "Password Added Successfully!" << endl;
     } else if (strength == PasswordStrength::Moderate) {
         cout << "Moderate" << endl;
+        printStrengthDetails(estimate);
     } else if (strength == PasswordStrength::Strong) {
         cout << "Strong" << endl;
+        printStrengthDetails(estimate);
     }
 
     system("pause");
 
-    KeyData entry;
-    entry.name = name;
-    entry.password = password;
-    entry.category = category;
-    entry.website = website;
-    entry.login = login;
-
-    keeper.addPassword(name, password, category, website, login);
+    string plaintext(password);
+    keeper.addPassword(name, plaintext, category, website, login);
+    secureZero(plaintext.data(), plaintext.size());
     cout << "Password Added Successfully!" << endl;
 }
 
@@ -253,7 +321,9 @@ void searchPassword() {
     cout << "Search For:\n";
     cout << "1. Password\n";
     cout << "2. Category\n";
-    cout << "Enter Your Choice (1-2): ";
+    cout << "3. Website\n";
+    cout << "4. Changed In The Last N Days\n";
+    cout << "Enter Your Choice (1-4): ";
     cin >> option;
 
     if (option == 1) {
@@ -270,7 +340,7 @@ void searchPassword() {
             cout << "Found " << results.size() << " Password(s) Matching The Query:\n";
             for (const auto& entry : results) {
                 cout << "Name: " << entry.name << endl;
-                cout << "Password: " << entry.password << endl;
+                cout << "Password: " << keeper.revealPassword(entry) << endl;
                 cout << "Category: " << entry.category << endl;
                 cout << "Website: " << entry.website << endl;
                 cout << "Login: " << entry.login << endl;
@@ -296,13 +366,60 @@ void searchPassword() {
             cout << "Found " << results.size() << " Password(s) In The Category:\n";
             for (const auto& entry : results) {
                 cout << "Name: " << entry.name << endl;
-                cout << "Password: " << entry.password << endl;
+                cout << "Password: " << keeper.revealPassword(entry) << endl;
+                cout << "Category: " << entry.category << endl;
+                cout << "Website: " << entry.website << endl;
+                cout << "Login: " << entry.login << endl;
+                cout << "----------\n";
+            }
+        }
+    } else if (option == 3) {
+        string query;
+        cin.ignore();
+        cout << "Enter The Website Or URL: ";
+        getline(cin, query);
+
+        vector<KeyData> results = keeper.findByWebsite(query);
+
+        if (results.empty()) {
+            cout << "No Passwords Found For The Website.\n";
+        } else {
+            cout << "Found " << results.size() << " Password(s) For The Website:\n";
+            for (const auto& entry : results) {
+                cout << "Name: " << entry.name << endl;
+                cout << "Password: " << keeper.revealPassword(entry) << endl;
                 cout << "Category: " << entry.category << endl;
                 cout << "Website: " << entry.website << endl;
                 cout << "Login: " << entry.login << endl;
                 cout << "----------\n";
             }
         }
+    } else if (option == 4) {
+        int days;
+        cout << "Enter The Number Of Days: ";
+        cin >> days;
+
+        time_t now = time(nullptr);
+        vector<KeyData> results = keeper.getPasswordsModifiedBetween(now - static_cast<int64_t>(days) * 86400, now);
+
+        if (results.empty()) {
+            cout << "No Passwords Changed In The Last " << days << " Day(s).\n";
+        } else {
+            cout << "Found " << results.size() << " Password(s) Changed In The Last " << days << " Day(s):\n";
+            for (auto it = results.rbegin(); it != results.rend(); ++it) {
+                time_t modified = static_cast<time_t>(it->modified);
+                char timestamp[20];
+                strftime(timestamp, sizeof(timestamp), "%d/%m/%Y %H:%M:%S", localtime(&modified));
+
+                cout << "Name: " << it->name << endl;
+                cout << "Password: " << keeper.revealPassword(*it) << endl;
+                cout << "Category: " << it->category << endl;
+                cout << "Website: " << it->website << endl;
+                cout << "Login: " << it->login << endl;
+                cout << "Modified: " << timestamp << endl;
+                cout << "----------\n";
+            }
+        }
     } else {
         cout << "Invalid Choice.\n";
     }
@@ -314,15 +431,55 @@ void searchPassword() {
 
 void sortPasswords() {
     string sortBy;
-    cout << "Enter The Sorting Criteria (name Or category): ";
+    vector<SortKey> keys;
+    cout << "Enter The Sorting Criteria (name, category, website, login, created, modified; e.g. category,modified:desc): ";
     cin >> sortBy;
 
-    if (sortBy == "name" || sortBy == "category") {
-        keeper.sortPasswords(sortBy);
-        cout << "Passwords Sorted Successfully!\n";
-    } else {
+    if (!parseSortKeys(sortBy, keys)) {
         cout << "Invalid Sorting Criteria. Please Try Again.\n";
+        system("pause");
+        return;
+    }
+
+    int pageSize;
+    cout << "Enter The Number Of Passwords Per Page: ";
+    cin >> pageSize;
+    if (pageSize <= 0) {
+        cout << "Invalid Page Size. Please Try Again.\n";
+        system("pause");
+        return;
+    }
+
+    // Fetch one entry more than the page holds to learn whether another page follows
+    cout << "Sorted Passwords:\n";
+    for (size_t offset = 0;; offset += pageSize) {
+        vector<KeyData> page = keeper.getSortedPasswords(keys, offset, pageSize + 1);
+        bool hasMore = page.size() > static_cast<size_t>(pageSize);
+        if (hasMore) {
+            page.pop_back();
+        }
+
+        for (const auto& entry : page) {
+            cout << "Name: " << entry.name << '\n'
+                 << "Password: " << keeper.revealPassword(entry) << '\n'
+                 << "Category: " << entry.category << '\n'
+                 << "Website: " << entry.website << '\n'
+                 << "Login: " << entry.login << '\n'
+                 << "----------\n";
+        }
+        cout.flush();
+
+        if (!hasMore) {
+            break;
+        }
+        char choice;
+        cout << "Show The Next Page? (y/n): ";
+        cin >> choice;
+        if (tolower(choice) != 'y') {
+            break;
+        }
     }
+    cout << "Passwords Sorted Successfully!\n";
     system("pause");
 
 }
@@ -351,6 +508,80 @@ void deleteCategory() {
     cout << "Category Deleted Successfully!" << endl;
 }
 
+/**
+ * @brief Changes the master password and re-encrypts the vault under the new key.
+ */
+
+void changeMasterPassword() {
+    string currentPassword, newPassword, confirmation;
+    cin.ignore();
+    cout << "Enter The Current Master Password: ";
+    getline(cin, currentPassword);
+    cout << "Enter The New Master Password: ";
+    getline(cin, newPassword);
+    cout << "Confirm The New Master Password: ";
+    getline(cin, confirmation);
+
+    if (newPassword != confirmation) {
+        cout << "The Passwords Do Not Match.\n";
+    } else {
+        keeper.changeMasterPassword(currentPassword, newPassword);
+    }
+    secureZero(currentPassword.data(), currentPassword.size());
+    secureZero(newPassword.data(), newPassword.size());
+    secureZero(confirmation.data(), confirmation.size());
+}
+
+/**
+ * @brief Audits the whole vault and prints the issues found, by category.
+ */
+
+void auditVault() {
+    const size_t shownPerCategory = 10;
+    AuditOptions options;
+    auto start = chrono::steady_clock::now();
+    AuditReport report = keeper.auditVault(options);
+    double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+    cout << "Audited " << report.entries << " Entries In " << round(seconds * 100) / 100 << " Seconds."
+         << endl;
+    if (report.unreadable > 0) {
+        cout << "Warning: " << report.unreadable << " Passwords Could Not Be Decrypted." << endl;
+    }
+    for (size_t issue = 0; issue < auditIssueCount; issue++) {
+        cout << describeIssue(static_cast<AuditIssue>(issue)) << ": " << report.counts[issue];
+        cout << (issue + 1 < auditIssueCount ? " | " : "\n");
+    }
+    cout << "Reused Passwords: " << report.reuseGroups << " | Groups Of Similar Passwords: " << report.similarGroups
+         << " | Stale Means Unchanged For " << options.staleAfterDays << " Days" << endl;
+
+    for (const CategoryAudit& category : report.categories) {
+        cout << endl << "Category: " << (category.category.empty() ? "(None)" : category.category) << " ("
+             << category.entries << " Entries, " << category.findings.size() << " With Issues)" << endl;
+        for (size_t i = 0; i < category.findings.size() && i < shownPerCategory; i++) {
+            const AuditFinding& finding = category.findings[i];
+            cout << "  " << finding.name << ": ";
+            bool first = true;
+            for (size_t issue = 0; issue < auditIssueCount; issue++) {
+                if (!finding.has(static_cast<AuditIssue>(issue))) {
+                    continue;
+                }
+                cout << (first ? "" : ", ") << describeIssue(static_cast<AuditIssue>(issue));
+                if (issue == static_cast<size_t>(AuditIssue::Reused)) {
+                    cout << " (Group " << finding.reuseGroup << ")";
+                } else if (issue == static_cast<size_t>(AuditIssue::NearDuplicate)) {
+                    cout << " (Group " << finding.similarGroup << ")";
+                }
+                first = false;
+            }
+            cout << endl;
+        }
+        if (category.findings.size() > shownPerCategory) {
+            cout << "  ... And " << category.findings.size() - shownPerCategory << " More" << endl;
+        }
+    }
+}
+
 /**
  * @brief Calls functions from options in the menu.
  */
@@ -388,11 +619,61 @@ void processMenuSelection(int selection) {
             system("pause");
             break;
         case 10:
+            changeMasterPassword();
+            system("pause");
+            break;
+        case 11:
+            auditVault();
+            system("pause");
+            break;
+        case 12:
             cout << "You Logged Out!" << endl;
             exit(0);
         default:
-            cout << "Invalid Choice. Please try again. (1-10)" << endl;
+            cout << "Invalid Choice. Please try again. (1-12)" << endl;
+    }
+}
+
+/**
+ * @brief Asks for the master password and unlocks the vault, or sets the master password of a new vault.
+ *
+ * @return True once the vault is unlocked; false after three wrong attempts.
+ */
+
+bool unlockVault() {
+    string masterPassword;
+
+    if (!keeper.hasMasterPassword()) {
+        while (true) {
+            string confirmation;
+            cout << "Choose A Master Password: ";
+            getline(cin, masterPassword);
+            cout << "Confirm The Master Password: ";
+            getline(cin, confirmation);
+            if (!cin) {
+                return false;
+            }
+            if (masterPassword == confirmation && keeper.unlock(masterPassword)) {
+                secureZero(masterPassword.data(), masterPassword.size());
+                secureZero(confirmation.data(), confirmation.size());
+                return true;
+            }
+            if (masterPassword != confirmation) {
+                cout << "The Passwords Do Not Match. Please Try Again.\n";
+            }
+        }
+    }
+
+    for (int attempt = 0; attempt < 3; attempt++) {
+        cout << "Enter The Master Password: ";
+        getline(cin, masterPassword);
+        bool unlocked = keeper.unlock(masterPassword);
+        secureZero(masterPassword.data(), masterPassword.size());
+        if (unlocked) {
+            return true;
+        }
     }
+    return false;
 }
 
 /**
@@ -410,11 +691,51 @@ void clearScreen() {
 /**
  * @brief The main function of the password management system.
  *
+ * Run as "PasswordManager --import-breaches <file> [corpus]" it instead
+ * converts a Pwned Passwords download, sorted by hash, into the breach
+ * corpus that new passwords are checked against.
+ *
+ * Run as "PasswordManager --import-xor-vault <file>" it decodes, once, a
+ * vault encrypted by the first version of the program (see
+ * PasswordKeeper::decodeLegacyXorPasswords).
+ *
+ * @param argc Number of arguments.
+ * @param argv Arguments.
  * @return 0 indicating successful program execution.
  */
 
-int main() {
+int main(int argc, char* argv[]) {
+    if (argc >= 3 && string(argv[1]) == "--import-breaches") {
+        string corpusPath = argc >= 4 ? argv[3] : defaultBreachCorpusFile;
+        size_t count = BreachCorpus::convert(argv[2], corpusPath);
+        if (count == 0) {
+            return 1;
+        }
+        cout << "Imported " << count << " Breached Password Hashes Into " << corpusPath << "." << endl;
+        return 0;
+    }
+
+    if (argc >= 3 && string(argv[1]) == "--import-xor-vault") {
+        if (!ifstream(argv[2])) {
+            cerr << "Error: Unable To Open The Vault File " << argv[2] << "!" << endl;
+            return 1;
+        }
+        PasswordKeeper legacyVault(argv[2]);
+        bool upgraded = legacyVault.hasMasterPassword();
+        size_t count = legacyVault.decodeLegacyXorPasswords();
+        if (upgraded) {
+            return 1;
+        }
+        cout << "Decoded " << count << " Passwords In " << argv[2]
+             << ". Open The Vault To Set A Master Password, Then Encrypt It." << endl;
+        return 0;
+    }
+
     keeper.selectSourceFile();
+    if (!unlockVault()) {
+        cout << "Too Many Wrong Attempts. Exiting." << endl;
+        return 1;
+    }
     int selection;
 
     while (true) {